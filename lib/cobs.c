@@ -0,0 +1,58 @@
+/**
+ * Source file of pico-fbw: https://github.com/pico-fbw/pico-fbw
+ * Licensed under the GNU AGPL-3.0
+ */
+
+#include "cobs.h"
+
+u32 cobs_encode(const byte *src, u32 len, byte *dst) {
+    // Each run of up to 254 non-zero bytes is prefixed with a code byte giving the distance to the next zero (which is dropped)
+    u32 out = 1, codeAt = 0;
+    byte code = 1;
+    for (u32 i = 0; i < len; i++) {
+        if (src[i] == 0) {
+            dst[codeAt] = code;
+            codeAt = out++;
+            code = 1;
+            continue;
+        }
+        dst[out++] = src[i];
+        if (++code == 0xFF) {
+            // Longest possible run, which implies no zero
+            dst[codeAt] = code;
+            codeAt = out++;
+            code = 1;
+        }
+    }
+    dst[codeAt] = code;
+    return out;
+}
+
+bool cobs_decode(const byte *src, u32 len, byte *dst, u32 *decodedLen) {
+    u32 in = 0, out = 0;
+    while (in < len) {
+        byte code = src[in++];
+        if (code == 0 || in + code - 1 > len)
+            return false;
+        // Decoding never writes ahead of where it reads, so this also works in place
+        for (byte i = 1; i < code; i++)
+            dst[out++] = src[in++];
+        if (code != 0xFF && in < len)
+            dst[out++] = 0;
+    }
+    *decodedLen = out;
+    return true;
+}
+
+u16 crc16_ccitt_update(u16 crc, const byte *data, u32 len) {
+    for (u32 i = 0; i < len; i++) {
+        crc ^= (u16)data[i] << 8;
+        for (u32 bit = 0; bit < 8; bit++)
+            crc = (crc & 0x8000) ? (u16)((crc << 1) ^ 0x1021) : (u16)(crc << 1);
+    }
+    return crc;
+}
+
+u16 crc16_ccitt(const byte *data, u32 len) {
+    return crc16_ccitt_update(CRC16_CCITT_INIT, data, len);
+}
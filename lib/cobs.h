@@ -0,0 +1,52 @@
+#pragma once
+
+#include <stdbool.h>
+#include "platform/types.h"
+
+// Consistent Overhead Byte Stuffing (Cheshire & Baker): encodes arbitrary data so that it contains no zero bytes, which lets
+// a zero byte delimit frames on a byte stream. A receiver that joins mid-stream (or sees garbage) resynchronizes at the next
+// zero byte.
+
+/**
+ * @param len length of the data to be encoded
+ * @return the largest possible length of the encoded data (not including any delimiter)
+ */
+#define COBS_ENCODED_MAX(len) ((len) + (len) / 254 + 1)
+
+/**
+ * Encodes data with COBS.
+ * @param src the data to encode
+ * @param len the length of the data
+ * @param dst where to store the encoded data, at least COBS_ENCODED_MAX(len) bytes long; must not overlap `src`
+ * @return the length of the encoded data
+ */
+u32 cobs_encode(const byte *src, u32 len, byte *dst);
+
+/**
+ * Decodes COBS-encoded data.
+ * @param src the encoded data (without a delimiter)
+ * @param len the length of the encoded data
+ * @param dst where to store the decoded data, at least `len` bytes long; may be the same as `src` to decode in place
+ * @param decodedLen pointer to where the length of the decoded data should be stored
+ * @return true if successful, false if the data was not valid COBS
+ */
+bool cobs_decode(const byte *src, u32 len, byte *dst, u32 *decodedLen);
+
+#define CRC16_CCITT_INIT 0xFFFF // Initial value of a CRC-16/CCITT-FALSE
+
+/**
+ * Continues a CRC-16/CCITT-FALSE over more data, so data that isn't all in memory at once can be checked piece by piece.
+ * @param crc the CRC so far (CRC16_CCITT_INIT to start a new one)
+ * @param data the data
+ * @param len the length of the data
+ * @return the CRC, including the data
+ */
+u16 crc16_ccitt_update(u16 crc, const byte *data, u32 len);
+
+/**
+ * Computes the CRC-16/CCITT-FALSE (polynomial 0x1021, initial value 0xFFFF) of some data.
+ * @param data the data
+ * @param len the length of the data
+ * @return the CRC
+ */
+u16 crc16_ccitt(const byte *data, u32 len);
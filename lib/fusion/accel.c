@@ -30,6 +30,9 @@ AccelerometerDetails accelerometers[] = {
         {0x69, 0x68},
         {.create = icm20948_acc_create,
          .read = icm20948_acc_read,
+         .read_all = icm20948_read_all,
+         .fifo_enable = icm20948_fifo_enable,
+         .fifo_read = icm20948_fifo_read,
          .get_odr = icm20948_acc_get_odr,
          .set_odr = icm20948_acc_set_odr,
          .get_scale = icm20948_acc_get_scale,
@@ -113,6 +116,12 @@ bool fusion_accelerometer_get(IMU *imu, f32 *x, f32 *y, f32 *z) {
         printfbw(aahrs, "ERROR: could not read from accelerometer");
         return false;
     }
+    return fusion_accelerometer_convert(imu, x, y, z);
+}
+
+bool fusion_accelerometer_convert(IMU *imu, f32 *x, f32 *y, f32 *z) {
+    if (!imu->acc)
+        return false;
 
     if (x)
         *x = (imu->acc->scale * imu->acc->ax) + imu->acc->offset_ax;
@@ -0,0 +1,186 @@
+/**
+ * Source file of pico-fbw: https://github.com/pico-fbw/pico-fbw
+ * Licensed under the GNU AGPL-3.0
+ */
+
+#include <math.h>
+#include <string.h>
+
+#include "deadreckon.h"
+
+#define GRAVITY 9.80665f       // m/s^2
+#define EARTH_RADIUS 6371000.0 // m
+#define PI 3.14159265358979323846
+
+#define DR_DT_MAX 0.5f            // Longest step that is integrated at once, s (longer gaps are assumed to be stalls)
+#define DR_SPEED_TIME 5.f         // Time constant with which the speed returns to the last fix's, s
+#define DR_SPEED_MIN 1.f          // Below this speed, the track is meaningless and the velocity isn't turned or scaled, m/s
+#define DR_CLIMB_GAIN 0.5f        // Weight of each new climb rate measurement
+#define DR_FIX_INTERVAL_MIN 0.05f // Fixes closer together than this don't give a usable climb rate, s
+
+static inline f32 wrap_pi(f32 a) {
+    while (a > (f32)PI)
+        a -= 2.f * (f32)PI;
+    while (a < -(f32)PI)
+        a += 2.f * (f32)PI;
+    return a;
+}
+
+/**
+ * Records the current state in the history, if it's time to.
+ * @param dr the propagator
+ * @param now the current time, us
+ */
+static void record(DeadReckoner *dr, u64 now) {
+    if (dr->historyCount > 0) {
+        const DRSample *newest = &dr->history[(dr->historyHead + DR_HISTORY - 1) % DR_HISTORY];
+        if (now - newest->time < DR_HISTORY_PERIOD_US)
+            return;
+    }
+    DRSample *s = &dr->history[dr->historyHead];
+    s->time = now;
+    memcpy(s->pos, dr->pos, sizeof(s->pos));
+    memcpy(s->vel, dr->vel, sizeof(s->vel));
+    dr->historyHead = (dr->historyHead + 1) % DR_HISTORY;
+    if (dr->historyCount < DR_HISTORY)
+        dr->historyCount++;
+}
+
+/**
+ * Finds the state at a given time.
+ * @param dr the propagator
+ * @param time the time, us
+ * @return the newest recorded state no later than `time` (or the oldest recorded state, if they are all later), or NULL if
+ * nothing has been recorded
+ */
+static DRSample *state_at(DeadReckoner *dr, u64 time) {
+    DRSample *s = NULL;
+    for (u32 i = 1; i <= dr->historyCount; i++) {
+        s = &dr->history[(dr->historyHead + DR_HISTORY - i) % DR_HISTORY];
+        if (s->time <= time)
+            break;
+    }
+    return s;
+}
+
+void dr_reset(DeadReckoner *dr) {
+    memset(dr, 0, sizeof(*dr));
+}
+
+void dr_predict(DeadReckoner *dr, u64 now, f32 yaw, f32 pitch, f32 accFwd) {
+    f32 dYaw = wrap_pi(yaw - dr->lastYaw);
+    f32 dt = (f32)(now - dr->lastUpdate) / 1E6f;
+    dr->lastYaw = yaw;
+    dr->lastUpdate = now;
+    if (!dr->hasFix || !isfinite(dYaw) || !isfinite(pitch) || !isfinite(accFwd))
+        return;
+    if (dt > DR_DT_MAX)
+        dt = DR_DT_MAX;
+
+    f32 speed = sqrtf(dr->vel[0] * dr->vel[0] + dr->vel[1] * dr->vel[1]);
+    if (speed >= DR_SPEED_MIN) {
+        // The aircraft's track follows its heading, so turn the velocity by however much the heading has changed
+        f32 c = cosf(dYaw), s = sinf(dYaw);
+        f32 n = dr->vel[0] * c - dr->vel[1] * s;
+        f32 e = dr->vel[0] * s + dr->vel[1] * c;
+        // Speed up or slow down with the acceleration along the track (the specific force, minus gravity's share of it)
+        f32 acc = (accFwd - GRAVITY * sinf(pitch)) * cosf(pitch);
+        f32 newSpeed = speed + (acc + (dr->refSpeed - speed) / DR_SPEED_TIME) * dt;
+        if (newSpeed < 0.f)
+            newSpeed = 0.f;
+        dr->vel[0] = n * (newSpeed / speed);
+        dr->vel[1] = e * (newSpeed / speed);
+    }
+    for (u32 i = 0; i < 3; i++)
+        dr->pos[i] += dr->vel[i] * dt;
+    record(dr, now);
+}
+
+void dr_fix(DeadReckoner *dr, u64 now, u64 latency, f64 lat, f64 lng, f32 alt, const f32 velNE[2]) {
+    u64 time = now > latency ? now - latency : 0;
+    f32 latSec = (f32)latency / 1E6f;
+    if (!dr->hasFix) {
+        // Start from this fix, extrapolated up to the present
+        dr->originLat = lat;
+        dr->originLng = lng;
+        dr->originAlt = alt;
+        if (velNE) {
+            dr->vel[0] = velNE[0];
+            dr->vel[1] = velNE[1];
+        }
+        dr->vel[2] = 0.f;
+        for (u32 i = 0; i < 3; i++)
+            dr->pos[i] = dr->vel[i] * latSec;
+        dr->refSpeed = sqrtf(dr->vel[0] * dr->vel[0] + dr->vel[1] * dr->vel[1]);
+        dr->lastFix = time;
+        dr->lastFixAlt = alt;
+        dr->lastUpdate = now;
+        dr->historyCount = 0;
+        dr->hasFix = true;
+        record(dr, now);
+        return;
+    }
+
+    // Climb rate from the altitude change since the last fix
+    f32 interval = (f32)(time - dr->lastFix) / 1E6f;
+    if (time > dr->lastFix && interval >= DR_FIX_INTERVAL_MIN)
+        dr->vel[2] += (-(alt - dr->lastFixAlt) / interval - dr->vel[2]) * DR_CLIMB_GAIN;
+    dr->lastFix = time;
+    dr->lastFixAlt = alt;
+
+    // Compare the fix against the state when it was measured, and apply the difference to that state and everything since
+    f32 measured[3];
+    measured[0] = (f32)((lat - dr->originLat) * (PI / 180.0) * EARTH_RADIUS);
+    measured[1] = (f32)((lng - dr->originLng) * (PI / 180.0) * EARTH_RADIUS * cos(dr->originLat * (PI / 180.0)));
+    measured[2] = -(alt - dr->originAlt);
+    const DRSample *then = state_at(dr, time);
+    f32 dPos[3], dVel[2] = {0.f, 0.f};
+    for (u32 i = 0; i < 3; i++)
+        dPos[i] = measured[i] - (then ? then->pos[i] : dr->pos[i]);
+    if (velNE) {
+        for (u32 i = 0; i < 2; i++)
+            dVel[i] = velNE[i] - (then ? then->vel[i] : dr->vel[i]);
+    }
+    for (u32 i = 0; i < 3; i++)
+        dr->pos[i] += dPos[i];
+    for (u32 i = 0; i < 2; i++)
+        dr->vel[i] += dVel[i];
+    for (u32 i = 0; i < dr->historyCount; i++) {
+        for (u32 j = 0; j < 3; j++)
+            dr->history[i].pos[j] += dPos[j];
+        for (u32 j = 0; j < 2; j++)
+            dr->history[i].vel[j] += dVel[j];
+    }
+    dr->refSpeed = velNE ? sqrtf(velNE[0] * velNE[0] + velNE[1] * velNE[1])
+                         : sqrtf(dr->vel[0] * dr->vel[0] + dr->vel[1] * dr->vel[1]);
+
+    // Move the origin to the present position, so positions stay small enough to be precise as single-precision floats
+    dr->originLng += (dr->pos[1] / (EARTH_RADIUS * cos(dr->originLat * (PI / 180.0)))) * (180.0 / PI);
+    dr->originLat += (dr->pos[0] / EARTH_RADIUS) * (180.0 / PI);
+    dr->originAlt -= dr->pos[2];
+    for (u32 i = 0; i < dr->historyCount; i++) {
+        for (u32 j = 0; j < 3; j++)
+            dr->history[i].pos[j] -= dr->pos[j];
+    }
+    memset(dr->pos, 0, sizeof(dr->pos));
+}
+
+bool dr_get(const DeadReckoner *dr, f64 *lat, f64 *lng, f32 *alt, f32 vel[3]) {
+    if (!dr->hasFix)
+        return false;
+    if (lat)
+        *lat = dr->originLat + (dr->pos[0] / EARTH_RADIUS) * (180.0 / PI);
+    if (lng)
+        *lng = dr->originLng + (dr->pos[1] / (EARTH_RADIUS * cos(dr->originLat * (PI / 180.0)))) * (180.0 / PI);
+    if (alt)
+        *alt = dr->originAlt - dr->pos[2];
+    if (vel)
+        memcpy(vel, dr->vel, sizeof(dr->vel));
+    return true;
+}
+
+f32 dr_fix_age(const DeadReckoner *dr, u64 now) {
+    if (!dr->hasFix)
+        return INFINITY;
+    return now > dr->lastFix ? (f32)(now - dr->lastFix) / 1E6f : 0.f;
+}
@@ -0,0 +1,82 @@
+#pragma once
+
+#include <stdbool.h>
+#include "platform/types.h"
+
+// Position and velocity propagator that fills in between GPS fixes (and carries on for a while without them).
+// Between fixes, the horizontal velocity is turned with the estimated heading and sped up or slowed down by the acceleration
+// along the body's X axis (with the speed slowly pulled back towards the last fix's), and the vertical velocity is the climb
+// rate seen between the last two fixes. Fixes are compensated for the GPS's latency: past states are kept for a while, and
+// each fix corrects the state from the time it was actually measured at, with the correction carried forward to the present.
+// Works on any estimator's attitude, as only the heading's changes (not its absolute value) are used.
+// Frames: the navigation frame is north, east, down (NED), with its origin moved to the latest fix. SI units throughout.
+
+#define DR_HISTORY 64              // Number of past states kept for latency compensation
+#define DR_HISTORY_PERIOD_US 10000 // Time between past states (so latencies of up to 640ms are compensated for)
+
+typedef struct DRSample {
+    u64 time;   // us
+    f32 pos[3]; // m
+    f32 vel[3]; // m/s
+} DRSample;
+
+typedef struct DeadReckoner {
+    f64 originLat, originLng; // deg
+    f32 originAlt;            // MSL, m
+    f32 pos[3];               // Position relative to the origin, NED, m
+    f32 vel[3];               // Velocity, NED, m/s
+    f32 refSpeed;             // Groundspeed of the last fix, m/s
+    f32 lastYaw;              // Heading at the last prediction, rad
+    u64 lastUpdate;           // Time of the last prediction, us
+    u64 lastFix;              // Time the last fix was measured at, us
+    f32 lastFixAlt;           // Altitude of the last fix, m
+    bool hasFix;              // Whether a fix has been received; until then, nothing is propagated
+    DRSample history[DR_HISTORY];
+    u32 historyHead, historyCount;
+} DeadReckoner;
+
+/**
+ * Resets the propagator, forgetting any fix.
+ * @param dr the propagator
+ */
+void dr_reset(DeadReckoner *dr);
+
+/**
+ * Propagates the state up to the present.
+ * @param dr the propagator
+ * @param now the current time, us
+ * @param yaw the estimated heading (positive clockwise), rad
+ * @param pitch the estimated pitch (positive nose up), rad
+ * @param accFwd specific force along the body's X (forward) axis, m/s^2
+ */
+void dr_predict(DeadReckoner *dr, u64 now, f32 yaw, f32 pitch, f32 accFwd);
+
+/**
+ * Corrects the state with a GPS fix.
+ * @param dr the propagator
+ * @param now the current time, us (the state should have been propagated up to this time)
+ * @param latency how long before `now` the fix was measured, us
+ * @param lat latitude, deg
+ * @param lng longitude, deg
+ * @param alt altitude, MSL, m
+ * @param velNE horizontal velocity (north, east), m/s, or NULL if the fix has none
+ */
+void dr_fix(DeadReckoner *dr, u64 now, u64 latency, f64 lat, f64 lng, f32 alt, const f32 velNE[2]);
+
+/**
+ * Gets the propagated state. Any of the pointers may be NULL.
+ * @param dr the propagator
+ * @param lat pointer to where the latitude should be stored, deg
+ * @param lng pointer to where the longitude should be stored, deg
+ * @param alt pointer to where the altitude should be stored, MSL, m
+ * @param vel pointer to where the velocity should be stored, NED, m/s
+ * @return true if the state is known (a fix has been received), false if not
+ */
+bool dr_get(const DeadReckoner *dr, f64 *lat, f64 *lng, f32 *alt, f32 vel[3]);
+
+/**
+ * @param dr the propagator
+ * @param now the current time, us
+ * @return the time since the last fix was measured, s, or INFINITY if there has never been one
+ */
+f32 dr_fix_age(const DeadReckoner *dr, u64 now);
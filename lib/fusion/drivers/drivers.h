@@ -19,9 +19,32 @@
 #include <stdbool.h>
 #include "platform/types.h"
 
-/* Accelerometer */
-
 typedef struct Accelerometer Accelerometer;
+typedef struct Gyroscope Gyroscope;
+typedef struct Magnetometer Magnetometer;
+
+// Optional operation for devices that combine multiple sensors (e.g. a 9-axis IMU): reads the raw values of all given sensors
+// in as few bus transactions as possible. `gyro` and `mag` may be NULL if they should not be read. The same function is set
+// as the `read_all` of every sensor it can read, so callers can tell which sensors it covers.
+typedef bool (*read_all_fn)(Accelerometer *acc, Gyroscope *gyro, Magnetometer *mag, void *imu_user_data);
+
+// A single raw accelerometer and gyroscope sample, as stored in a device's FIFO.
+typedef struct RawIMUSample {
+    int16_t ax, ay, az;
+    int16_t gx, gy, gz;
+} RawIMUSample;
+
+// Optional operations for devices with an on-chip FIFO that buffers accelerometer and gyroscope samples at the ODR.
+// Like `read_all`, the same functions are set on both the accelerometer and the gyroscope.
+// fifo_enable: starts (clearing anything already buffered) or stops buffering samples.
+// fifo_read: reads up to `max` of the oldest buffered samples into `samples`, oldest first, and returns how many were read
+// (or -1 on error). `overflow` is set if the FIFO filled up since the last read, meaning samples were lost before these.
+// `pending` is set to the number of samples that are still buffered after these (more than `max` were buffered).
+typedef bool (*fifo_enable_fn)(Accelerometer *acc, Gyroscope *gyro, bool enable, void *imu_user_data);
+typedef i32 (*fifo_read_fn)(Accelerometer *acc, Gyroscope *gyro, RawIMUSample samples[], u32 max, bool *overflow,
+                            u32 *pending, void *imu_user_data);
+
+/* Accelerometer */
 
 typedef bool (*acc_detect_fn)(Accelerometer *dev, void *imu_user_data);
 typedef bool (*acc_create_fn)(Accelerometer *dev, void *imu_user_data);
@@ -43,6 +66,9 @@ typedef struct Accelerometer {
     acc_create_fn create;
     acc_destroy_fn destroy;
     acc_read_fn read;
+    read_all_fn read_all;
+    fifo_enable_fn fifo_enable;
+    fifo_read_fn fifo_read;
     acc_get_odr_fn get_odr;
     acc_set_odr_fn set_odr;
     acc_get_scale_fn get_scale;
@@ -58,8 +84,6 @@ typedef struct Accelerometer {
 
 /* Gyroscope */
 
-typedef struct Gyroscope Gyroscope;
-
 typedef bool (*gyro_detect_fn)(Gyroscope *dev, void *imu_user_data);
 typedef bool (*gyro_create_fn)(Gyroscope *dev, void *imu_user_data);
 typedef bool (*gyro_destroy_fn)(Gyroscope *dev, void *imu_user_data);
@@ -80,6 +104,9 @@ typedef struct Gyroscope {
     gyro_create_fn create;
     gyro_destroy_fn destroy;
     gyro_read_fn read;
+    read_all_fn read_all;
+    fifo_enable_fn fifo_enable;
+    fifo_read_fn fifo_read;
     gyro_get_odr_fn get_odr;
     gyro_set_odr_fn set_odr;
     gyro_get_scale_fn get_scale;
@@ -96,8 +123,6 @@ typedef struct Gyroscope {
 
 /* Magnetometer */
 
-typedef struct Magnetometer Magnetometer;
-
 typedef bool (*mag_detect_fn)(Magnetometer *dev, void *imu_user_data);
 typedef bool (*mag_create_fn)(Magnetometer *dev, void *imu_user_data);
 typedef bool (*mag_destroy_fn)(Magnetometer *dev, void *imu_user_data);
@@ -118,6 +143,7 @@ typedef struct Magnetometer {
     mag_create_fn create;
     mag_destroy_fn destroy;
     mag_read_fn read;
+    read_all_fn read_all;
     mag_get_odr_fn get_odr;
     mag_set_odr_fn set_odr;
     mag_get_scale_fn get_scale;
@@ -137,4 +163,8 @@ typedef struct IMU {
     Gyroscope *gyro;
     Magnetometer *mag;
     void *state; // A driver may choose to store some state here
+    // FIFO bookkeeping, see fusion_fifo_enable()
+    bool fifo_enabled;
+    f32 fifo_period;         // Time between samples in the FIFO, in us
+    u64 fifo_last_timestamp; // Timestamp of the last sample read from the FIFO, in us
 } IMU;
@@ -18,6 +18,15 @@
 #define ICM20948_ACC_BASE_ODR 1125.f
 #define ICM20948_GYRO_BASE_ODR 1100.f
 
+#define ICM20948_ACCGYRO_LEN 12 // ACCEL_XOUT_H through GYRO_ZOUT_L
+#define ICM20948_MAG_LEN 8      // HXL through ST2 (ST2 must be read to release the data registers)
+// ACCEL_XOUT_H through EXT_SLV_SENS_DATA_07 (accel, gyro, temperature, mag)
+#define ICM20948_BURST_LEN (ICM20948_REG0_EXT_SLV_SENS_DATA_00 - ICM20948_REG0_ACCEL_XOUT_H + ICM20948_MAG_LEN)
+
+#define ICM20948_FIFO_SIZE 512                       // bytes
+#define ICM20948_FIFO_FRAME_LEN ICM20948_ACCGYRO_LEN // Accel then gyro, in register order
+#define ICM20948_FIFO_CHUNK 8                        // Frames read from FIFO_R_W per transaction
+
 static bool icm20948_change_bank(byte i2caddr, void *state, u8 bank_no) {
     ICM20948State *iud = (ICM20948State *)state;
     byte bank_addr = 0x00;
@@ -56,8 +65,9 @@ static bool icm20948_detect(byte addr, void *state) {
 
     if (!state)
         return false;
+    // The acc and gyro are the same device, so if one has already been set up, only its address can match
     if (iud->accgyro_initialized)
-        return true;
+        return addr == iud->accgyro_addr;
 
     device_id = mgos_i2c_read_reg_b(addr, ICM20948_REG0_WHO_AM_I);
     if (device_id == ICM20948_DEVID)
@@ -115,6 +125,7 @@ bool icm20948_acc_create(Accelerometer *dev, void *state) {
         if (!icm20948_accgyro_create(dev->addr, state))
             return false;
         iud->accgyro_initialized = true;
+        iud->accgyro_addr = dev->addr;
     }
 
     if (!icm20948_change_bank(dev->addr, state, 2))
@@ -258,6 +269,7 @@ bool icm20948_gyro_create(Gyroscope *dev, void *state) {
         if (!icm20948_accgyro_create(dev->addr, state))
             return false;
         iud->accgyro_initialized = true;
+        iud->accgyro_addr = dev->addr;
     }
 
     if (!icm20948_change_bank(dev->addr, state, 2))
@@ -407,22 +419,28 @@ bool icm20948_mag_create(Magnetometer *dev, void *state) {
 }
 
 bool icm20948_mag_read(Magnetometer *dev, void *state) {
+    ICM20948State *iud = (ICM20948State *)state;
     byte data[6];
     if (!dev)
         return false;
 
-    if (!mgos_i2c_read_reg_n(dev->addr, ICM20948_HXL_M, 6, data))
-        return false;
-
-    // It is required to read ST2 register after data reading.
-    mgos_i2c_read_reg_b(dev->addr, ICM20948_ST2_M);
+    if (iud && iud->mag_via_master) {
+        // The mag is no longer visible on the bus, but the I2C master keeps a copy of its data registers
+        if (!icm20948_change_bank(iud->accgyro_addr, state, 0))
+            return false;
+        if (!mgos_i2c_read_reg_n(iud->accgyro_addr, ICM20948_REG0_EXT_SLV_SENS_DATA_00, 6, data))
+            return false;
+    } else {
+        if (!mgos_i2c_read_reg_n(dev->addr, ICM20948_HXL_M, 6, data))
+            return false;
+        // It is required to read ST2 register after data reading.
+        mgos_i2c_read_reg_b(dev->addr, ICM20948_ST2_M);
+    }
 
     dev->mx = (data[1] << 8) | (data[0]);
     dev->my = (data[3] << 8) | (data[2]);
     dev->mz = (data[5] << 8) | (data[4]);
     return true;
-
-    (void)state;
 }
 
 bool icm20948_mag_get_odr(Magnetometer *dev, void *state, f32 *odr) {
@@ -475,3 +493,150 @@ bool icm20948_mag_set_odr(Magnetometer *dev, void *state, f32 odr) {
     return false;
     (void)state;
 }
+
+/* Combined */
+
+/**
+ * Hands the mag over to the ICM20948's internal I2C master, which then reads the mag's data registers (HXL through ST2) into
+ * EXT_SLV_SENS_DATA_00 at the acc/gyro's sample rate, right after the acc/gyro's own data registers.
+ * @note Once this is done, the mag can no longer be accessed directly.
+ */
+static bool icm20948_enable_mag_master(byte i2caddr, byte mag_addr, void *state) {
+    ICM20948State *iud = (ICM20948State *)state;
+
+    if (!icm20948_change_bank(i2caddr, state, 3))
+        return false;
+    // I2C_MST_CTRL: I2C_MST_P_NSR=0(restart between reads); I2C_MST_CLK=0111(345.6kHz);
+    // I2C_SLV0_ADDR: I2C_SLV0_RNW=1(read); I2C_ID_0=mag_addr;
+    // I2C_SLV0_REG: HXL;
+    // I2C_SLV0_CTRL: I2C_SLV0_EN=1; I2C_SLV0_LENG=ICM20948_MAG_LEN;
+    mgos_i2c_write_reg_b(i2caddr, ICM20948_REG3_I2C_MST_CTRL, 0x07);
+    mgos_i2c_write_reg_b(i2caddr, ICM20948_REG3_I2C_SLV0_ADDR, 0x80 | mag_addr);
+    mgos_i2c_write_reg_b(i2caddr, ICM20948_REG3_I2C_SLV0_REG, ICM20948_HXL_M);
+    if (!mgos_i2c_write_reg_b(i2caddr, ICM20948_REG3_I2C_SLV0_CTRL, 0x80 | ICM20948_MAG_LEN))
+        return false;
+
+    if (!icm20948_change_bank(i2caddr, state, 0))
+        return false;
+    // INT_PIN_CFG: BYPASS_EN=0(the master now owns the auxiliary bus);
+    // USER_CTRL: I2C_MST_EN=1;
+    mgos_i2c_write_reg_b(i2caddr, ICM20948_REG0_INT_PIN_CFG, 0x00);
+    if (!mgos_i2c_write_reg_b(i2caddr, ICM20948_REG0_USER_CTRL, 0x20))
+        return false;
+
+    iud->mag_via_master = true;
+    return true;
+}
+
+bool icm20948_read_all(Accelerometer *acc, Gyroscope *gyro, Magnetometer *mag, void *state) {
+    ICM20948State *iud = (ICM20948State *)state;
+    byte data[ICM20948_BURST_LEN];
+    if (!acc || !state)
+        return false;
+
+    if (mag && !iud->mag_via_master && !icm20948_enable_mag_master(acc->addr, mag->addr, state))
+        return false;
+    if (!icm20948_change_bank(acc->addr, state, 0))
+        return false;
+    // Everything is laid out contiguously, so a single burst can read it all; only read as far as is needed though
+    size_t len = mag ? ICM20948_BURST_LEN : (gyro ? ICM20948_ACCGYRO_LEN : 6);
+    if (!mgos_i2c_read_reg_n(acc->addr, ICM20948_REG0_ACCEL_XOUT_H, len, data))
+        return false;
+
+    acc->ax = (data[0] << 8) | (data[1]);
+    acc->ay = (data[2] << 8) | (data[3]);
+    acc->az = (data[4] << 8) | (data[5]);
+    if (gyro) {
+        gyro->gx = (data[6] << 8) | (data[7]);
+        gyro->gy = (data[8] << 8) | (data[9]);
+        gyro->gz = (data[10] << 8) | (data[11]);
+    }
+    if (mag) {
+        const byte *m = &data[ICM20948_REG0_EXT_SLV_SENS_DATA_00 - ICM20948_REG0_ACCEL_XOUT_H];
+        mag->mx = (m[1] << 8) | (m[0]);
+        mag->my = (m[3] << 8) | (m[2]);
+        mag->mz = (m[5] << 8) | (m[4]);
+    }
+    return true;
+}
+
+/* FIFO */
+
+static bool icm20948_fifo_reset(byte i2caddr) {
+    // FIFO_RST: FIFO_RESET=11111 (assert then deassert)
+    if (!mgos_i2c_write_reg_b(i2caddr, ICM20948_REG0_FIFO_RST, 0x1f))
+        return false;
+    return mgos_i2c_write_reg_b(i2caddr, ICM20948_REG0_FIFO_RST, 0x00);
+}
+
+bool icm20948_fifo_enable(Accelerometer *acc, Gyroscope *gyro, bool enable, void *state) {
+    if (!acc || !state)
+        return false;
+
+    if (!icm20948_change_bank(acc->addr, state, 0))
+        return false;
+    if (!enable) {
+        // USER_CTRL: FIFO_EN=0; FIFO_EN_2: nothing;
+        if (!mgos_i2c_setbits_reg_b(acc->addr, ICM20948_REG0_USER_CTRL, 6, 1, 0))
+            return false;
+        return mgos_i2c_write_reg_b(acc->addr, ICM20948_REG0_FIFO_EN_2, 0x00);
+    }
+    // FIFO_EN_2: ACCEL_FIFO_EN=1; GYRO_Z/Y/X_FIFO_EN=1 (if the gyro is wanted); TEMP_FIFO_EN=0;
+    // FIFO_MODE: snapshot (stop writing when full rather than overwriting, which would misalign frames)
+    // USER_CTRL: FIFO_EN=1 (I2C_MST_EN is left as-is)
+    if (!mgos_i2c_write_reg_b(acc->addr, ICM20948_REG0_FIFO_EN_2, gyro ? 0x1e : 0x10))
+        return false;
+    if (!mgos_i2c_write_reg_b(acc->addr, ICM20948_REG0_FIFO_MODE, 0x1f))
+        return false;
+    if (!icm20948_fifo_reset(acc->addr))
+        return false;
+    return mgos_i2c_setbits_reg_b(acc->addr, ICM20948_REG0_USER_CTRL, 6, 1, 1);
+}
+
+i32 icm20948_fifo_read(Accelerometer *acc, Gyroscope *gyro, RawIMUSample samples[], u32 max, bool *overflow, u32 *pending,
+                       void *state) {
+    byte data[ICM20948_FIFO_CHUNK * ICM20948_FIFO_FRAME_LEN];
+    if (!acc || !samples || !state)
+        return -1;
+    // Without the gyro, frames only contain the accel
+    u32 frameLen = gyro ? ICM20948_FIFO_FRAME_LEN : 6;
+
+    if (!icm20948_change_bank(acc->addr, state, 0))
+        return -1;
+    if (!mgos_i2c_read_reg_n(acc->addr, ICM20948_REG0_FIFO_COUNTH, 2, data))
+        return -1;
+    u32 count = ((data[0] & 0x1f) << 8) | data[1];
+    u32 frames = count / frameLen;
+    // In snapshot mode, the FIFO stops accepting samples once the next one would no longer fit
+    bool full = count + frameLen > ICM20948_FIFO_SIZE;
+    if (overflow)
+        *overflow = full;
+
+    u32 n = frames < max ? frames : max;
+    if (pending)
+        *pending = frames - n;
+    for (u32 done = 0; done < n;) {
+        u32 chunk = n - done < ICM20948_FIFO_CHUNK ? n - done : ICM20948_FIFO_CHUNK;
+        // FIFO_R_W does not auto-increment, so a burst read from it keeps popping bytes from the FIFO
+        if (!mgos_i2c_read_reg_n(acc->addr, ICM20948_REG0_FIFO_R_W, chunk * frameLen, data))
+            return -1;
+        for (u32 i = 0; i < chunk; i++) {
+            const byte *f = &data[i * frameLen];
+            RawIMUSample *s = &samples[done + i];
+            s->ax = (f[0] << 8) | (f[1]);
+            s->ay = (f[2] << 8) | (f[3]);
+            s->az = (f[4] << 8) | (f[5]);
+            if (gyro) {
+                s->gx = (f[6] << 8) | (f[7]);
+                s->gy = (f[8] << 8) | (f[9]);
+                s->gz = (f[10] << 8) | (f[11]);
+            } else
+                s->gx = s->gy = s->gz = 0;
+        }
+        done += chunk;
+    }
+    // Once a full FIFO has been drained, reset it to discard any partial frame and let it start buffering again
+    if (full && n == frames && !icm20948_fifo_reset(acc->addr))
+        return -1;
+    return (i32)n;
+}
@@ -20,6 +20,11 @@
 #define ICM20948_REG0_ACCEL_XOUT_H (0x2d)
 #define ICM20948_REG0_GYRO_XOUT_H (0x33)
 #define ICM20948_REG0_EXT_SLV_SENS_DATA_00 (0x3b)
+#define ICM20948_REG0_FIFO_EN_2 (0x67)
+#define ICM20948_REG0_FIFO_RST (0x68)
+#define ICM20948_REG0_FIFO_MODE (0x69)
+#define ICM20948_REG0_FIFO_COUNTH (0x70)
+#define ICM20948_REG0_FIFO_R_W (0x72)
 #define ICM20948_REG0_BANK_SEL (0x7f)
 #define ICM20948_REG2_GYRO_SMPLRT_DIV (0x00)
 #define ICM20948_REG2_GYRO_CONFIG_1 (0x01)
@@ -41,6 +46,8 @@
 
 typedef struct ICM20948State {
     bool accgyro_initialized;
+    byte accgyro_addr; // Address the acc/gyro was initialized at
+    bool mag_via_master; // Whether the mag is being read through the ICM20948's I2C master (see icm20948_read_all())
     i8 current_bank_no;
 } ICM20948State;
 
@@ -68,3 +75,8 @@ bool icm20948_mag_create(Magnetometer *dev, void *state);
 bool icm20948_mag_read(Magnetometer *dev, void *state);
 bool icm20948_mag_get_odr(Magnetometer *dev, void *state, f32 *odr);
 bool icm20948_mag_set_odr(Magnetometer *dev, void *state, f32 odr);
+
+bool icm20948_read_all(Accelerometer *acc, Gyroscope *gyro, Magnetometer *mag, void *state);
+bool icm20948_fifo_enable(Accelerometer *acc, Gyroscope *gyro, bool enable, void *state);
+i32 icm20948_fifo_read(Accelerometer *acc, Gyroscope *gyro, RawIMUSample samples[], u32 max, bool *overflow, u32 *pending,
+                       void *state);
@@ -0,0 +1,504 @@
+/**
+ * Source file of pico-fbw: https://github.com/pico-fbw/pico-fbw
+ * Licensed under the GNU AGPL-3.0
+ */
+
+#include <math.h>
+#include <string.h>
+
+#include "ekf.h"
+
+// The error state is δx = [δθ, δv, δp, δb, δd], where δθ is a small rotation applied on the navigation-frame side of the
+// attitude (R = (I + [δθ]x) R̂). Measurements are fused one scalar at a time, which avoids any matrix inversion, and each
+// correction is injected into the nominal state straight away.
+
+#define GRAVITY 9.80665f       // m/s^2
+#define EARTH_RADIUS 6371000.0 // m
+#define PI 3.14159265358979323846
+
+#define EKF_COVARIANCE_PERIOD 0.01f // Maximum time between covariance predictions, s
+
+// Process noise (continuous-time, per sqrt(s))
+#define EKF_GYRO_NOISE 0.015f // rad/s
+#define EKF_ACC_NOISE 0.5f    // m/s^2
+#define EKF_BIAS_NOISE 1E-4f  // rad/s
+#define EKF_POS_NOISE 0.1f    // m
+#define EKF_DECL_NOISE 1E-4f  // rad
+
+// Measurement noise
+#define EKF_GRAVITY_NOISE 0.6f    // m/s^2, when the accelerometer reads exactly 1G
+#define EKF_GRAVITY_INFLATION 4.f // Noise increase per m/s^2 the accelerometer is away from 1G
+#define EKF_HEADING_NOISE 0.1f    // rad
+#define EKF_GPS_VEL_NOISE 0.5f    // m/s
+#define EKF_GPS_VERT_FACTOR 1.5f  // Vertical accuracy relative to horizontal accuracy
+
+#define EKF_GATE 5.f // Innovations larger than this many standard deviations are rejected
+
+// Initial uncertainty (standard deviations)
+#define EKF_INIT_TILT 0.1f    // rad
+#define EKF_INIT_HEADING 0.3f // rad, with a magnetometer (otherwise the heading is unknown)
+#define EKF_INIT_VEL 2.f      // m/s
+#define EKF_INIT_POS 5.f      // m
+#define EKF_INIT_BIAS 0.02f   // rad/s
+#define EKF_INIT_DECL 0.3f    // rad
+
+#define EKF_VARIANCE_MIN 1E-9f
+#define EKF_VARIANCE_MAX 1E6f
+
+/* --- Small vector and quaternion helpers --- */
+
+static inline f32 dot3(const f32 a[3], const f32 b[3]) { return a[0] * b[0] + a[1] * b[1] + a[2] * b[2]; }
+
+static inline void cross3(const f32 a[3], const f32 b[3], f32 out[3]) {
+    out[0] = a[1] * b[2] - a[2] * b[1];
+    out[1] = a[2] * b[0] - a[0] * b[2];
+    out[2] = a[0] * b[1] - a[1] * b[0];
+}
+
+static inline bool finite3(const f32 v[3]) { return isfinite(v[0]) && isfinite(v[1]) && isfinite(v[2]); }
+
+/**
+ * Multiplies two quaternions (out = a ⊗ b); `out` may alias either input.
+ */
+static void quat_mul(const f32 a[4], const f32 b[4], f32 out[4]) {
+    f32 w = a[0] * b[0] - a[1] * b[1] - a[2] * b[2] - a[3] * b[3];
+    f32 x = a[0] * b[1] + a[1] * b[0] + a[2] * b[3] - a[3] * b[2];
+    f32 y = a[0] * b[2] - a[1] * b[3] + a[2] * b[0] + a[3] * b[1];
+    f32 z = a[0] * b[3] + a[1] * b[2] - a[2] * b[1] + a[3] * b[0];
+    out[0] = w;
+    out[1] = x;
+    out[2] = y;
+    out[3] = z;
+}
+
+/**
+ * Converts a rotation vector (axis * angle) into a quaternion.
+ */
+static void quat_from_rotvec(const f32 v[3], f32 out[4]) {
+    f32 angle = sqrtf(dot3(v, v));
+    if (angle < 1E-6f) {
+        // Small-angle approximation, avoids dividing by ~0
+        out[0] = 1.f;
+        out[1] = 0.5f * v[0];
+        out[2] = 0.5f * v[1];
+        out[3] = 0.5f * v[2];
+        return;
+    }
+    f32 s = sinf(0.5f * angle) / angle;
+    out[0] = cosf(0.5f * angle);
+    out[1] = v[0] * s;
+    out[2] = v[1] * s;
+    out[3] = v[2] * s;
+}
+
+static void quat_normalize(f32 q[4]) {
+    f32 norm = sqrtf(q[0] * q[0] + q[1] * q[1] + q[2] * q[2] + q[3] * q[3]);
+    if (norm > 0.f) {
+        for (u32 i = 0; i < 4; i++)
+            q[i] /= norm;
+    }
+    if (q[0] < 0.f) {
+        // Keep the scalar part positive so the quaternion (and its Euler angles) stay continuous
+        for (u32 i = 0; i < 4; i++)
+            q[i] = -q[i];
+    }
+}
+
+/**
+ * Converts a quaternion into a rotation matrix.
+ */
+static void quat_to_dcm(const f32 q[4], f32 R[3][3]) {
+    f32 w = q[0], x = q[1], y = q[2], z = q[3];
+    R[0][0] = 1.f - 2.f * (y * y + z * z);
+    R[0][1] = 2.f * (x * y - w * z);
+    R[0][2] = 2.f * (x * z + w * y);
+    R[1][0] = 2.f * (x * y + w * z);
+    R[1][1] = 1.f - 2.f * (x * x + z * z);
+    R[1][2] = 2.f * (y * z - w * x);
+    R[2][0] = 2.f * (x * z - w * y);
+    R[2][1] = 2.f * (y * z + w * x);
+    R[2][2] = 1.f - 2.f * (x * x + y * y);
+}
+
+/**
+ * Builds a quaternion from Euler angles (aerospace sequence).
+ */
+static void quat_from_euler(f32 roll, f32 pitch, f32 yaw, f32 q[4]) {
+    f32 cr = cosf(0.5f * roll), sr = sinf(0.5f * roll);
+    f32 cp = cosf(0.5f * pitch), sp = sinf(0.5f * pitch);
+    f32 cy = cosf(0.5f * yaw), sy = sinf(0.5f * yaw);
+    q[0] = cr * cp * cy + sr * sp * sy;
+    q[1] = sr * cp * cy - cr * sp * sy;
+    q[2] = cr * sp * cy + sr * cp * sy;
+    q[3] = cr * cp * sy - sr * sp * cy;
+}
+
+static inline void rotate(const f32 R[3][3], const f32 v[3], f32 out[3]) {
+    for (u32 i = 0; i < 3; i++)
+        out[i] = R[i][0] * v[0] + R[i][1] * v[1] + R[i][2] * v[2];
+}
+
+static inline void rotate_transposed(const f32 R[3][3], const f32 v[3], f32 out[3]) {
+    for (u32 i = 0; i < 3; i++)
+        out[i] = R[0][i] * v[0] + R[1][i] * v[1] + R[2][i] * v[2];
+}
+
+/**
+ * Rotates a body-frame magnetometer reading by `R` and measures its angle from north.
+ * With a roll/pitch-only `R`, this is the heading; with the full attitude, it is the heading error.
+ */
+static inline f32 mag_heading(const f32 R[3][3], const f32 mag[3]) {
+    f32 m[3];
+    rotate(R, mag, m);
+    return atan2f(-m[1], m[0]);
+}
+
+static inline f32 wrap_pi(f32 angle) {
+    while (angle > (f32)PI)
+        angle -= 2.f * (f32)PI;
+    while (angle < -(f32)PI)
+        angle += 2.f * (f32)PI;
+    return angle;
+}
+
+/* --- Covariance --- */
+
+/**
+ * Forces the covariance to stay symmetric and its variances within sane bounds, which keeps round-off in single precision
+ * from building up into a filter divergence.
+ */
+static void condition_covariance(EKF *ekf) {
+    for (u32 i = 0; i < EKF_STATES; i++) {
+        if (ekf->P[i][i] < EKF_VARIANCE_MIN)
+            ekf->P[i][i] = EKF_VARIANCE_MIN;
+        if (ekf->P[i][i] > EKF_VARIANCE_MAX)
+            ekf->P[i][i] = EKF_VARIANCE_MAX;
+        for (u32 j = i + 1; j < EKF_STATES; j++) {
+            f32 avg = 0.5f * (ekf->P[i][j] + ekf->P[j][i]);
+            ekf->P[i][j] = avg;
+            ekf->P[j][i] = avg;
+        }
+    }
+}
+
+/**
+ * Resets the variance of a block of states, removing any correlation with the other states.
+ */
+static void reset_block(EKF *ekf, u32 start, f32 sigma) {
+    for (u32 i = start; i < start + 3; i++) {
+        for (u32 j = 0; j < EKF_STATES; j++) {
+            ekf->P[i][j] = 0.f;
+            ekf->P[j][i] = 0.f;
+        }
+        ekf->P[i][i] = sigma * sigma;
+    }
+}
+
+/**
+ * Propagates the covariance over the IMU data accumulated since the last call (P = Φ P Φ' + Q).
+ * Only the non-identity blocks of Φ are multiplied out:
+ *   δθ' = δθ - R̂ δb dt
+ *   δv' = δv - [Δv]x δθ   (Δv being the specific force integrated in the navigation frame)
+ *   δp' = δp + δv dt
+ * (δb and δd are constant.)
+ */
+static void predict_covariance(EKF *ekf) {
+    f32 dt = ekf->covDt;
+    if (dt <= 0.f)
+        return;
+    f32 R[3][3];
+    quat_to_dcm(ekf->q, R);
+    const f32 *dv = ekf->covDelVel;
+    // Skew-symmetric [Δv]x
+    const f32 S[3][3] = {{0.f, -dv[2], dv[1]}, {dv[2], 0.f, -dv[0]}, {-dv[1], dv[0], 0.f}};
+
+    // A = Φ P
+    f32 A[EKF_STATES][EKF_STATES];
+    for (u32 j = 0; j < EKF_STATES; j++) {
+        for (u32 i = 0; i < 3; i++) {
+            A[EKF_ATT + i][j] = ekf->P[EKF_ATT + i][j] - dt * (R[i][0] * ekf->P[EKF_BIAS][j] + R[i][1] * ekf->P[EKF_BIAS + 1][j] +
+                                                                R[i][2] * ekf->P[EKF_BIAS + 2][j]);
+            A[EKF_VEL + i][j] = ekf->P[EKF_VEL + i][j] - (S[i][0] * ekf->P[EKF_ATT][j] + S[i][1] * ekf->P[EKF_ATT + 1][j] +
+                                                          S[i][2] * ekf->P[EKF_ATT + 2][j]);
+            A[EKF_POS + i][j] = ekf->P[EKF_POS + i][j] + dt * ekf->P[EKF_VEL + i][j];
+            A[EKF_BIAS + i][j] = ekf->P[EKF_BIAS + i][j];
+        }
+        A[EKF_DECL][j] = ekf->P[EKF_DECL][j];
+    }
+    // P = A Φ' (row i of the result is Φ applied to row i of A)
+    for (u32 i = 0; i < EKF_STATES; i++) {
+        for (u32 k = 0; k < 3; k++) {
+            ekf->P[i][EKF_ATT + k] =
+                A[i][EKF_ATT + k] - dt * (R[k][0] * A[i][EKF_BIAS] + R[k][1] * A[i][EKF_BIAS + 1] + R[k][2] * A[i][EKF_BIAS + 2]);
+            ekf->P[i][EKF_VEL + k] =
+                A[i][EKF_VEL + k] - (S[k][0] * A[i][EKF_ATT] + S[k][1] * A[i][EKF_ATT + 1] + S[k][2] * A[i][EKF_ATT + 2]);
+            ekf->P[i][EKF_POS + k] = A[i][EKF_POS + k] + dt * A[i][EKF_VEL + k];
+            ekf->P[i][EKF_BIAS + k] = A[i][EKF_BIAS + k];
+        }
+        ekf->P[i][EKF_DECL] = A[i][EKF_DECL];
+    }
+
+    // Q
+    for (u32 i = 0; i < 3; i++) {
+        ekf->P[EKF_ATT + i][EKF_ATT + i] += EKF_GYRO_NOISE * EKF_GYRO_NOISE * dt;
+        ekf->P[EKF_VEL + i][EKF_VEL + i] += EKF_ACC_NOISE * EKF_ACC_NOISE * dt;
+        ekf->P[EKF_POS + i][EKF_POS + i] += EKF_POS_NOISE * EKF_POS_NOISE * dt;
+        ekf->P[EKF_BIAS + i][EKF_BIAS + i] += EKF_BIAS_NOISE * EKF_BIAS_NOISE * dt;
+    }
+    ekf->P[EKF_DECL][EKF_DECL] += EKF_DECL_NOISE * EKF_DECL_NOISE * dt;
+    if (!ekf->hasOrigin) {
+        // Without GPS, velocity and position are unobservable; keep them out of the attitude solution
+        reset_block(ekf, EKF_VEL, EKF_INIT_VEL);
+        reset_block(ekf, EKF_POS, EKF_INIT_POS);
+    }
+    condition_covariance(ekf);
+
+    ekf->covDt = 0.f;
+    memset(ekf->covDelVel, 0, sizeof(ekf->covDelVel));
+}
+
+/* --- Measurement updates --- */
+
+/**
+ * Applies an error-state correction to the nominal state.
+ */
+static void inject(EKF *ekf, const f32 dx[EKF_STATES]) {
+    f32 dq[4];
+    quat_from_rotvec(&dx[EKF_ATT], dq);
+    quat_mul(dq, ekf->q, ekf->q);
+    quat_normalize(ekf->q);
+    for (u32 i = 0; i < 3; i++) {
+        ekf->vel[i] += dx[EKF_VEL + i];
+        ekf->pos[i] += dx[EKF_POS + i];
+        ekf->bias[i] += dx[EKF_BIAS + i];
+    }
+    ekf->decl += dx[EKF_DECL];
+}
+
+/**
+ * Fuses a scalar measurement.
+ * @param ekf the filter
+ * @param H the measurement's Jacobian with respect to the error state
+ * @param innov the innovation (measured - predicted)
+ * @param var the measurement's variance
+ * @return true if the measurement was fused, false if it failed the innovation gate
+ */
+static bool fuse_scalar(EKF *ekf, const f32 H[EKF_STATES], f32 innov, f32 var) {
+    f32 PHt[EKF_STATES];
+    for (u32 i = 0; i < EKF_STATES; i++) {
+        f32 sum = 0.f;
+        for (u32 j = 0; j < EKF_STATES; j++) {
+            if (H[j] != 0.f)
+                sum += ekf->P[i][j] * H[j];
+        }
+        PHt[i] = sum;
+    }
+    f32 S = var;
+    for (u32 i = 0; i < EKF_STATES; i++)
+        S += H[i] * PHt[i];
+    if (!(S > 0.f) || !isfinite(innov))
+        return false;
+    if (innov * innov > EKF_GATE * EKF_GATE * S)
+        return false;
+
+    f32 K[EKF_STATES], dx[EKF_STATES];
+    for (u32 i = 0; i < EKF_STATES; i++) {
+        K[i] = PHt[i] / S;
+        dx[i] = K[i] * innov;
+    }
+    // P = (I - K H) P = P - K (P H')'
+    for (u32 i = 0; i < EKF_STATES; i++) {
+        for (u32 j = 0; j < EKF_STATES; j++)
+            ekf->P[i][j] -= K[i] * PHt[j];
+    }
+    condition_covariance(ekf);
+    inject(ekf, dx);
+    return true;
+}
+
+/* --- Public API --- */
+
+void ekf_reset(EKF *ekf) {
+    memset(ekf, 0, sizeof(EKF));
+    ekf->q[0] = 1.f;
+    for (u32 i = 0; i < 3; i++) {
+        ekf->P[EKF_ATT + i][EKF_ATT + i] = EKF_INIT_TILT * EKF_INIT_TILT;
+        ekf->P[EKF_VEL + i][EKF_VEL + i] = EKF_INIT_VEL * EKF_INIT_VEL;
+        ekf->P[EKF_POS + i][EKF_POS + i] = EKF_INIT_POS * EKF_INIT_POS;
+        ekf->P[EKF_BIAS + i][EKF_BIAS + i] = EKF_INIT_BIAS * EKF_INIT_BIAS;
+    }
+    ekf->P[EKF_DECL][EKF_DECL] = EKF_INIT_DECL * EKF_INIT_DECL;
+    ekf->P[EKF_ATT + 2][EKF_ATT + 2] = (f32)(PI * PI);
+}
+
+void ekf_align(EKF *ekf, const f32 acc[3], const f32 mag[3]) {
+    // At rest, the accelerometer reads the reaction to gravity, (0, 0, -g) when level
+    f32 roll = atan2f(-acc[1], -acc[2]);
+    f32 pitch = atan2f(acc[0], sqrtf(acc[1] * acc[1] + acc[2] * acc[2]));
+    f32 yaw = 0.f;
+    bool haveHeading = mag && (mag[0] != 0.f || mag[1] != 0.f || mag[2] != 0.f) && finite3(mag);
+    if (haveHeading) {
+        f32 q[4], R[3][3];
+        quat_from_euler(roll, pitch, 0.f, q);
+        quat_to_dcm(q, R);
+        yaw = mag_heading(R, mag) + ekf->decl;
+    }
+    quat_from_euler(roll, pitch, yaw, ekf->q);
+    quat_normalize(ekf->q);
+    reset_block(ekf, EKF_ATT, EKF_INIT_TILT);
+    ekf->P[EKF_ATT + 2][EKF_ATT + 2] = haveHeading ? EKF_INIT_HEADING * EKF_INIT_HEADING : (f32)(PI * PI);
+    ekf->aligned = true;
+}
+
+bool ekf_predict(EKF *ekf, f32 dt, const f32 gyro[3], const f32 acc[3]) {
+    if (!(dt > 0.f) || !finite3(gyro) || !finite3(acc))
+        return false;
+    f32 R[3][3];
+    quat_to_dcm(ekf->q, R);
+
+    // Velocity and position, using the attitude at the start of the interval
+    f32 fn[3];
+    rotate(R, acc, fn);
+    if (ekf->hasOrigin) {
+        for (u32 i = 0; i < 3; i++) {
+            f32 a = fn[i] + (i == 2 ? GRAVITY : 0.f);
+            ekf->pos[i] += ekf->vel[i] * dt + 0.5f * a * dt * dt;
+            ekf->vel[i] += a * dt;
+        }
+    }
+
+    // Attitude
+    f32 rot[3], dq[4];
+    for (u32 i = 0; i < 3; i++)
+        rot[i] = (gyro[i] - ekf->bias[i]) * dt;
+    quat_from_rotvec(rot, dq);
+    quat_mul(ekf->q, dq, ekf->q);
+    quat_normalize(ekf->q);
+
+    for (u32 i = 0; i < 3; i++)
+        ekf->covDelVel[i] += fn[i] * dt;
+    ekf->covDt += dt;
+    if (ekf->covDt >= EKF_COVARIANCE_PERIOD)
+        predict_covariance(ekf);
+    ekf->counter++;
+    return true;
+}
+
+bool ekf_fuse_gravity(EKF *ekf, const f32 acc[3], const f32 gyro[3]) {
+    if (!finite3(acc) || !finite3(gyro))
+        return false;
+    predict_covariance(ekf);
+    f32 norm = sqrtf(dot3(acc, acc));
+    if (norm < 0.5f * GRAVITY || norm > 1.5f * GRAVITY)
+        return false; // Too far from 1G to say anything useful about the direction of gravity
+    f32 sigma = EKF_GRAVITY_NOISE * (1.f + EKF_GRAVITY_INFLATION * fabsf(norm - GRAVITY));
+
+    bool fused = false;
+    for (u32 k = 0; k < 3; k++) {
+        // Each axis is fused with the latest attitude, as the previous axis will have moved it
+        f32 R[3][3];
+        quat_to_dcm(ekf->q, R);
+        // Predicted specific force: gravity's reaction (u = (0, 0, -g)) plus the centripetal acceleration ω x v
+        f32 predicted = -GRAVITY * R[2][k];
+        if (ekf->hasOrigin) {
+            f32 vb[3], omega[3], cen[3];
+            rotate_transposed(R, ekf->vel, vb);
+            for (u32 i = 0; i < 3; i++)
+                omega[i] = gyro[i] - ekf->bias[i];
+            cross3(omega, vb, cen);
+            predicted += cen[k];
+        }
+        // h = R̂'u + R̂'[u]x δθ
+        f32 H[EKF_STATES] = {0};
+        H[EKF_ATT] = -GRAVITY * R[1][k];
+        H[EKF_ATT + 1] = GRAVITY * R[0][k];
+        fused |= fuse_scalar(ekf, H, acc[k] - predicted, sigma * sigma);
+    }
+    return fused;
+}
+
+bool ekf_fuse_heading(EKF *ekf, const f32 mag[3]) {
+    if (!finite3(mag) || (mag[0] == 0.f && mag[1] == 0.f && mag[2] == 0.f))
+        return false;
+    predict_covariance(ekf);
+    f32 R[3][3];
+    quat_to_dcm(ekf->q, R);
+    // Reject readings whose horizontal component is too small to give a stable heading
+    f32 m[3];
+    rotate(R, mag, m);
+    f32 horiz = sqrtf(m[0] * m[0] + m[1] * m[1]);
+    if (horiz < 0.1f * sqrtf(dot3(m, m)))
+        return false;
+    // The reading, rotated into the estimated navigation frame, should point to magnetic north (`decl` east of true north);
+    // any other angle is the heading error
+    f32 H[EKF_STATES] = {0};
+    H[EKF_ATT + 2] = 1.f;
+    H[EKF_DECL] = -1.f;
+    return fuse_scalar(ekf, H, wrap_pi(mag_heading(R, mag) + ekf->decl), EKF_HEADING_NOISE * EKF_HEADING_NOISE);
+}
+
+bool ekf_fuse_gps(EKF *ekf, f64 lat, f64 lng, f32 alt, const f32 velNE[2], f32 hAcc) {
+    if (!isfinite(lat) || !isfinite(lng) || !isfinite(alt) || !(hAcc > 0.f))
+        return false;
+    predict_covariance(ekf);
+    if (!ekf->hasOrigin) {
+        ekf->originLat = lat;
+        ekf->originLng = lng;
+        ekf->originAlt = alt;
+        memset(ekf->pos, 0, sizeof(ekf->pos));
+        memset(ekf->vel, 0, sizeof(ekf->vel));
+        reset_block(ekf, EKF_POS, hAcc);
+        reset_block(ekf, EKF_VEL, EKF_INIT_VEL);
+        if (velNE) {
+            ekf->vel[0] = velNE[0];
+            ekf->vel[1] = velNE[1];
+            ekf->P[EKF_VEL][EKF_VEL] = ekf->P[EKF_VEL + 1][EKF_VEL + 1] = EKF_GPS_VEL_NOISE * EKF_GPS_VEL_NOISE;
+        }
+        ekf->hasOrigin = true;
+        return true;
+    }
+
+    // Flat-earth approximation around the origin, which holds well over the distances a flight covers
+    f32 measured[3];
+    measured[0] = (f32)((lat - ekf->originLat) * (PI / 180.0) * EARTH_RADIUS);
+    measured[1] = (f32)((lng - ekf->originLng) * (PI / 180.0) * EARTH_RADIUS * cos(ekf->originLat * (PI / 180.0)));
+    measured[2] = -(alt - ekf->originAlt);
+    bool fused = false;
+    for (u32 i = 0; i < 3; i++) {
+        f32 sigma = i == 2 ? hAcc * EKF_GPS_VERT_FACTOR : hAcc;
+        f32 H[EKF_STATES] = {0};
+        H[EKF_POS + i] = 1.f;
+        fused |= fuse_scalar(ekf, H, measured[i] - ekf->pos[i], sigma * sigma);
+    }
+    if (velNE && isfinite(velNE[0]) && isfinite(velNE[1])) {
+        for (u32 i = 0; i < 2; i++) {
+            f32 H[EKF_STATES] = {0};
+            H[EKF_VEL + i] = 1.f;
+            fused |= fuse_scalar(ekf, H, velNE[i] - ekf->vel[i], EKF_GPS_VEL_NOISE * EKF_GPS_VEL_NOISE);
+        }
+    }
+    return fused;
+}
+
+void ekf_get_angles(const EKF *ekf, f32 *roll, f32 *pitch, f32 *yaw) {
+    f32 R[3][3];
+    quat_to_dcm(ekf->q, R);
+    if (roll)
+        *roll = atan2f(R[2][1], R[2][2]);
+    if (pitch)
+        *pitch = asinf(fmaxf(-1.f, fminf(1.f, -R[2][0])));
+    if (yaw)
+        *yaw = atan2f(R[1][0], R[0][0]);
+}
+
+bool ekf_get_position(const EKF *ekf, f64 *lat, f64 *lng, f32 *alt) {
+    if (!ekf->hasOrigin)
+        return false;
+    if (lat)
+        *lat = ekf->originLat + (ekf->pos[0] / EARTH_RADIUS) * (180.0 / PI);
+    if (lng)
+        *lng = ekf->originLng + (ekf->pos[1] / (EARTH_RADIUS * cos(ekf->originLat * (PI / 180.0)))) * (180.0 / PI);
+    if (alt)
+        *alt = ekf->originAlt - ekf->pos[2];
+    return true;
+}
@@ -0,0 +1,116 @@
+#pragma once
+
+#include <stdbool.h>
+#include "platform/types.h"
+
+// Error-state extended Kalman filter for attitude, velocity, position, and gyroscope bias.
+// The nominal state is integrated from the gyroscope and accelerometer, and a 13-state error covariance (attitude, velocity,
+// position, gyroscope bias, magnetic declination) tracks its uncertainty. Corrections come from gravity (accelerometer), heading (magnetometer), and
+// GPS position/velocity. Attitude errors are expressed in the navigation frame.
+// Everything is single-precision and fixed-size; the filter never allocates.
+// Frames: the body frame is X forward, Y right, Z down (FRD); the navigation frame is north, east, down (NED), with its
+// origin at the first GPS fix.
+
+#define EKF_STATES 13
+
+// Indices of the error states
+#define EKF_ATT 0
+#define EKF_VEL 3
+#define EKF_POS 6
+#define EKF_BIAS 9
+#define EKF_DECL 12
+
+typedef struct EKF {
+    // Nominal state
+    f32 q[4];    // Attitude, rotation from body to navigation frame, as a quaternion (w, x, y, z)
+    f32 vel[3];  // Velocity, NED, m/s
+    f32 pos[3];  // Position relative to the origin, NED, m
+    f32 bias[3]; // Gyroscope bias, rad/s
+    f32 decl;    // Magnetic declination (positive east), rad; only observable while maneuvering with GPS
+    // Error-state covariance
+    f32 P[EKF_STATES][EKF_STATES];
+    // Covariance prediction is done in batches (see ekf_predict()), these accumulate the IMU data in between
+    f32 covDt;        // s
+    f32 covDelVel[3]; // Integrated specific force, NED, m/s
+    // Navigation frame origin
+    f64 originLat, originLng; // deg
+    f32 originAlt;            // MSL, m
+    bool hasOrigin;           // Whether a GPS fix has been received; until then, velocity and position are not estimated
+    bool aligned;             // Whether the attitude has been initialized
+    u32 counter;              // Number of predictions run
+} EKF;
+
+/**
+ * Resets the filter to an unaligned state with no origin.
+ * @param ekf the filter
+ */
+void ekf_reset(EKF *ekf);
+
+/**
+ * Initializes the attitude from a (roughly static) accelerometer reading and, if available, a magnetometer reading.
+ * @param ekf the filter
+ * @param acc specific force, body frame, m/s^2
+ * @param mag magnetic field, body frame (any unit), or NULL if unavailable (the heading is then arbitrarily set to 0)
+ */
+void ekf_align(EKF *ekf, const f32 acc[3], const f32 mag[3]);
+
+/**
+ * Integrates one IMU sample into the nominal state.
+ * The covariance is propagated every `EKF_COVARIANCE_PERIOD` seconds (and before every fusion), so calling this at high rates
+ * is cheap.
+ * @param ekf the filter
+ * @param dt time since the previous sample, s
+ * @param gyro angular rate, body frame, rad/s
+ * @param acc specific force, body frame, m/s^2
+ * @return true if successful, false if the inputs were invalid
+ */
+bool ekf_predict(EKF *ekf, f32 dt, const f32 gyro[3], const f32 acc[3]);
+
+/**
+ * Corrects roll and pitch with an accelerometer reading, assuming it measures gravity plus the centripetal acceleration
+ * implied by the current velocity and turn rate. Readings far from 1G are trusted less.
+ * @param ekf the filter
+ * @param acc specific force, body frame, m/s^2
+ * @param gyro angular rate, body frame, rad/s
+ * @return true if the reading was fused, false if it was rejected
+ */
+bool ekf_fuse_gravity(EKF *ekf, const f32 acc[3], const f32 gyro[3]);
+
+/**
+ * Corrects the heading with a magnetometer reading, taking the estimated declination into account.
+ * @param ekf the filter
+ * @param mag magnetic field, body frame (any unit)
+ * @return true if the reading was fused, false if it was rejected
+ */
+bool ekf_fuse_heading(EKF *ekf, const f32 mag[3]);
+
+/**
+ * Corrects position and velocity with a GPS fix; the first fix sets the origin.
+ * @param ekf the filter
+ * @param lat latitude, deg
+ * @param lng longitude, deg
+ * @param alt altitude, MSL, m
+ * @param velNE horizontal velocity (north, east), m/s, or NULL if unavailable
+ * @param hAcc estimated horizontal accuracy of the fix, m
+ * @return true if any part of the fix was fused, false if it was rejected
+ */
+bool ekf_fuse_gps(EKF *ekf, f64 lat, f64 lng, f32 alt, const f32 velNE[2], f32 hAcc);
+
+/**
+ * Gets the attitude as Euler angles (aerospace sequence: yaw, then pitch, then roll).
+ * @param ekf the filter
+ * @param roll pointer to where the roll should be stored (positive right wing down), rad, may be NULL
+ * @param pitch pointer to where the pitch should be stored (positive nose up), rad, may be NULL
+ * @param yaw pointer to where the yaw should be stored (heading, positive clockwise from north), rad, may be NULL
+ */
+void ekf_get_angles(const EKF *ekf, f32 *roll, f32 *pitch, f32 *yaw);
+
+/**
+ * Gets the estimated geodetic position.
+ * @param ekf the filter
+ * @param lat pointer to where the latitude should be stored, deg, may be NULL
+ * @param lng pointer to where the longitude should be stored, deg, may be NULL
+ * @param alt pointer to where the altitude (MSL) should be stored, m, may be NULL
+ * @return true if the position is known, false if no GPS fix has been fused yet
+ */
+bool ekf_get_position(const EKF *ekf, f64 *lat, f64 *lng, f32 *alt);
@@ -0,0 +1,141 @@
+/**
+ * Source file of pico-fbw: https://github.com/pico-fbw/pico-fbw
+ * Licensed under the GNU AGPL-3.0
+ */
+
+#include <stddef.h>
+
+#include "ekf.h"
+#include "madgwick.h"
+
+#include "estimator.h"
+
+/* --- Madgwick --- */
+
+#define MADGWICK_BETA 0.1f
+
+static void *madgwick_est_create(f32 rate) {
+    Madgwick *filter = madgwick_create();
+    if (filter)
+        madgwick_set_params(filter, rate, MADGWICK_BETA);
+    return filter;
+}
+
+static void madgwick_est_destroy(void *state) {
+    Madgwick *filter = state;
+    madgwick_destroy(&filter);
+}
+
+static bool madgwick_est_update_imu(void *state, f32 dt, const EstimatorIMU *imu) {
+    // The filter works in a Z-up frame (X forward, Y left, Z up), so Y and Z are flipped
+    // FIXME: the magnetometer is not used until it can be calibrated
+    return madgwick_update_dt(state, dt, imu->gyro[0], -imu->gyro[1], -imu->gyro[2], imu->acc[0], -imu->acc[1], -imu->acc[2],
+                              0.f, 0.f, 0.f);
+}
+
+static bool madgwick_est_get_attitude(void *state, f32 *roll, f32 *pitch, f32 *yaw) {
+    // In the filter's frame, its "pitch" is a rotation about X (roll), its "roll" a rotation about Y (nose down), and its yaw
+    // counterclockwise
+    f32 x, y, z;
+    if (!madgwick_get_angles(state, &y, &x, &z))
+        return false;
+    if (roll)
+        *roll = x;
+    if (pitch)
+        *pitch = -y;
+    if (yaw)
+        *yaw = -z;
+    return true;
+}
+
+const Estimator estimator_madgwick = {
+    .name = "Madgwick",
+    .usesMag = false,
+    .create = madgwick_est_create,
+    .destroy = madgwick_est_destroy,
+    .update_imu = madgwick_est_update_imu,
+    .update_gps = NULL,
+    .get_attitude = madgwick_est_get_attitude,
+    .get_position = NULL,
+};
+
+/* --- EKF --- */
+
+#define EKF_CORRECTION_PERIOD 0.01f // Minimum time between accelerometer or magnetometer corrections, s
+
+typedef struct EKFEstimator {
+    EKF ekf;
+    f32 sinceGravity, sinceHeading; // Time since the last accelerometer and magnetometer corrections, s
+    bool inUse;
+} EKFEstimator;
+
+// The EKF is large and there is only ever one AAHRS, so its state is allocated statically
+static EKFEstimator ekfEstimator;
+
+static void *ekf_est_create(f32 rate) {
+    (void)rate; // The EKF integrates with each sample's own dt
+    if (ekfEstimator.inUse)
+        return NULL;
+    ekf_reset(&ekfEstimator.ekf);
+    ekfEstimator.sinceGravity = 0.f;
+    ekfEstimator.sinceHeading = 0.f;
+    ekfEstimator.inUse = true;
+    return &ekfEstimator;
+}
+
+static void ekf_est_destroy(void *state) {
+    ((EKFEstimator *)state)->inUse = false;
+}
+
+static bool ekf_est_update_imu(void *state, f32 dt, const EstimatorIMU *imu) {
+    EKFEstimator *est = state;
+    bool haveMag = imu->mag[0] != 0.f || imu->mag[1] != 0.f || imu->mag[2] != 0.f;
+    if (!est->ekf.aligned) {
+        ekf_align(&est->ekf, imu->acc, haveMag ? imu->mag : NULL);
+        return true;
+    }
+    if (!ekf_predict(&est->ekf, dt, imu->gyro, imu->acc))
+        return false;
+    // Corrections are much more expensive than predictions, so they run at a fixed rate regardless of the sample rate
+    est->sinceGravity += dt;
+    est->sinceHeading += dt;
+    if (est->sinceGravity >= EKF_CORRECTION_PERIOD) {
+        est->sinceGravity = 0.f;
+        ekf_fuse_gravity(&est->ekf, imu->acc, imu->gyro);
+    }
+    if (haveMag && est->sinceHeading >= EKF_CORRECTION_PERIOD) {
+        est->sinceHeading = 0.f;
+        ekf_fuse_heading(&est->ekf, imu->mag);
+    }
+    return true;
+}
+
+static bool ekf_est_update_gps(void *state, const EstimatorGPS *gps) {
+    EKFEstimator *est = state;
+    if (!est->ekf.aligned)
+        return false;
+    return ekf_fuse_gps(&est->ekf, gps->lat, gps->lng, gps->alt, gps->hasVel ? gps->vel : NULL, gps->hAcc);
+}
+
+static bool ekf_est_get_attitude(void *state, f32 *roll, f32 *pitch, f32 *yaw) {
+    EKFEstimator *est = state;
+    if (!est->ekf.aligned)
+        return false;
+    ekf_get_angles(&est->ekf, roll, pitch, yaw);
+    return true;
+}
+
+static bool ekf_est_get_position(void *state, f64 *lat, f64 *lng, f32 *alt) {
+    return ekf_get_position(&((EKFEstimator *)state)->ekf, lat, lng, alt);
+}
+
+const Estimator estimator_ekf = {
+    .name = "EKF",
+    .usesMag = true,
+    .create = ekf_est_create,
+    .destroy = ekf_est_destroy,
+    .update_imu = ekf_est_update_imu,
+    .update_gps = ekf_est_update_gps,
+    .get_attitude = ekf_est_get_attitude,
+    .get_position = ekf_est_get_position,
+};
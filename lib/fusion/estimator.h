@@ -0,0 +1,77 @@
+#pragma once
+
+#include <stdbool.h>
+#include "platform/types.h"
+
+// Common interface to the state estimators (attitude, and where supported, position) that AAHRS can run.
+// All data passed through this interface is in the body frame: X forward, Y right, Z down (FRD), in SI units.
+
+typedef struct EstimatorIMU {
+    f32 gyro[3]; // Angular rate, rad/s
+    f32 acc[3];  // Specific force, m/s^2 (reads (0, 0, -9.81) when level and at rest)
+    f32 mag[3];  // Magnetic field, any unit, or all zeros if there is no new reading
+} EstimatorIMU;
+
+typedef struct EstimatorGPS {
+    f64 lat, lng; // deg
+    f32 alt;      // MSL, m
+    f32 vel[2];   // Horizontal velocity (north, east), m/s
+    bool hasVel;  // Whether `vel` is valid
+    f32 hAcc;     // Estimated horizontal accuracy, m
+} EstimatorGPS;
+
+typedef void *(*estimator_create_fn)(f32 rate);
+typedef void (*estimator_destroy_fn)(void *state);
+typedef bool (*estimator_update_imu_fn)(void *state, f32 dt, const EstimatorIMU *imu);
+typedef bool (*estimator_update_gps_fn)(void *state, const EstimatorGPS *gps);
+typedef bool (*estimator_get_attitude_fn)(void *state, f32 *roll, f32 *pitch, f32 *yaw);
+typedef bool (*estimator_get_position_fn)(void *state, f64 *lat, f64 *lng, f32 *alt);
+
+typedef struct Estimator {
+    const char *name; // Human-readable identifier of the estimator
+    bool usesMag;     // Whether the estimator makes use of magnetometer readings (if not, they need not be read)
+    /**
+     * Creates an instance of the estimator.
+     * @param rate nominal rate at which IMU samples will be fed in, Hz
+     * @return the estimator's state, or NULL if it could not be created
+     */
+    estimator_create_fn create;
+    /**
+     * Destroys an instance of the estimator.
+     * @param state the estimator's state
+     */
+    estimator_destroy_fn destroy;
+    /**
+     * Feeds one IMU sample into the estimator.
+     * @param state the estimator's state
+     * @param dt time elapsed since the previous sample, s
+     * @param imu the sample
+     * @return true if successful, false if not
+     */
+    estimator_update_imu_fn update_imu;
+    /**
+     * Feeds one GPS fix into the estimator. NULL if the estimator does not use GPS.
+     * @param state the estimator's state
+     * @param gps the fix
+     * @return true if the fix was used, false if not
+     */
+    estimator_update_gps_fn update_gps;
+    /**
+     * Gets the estimated attitude, in radians: roll (positive right wing down), pitch (positive nose up), and yaw (heading,
+     * positive clockwise). Any of the pointers may be NULL.
+     * @param state the estimator's state
+     * @return true if successful, false if not
+     */
+    estimator_get_attitude_fn get_attitude;
+    /**
+     * Gets the estimated position. NULL if the estimator does not estimate position. Any of the pointers may be NULL.
+     * @param state the estimator's state
+     * @return true if the position is known, false if not
+     */
+    estimator_get_position_fn get_position;
+} Estimator;
+
+// Madgwick's gradient descent filter, attitude only
+extern const Estimator estimator_madgwick;
+// Error-state extended Kalman filter (see ekf.h), attitude and position
+extern const Estimator estimator_ekf;
@@ -16,6 +16,7 @@
 
 #include <math.h>
 #include <stdlib.h>
+#include "platform/time.h"
 
 #include "drivers/drivers.h"
 
@@ -57,3 +58,117 @@ bool fusion_magnetometer_present(IMU *imu) {
         return false;
     return imu->mag != NULL;
 }
+
+bool fusion_imu_get(IMU *imu, f32 acc[3], f32 gyro[3], f32 mag[3]) {
+    if (!imu)
+        return false;
+    Accelerometer *a = acc ? imu->acc : NULL;
+    Gyroscope *g = gyro ? imu->gyro : NULL;
+    Magnetometer *m = mag ? imu->mag : NULL;
+
+    // The burst path is only usable if a single driver covers every sensor that was asked for
+    read_all_fn read_all = a ? a->read_all : NULL;
+    if (read_all && (!g || g->read_all == read_all) && (!m || m->read_all == read_all)) {
+        if (!read_all(a, g, m, imu->state)) {
+            printfbw(aahrs, "ERROR: could not read from IMU");
+            return false;
+        }
+        if (a && !fusion_accelerometer_convert(imu, &acc[0], &acc[1], &acc[2]))
+            return false;
+        if (g && !fusion_gyroscope_convert(imu, &gyro[0], &gyro[1], &gyro[2]))
+            return false;
+        if (m && !fusion_magnetometer_convert(imu, &mag[0], &mag[1], &mag[2]))
+            return false;
+        return true;
+    }
+
+    bool ok = true;
+    if (acc)
+        ok &= fusion_accelerometer_get(imu, &acc[0], &acc[1], &acc[2]);
+    if (gyro)
+        ok &= fusion_gyroscope_get(imu, &gyro[0], &gyro[1], &gyro[2]);
+    if (mag)
+        ok &= fusion_magnetometer_get(imu, &mag[0], &mag[1], &mag[2]);
+    return ok;
+}
+
+bool fusion_fifo_enable(IMU *imu, bool enable) {
+    if (!imu || !imu->acc || !imu->acc->fifo_enable || !imu->acc->fifo_read)
+        return false;
+    if (imu->gyro && imu->gyro->fifo_enable != imu->acc->fifo_enable)
+        return false;
+
+    if (enable) {
+        // The gyro sets the FIFO's write rate if present
+        f32 odr;
+        bool gotODR = imu->gyro ? fusion_gyroscope_get_odr(imu, &odr) : fusion_accelerometer_get_odr(imu, &odr);
+        if (!gotODR || odr <= 0)
+            return false;
+        imu->fifo_period = 1E6f / odr;
+        imu->fifo_last_timestamp = 0;
+    }
+    if (!imu->acc->fifo_enable(imu->acc, imu->gyro, enable, imu->state)) {
+        printfbw(aahrs, "ERROR: could not %s IMU FIFO", enable ? "enable" : "disable");
+        return false;
+    }
+    imu->fifo_enabled = enable;
+    return true;
+}
+
+i32 fusion_fifo_read(IMU *imu, IMUSample samples[], u32 max, bool *overflow) {
+    RawIMUSample raw[FUSION_FIFO_BATCH];
+    if (!imu || !imu->fifo_enabled || !samples)
+        return -1;
+    if (max > FUSION_FIFO_BATCH)
+        max = FUSION_FIFO_BATCH;
+
+    bool lost = false;
+    u32 pending = 0;
+    i32 n = imu->acc->fifo_read(imu->acc, imu->gyro, raw, max, &lost, &pending, imu->state);
+    if (overflow)
+        *overflow = lost;
+    if (n <= 0)
+        return n;
+    // Any samples left in the FIFO are newer than these, so the newest one read was taken that many periods ago (but not
+    // before the previous batch's last one)
+    u64 now = time_us(), last = imu->fifo_last_timestamp;
+    u64 behind = (u64)(imu->fifo_period * pending);
+    now = behind < now - last ? now - behind : last;
+
+    // Stamp the newest sample with that time and space the rest one period apart before it.
+    // If that would place the first sample at or before the previous batch's last one (the FIFO was read faster than the
+    // period estimate suggests, for example due to clock mismatch), spread the samples evenly since the last read instead.
+    u64 span = (u64)(imu->fifo_period * (n - 1));
+    bool evenly = !lost && last != 0 && (span >= now || now - span <= last);
+    for (i32 i = 0; i < n; i++) {
+        Accelerometer *acc = imu->acc;
+        Gyroscope *gyro = imu->gyro;
+        acc->ax = raw[i].ax;
+        acc->ay = raw[i].ay;
+        acc->az = raw[i].az;
+        fusion_accelerometer_convert(imu, &samples[i].acc[0], &samples[i].acc[1], &samples[i].acc[2]);
+        if (gyro) {
+            gyro->gx = raw[i].gx;
+            gyro->gy = raw[i].gy;
+            gyro->gz = raw[i].gz;
+            fusion_gyroscope_convert(imu, &samples[i].gyro[0], &samples[i].gyro[1], &samples[i].gyro[2]);
+        } else
+            samples[i].gyro[0] = samples[i].gyro[1] = samples[i].gyro[2] = 0.f;
+
+        if (evenly)
+            samples[i].timestamp = last + (now - last) * (u64)(i + 1) / (u64)n;
+        else
+            samples[i].timestamp = now - (u64)(imu->fifo_period * (n - 1 - i));
+
+        // Nothing is known about the time before the first sample, or across a gap where samples were lost
+        u64 previous = i > 0 ? samples[i - 1].timestamp : (lost ? 0 : last);
+        f32 dt = (f32)(samples[i].timestamp - previous);
+        if (previous == 0 || !(dt > 0.f))
+            dt = imu->fifo_period;
+        else if (dt > imu->fifo_period * FUSION_FIFO_DT_PERIODS)
+            dt = imu->fifo_period * FUSION_FIFO_DT_PERIODS;
+        samples[i].dt = dt / 1E6f;
+    }
+    imu->fifo_last_timestamp = samples[n - 1].timestamp;
+    return n;
+}
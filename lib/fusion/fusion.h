@@ -7,6 +7,17 @@
 
 #define NOADDR 0xFF // Denotes no address (for devices with only one I2C address)
 
+// A single converted sample read from an IMU's FIFO
+#define FUSION_FIFO_BATCH 32     // Maximum number of samples fusion_fifo_read() will read at once
+#define FUSION_FIFO_DT_PERIODS 4 // Longest time a sample is said to cover, in sample periods (longer gaps are stalls)
+
+typedef struct IMUSample {
+    f32 acc[3];    // G
+    f32 gyro[3];   // DPS
+    u64 timestamp; // System time at which the sample was taken, in us
+    f32 dt;        // Time since the previous sample, in s
+} IMUSample;
+
 typedef bool (*detect_fn)(byte addr, void *state);
 typedef void *(*create_state_fn)();
 typedef void *(*destroy_state_fn)(void *state);
@@ -49,6 +60,26 @@ bool fusion_accelerometer_present(IMU *imu);
 bool fusion_gyroscope_present(IMU *imu);
 bool fusion_magnetometer_present(IMU *imu);
 
+// Return data from all present sensors (accelerometer in G, gyroscope in DPS, magnetometer in Gauss).
+// When the sensors all come from the same device, they are read together in a single burst, which is both faster and
+// guarantees that all samples are from the same instant; otherwise, this is equivalent to calling each sensor's get function.
+// Any of `acc`, `gyro`, and `mag` may be NULL to skip that sensor.
+bool fusion_imu_get(IMU *imu, f32 acc[3], f32 gyro[3], f32 mag[3]);
+
+// Start or stop buffering accelerometer and gyroscope samples in the IMU's on-chip FIFO.
+// Returns false if the IMU has no FIFO (or its accelerometer and gyroscope are not buffered by the same one), in which case
+// the caller should keep polling with fusion_imu_get().
+bool fusion_fifo_enable(IMU *imu, bool enable);
+
+// Drain up to `max` samples from the IMU's FIFO into `samples`, oldest first.
+// The FIFO does not store timestamps, so they are reconstructed from the ODR: the newest sample is stamped with the time
+// of the read and the ones before it are spaced one sample period apart. `overflow` (may be NULL) is set if samples were
+// lost since the last read; the first returned sample then follows a gap rather than the previously returned sample.
+// Each sample's `dt` is the time since the one before it, which is taken to be one period for the first sample read and the
+// first after a gap, and is never more than FUSION_FIFO_DT_PERIODS periods.
+// Returns the number of samples read, or -1 on error.
+i32 fusion_fifo_read(IMU *imu, IMUSample samples[], u32 max, bool *overflow);
+
 /* Accelerometer functions, see accel.c */
 
 // Scans the I2C bus for a supported accelerometer and initializes one if found
@@ -57,6 +88,9 @@ bool fusion_accelerometer_find(IMU *imu, const AccelerometerOptions *opts);
 // Return accelerometer data in units of G
 bool fusion_accelerometer_get(IMU *imu, f32 *x, f32 *y, f32 *z);
 
+// Convert the last raw accelerometer reading into units of G without reading from the device again
+bool fusion_accelerometer_convert(IMU *imu, f32 *x, f32 *y, f32 *z);
+
 // Get/set accelerometer offset in units of G
 bool fusion_accelerometer_get_offset(IMU *imu, f32 *x, f32 *y, f32 *z);
 bool fusion_accelerometer_set_offset(IMU *imu, f32 x, f32 y, f32 z);
@@ -81,6 +115,9 @@ bool fusion_gyroscope_find(IMU *imu, const GyroscopeOptions *opts);
 // Return gyroscope data in units of degrees/sec
 bool fusion_gyroscope_get(IMU *imu, f32 *x, f32 *y, f32 *z);
 
+// Convert the last raw gyroscope reading into units of DPS without reading from the device again
+bool fusion_gyroscope_convert(IMU *imu, f32 *x, f32 *y, f32 *z);
+
 // Get/set gyroscope offset in units of degrees/sec
 bool fusion_gyroscope_get_offset(IMU *imu, f32 *x, f32 *y, f32 *z);
 bool fusion_gyroscope_set_offset(IMU *imu, f32 x, f32 y, f32 z);
@@ -115,6 +152,9 @@ bool fusion_magnetometer_find(IMU *imu, const MagnetometerOptions *opts);
 // Return magnetometer data in units of Gauss
 bool fusion_magnetometer_get(IMU *imu, f32 *x, f32 *y, f32 *z);
 
+// Convert the last raw magnetometer reading into units of Gauss without reading from the device again
+bool fusion_magnetometer_convert(IMU *imu, f32 *x, f32 *y, f32 *z);
+
 // Get/set magnetometer scale in units of Gauss
 // The driver will set the scale to at least the given `scale` parameter, eg 400
 // Will return true upon success, false if setting the scale is not feasible.
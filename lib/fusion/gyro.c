@@ -29,6 +29,9 @@ GyroscopeDetails gyroscopes[] = {
      {0x69, 0x68},
      {.create = icm20948_gyro_create,
       .read = icm20948_gyro_read,
+      .read_all = icm20948_read_all,
+      .fifo_enable = icm20948_fifo_enable,
+      .fifo_read = icm20948_fifo_read,
       .get_odr = icm20948_gyro_get_odr,
       .set_odr = icm20948_gyro_set_odr,
       .get_scale = icm20948_gyro_get_scale,
@@ -115,6 +118,12 @@ bool fusion_gyroscope_get(IMU *imu, f32 *x, f32 *y, f32 *z) {
         printfbw(aahrs, "ERROR: could not read from gyroscope");
         return false;
     }
+    return fusion_gyroscope_convert(imu, x, y, z);
+}
+
+bool fusion_gyroscope_convert(IMU *imu, f32 *x, f32 *y, f32 *z) {
+    if (!imu->gyro)
+        return false;
 
     // LOG(LL_DEBUG, ("Raw: gx=%d gy=%d gz=%d", imu->gyro->gx, imu->gyro->gy, imu->gyro->gz));
     if (x) {
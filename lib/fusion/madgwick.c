@@ -88,7 +88,7 @@ bool madgwick_reset(Madgwick *filter) {
     return true;
 }
 
-static bool madgwick_updateIMU(Madgwick *filter, f32 gx, f32 gy, f32 gz, f32 ax, f32 ay, f32 az) {
+static bool madgwick_updateIMU(Madgwick *filter, f32 dt, f32 gx, f32 gy, f32 gz, f32 ax, f32 ay, f32 az) {
     f32 recipNorm;
     f32 s0, s1, s2, s3;
     f32 qDot1, qDot2, qDot3, qDot4;
@@ -144,10 +144,10 @@ static bool madgwick_updateIMU(Madgwick *filter, f32 gx, f32 gy, f32 gz, f32 ax,
     }
 
     // Integrate rate of change of quaternion to yield quaternion
-    filter->q0 += qDot1 * filter->inv_freq;
-    filter->q1 += qDot2 * filter->inv_freq;
-    filter->q2 += qDot3 * filter->inv_freq;
-    filter->q3 += qDot4 * filter->inv_freq;
+    filter->q0 += qDot1 * dt;
+    filter->q1 += qDot2 * dt;
+    filter->q2 += qDot3 * dt;
+    filter->q3 += qDot4 * dt;
 
     // Normalise quaternion
     recipNorm = invSqrt(filter->q0 * filter->q0 + filter->q1 * filter->q1 + filter->q2 * filter->q2 + filter->q3 * filter->q3);
@@ -164,6 +164,13 @@ bool madgwick_update(Madgwick *filter, f32 gx, f32 gy, f32 gz, f32 ax, f32 ay, f
     if (!filter) {
         return false;
     }
+    return madgwick_update_dt(filter, filter->inv_freq, gx, gy, gz, ax, ay, az, mx, my, mz);
+}
+
+bool madgwick_update_dt(Madgwick *filter, f32 dt, f32 gx, f32 gy, f32 gz, f32 ax, f32 ay, f32 az, f32 mx, f32 my, f32 mz) {
+    if (!filter || !(dt > 0.0f)) {
+        return false;
+    }
     f32 recipNorm;
     f32 s0, s1, s2, s3;
     f32 qDot1, qDot2, qDot3, qDot4;
@@ -173,7 +180,7 @@ bool madgwick_update(Madgwick *filter, f32 gx, f32 gy, f32 gz, f32 ax, f32 ay, f
 
     // Use IMU algorithm if magnetometer measurement invalid (avoids NaN in magnetometer normalisation)
     if ((mx == 0.0f) && (my == 0.0f) && (mz == 0.0f)) {
-        madgwick_updateIMU(filter, gx, gy, gz, ax, ay, az);
+        madgwick_updateIMU(filter, dt, gx, gy, gz, ax, ay, az);
         return false;
     }
 
@@ -263,10 +270,10 @@ bool madgwick_update(Madgwick *filter, f32 gx, f32 gy, f32 gz, f32 ax, f32 ay, f
     }
 
     // Integrate rate of change of quaternion to yield quaternion
-    filter->q0 += qDot1 * filter->inv_freq;
-    filter->q1 += qDot2 * filter->inv_freq;
-    filter->q2 += qDot3 * filter->inv_freq;
-    filter->q3 += qDot4 * filter->inv_freq;
+    filter->q0 += qDot1 * dt;
+    filter->q1 += qDot2 * dt;
+    filter->q2 += qDot3 * dt;
+    filter->q3 += qDot4 * dt;
 
     // Normalise quaternion
     recipNorm = invSqrt(filter->q0 * filter->q0 + filter->q1 * filter->q1 + filter->q2 * filter->q2 + filter->q3 * filter->q3);
@@ -44,6 +44,13 @@ bool madgwick_reset(Madgwick *filter);
  */
 bool madgwick_update(Madgwick *filter, f32 gx, f32 gy, f32 gz, f32 ax, f32 ay, f32 az, f32 mx, f32 my, f32 mz);
 
+/* Same as `madgwick_update()`, but integrates over `dt` seconds instead of the
+ * period set by `madgwick_set_params()`. Use this when samples do not arrive at
+ * a fixed rate, passing the time elapsed since the previous sample.
+ * Returns false if `dt` is not positive.
+ */
+bool madgwick_update_dt(Madgwick *filter, f32 dt, f32 gx, f32 gy, f32 gz, f32 ax, f32 ay, f32 az, f32 mx, f32 my, f32 mz);
+
 /*
  * Returns AHRS Quaternion, as values between -1.0 and +1.0.
  * Each of q0, q1, q2, q3 pointers may be NULL, in which case they will not be
@@ -29,6 +29,7 @@ MagnetometerDetails magnetometers[] = {
      {0x0C, NOADDR},
      {.create = icm20948_mag_create,
       .read = icm20948_mag_read,
+      .read_all = icm20948_read_all,
       .get_odr = icm20948_mag_get_odr,
       .set_odr = icm20948_mag_set_odr},
      icm20948_mag_detect,
@@ -108,14 +109,20 @@ bool fusion_magnetometer_find(IMU *imu, const MagnetometerOptions *opts) {
 }
 
 bool fusion_magnetometer_get(IMU *imu, f32 *x, f32 *y, f32 *z) {
-    f32 mxb, myb, mzb;
-
     if (!imu->mag || !imu->mag->read)
         return false;
     if (!imu->mag->read(imu->mag, imu->state)) {
         printfbw(aahrs, "ERROR: could not read from magnetometer");
         return false;
     }
+    return fusion_magnetometer_convert(imu, x, y, z);
+}
+
+bool fusion_magnetometer_convert(IMU *imu, f32 *x, f32 *y, f32 *z) {
+    f32 mxb, myb, mzb;
+
+    if (!imu->mag)
+        return false;
 
     // LOG(LL_DEBUG, ("Raw: mx=%d my=%d mz=%d", imu->mag->mx, imu->mag->my, imu->mag->mz));
     mxb = imu->mag->bias[0] * imu->mag->mx * imu->mag->scale;
@@ -0,0 +1,338 @@
+/**
+ * Source file of pico-fbw: https://github.com/pico-fbw/pico-fbw
+ * Licensed under the GNU AGPL-3.0
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "jsonreader.h"
+
+static inline bool is_digit(char c) {
+    return c >= '0' && c <= '9';
+}
+
+static i32 hex_value(char c) {
+    if (c >= '0' && c <= '9')
+        return c - '0';
+    if (c >= 'a' && c <= 'f')
+        return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F')
+        return c - 'A' + 10;
+    return -1;
+}
+
+// Returns the next character of the document, or a null character at its end
+static inline char peek(const JSONReader *json) {
+    return json->pos < json->len ? json->str[json->pos] : '\0';
+}
+
+static void skip_whitespace(JSONReader *json) {
+    char c = peek(json);
+    while (c == ' ' || c == '\t' || c == '\n' || c == '\r') {
+        json->pos++;
+        c = peek(json);
+    }
+}
+
+static void skip_digits(JSONReader *json) {
+    while (is_digit(peek(json)))
+        json->pos++;
+}
+
+// Reads a key or string, starting after its opening quote; its escapes are only checked here, and are decoded when it's used
+static bool read_string(JSONReader *json) {
+    json->text = &json->str[json->pos];
+    while (true) {
+        char c = peek(json);
+        if ((u8)c < 0x20)
+            return false; // Control characters must be escaped (this also catches the end of the document)
+        json->pos++;
+        if (c == '"') {
+            json->textLen = (u32)(&json->str[json->pos - 1] - json->text);
+            return true;
+        }
+        if (c != '\\')
+            continue;
+        c = peek(json);
+        json->pos++;
+        if (c == 'u') {
+            for (u32 i = 0; i < 4; i++, json->pos++) {
+                if (hex_value(peek(json)) < 0)
+                    return false;
+            }
+        } else if (c == '\0' || !strchr("\"\\/bfnrt", c))
+            return false;
+    }
+}
+
+static bool read_number(JSONReader *json) {
+    u32 start = json->pos;
+    if (peek(json) == '-')
+        json->pos++;
+    // No leading zeros are allowed
+    if (peek(json) == '0')
+        json->pos++;
+    else if (is_digit(peek(json)))
+        skip_digits(json);
+    else
+        return false;
+    if (peek(json) == '.') {
+        json->pos++;
+        if (!is_digit(peek(json)))
+            return false;
+        skip_digits(json);
+    }
+    if (peek(json) == 'e' || peek(json) == 'E') {
+        json->pos++;
+        if (peek(json) == '+' || peek(json) == '-')
+            json->pos++;
+        if (!is_digit(peek(json)))
+            return false;
+        skip_digits(json);
+    }
+    // The document may not be null-terminated after the number, so it's copied out to be converted
+    u32 len = json->pos - start;
+    if (len >= JSONR_NUMBER_MAX)
+        return false;
+    char buf[JSONR_NUMBER_MAX];
+    memcpy(buf, &json->str[start], len);
+    buf[len] = '\0';
+    json->number = strtod(buf, NULL);
+    return true;
+}
+
+static bool read_literal(JSONReader *json, const char *literal) {
+    u32 len = (u32)strlen(literal);
+    if (json->len - json->pos < len || strncmp(&json->str[json->pos], literal, len) != 0)
+        return false;
+    json->pos += len;
+    return true;
+}
+
+static bool push(JSONReader *json, bool object) {
+    if (json->depth >= JSONR_DEPTH_MAX)
+        return false;
+    json->depth++;
+    u32 bit = 1u << (json->depth - 1);
+    if (object)
+        json->inObject |= bit;
+    else
+        json->inObject &= ~bit;
+    json->hasItems &= ~bit;
+    return true;
+}
+
+static JSONToken read_value(JSONReader *json) {
+    switch (peek(json)) {
+        case '{':
+            json->pos++;
+            return push(json, true) ? JSONR_OBJECT_BEGIN : JSONR_ERROR;
+        case '[':
+            json->pos++;
+            return push(json, false) ? JSONR_ARRAY_BEGIN : JSONR_ERROR;
+        case '"':
+            json->pos++;
+            return read_string(json) ? JSONR_STRING : JSONR_ERROR;
+        case 't':
+            return read_literal(json, "true") ? JSONR_TRUE : JSONR_ERROR;
+        case 'f':
+            return read_literal(json, "false") ? JSONR_FALSE : JSONR_ERROR;
+        case 'n':
+            return read_literal(json, "null") ? JSONR_NULL : JSONR_ERROR;
+        default:
+            return read_number(json) ? JSONR_NUMBER : JSONR_ERROR;
+    }
+}
+
+static JSONToken read_token(JSONReader *json) {
+    if (json->token == JSONR_ERROR)
+        return JSONR_ERROR;
+    skip_whitespace(json);
+    if (json->done)
+        return peek(json) == '\0' ? JSONR_END : JSONR_ERROR; // Nothing but whitespace may follow the top-level value
+    if (json->depth == 0 || json->afterKey) {
+        json->afterKey = false;
+        JSONToken token = read_value(json);
+        if (json->depth == 0)
+            json->done = true; // A top-level value that isn't a container is the whole document
+        return token;
+    }
+
+    u32 bit = 1u << (json->depth - 1);
+    bool inObject = (json->inObject & bit) != 0;
+    if (peek(json) == (inObject ? '}' : ']')) {
+        json->pos++;
+        json->depth--;
+        if (json->depth == 0)
+            json->done = true;
+        return inObject ? JSONR_OBJECT_END : JSONR_ARRAY_END;
+    }
+    // Items after the first are separated by commas
+    if (json->hasItems & bit) {
+        if (peek(json) != ',')
+            return JSONR_ERROR;
+        json->pos++;
+        skip_whitespace(json);
+    } else
+        json->hasItems |= bit;
+    if (!inObject)
+        return read_value(json);
+    // Items of an object start with a key
+    if (peek(json) != '"')
+        return JSONR_ERROR;
+    json->pos++;
+    if (!read_string(json))
+        return JSONR_ERROR;
+    skip_whitespace(json);
+    if (peek(json) != ':')
+        return JSONR_ERROR;
+    json->pos++;
+    json->afterKey = true;
+    return JSONR_KEY;
+}
+
+static u32 encode_utf8(u32 cp, char out[4]) {
+    if (cp < 0x80) {
+        out[0] = (char)cp;
+        return 1;
+    }
+    if (cp < 0x800) {
+        out[0] = (char)(0xC0 | (cp >> 6));
+        out[1] = (char)(0x80 | (cp & 0x3F));
+        return 2;
+    }
+    if (cp < 0x10000) {
+        out[0] = (char)(0xE0 | (cp >> 12));
+        out[1] = (char)(0x80 | ((cp >> 6) & 0x3F));
+        out[2] = (char)(0x80 | (cp & 0x3F));
+        return 3;
+    }
+    out[0] = (char)(0xF0 | (cp >> 18));
+    out[1] = (char)(0x80 | ((cp >> 12) & 0x3F));
+    out[2] = (char)(0x80 | ((cp >> 6) & 0x3F));
+    out[3] = (char)(0x80 | (cp & 0x3F));
+    return 4;
+}
+
+static u32 hex4(const char *str) {
+    return (u32)((hex_value(str[0]) << 12) | (hex_value(str[1]) << 8) | (hex_value(str[2]) << 4) | hex_value(str[3]));
+}
+
+/**
+ * Decodes the next character of a key or string.
+ * @param text the key or string (escaped, as checked by `read_string()`)
+ * @param len the length of `text`
+ * @param pos position of the character in `text`, moved past it
+ * @param out where to store the character, encoded as UTF-8
+ * @return the length of the character
+ */
+static u32 unescape(const char *text, u32 len, u32 *pos, char out[4]) {
+    char c = text[(*pos)++];
+    if (c != '\\') {
+        out[0] = c;
+        return 1;
+    }
+    c = text[(*pos)++];
+    switch (c) {
+        case 'b':
+            out[0] = '\b';
+            return 1;
+        case 'f':
+            out[0] = '\f';
+            return 1;
+        case 'n':
+            out[0] = '\n';
+            return 1;
+        case 'r':
+            out[0] = '\r';
+            return 1;
+        case 't':
+            out[0] = '\t';
+            return 1;
+        case 'u': {
+            u32 cp = hex4(&text[*pos]);
+            *pos += 4;
+            // Characters outside the basic multilingual plane are escaped as a pair of surrogates
+            if (cp >= 0xD800 && cp < 0xDC00 && *pos + 6 <= len && text[*pos] == '\\' && text[*pos + 1] == 'u') {
+                u32 low = hex4(&text[*pos + 2]);
+                if (low >= 0xDC00 && low < 0xE000) {
+                    cp = 0x10000 + ((cp - 0xD800) << 10) + (low - 0xDC00);
+                    *pos += 6;
+                }
+            }
+            return encode_utf8(cp, out);
+        }
+        default: // Quote, backslash, or slash
+            out[0] = c;
+            return 1;
+    }
+}
+
+static inline bool has_text(const JSONReader *json) {
+    return json->token == JSONR_KEY || json->token == JSONR_STRING;
+}
+
+void jsonr_init(JSONReader *json, const char *str, u32 len) {
+    *json = (JSONReader){.str = str, .len = len, .token = JSONR_NONE};
+}
+
+JSONToken jsonr_next(JSONReader *json) {
+    json->token = read_token(json);
+    return json->token;
+}
+
+bool jsonr_skip(JSONReader *json) {
+    switch (jsonr_next(json)) {
+        case JSONR_OBJECT_BEGIN:
+        case JSONR_ARRAY_BEGIN: {
+            // Read until the container is closed
+            u32 depth = json->depth - 1;
+            while (json->depth > depth) {
+                JSONToken token = jsonr_next(json);
+                if (token == JSONR_ERROR || token == JSONR_END)
+                    return false;
+            }
+            return true;
+        }
+        case JSONR_STRING:
+        case JSONR_NUMBER:
+        case JSONR_TRUE:
+        case JSONR_FALSE:
+        case JSONR_NULL:
+            return true;
+        default:
+            return false;
+    }
+}
+
+bool jsonr_equals(const JSONReader *json, const char *str) {
+    if (!has_text(json))
+        return false;
+    u32 pos = 0;
+    while (pos < json->textLen) {
+        char c[4];
+        u32 n = unescape(json->text, json->textLen, &pos, c);
+        for (u32 i = 0; i < n; i++, str++) {
+            if (*str == '\0' || *str != c[i])
+                return false;
+        }
+    }
+    return *str == '\0';
+}
+
+bool jsonr_string(const JSONReader *json, char *buf, u32 size) {
+    if (!has_text(json) || size == 0)
+        return false;
+    u32 pos = 0, len = 0;
+    while (pos < json->textLen) {
+        char c[4];
+        u32 n = unescape(json->text, json->textLen, &pos, c);
+        if (len + n >= size)
+            return false; // One byte is always kept free for the null terminator
+        memcpy(&buf[len], c, n);
+        len += n;
+    }
+    buf[len] = '\0';
+    return true;
+}
@@ -0,0 +1,93 @@
+#pragma once
+
+#include <stdbool.h>
+#include "platform/types.h"
+
+// Streaming JSON reader, the counterpart of lib/jsonwriter.h: pulls a document apart one token at a time, straight out of the
+// string it's given, so reading a document (of any size) never touches the heap or builds a tree of it. The document's syntax
+// is checked as it's read; values are handled (or skipped) by the caller as they come, e.g.
+//     if (jsonr_next(&json) != JSONR_OBJECT_BEGIN)
+//         return false;
+//     while (jsonr_next(&json) == JSONR_KEY) {
+//         if (jsonr_equals(&json, "mode") && jsonr_next(&json) == JSONR_NUMBER)
+//             mode = json.number;
+//         else if (!jsonr_skip(&json))
+//             return false;
+//     }
+//     return json.token == JSONR_OBJECT_END;
+
+#define JSONR_DEPTH_MAX 32  // Deepest nesting of objects and arrays
+#define JSONR_NUMBER_MAX 40 // Longest number that can be read
+
+// clang-format off
+typedef enum JSONToken {
+    JSONR_NONE,  // Nothing has been read yet
+    JSONR_ERROR, // The document is malformed (every token after this is an error too)
+    JSONR_END,   // The document has been read in full
+    JSONR_OBJECT_BEGIN,
+    JSONR_OBJECT_END,
+    JSONR_ARRAY_BEGIN,
+    JSONR_ARRAY_END,
+    JSONR_KEY,
+    JSONR_STRING,
+    JSONR_NUMBER,
+    JSONR_TRUE,
+    JSONR_FALSE,
+    JSONR_NULL,
+} JSONToken;
+// clang-format on
+
+typedef struct JSONReader {
+    const char *str;
+    u32 len;
+    u32 pos;       // Position of the next character to read
+    u32 depth;
+    u32 inObject;  // Bit n is set if the container at depth n + 1 is an object (rather than an array)
+    u32 hasItems;  // Bit n is set if the container at depth n + 1 already holds an item
+    bool afterKey; // Whether a key was just read (so a value must follow)
+    bool done;     // Whether the top-level value has been read
+    // The last token read
+    JSONToken token;
+    const char *text; // Contents of a key or string (still escaped, not null-terminated)
+    u32 textLen;
+    f64 number; // Value of a number
+} JSONReader;
+
+/**
+ * Sets up a reader.
+ * @param json the reader
+ * @param str the document; it isn't copied, so it must be kept around for as long as it's being read
+ * @param len the length of the document (reading also stops at a null terminator)
+ */
+void jsonr_init(JSONReader *json, const char *str, u32 len);
+
+/**
+ * Reads the next token of the document.
+ * @param json the reader
+ * @return the token (also kept in `json->token`)
+ */
+JSONToken jsonr_next(JSONReader *json);
+
+/**
+ * Reads and discards the next value of the document, including everything inside it if it's an object or an array.
+ * Usually used after a key that isn't of interest.
+ * @param json the reader
+ * @return true if a value was skipped, false if the document is malformed or there was no value to skip
+ */
+bool jsonr_skip(JSONReader *json);
+
+/**
+ * @param json the reader
+ * @param str a (null-terminated) string
+ * @return true if the last token was a key or a string that equals `str` (once unescaped)
+ */
+bool jsonr_equals(const JSONReader *json, const char *str);
+
+/**
+ * Copies the last key or string read, unescaped and null-terminated.
+ * @param json the reader
+ * @param buf where to store the string
+ * @param size the size of `buf`
+ * @return true if successful, false if the last token wasn't a key or string or it didn't fit into `buf`
+ */
+bool jsonr_string(const JSONReader *json, char *buf, u32 size);
@@ -0,0 +1,204 @@
+/**
+ * Source file of pico-fbw: https://github.com/pico-fbw/pico-fbw
+ * Licensed under the GNU AGPL-3.0
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "jsonwriter.h"
+
+static void flush(JSONWriter *json) {
+    if (json->len > 0)
+        json->sink(json->buf, json->len, json->ctx);
+    json->len = 0;
+}
+
+static void put(JSONWriter *json, const char *data, u32 len) {
+    json->total += len;
+    while (len > 0) {
+        // One byte is always kept free for the null terminator
+        u32 space = json->size > json->len + 1 ? json->size - json->len - 1 : 0;
+        if (space == 0) {
+            if (!json->sink) {
+                json->overflow = true;
+                return;
+            }
+            flush(json);
+            continue;
+        }
+        u32 n = len < space ? len : space;
+        memcpy(json->buf + json->len, data, n);
+        json->len += n;
+        data += n;
+        len -= n;
+    }
+}
+
+// Writes the separator that goes before a value (nothing after a key or before the first item of a container)
+static void separate(JSONWriter *json) {
+    if (json->afterKey) {
+        json->afterKey = false;
+        return;
+    }
+    if (json->depth == 0 || json->depth > JSONW_DEPTH_MAX)
+        return;
+    u32 bit = 1u << (json->depth - 1);
+    if (json->hasItems & bit)
+        put(json, ",", 1);
+    else
+        json->hasItems |= bit;
+}
+
+static void begin(JSONWriter *json, char open) {
+    separate(json);
+    put(json, &open, 1);
+    json->depth++;
+    if (json->depth <= JSONW_DEPTH_MAX)
+        json->hasItems &= ~(1u << (json->depth - 1));
+}
+
+static void end(JSONWriter *json, char close) {
+    if (json->depth > 0)
+        json->depth--;
+    put(json, &close, 1);
+}
+
+static void put_string(JSONWriter *json, const char *str) {
+    put(json, "\"", 1);
+    const char *run = str; // Characters that don't need escaping are written in runs
+    for (; *str; str++) {
+        char c = *str;
+        if (c != '"' && c != '\\' && (u8)c >= 0x20)
+            continue;
+        put(json, run, (u32)(str - run));
+        run = str + 1;
+        switch (c) {
+            case '"':
+                put(json, "\\\"", 2);
+                break;
+            case '\\':
+                put(json, "\\\\", 2);
+                break;
+            case '\n':
+                put(json, "\\n", 2);
+                break;
+            case '\r':
+                put(json, "\\r", 2);
+                break;
+            case '\t':
+                put(json, "\\t", 2);
+                break;
+            default: {
+                char escaped[7];
+                snprintf(escaped, sizeof(escaped), "\\u%04x", (u8)c);
+                put(json, escaped, 6);
+                break;
+            }
+        }
+    }
+    put(json, run, (u32)(str - run));
+    put(json, "\"", 1);
+}
+
+void jsonw_init(JSONWriter *json, char *buf, u32 size) {
+    *json = (JSONWriter){.buf = buf, .size = size};
+}
+
+void jsonw_init_sink(JSONWriter *json, char *buf, u32 size, jsonw_sink_t sink, void *ctx) {
+    *json = (JSONWriter){.buf = buf, .size = size, .sink = sink, .ctx = ctx};
+}
+
+void jsonw_object_begin(JSONWriter *json) {
+    begin(json, '{');
+}
+
+void jsonw_object_end(JSONWriter *json) {
+    end(json, '}');
+}
+
+void jsonw_array_begin(JSONWriter *json) {
+    begin(json, '[');
+}
+
+void jsonw_array_end(JSONWriter *json) {
+    end(json, ']');
+}
+
+void jsonw_key(JSONWriter *json, const char *key) {
+    separate(json);
+    put_string(json, key);
+    put(json, ":", 1);
+    json->afterKey = true;
+}
+
+void jsonw_string(JSONWriter *json, const char *str) {
+    if (!str) {
+        jsonw_null(json);
+        return;
+    }
+    separate(json);
+    put_string(json, str);
+}
+
+void jsonw_number(JSONWriter *json, f64 num) {
+    if (!isfinite(num)) {
+        jsonw_null(json);
+        return;
+    }
+    separate(json);
+    char buf[32];
+    i32 len;
+    if (fabs(num) < 2147483647.0 && num == (f64)(long)num)
+        len = snprintf(buf, sizeof(buf), "%ld", (long)num); // Integers are common and much cheaper to format
+    else {
+        // 15 digits are enough for most numbers (and don't show binary rounding noise, e.g. 47.402116100000001), but some
+        // need all 17 to round-trip exactly
+        len = snprintf(buf, sizeof(buf), "%.15g", num);
+        if (strtod(buf, NULL) != num)
+            len = snprintf(buf, sizeof(buf), "%.17g", num);
+    }
+    if (len > 0)
+        put(json, buf, (u32)len);
+}
+
+void jsonw_bool(JSONWriter *json, bool value) {
+    separate(json);
+    if (value)
+        put(json, "true", 4);
+    else
+        put(json, "false", 5);
+}
+
+void jsonw_null(JSONWriter *json) {
+    separate(json);
+    put(json, "null", 4);
+}
+
+void jsonw_key_string(JSONWriter *json, const char *key, const char *str) {
+    jsonw_key(json, key);
+    jsonw_string(json, str);
+}
+
+void jsonw_key_number(JSONWriter *json, const char *key, f64 num) {
+    jsonw_key(json, key);
+    jsonw_number(json, num);
+}
+
+void jsonw_key_null(JSONWriter *json, const char *key) {
+    jsonw_key(json, key);
+    jsonw_null(json);
+}
+
+u32 jsonw_finish(JSONWriter *json) {
+    if (json->sink) {
+        flush(json);
+        return json->total;
+    }
+    if (json->size > 0)
+        json->buf[json->len] = '\0';
+    // A writer without a buffer only measures the document, so it's expected not to fit
+    return json->overflow && json->size > 0 ? 0 : json->total;
+}
@@ -0,0 +1,94 @@
+#pragma once
+
+#include <stdbool.h>
+#include "platform/types.h"
+
+// Streaming JSON writer: emits a document token by token straight into a fixed buffer, or through a small buffer into a sink
+// (e.g. the serial port or a socket), so building a response never touches the heap. Separators (commas and colons) are
+// inserted automatically, so a document is written simply as e.g.
+//     jsonw_object_begin(&json);
+//     jsonw_key_number(&json, "mode", 3);
+//     jsonw_object_end(&json);
+//     jsonw_finish(&json);
+
+#define JSONW_DEPTH_MAX 32 // Deepest nesting of objects and arrays
+
+/**
+ * Receives output from a writer.
+ * @param data the output (not null-terminated)
+ * @param len the length of the output
+ * @param ctx the writer's context
+ */
+typedef void (*jsonw_sink_t)(const char *data, u32 len, void *ctx);
+
+typedef struct JSONWriter {
+    char *buf;
+    u32 size;
+    u32 len;       // Bytes currently held in `buf`
+    u32 total;     // Bytes written to the document so far (including any that didn't fit)
+    bool overflow; // Whether some of the document didn't fit into `buf` (only without a sink)
+    jsonw_sink_t sink;
+    void *ctx;
+    u32 depth;
+    u32 hasItems;  // Bit n is set if the container at depth n + 1 already holds an item
+    bool afterKey; // Whether a key was just written (so the next value needs no separator)
+} JSONWriter;
+
+/**
+ * Sets up a writer that writes into a buffer.
+ * @param json the writer
+ * @param buf the buffer, or NULL (with `size` 0) to only measure the document
+ * @param size the size of the buffer; the document is always null-terminated, so it can be at most `size - 1` long
+ */
+void jsonw_init(JSONWriter *json, char *buf, u32 size);
+
+/**
+ * Sets up a writer that passes its output to a sink whenever its buffer fills up (and when the document is finished).
+ * @param json the writer
+ * @param buf the buffer
+ * @param size the size of the buffer, at least 2
+ * @param sink the sink
+ * @param ctx passed to `sink`
+ */
+void jsonw_init_sink(JSONWriter *json, char *buf, u32 size, jsonw_sink_t sink, void *ctx);
+
+void jsonw_object_begin(JSONWriter *json);
+void jsonw_object_end(JSONWriter *json);
+void jsonw_array_begin(JSONWriter *json);
+void jsonw_array_end(JSONWriter *json);
+
+/**
+ * Writes the key of the next value in an object.
+ * @param json the writer
+ * @param key the key
+ */
+void jsonw_key(JSONWriter *json, const char *key);
+
+/**
+ * Writes a string, escaped as necessary.
+ * @param json the writer
+ * @param str the string, or NULL to write null
+ */
+void jsonw_string(JSONWriter *json, const char *str);
+
+/**
+ * Writes a number (integers are written without a fraction; NaN and infinity, which JSON can't represent, as null).
+ * @param json the writer
+ * @param num the number
+ */
+void jsonw_number(JSONWriter *json, f64 num);
+
+void jsonw_bool(JSONWriter *json, bool value);
+void jsonw_null(JSONWriter *json);
+
+// Shorthands for a key followed by its value
+void jsonw_key_string(JSONWriter *json, const char *key, const char *str);
+void jsonw_key_number(JSONWriter *json, const char *key, f64 num);
+void jsonw_key_null(JSONWriter *json, const char *key);
+
+/**
+ * Finishes a document: null-terminates the buffer, or passes whatever is left in it to the sink.
+ * @param json the writer
+ * @return the length of the document (also if the writer only measured it), or 0 if it didn't fit into the buffer
+ */
+u32 jsonw_finish(JSONWriter *json);
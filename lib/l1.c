@@ -0,0 +1,54 @@
+/**
+ * Source file of pico-fbw: https://github.com/pico-fbw/pico-fbw
+ * Licensed under the GNU AGPL-3.0
+ */
+
+#include <math.h>
+#include "platform/helpers.h"
+
+#include "l1.h"
+
+#define GRAVITY 9.80665f          // m/s^2
+#define L1_SPEED_MIN 1.f          // Groundspeed below which the aircraft is assumed to be moving at this speed, m/s
+#define L1_INTERCEPT_MAX 0.7071f  // Sine of the steepest angle a leg will be intercepted at (45 deg)
+#define L1_TURN_ANGLE_MAX 2.0944f // Largest course change that the turn distance is worked out for, rad (120 deg)
+
+/**
+ * @param a an angle, rad
+ * @return the angle wrapped to -pi to pi
+ */
+static inline f32 wrap_pi(f32 a) {
+    while (a > (f32)M_PI)
+        a -= 2.f * (f32)M_PI;
+    while (a < -(f32)M_PI)
+        a += 2.f * (f32)M_PI;
+    return a;
+}
+
+void l1_update(L1Controller *l1, const NavLeg *leg, const NavTrack *track, f32 speed, f32 course) {
+    speed = fmaxf(speed, L1_SPEED_MIN);
+    l1->distance = l1->period * l1->damping * speed / (f32)M_PI;
+    // Along a great circle the course changes, so go by the bearing to the end of the leg instead
+    f32 legCourse = leg->greatCircle ? track->bearing : leg->course;
+    // Angle between the aircraft's velocity and the leg (positive when heading to the right of it)
+    f32 nu2 = wrap_pi((course - legCourse) * ((f32)M_PI / 180.f));
+    // Angle from the leg to the reference point, as seen from the aircraft (positive when right of the leg); far from the leg,
+    // the reference point can't be on it anymore, so the leg is intercepted at a fixed angle instead
+    f32 nu1 = asinf(clampf(track->crossTrack / l1->distance, -L1_INTERCEPT_MAX, L1_INTERCEPT_MAX));
+    // Angle from the aircraft's velocity to the reference point
+    f32 eta = clampf(-(nu1 + nu2), -(f32)M_PI / 2.f, (f32)M_PI / 2.f);
+    f32 k = 4.f * l1->damping * l1->damping;
+    l1->latAcc = k * speed * speed / l1->distance * sinf(eta);
+    l1->out = clampf(atanf(l1->latAcc / GRAVITY) * (180.f / (f32)M_PI), -l1->bankLimit, l1->bankLimit);
+}
+
+f32 l1_turn_distance(const L1Controller *l1, f32 speed, f32 courseIn, f32 courseOut) {
+    if (l1->bankLimit <= 0)
+        return 0;
+    f32 angle = fabsf(wrap_pi((courseOut - courseIn) * ((f32)M_PI / 180.f)));
+    if (angle > L1_TURN_ANGLE_MAX)
+        angle = L1_TURN_ANGLE_MAX;
+    // Radius of a turn at the bank limit, and how far before the corner it has to start for the arc to end on the next leg
+    f32 radius = speed * speed / (GRAVITY * tanf(l1->bankLimit * ((f32)M_PI / 180.f)));
+    return radius * tanf(angle / 2.f);
+}
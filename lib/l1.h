@@ -0,0 +1,41 @@
+#pragma once
+
+#include "platform/types.h"
+
+#include "lib/nav.h"
+
+// L1 path-following guidance, which steers onto and along a leg rather than towards its end.
+// Each update, a reference point is picked on the leg a distance L1 ahead of the aircraft, and the lateral acceleration needed
+// to fly an arc through it is commanded (and turned into a bank angle). L1 grows with groundspeed so that the loop's response
+// stays at a set period and damping, and because the aircraft's actual velocity over the ground is used, wind is corrected for.
+// Reference: S. Park, J. Deyst, J. How, "A New Nonlinear Guidance Logic for Trajectory Tracking" (AIAA 2004-4900)
+
+typedef struct L1Controller {
+    f32 period;    // Period of the guidance loop's response, s (shorter tracks more tightly, but may oscillate)
+    f32 damping;   // Damping ratio of the guidance loop's response
+    f32 bankLimit; // Largest bank angle that will be commanded, deg
+    // Outputs
+    f32 distance; // Current L1 distance, m
+    f32 latAcc;   // Commanded lateral acceleration (positive to the right), m/s^2
+    f32 out;      // Commanded bank angle (positive to the right), deg
+} L1Controller;
+
+/**
+ * Updates an L1Controller.
+ * @param l1 the controller
+ * @param leg the leg being followed
+ * @param track the aircraft's position relative to the leg
+ * @param speed the aircraft's groundspeed, m/s
+ * @param course the aircraft's track over the ground, deg
+ */
+void l1_update(L1Controller *l1, const NavLeg *leg, const NavTrack *track, f32 speed, f32 course);
+
+/**
+ * Calculates how early to start turning onto a new leg, so that the aircraft rolls out on it rather than overshooting it.
+ * @param l1 the controller
+ * @param speed the aircraft's groundspeed, m/s
+ * @param courseIn the course of the leg being flown, deg
+ * @param courseOut the course of the next leg, deg
+ * @return the distance before the end of the leg at which to turn, m
+ */
+f32 l1_turn_distance(const L1Controller *l1, f32 speed, f32 courseIn, f32 courseOut);
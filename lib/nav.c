@@ -11,6 +11,26 @@
 #define EARTH_RADIUS_KM 6371                    // Earth's radius in kilometers
 #define EARTH_RADIUS_M (EARTH_RADIUS_KM * 1000) // Earth's radius in meters
 
+/**
+ * @param deltaL a difference in longitude, deg
+ * @return the difference the short way around the Earth, -180 to 180 deg
+ */
+static inline f64 wrap_longitude(f64 deltaL) {
+    if (deltaL > 180)
+        deltaL -= 360;
+    else if (deltaL < -180)
+        deltaL += 360;
+    return deltaL;
+}
+
+/**
+ * @param bearing a bearing, deg
+ * @return the bearing mapped to a heading, 0 to 360 deg (the same way as calculate_bearing())
+ */
+static inline f32 to_heading(f32 bearing) {
+    return bearing <= 0 ? bearing + 360 : bearing;
+}
+
 f64 calculate_bearing(f64 latA, f64 lonA, f64 latB, f64 lonB) {
     f64 thetaA = radians(latA);
     f64 thetaB = radians(latB);
@@ -39,3 +59,60 @@ f64 calculate_distance(f64 latA, f64 lonA, f64 latB, f64 lonB) {
 
     return EARTH_RADIUS_M * c;
 }
+
+void nav_leg_init(NavLeg *leg, f64 latA, f64 lonA, f64 latB, f64 lonB) {
+    leg->startLat = latA;
+    leg->startLng = lonA;
+    leg->endLat = latB;
+    leg->endLng = lonB;
+    leg->mPerDegLat = (f32)radians(EARTH_RADIUS_M);
+    leg->midLat = (latA + latB) / 2;
+    leg->mPerDegLng = (f32)(radians(EARTH_RADIUS_M) * cos(radians(leg->midLat)));
+    leg->mPerDegLngSlope = (f32)(-radians(leg->mPerDegLng * tan(radians(leg->midLat))));
+    leg->end[0] = (f32)wrap_longitude(lonB - lonA) * leg->mPerDegLng;
+    leg->end[1] = (f32)(latB - latA) * leg->mPerDegLat;
+    f32 planeLength = sqrtf(leg->end[0] * leg->end[0] + leg->end[1] * leg->end[1]);
+    if (planeLength > 0) {
+        leg->dir[0] = leg->end[0] / planeLength;
+        leg->dir[1] = leg->end[1] / planeLength;
+    } else
+        leg->dir[0] = leg->dir[1] = 0;
+    leg->greatCircle = planeLength > NAV_FLAT_EARTH_MAX;
+    if (leg->greatCircle) {
+        leg->length = (f32)calculate_distance(latA, lonA, latB, lonB);
+        leg->course = (f32)calculate_bearing(latA, lonA, latB, lonB);
+    } else {
+        leg->length = planeLength;
+        leg->course = to_heading(atan2f(leg->end[0], leg->end[1]) * (180.f / (f32)M_PI));
+    }
+}
+
+void nav_leg_track(const NavLeg *leg, f64 lat, f64 lon, NavTrack *track) {
+    if (leg->greatCircle) {
+        // Cross-track and along-track distances on a sphere
+        f64 d13 = calculate_distance(leg->startLat, leg->startLng, lat, lon) / EARTH_RADIUS_M;
+        f64 dTheta = radians(calculate_bearing(leg->startLat, leg->startLng, lat, lon) - leg->course);
+        f64 xt = asin(sin(d13) * sin(dTheta));
+        f64 at = acos(clamp(cos(d13) / cos(xt), -1.0, 1.0));
+        track->crossTrack = (f32)(xt * EARTH_RADIUS_M);
+        track->alongTrack = (f32)(cos(dTheta) < 0 ? -at * EARTH_RADIUS_M : at * EARTH_RADIUS_M);
+        track->distance = (f32)calculate_distance(lat, lon, leg->endLat, leg->endLng);
+        track->bearing = (f32)calculate_bearing(lat, lon, leg->endLat, leg->endLng);
+        return;
+    }
+    // Position on the leg's plane (east, north), relative to the start and to the end of the leg
+    // Each east distance is scaled at the mean latitude of the two points it spans (linearly from midLat), which keeps
+    // distances within a few centimetres of great-circle distances without needing any trigonometry
+    f32 dLat = (f32)(lat - leg->midLat);
+    f32 fromStart[2], toEnd[2];
+    fromStart[0] = (f32)wrap_longitude(lon - leg->startLng) *
+                   (leg->mPerDegLng + leg->mPerDegLngSlope * (dLat + (f32)(leg->startLat - leg->midLat)) / 2);
+    fromStart[1] = (f32)(lat - leg->startLat) * leg->mPerDegLat;
+    toEnd[0] = (f32)wrap_longitude(leg->endLng - lon) *
+               (leg->mPerDegLng + leg->mPerDegLngSlope * (dLat + (f32)(leg->endLat - leg->midLat)) / 2);
+    toEnd[1] = (f32)(leg->endLat - lat) * leg->mPerDegLat;
+    track->crossTrack = fromStart[0] * leg->dir[1] - fromStart[1] * leg->dir[0];
+    track->alongTrack = fromStart[0] * leg->dir[0] + fromStart[1] * leg->dir[1];
+    track->distance = sqrtf(toEnd[0] * toEnd[0] + toEnd[1] * toEnd[1]);
+    track->bearing = to_heading(atan2f(toEnd[0], toEnd[1]) * (180.f / (f32)M_PI));
+}
@@ -1,7 +1,38 @@
 #pragma once
 
+#include <stdbool.h>
 #include "platform/types.h"
 
+#define NAV_FLAT_EARTH_MAX 10000 // Longest leg navigated on a flat-earth approximation, m (longer legs use great circles)
+
+// Geometry of a leg between two points, worked out once when the leg is set up rather than for every position (auto mode sets
+// up the leg after each Waypoint as it loads that Waypoint, not when the flight plan is parsed).
+// Each leg is laid out on its own local tangent plane (east, north, up) with its origin at the leg's start, so that positions
+// along it can be worked out with a handful of single-precision operations instead of trigonometry (about 3x as fast as
+// calculate_distance() and calculate_bearing() together on x86, see test/nav_bench.c).
+// Legs longer than NAV_FLAT_EARTH_MAX are navigated on a great circle instead, where the plane would no longer be accurate.
+typedef struct NavLeg {
+    f64 startLat, startLng; // deg
+    f64 endLat, endLng;     // deg
+    f32 mPerDegLat;         // Length of a degree of latitude on the leg's plane, m
+    f64 midLat;             // Mean latitude of the leg, deg
+    f32 mPerDegLng;         // Length of a degree of longitude at midLat, m
+    f32 mPerDegLngSlope;    // Change in the length of a degree of longitude per degree of latitude north of midLat, m/deg
+    f32 end[2];             // End of the leg on the plane (east, north), m
+    f32 dir[2];             // Unit vector along the leg (east, north)
+    f32 length;             // m
+    f32 course;             // Initial course of the leg, 0 to 360 deg
+    bool greatCircle;       // Whether the leg is too long for the plane and is navigated on a great circle
+} NavLeg;
+
+// A position relative to a leg
+typedef struct NavTrack {
+    f32 crossTrack; // Distance off the leg, positive when right of it, m
+    f32 alongTrack; // Distance along the leg from its start, m
+    f32 distance;   // Distance to go to the end of the leg, m
+    f32 bearing;    // Bearing to the end of the leg, 0 to 360 deg
+} NavTrack;
+
 /**
  * Calculates the bearing between two points.
  * @param latA Latitude of the first point.
@@ -21,3 +52,22 @@ f64 calculate_bearing(f64 latA, f64 lonA, f64 latB, f64 lonB);
  * @return Distance in meters.
  */
 f64 calculate_distance(f64 latA, f64 lonA, f64 latB, f64 lonB);
+
+/**
+ * Works out the geometry of a leg, ready for nav_leg_track().
+ * @param leg the leg to fill in
+ * @param latA Latitude of the leg's start.
+ * @param lonA Longitude of the leg's start.
+ * @param latB Latitude of the leg's end.
+ * @param lonB Longitude of the leg's end.
+ */
+void nav_leg_init(NavLeg *leg, f64 latA, f64 lonA, f64 latB, f64 lonB);
+
+/**
+ * Calculates a position relative to a leg.
+ * @param leg the leg
+ * @param lat Latitude of the position.
+ * @param lon Longitude of the position.
+ * @param track pointer to where the position relative to the leg should be stored
+ */
+void nav_leg_track(const NavLeg *leg, f64 lat, f64 lon, NavTrack *track);
@@ -0,0 +1,200 @@
+/**
+ * Source file of pico-fbw: https://github.com/pico-fbw/pico-fbw
+ * Licensed under the GNU AGPL-3.0
+ */
+
+#include <string.h>
+
+#include "nmea.h"
+
+#define DECIMALS_MAX 9 // Most fractional digits kept when converting a field, any beyond are ignored
+
+static const f32 powers[DECIMALS_MAX + 1] = {1e0f, 1e1f, 1e2f, 1e3f, 1e4f, 1e5f, 1e6f, 1e7f, 1e8f, 1e9f};
+
+/**
+ * @param c a hex digit
+ * @return the digit's value, or -1 if it isn't a hex digit
+ */
+static i32 hex_value(char c) {
+    if (c >= '0' && c <= '9')
+        return c - '0';
+    if (c >= 'A' && c <= 'F')
+        return c - 'A' + 10;
+    if (c >= 'a' && c <= 'f')
+        return c - 'a' + 10;
+    return -1;
+}
+
+/**
+ * Splits the sentence in the parser's buffer into its fields.
+ * @param nmea the parser
+ */
+static void split_fields(NMEAParser *nmea) {
+    nmea->sentence[nmea->len] = '\0';
+    nmea->fields[0] = nmea->sentence;
+    nmea->numFields = 1;
+    for (char *c = nmea->sentence; *c != '\0'; c++) {
+        if (*c != ',')
+            continue;
+        *c = '\0';
+        if (nmea->numFields < NMEA_FIELDS_MAX)
+            nmea->fields[nmea->numFields++] = c + 1;
+    }
+}
+
+/**
+ * Parses a decimal number as an integer and the number of digits after its decimal point, so no precision is lost.
+ * @param field the field
+ * @param value pointer to where the value (with its decimal point removed) should be stored
+ * @param decimals pointer to where the number of digits after the decimal point should be stored
+ * @return true if successful
+ */
+static bool parse_decimal(const char *field, i64 *value, u32 *decimals) {
+    const char *c = field;
+    while (*c == ' ')
+        c++; // Not standard, but some modules pad their fields
+    bool negative = *c == '-';
+    if (*c == '-' || *c == '+')
+        c++;
+    i64 v = 0;
+    u32 digits = 0, d = 0;
+    bool point = false;
+    for (; *c != '\0'; c++) {
+        if (*c == '.' && !point) {
+            point = true;
+        } else if (*c >= '0' && *c <= '9') {
+            if (point && d >= DECIMALS_MAX)
+                continue; // Extra precision is ignored
+            if (v > (INT64_MAX - 9) / 10)
+                return false;
+            v = v * 10 + (*c - '0');
+            digits++;
+            if (point)
+                d++;
+        } else {
+            return false;
+        }
+    }
+    if (digits == 0)
+        return false;
+    *value = negative ? -v : v;
+    *decimals = d;
+    return true;
+}
+
+void nmea_init(NMEAParser *nmea) {
+    nmea->len = 0;
+    nmea->state = NMEA_STATE_START;
+    nmea->numFields = 0;
+    nmea->sentences = 0;
+    nmea->errors = 0;
+}
+
+bool nmea_feed(NMEAParser *nmea, char c) {
+    if (c == '$') {
+        // Always starts a new sentence, even if the last one was cut off
+        if (nmea->state != NMEA_STATE_START)
+            nmea->errors++;
+        nmea->state = NMEA_STATE_BODY;
+        nmea->len = 0;
+        nmea->checksum = 0;
+        return false;
+    }
+    switch (nmea->state) {
+        case NMEA_STATE_START:
+            return false;
+        case NMEA_STATE_BODY:
+            if (c == '*') {
+                nmea->state = NMEA_STATE_CHECKSUM1;
+                return false;
+            }
+            if (c < ' ' || c > '~' || nmea->len >= NMEA_SENTENCE_MAX) {
+                // Unprintable characters (including a line ending before the checksum) mean the sentence is garbled
+                nmea->errors++;
+                nmea->state = NMEA_STATE_START;
+                return false;
+            }
+            nmea->sentence[nmea->len++] = c;
+            nmea->checksum ^= (u8)c;
+            return false;
+        case NMEA_STATE_CHECKSUM1: {
+            i32 digit = hex_value(c);
+            if (digit < 0) {
+                nmea->errors++;
+                nmea->state = NMEA_STATE_START;
+                return false;
+            }
+            nmea->received = (u8)(digit << 4);
+            nmea->state = NMEA_STATE_CHECKSUM2;
+            return false;
+        }
+        case NMEA_STATE_CHECKSUM2: {
+            i32 digit = hex_value(c);
+            nmea->state = NMEA_STATE_START;
+            if (digit < 0 || (nmea->received | (u8)digit) != nmea->checksum) {
+                nmea->errors++;
+                return false;
+            }
+            split_fields(nmea);
+            nmea->sentences++;
+            return true;
+        }
+        default:
+            nmea->state = NMEA_STATE_START;
+            return false;
+    }
+}
+
+bool nmea_is(const NMEAParser *nmea, const char *type) {
+    if (nmea->numFields == 0)
+        return false;
+    const char *address = nmea->fields[0];
+    if (address[0] == 'P')
+        return strcmp(address, type) == 0; // Proprietary sentences have no talker ID
+    return strlen(address) == strlen(type) + 2 && strcmp(address + 2, type) == 0;
+}
+
+const char *nmea_field(const NMEAParser *nmea, u32 index) {
+    return index < nmea->numFields ? nmea->fields[index] : "";
+}
+
+bool nmea_to_float(const char *field, f32 *value) {
+    i64 v;
+    u32 decimals;
+    if (!parse_decimal(field, &v, &decimals))
+        return false;
+    *value = (f32)v / powers[decimals];
+    return true;
+}
+
+bool nmea_to_int(const char *field, i32 *value) {
+    i64 v;
+    u32 decimals;
+    if (!parse_decimal(field, &v, &decimals) || decimals > 0 || v > INT32_MAX || v < INT32_MIN)
+        return false;
+    *value = (i32)v;
+    return true;
+}
+
+bool nmea_to_coord(const char *field, const char *hemisphere, f64 *deg) {
+    i64 v;
+    u32 decimals;
+    if (!parse_decimal(field, &v, &decimals) || v < 0)
+        return false;
+    bool negative;
+    if (strcmp(hemisphere, "N") == 0 || strcmp(hemisphere, "E") == 0)
+        negative = false;
+    else if (strcmp(hemisphere, "S") == 0 || strcmp(hemisphere, "W") == 0)
+        negative = true;
+    else
+        return false;
+    // The degrees are everything before the last two digits of whole minutes
+    i64 scale = 1;
+    for (u32 i = 0; i < decimals; i++)
+        scale *= 10;
+    i64 degrees = v / (scale * 100);
+    f64 minutes = (f64)(v % (scale * 100)) / (f64)scale;
+    f64 coord = (f64)degrees + minutes / 60.0;
+    *deg = negative ? -coord : coord;
+    return true;
+}
@@ -0,0 +1,96 @@
+#pragma once
+
+#include <stdbool.h>
+#include "platform/types.h"
+
+// Incremental NMEA 0183 parser: bytes are fed in one at a time as they arrive (e.g. straight out of a UART's ring), and a
+// sentence is only handed over once its checksum has been verified. Fields are split up in place, in the parser's own buffer,
+// so parsing never allocates or copies a sentence.
+//
+// Example:
+//     NMEAParser nmea;
+//     nmea_init(&nmea);
+//     for (u32 i = 0; i < len; i++) {
+//         if (nmea_feed(&nmea, data[i]) && nmea_is(&nmea, "GGA"))
+//             nmea_to_coord(nmea_field(&nmea, 2), nmea_field(&nmea, 3), &lat);
+//     }
+
+#define NMEA_SENTENCE_MAX 96 // Longest sentence (between the '$' and '*') that can be parsed; the standard allows 79 characters
+#define NMEA_FIELDS_MAX 24   // Most fields (including the address field) that can be parsed, any beyond are ignored
+
+// clang-format off
+typedef enum NMEAState {
+    NMEA_STATE_START,     // Waiting for a '$'
+    NMEA_STATE_BODY,      // Reading the sentence up to the '*'
+    NMEA_STATE_CHECKSUM1, // Reading the checksum's first hex digit
+    NMEA_STATE_CHECKSUM2, // Reading the checksum's second hex digit
+} NMEAState;
+// clang-format on
+
+typedef struct NMEAParser {
+    char sentence[NMEA_SENTENCE_MAX + 1];
+    u32 len;
+    u8 checksum; // Running checksum of the sentence
+    u8 received; // Checksum given by the sentence
+    NMEAState state;
+    const char *fields[NMEA_FIELDS_MAX]; // The fields of the last complete sentence, pointing into `sentence`
+    u32 numFields;
+    u32 sentences; // Number of valid sentences parsed
+    u32 errors;    // Number of sentences dropped because they were malformed, too long, or failed their checksum
+} NMEAParser;
+
+/**
+ * Initializes an NMEA parser.
+ * @param nmea the parser
+ */
+void nmea_init(NMEAParser *nmea);
+
+/**
+ * Feeds a byte into an NMEA parser.
+ * @param nmea the parser
+ * @param c the byte
+ * @return true if the byte completed a valid sentence, which can be read with `nmea_field()` until the next byte is fed
+ */
+bool nmea_feed(NMEAParser *nmea, char c);
+
+/**
+ * Checks the type of the last complete sentence.
+ * @param nmea the parser
+ * @param type the type, without a talker ID (e.g. "GGA" matches "GPGGA" and "GNGGA"); proprietary sentences (e.g. "PMTK001")
+ * must be given in full
+ * @return whether the sentence is of the given type
+ */
+bool nmea_is(const NMEAParser *nmea, const char *type);
+
+/**
+ * @param nmea the parser
+ * @param index the index of the field, where 0 is the address field (e.g. "GPGGA")
+ * @return the field of the last complete sentence (null-terminated), or an empty string if it has no such field
+ */
+const char *nmea_field(const NMEAParser *nmea, u32 index);
+
+/**
+ * Converts a decimal field (e.g. "-12.345").
+ * @param field the field
+ * @param value pointer to where the value should be stored
+ * @return true if successful, false if the field is empty or invalid (`value` is left untouched)
+ */
+bool nmea_to_float(const char *field, f32 *value);
+
+/**
+ * Converts an integer field (e.g. "08").
+ * @param field the field
+ * @param value pointer to where the value should be stored
+ * @return true if successful, false if the field is empty or invalid (`value` is left untouched)
+ */
+bool nmea_to_int(const char *field, i32 *value);
+
+/**
+ * Converts a coordinate from its pair of fields.
+ * @param field the coordinate, in (d)ddmm.mmmm format
+ * @param hemisphere the hemisphere ("N", "S", "E", or "W")
+ * @param deg pointer to where the coordinate should be stored, in degrees (negative in the southern or western hemisphere)
+ * @return true if successful, false if either field is empty or invalid (`deg` is left untouched)
+ * @note This keeps the full precision of the coordinate (which a float could not).
+ */
+bool nmea_to_coord(const char *field, const char *hemisphere, f64 *deg);
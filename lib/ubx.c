@@ -0,0 +1,157 @@
+/**
+ * Source file of pico-fbw: https://github.com/pico-fbw/pico-fbw
+ * Licensed under the GNU AGPL-3.0
+ */
+
+#include <string.h>
+
+#include "ubx.h"
+
+#define PVT_FLAG_GNSS_FIX_OK (1 << 0) // Bit of the NAV-PVT flags field
+
+// Little-endian field access, independent of the host's endianness and alignment
+
+static inline u16 get_u16(const byte *p) {
+    return (u16)(p[0] | (p[1] << 8));
+}
+
+static inline u32 get_u32(const byte *p) {
+    return (u32)p[0] | ((u32)p[1] << 8) | ((u32)p[2] << 16) | ((u32)p[3] << 24);
+}
+
+static inline i32 get_i32(const byte *p) {
+    return (i32)get_u32(p);
+}
+
+static inline void checksum_add(u8 *ckA, u8 *ckB, byte b) {
+    *ckA += b;
+    *ckB += *ckA;
+}
+
+void ubx_init(UBXParser *ubx) {
+    ubx->state = UBX_STATE_SYNC1;
+    ubx->messages = 0;
+    ubx->errors = 0;
+}
+
+bool ubx_feed(UBXParser *ubx, byte b) {
+    switch (ubx->state) {
+        case UBX_STATE_SYNC1:
+            if (b == UBX_SYNC1)
+                ubx->state = UBX_STATE_SYNC2;
+            return false;
+        case UBX_STATE_SYNC2:
+            // A repeated first sync character may still be followed by the second
+            ubx->state = b == UBX_SYNC2 ? UBX_STATE_CLASS : (b == UBX_SYNC1 ? UBX_STATE_SYNC2 : UBX_STATE_SYNC1);
+            ubx->ckA = ubx->ckB = 0;
+            return false;
+        case UBX_STATE_CLASS:
+            ubx->cls = b;
+            checksum_add(&ubx->ckA, &ubx->ckB, b);
+            ubx->state = UBX_STATE_ID;
+            return false;
+        case UBX_STATE_ID:
+            ubx->id = b;
+            checksum_add(&ubx->ckA, &ubx->ckB, b);
+            ubx->state = UBX_STATE_LEN1;
+            return false;
+        case UBX_STATE_LEN1:
+            ubx->len = b;
+            checksum_add(&ubx->ckA, &ubx->ckB, b);
+            ubx->state = UBX_STATE_LEN2;
+            return false;
+        case UBX_STATE_LEN2:
+            ubx->len |= (u16)(b << 8);
+            checksum_add(&ubx->ckA, &ubx->ckB, b);
+            ubx->pos = 0;
+            ubx->state = ubx->len > 0 ? UBX_STATE_PAYLOAD : UBX_STATE_CK_A;
+            return false;
+        case UBX_STATE_PAYLOAD:
+            if (ubx->pos < UBX_PAYLOAD_MAX)
+                ubx->payload[ubx->pos] = b;
+            checksum_add(&ubx->ckA, &ubx->ckB, b);
+            if (++ubx->pos >= ubx->len)
+                ubx->state = UBX_STATE_CK_A;
+            return false;
+        case UBX_STATE_CK_A:
+            if (b != ubx->ckA) {
+                ubx->errors++;
+                ubx->state = b == UBX_SYNC1 ? UBX_STATE_SYNC2 : UBX_STATE_SYNC1;
+                return false;
+            }
+            ubx->state = UBX_STATE_CK_B;
+            return false;
+        case UBX_STATE_CK_B:
+            ubx->state = UBX_STATE_SYNC1;
+            if (b != ubx->ckB) {
+                ubx->errors++;
+                return false;
+            }
+            ubx->messages++;
+            return ubx->len <= UBX_PAYLOAD_MAX;
+        default:
+            ubx->state = UBX_STATE_SYNC1;
+            return false;
+    }
+}
+
+u32 ubx_frame(u8 cls, u8 id, const byte *payload, u16 len, byte *frame) {
+    frame[0] = UBX_SYNC1;
+    frame[1] = UBX_SYNC2;
+    frame[2] = cls;
+    frame[3] = id;
+    frame[4] = (byte)(len & 0xFF);
+    frame[5] = (byte)(len >> 8);
+    if (len > 0)
+        memcpy(&frame[6], payload, len);
+    u8 ckA = 0, ckB = 0;
+    for (u32 i = 2; i < 6 + (u32)len; i++)
+        checksum_add(&ckA, &ckB, frame[i]);
+    frame[6 + len] = ckA;
+    frame[7 + len] = ckB;
+    return len + UBX_FRAME_OVERHEAD;
+}
+
+bool ubx_decode_nav_pvt(const UBXParser *ubx, UBXNavPVT *pvt) {
+    // Older protocol versions send a shorter (84 byte) message, with everything needed here at the same offsets
+    if (ubx->cls != UBX_CLASS_NAV || ubx->id != UBX_NAV_PVT || ubx->len < 84)
+        return false;
+    const byte *p = ubx->payload;
+    pvt->iTOW = get_u32(&p[0]);
+    pvt->fixType = p[20];
+    pvt->fixOk = (p[21] & PVT_FLAG_GNSS_FIX_OK) != 0;
+    pvt->numSV = p[23];
+    pvt->lng = get_i32(&p[24]) * 1e-7;
+    pvt->lat = get_i32(&p[28]) * 1e-7;
+    pvt->hMSL = get_i32(&p[36]) * 1e-3f;
+    pvt->hAcc = get_u32(&p[40]) * 1e-3f;
+    for (u32 i = 0; i < 3; i++)
+        pvt->velNED[i] = get_i32(&p[48 + i * 4]) * 1e-3f;
+    pvt->gSpeed = get_i32(&p[60]) * 1e-3f;
+    pvt->headMot = get_i32(&p[64]) * 1e-5f;
+    if (pvt->headMot < 0)
+        pvt->headMot += 360.f;
+    pvt->pDOP = get_u16(&p[76]) * 0.01f;
+    return true;
+}
+
+bool ubx_decode_nav_dop(const UBXParser *ubx, UBXNavDOP *dop) {
+    if (ubx->cls != UBX_CLASS_NAV || ubx->id != UBX_NAV_DOP || ubx->len < UBX_NAV_DOP_LEN)
+        return false;
+    const byte *p = ubx->payload;
+    dop->iTOW = get_u32(&p[0]);
+    dop->pDOP = get_u16(&p[6]) * 0.01f;
+    dop->vDOP = get_u16(&p[10]) * 0.01f;
+    dop->hDOP = get_u16(&p[12]) * 0.01f;
+    return true;
+}
+
+i32 ubx_ack(const UBXParser *ubx, u8 cls, u8 id) {
+    if (ubx->cls != UBX_CLASS_ACK || ubx->len < 2 || ubx->payload[0] != cls || ubx->payload[1] != id)
+        return -1;
+    if (ubx->id == UBX_ACK_ACK)
+        return 1;
+    if (ubx->id == UBX_ACK_NAK)
+        return 0;
+    return -1;
+}
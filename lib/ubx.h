@@ -0,0 +1,136 @@
+#pragma once
+
+#include <stdbool.h>
+#include "platform/types.h"
+
+// Incremental parser for u-blox's binary UBX protocol, fed one byte at a time like lib/nmea.h, along with the few messages
+// that are needed to configure a u-blox receiver and read its navigation solution.
+// Protocol reference: https://content.u-blox.com/sites/default/files/products/documents/u-blox8-M8_ReceiverDescrProtSpec_UBX-13003221.pdf
+//
+// A frame is: 0xB5 0x62, class, ID, payload length (u16), payload, and a two-byte Fletcher checksum over everything from the
+// class to the end of the payload. All values are little-endian.
+
+#define UBX_SYNC1 0xB5
+#define UBX_SYNC2 0x62
+#define UBX_FRAME_OVERHEAD 8 // Sync characters, class, ID, length, and checksum
+#define UBX_PAYLOAD_MAX 100  // Longest payload that is kept; longer messages are checked but can't be read
+
+// Message classes and IDs
+#define UBX_CLASS_NAV 0x01
+#define UBX_CLASS_ACK 0x05
+#define UBX_CLASS_CFG 0x06
+#define UBX_CLASS_NMEA 0xF0
+#define UBX_NAV_DOP 0x04
+#define UBX_NAV_PVT 0x07
+#define UBX_ACK_NAK 0x00
+#define UBX_ACK_ACK 0x01
+#define UBX_CFG_MSG 0x01
+#define UBX_CFG_RATE 0x08
+
+#define UBX_NAV_PVT_LEN 92
+#define UBX_NAV_DOP_LEN 18
+
+// Values of UBXNavPVT.fixType
+#define UBX_FIX_NONE 0
+#define UBX_FIX_2D 2
+#define UBX_FIX_3D 3
+#define UBX_FIX_GNSS_DR 4 // GNSS and dead reckoning combined
+
+// clang-format off
+typedef enum UBXState {
+    UBX_STATE_SYNC1,
+    UBX_STATE_SYNC2,
+    UBX_STATE_CLASS,
+    UBX_STATE_ID,
+    UBX_STATE_LEN1,
+    UBX_STATE_LEN2,
+    UBX_STATE_PAYLOAD,
+    UBX_STATE_CK_A,
+    UBX_STATE_CK_B,
+} UBXState;
+// clang-format on
+
+typedef struct UBXParser {
+    UBXState state;
+    u8 cls, id; // Class and ID of the message
+    u16 len;    // Length of the message's payload
+    u16 pos;    // Bytes of the payload read so far
+    u8 ckA, ckB;
+    byte payload[UBX_PAYLOAD_MAX];
+    u32 messages; // Number of valid messages parsed
+    u32 errors;   // Number of messages dropped because they failed their checksum
+} UBXParser;
+
+// Navigation position, velocity, and time solution (UBX-NAV-PVT), with values converted from the message's integers
+typedef struct UBXNavPVT {
+    u32 iTOW;      // GPS time of week of the navigation epoch, ms
+    u8 fixType;    // UBX_FIX_*
+    bool fixOk;    // Whether the fix is valid (within the receiver's DOP and accuracy masks)
+    u8 numSV;      // Number of satellites used in the solution
+    f64 lat, lng;  // deg
+    f32 hMSL;      // Height above mean sea level, m
+    f32 hAcc;      // Horizontal accuracy estimate, m
+    f32 velNED[3]; // Velocity (north, east, down), m/s
+    f32 gSpeed;    // Ground speed, m/s
+    f32 headMot;   // Heading of motion (track), 0 to 360 deg
+    f32 pDOP;
+} UBXNavPVT;
+
+// Dilution of precision (UBX-NAV-DOP)
+typedef struct UBXNavDOP {
+    u32 iTOW; // ms
+    f32 pDOP, hDOP, vDOP;
+} UBXNavDOP;
+
+/**
+ * Initializes a UBX parser.
+ * @param ubx the parser
+ */
+void ubx_init(UBXParser *ubx);
+
+/**
+ * Feeds a byte into a UBX parser.
+ * @param ubx the parser
+ * @param b the byte
+ * @return true if the byte completed a valid message, whose class, ID, length and payload can be read from the parser until
+ * the next byte is fed
+ * @note Messages with payloads longer than UBX_PAYLOAD_MAX are validated and counted, but never returned.
+ */
+bool ubx_feed(UBXParser *ubx, byte b);
+
+/**
+ * Assembles a UBX frame.
+ * @param cls the message's class
+ * @param id the message's ID
+ * @param payload the message's payload (may be NULL if `len` is 0)
+ * @param len the length of the payload
+ * @param frame where to store the frame, at least `len` + UBX_FRAME_OVERHEAD bytes long
+ * @return the length of the frame
+ */
+u32 ubx_frame(u8 cls, u8 id, const byte *payload, u16 len, byte *frame);
+
+/**
+ * Decodes the last message parsed as a UBX-NAV-PVT message.
+ * @param ubx the parser
+ * @param pvt pointer to where the solution should be stored
+ * @return true if the last message was a UBX-NAV-PVT message
+ */
+bool ubx_decode_nav_pvt(const UBXParser *ubx, UBXNavPVT *pvt);
+
+/**
+ * Decodes the last message parsed as a UBX-NAV-DOP message.
+ * @param ubx the parser
+ * @param dop pointer to where the DOPs should be stored
+ * @return true if the last message was a UBX-NAV-DOP message
+ */
+bool ubx_decode_nav_dop(const UBXParser *ubx, UBXNavDOP *dop);
+
+/**
+ * Checks whether the last message parsed acknowledges (or rejects) a message.
+ * @param ubx the parser
+ * @param cls the class of the acknowledged message
+ * @param id the ID of the acknowledged message
+ * @return 1 if the message was acknowledged (UBX-ACK-ACK), 0 if it was rejected (UBX-ACK-NAK), or -1 if the last message was
+ * neither
+ */
+i32 ubx_ack(const UBXParser *ubx, u8 cls, u8 id);
@@ -0,0 +1,197 @@
+/**
+ * Source file of pico-fbw: https://github.com/pico-fbw/pico-fbw
+ * Licensed under the GNU AGPL-3.0
+ */
+
+#include "platform/time.h"
+
+#include "callback.h"
+
+// Callbacks are kept in a hierarchical timer wheel, as described in "Hashed and Hierarchical Timing Wheels" (Varghese & Lauck).
+// Each level has WHEEL_SLOTS slots; a slot in level 0 spans one tick (1ms), a slot in level 1 spans all of level 0, and so on.
+// A callback is inserted into the lowest level whose span reaches its deadline and is cascaded down into lower levels as time
+// passes, so scheduling, cancelling, and running a callback are all O(1).
+// Callbacks live in a fixed pool rather than on the heap. Their IDs contain a generation count that changes every time a
+// slot in the pool is freed, so cancelling a stale ID (of a callback that has already run) can never affect a newer callback
+// that has reused the same slot.
+
+#define POOL_SIZE 16 // Maximum number of callbacks that can be scheduled at once
+#define WHEEL_BITS 6
+#define WHEEL_SLOTS (1 << WHEEL_BITS)
+#define WHEEL_MASK (WHEEL_SLOTS - 1)
+#define WHEEL_LEVELS 4
+#define WHEEL_SPAN ((u64)1 << (WHEEL_BITS * WHEEL_LEVELS)) // Ticks spanned by the whole wheel (~4.6 hours)
+#define NONE (-1)
+
+typedef struct Entry {
+    Callback callback;
+    void *data;
+    u64 deadline;   // Tick that the callback is due at
+    u16 generation; // Incremented every time the entry is freed
+    i16 list;       // List (wheel slot) that the entry is in, or NONE if it is free or running
+    i16 prev, next; // Neighbours within the list
+} Entry;
+
+static Entry pool[POOL_SIZE];
+static i16 heads[WHEEL_LEVELS * WHEEL_SLOTS];
+static i16 tails[WHEEL_LEVELS * WHEEL_SLOTS];
+static i16 freeHead = NONE;
+static u32 scheduled = 0; // Number of callbacks currently in the wheel
+static u64 tick = 0;      // Last tick that has been dispatched
+static bool initialized = false;
+static i16 running = NONE;           // Entry whose callback is currently running
+static bool runningCancelled = false; // Whether the running callback was cancelled from within itself
+
+static inline u64 now_tick() {
+    return time_us() / 1000;
+}
+
+static void init() {
+    for (u32 i = 0; i < WHEEL_LEVELS * WHEEL_SLOTS; i++) {
+        heads[i] = NONE;
+        tails[i] = NONE;
+    }
+    for (i16 i = 0; i < POOL_SIZE; i++) {
+        pool[i].list = NONE;
+        pool[i].next = i + 1 < POOL_SIZE ? i + 1 : NONE;
+    }
+    freeHead = 0;
+    tick = now_tick();
+    initialized = true;
+}
+
+static void list_append(i16 list, i16 e) {
+    pool[e].list = list;
+    pool[e].prev = tails[list];
+    pool[e].next = NONE;
+    if (tails[list] != NONE)
+        pool[tails[list]].next = e;
+    else
+        heads[list] = e;
+    tails[list] = e;
+}
+
+static void list_remove(i16 e) {
+    i16 list = pool[e].list;
+    if (pool[e].prev != NONE)
+        pool[pool[e].prev].next = pool[e].next;
+    else
+        heads[list] = pool[e].next;
+    if (pool[e].next != NONE)
+        pool[pool[e].next].prev = pool[e].prev;
+    else
+        tails[list] = pool[e].prev;
+    pool[e].list = NONE;
+}
+
+/**
+ * Places an entry into the slot of the wheel that matches its deadline.
+ * @param e the entry to place
+ */
+static void wheel_insert(i16 e) {
+    if (pool[e].deadline <= tick)
+        pool[e].deadline = tick + 1;
+    // Deadlines beyond the span of the wheel are parked in the last slot they can reach, and will be cascaded back up into
+    // the top level until they are in range
+    u64 deadline = pool[e].deadline;
+    if (deadline - tick >= WHEEL_SPAN)
+        deadline = tick + WHEEL_SPAN - 1;
+    u32 level = 0;
+    while (level < WHEEL_LEVELS - 1 && deadline - tick >= ((u64)1 << (WHEEL_BITS * (level + 1))))
+        level++;
+    list_append((i16)(level * WHEEL_SLOTS + ((deadline >> (WHEEL_BITS * level)) & WHEEL_MASK)), e);
+}
+
+/**
+ * Moves all entries in a slot of a level down into the levels below it.
+ * @param level the level of the slot
+ * @param slot the slot to cascade
+ */
+static void wheel_cascade(u32 level, u32 slot) {
+    i16 list = (i16)(level * WHEEL_SLOTS + slot);
+    while (heads[list] != NONE) {
+        i16 e = heads[list];
+        list_remove(e);
+        wheel_insert(e);
+    }
+}
+
+static void entry_free(i16 e) {
+    pool[e].generation++;
+    pool[e].list = NONE;
+    pool[e].next = freeHead;
+    freeHead = e;
+    scheduled--;
+}
+
+/**
+ * Runs the callback of an entry and reschedules or frees the entry as the callback requests.
+ * @param e the entry to run
+ */
+static void entry_run(i16 e) {
+    running = e;
+    runningCancelled = false;
+    i32 reschedule = pool[e].callback(pool[e].data);
+    running = NONE;
+    if (reschedule > 0 && !runningCancelled) {
+        pool[e].deadline = now_tick() + (u32)reschedule;
+        wheel_insert(e);
+    } else
+        entry_free(e);
+}
+
+void callback_dispatch() {
+    if (!initialized)
+        return;
+    u64 now = now_tick();
+    if (scheduled == 0) {
+        tick = now; // Nothing to cascade or run, so the wheel can skip straight to the current time
+        return;
+    }
+    while (tick < now) {
+        tick++;
+        // Every time a level wraps around, the next slot of the level above it is cascaded down
+        for (u32 level = 1; level < WHEEL_LEVELS; level++) {
+            if ((tick & (((u64)1 << (WHEEL_BITS * level)) - 1)) != 0)
+                break;
+            wheel_cascade(level, (tick >> (WHEEL_BITS * level)) & WHEEL_MASK);
+        }
+        // Callbacks may schedule or cancel other callbacks, so the slot is re-read after each one runs
+        i16 list = (i16)(tick & WHEEL_MASK);
+        while (heads[list] != NONE) {
+            i16 e = heads[list];
+            list_remove(e);
+            entry_run(e);
+        }
+    }
+}
+
+CallbackID callback_in_ms(u32 ms, Callback callback, void *data) {
+    if (!callback)
+        return 0;
+    if (!initialized)
+        init();
+    if (freeHead == NONE)
+        return 0; // Pool exhausted
+    i16 e = freeHead;
+    freeHead = pool[e].next;
+    scheduled++;
+    pool[e].callback = callback;
+    pool[e].data = data;
+    // Round up to the next tick so the callback never runs early
+    pool[e].deadline = (time_us() + (u64)ms * 1000 + 999) / 1000;
+    wheel_insert(e);
+    return ((u32)pool[e].generation << 16) | (u32)(e + 1);
+}
+
+void cancel_callback(CallbackID id) {
+    i32 e = (i32)(id & 0xFFFF) - 1;
+    if (e < 0 || e >= POOL_SIZE || pool[e].generation != (u16)(id >> 16))
+        return; // Invalid, or has already run/been cancelled
+    if (e == running)
+        runningCancelled = true; // Will be freed once the callback returns
+    else if (pool[e].list != NONE) {
+        list_remove((i16)e);
+        entry_free((i16)e);
+    }
+}
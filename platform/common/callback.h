@@ -0,0 +1,10 @@
+#pragma once
+
+// callback_in_ms() and cancel_callback() (see platform/time.h) are implemented once in callback.c for every platform, on top
+// of the platform's time_us(). All a platform needs to do is call callback_dispatch() from its sys_periodic().
+
+/**
+ * Runs any callbacks that have become due since the last dispatch.
+ * @note This must be called from sys_periodic(); callbacks will never run from anywhere else.
+ */
+void callback_dispatch();
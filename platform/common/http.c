@@ -0,0 +1,234 @@
+/**
+ * Source file of pico-fbw: https://github.com/pico-fbw/pico-fbw
+ * Licensed under the GNU AGPL-3.0
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+
+#include "http.h"
+
+// Preformatted pieces of response headers
+#define HEAD_VERSION "HTTP/1.1 "
+#define HEAD_CONTENT_TYPE "Content-Type: "
+#define HEAD_CONTENT_LENGTH "Content-Length: "
+#define HEAD_CHUNKED "Transfer-Encoding: chunked\r\n"
+#define HEAD_CLOSE "Connection: close\r\n"
+#define HEAD_END "\r\n"
+
+static void fail(HTTPParser *parser, i32 error) {
+    parser->state = HTTP_PARSE_ERROR;
+    parser->error = error;
+    parser->request.keepAlive = false;
+}
+
+static char *trim(char *str) {
+    while (*str == ' ' || *str == '\t')
+        str++;
+    char *end = str + strlen(str);
+    while (end > str && (end[-1] == ' ' || end[-1] == '\t'))
+        end--;
+    *end = '\0';
+    return str;
+}
+
+/**
+ * Parses the request line and headers, once they've all been received.
+ * @param parser the parser
+ * @note The head is split up in place, so the request's strings all point into it.
+ */
+static void parse_head(HTTPParser *parser) {
+    HTTPRequest *req = &parser->request;
+    parser->head[parser->headLen] = '\0';
+    // Request line: METHOD SP target SP HTTP/x.y
+    char *line = parser->head;
+    char *next = strstr(line, "\r\n");
+    *next = '\0';
+    char *target = strchr(line, ' ');
+    char *version = target ? strchr(target + 1, ' ') : NULL;
+    if (!version || strncmp(version + 1, "HTTP/1.", strlen("HTTP/1.")) != 0) {
+        fail(parser, 400);
+        return;
+    }
+    *target++ = '\0';
+    *version++ = '\0';
+    if (strcmp(line, "GET") == 0)
+        req->method = HTTP_METHOD_GET;
+    else if (strcmp(line, "HEAD") == 0)
+        req->method = HTTP_METHOD_HEAD;
+    else if (strcmp(line, "POST") == 0)
+        req->method = HTTP_METHOD_POST;
+    else
+        req->method = HTTP_METHOD_UNKNOWN;
+    req->target = target;
+    req->keepAlive = strcmp(version, "HTTP/1.0") != 0; // Persistent by default since HTTP/1.1
+
+    // Headers: Name ":" value CRLF, up to an empty line
+    u32 contentLength = 0;
+    for (line = next + 2; *line != '\0'; line = next + 2) {
+        next = strstr(line, "\r\n");
+        if (!next || next == line)
+            break; // The empty line that ends the headers
+        *next = '\0';
+        char *colon = strchr(line, ':');
+        if (!colon) {
+            fail(parser, 400);
+            return;
+        }
+        *colon = '\0';
+        const char *name = line;
+        const char *value = trim(colon + 1);
+        if (strcasecmp(name, "Content-Length") == 0) {
+            char *end;
+            unsigned long len = strtoul(value, &end, 10);
+            if (end == value || *end != '\0') {
+                fail(parser, 400);
+                return;
+            }
+            if (len > HTTP_BODY_MAX) {
+                fail(parser, 413);
+                return;
+            }
+            contentLength = (u32)len;
+        } else if (strcasecmp(name, "Transfer-Encoding") == 0) {
+            fail(parser, 501); // Chunked request bodies aren't supported (browsers never send them)
+            return;
+        } else if (strcasecmp(name, "Connection") == 0) {
+            if (strcasecmp(value, "close") == 0)
+                req->keepAlive = false;
+            else if (strcasecmp(value, "keep-alive") == 0)
+                req->keepAlive = true;
+        }
+        if (req->numHeaders < HTTP_HEADERS_MAX)
+            req->headers[req->numHeaders++] = (HTTPHeader){.name = name, .value = value};
+    }
+
+    if (contentLength == 0) {
+        parser->state = HTTP_PARSE_DONE;
+        return;
+    }
+    req->body = malloc(contentLength + 1);
+    if (!req->body) {
+        fail(parser, 500);
+        return;
+    }
+    req->bodyLen = contentLength;
+    parser->bodyRead = 0;
+    parser->state = HTTP_PARSE_BODY;
+}
+
+void http_parser_init(HTTPParser *parser) {
+    parser->state = HTTP_PARSE_HEAD;
+    parser->error = 0;
+    parser->request = (HTTPRequest){0};
+    parser->headLen = 0;
+    parser->bodyRead = 0;
+}
+
+void http_parser_reset(HTTPParser *parser) {
+    free(parser->request.body);
+    http_parser_init(parser);
+}
+
+u32 http_parse(HTTPParser *parser, const char *data, u32 len) {
+    u32 used = 0;
+    while (used < len) {
+        switch (parser->state) {
+            case HTTP_PARSE_HEAD: {
+                char c = data[used++];
+                if (parser->headLen == 0 && (c == '\r' || c == '\n'))
+                    continue; // Empty lines before a request are ignored
+                if (parser->headLen >= HTTP_HEAD_MAX - 1) {
+                    fail(parser, 431);
+                    return used;
+                }
+                parser->head[parser->headLen++] = c;
+                if (parser->headLen >= 4 && memcmp(parser->head + parser->headLen - 4, "\r\n\r\n", 4) == 0)
+                    parse_head(parser);
+                break;
+            }
+            case HTTP_PARSE_BODY: {
+                HTTPRequest *req = &parser->request;
+                u32 n = req->bodyLen - parser->bodyRead;
+                if (n > len - used)
+                    n = len - used;
+                memcpy(req->body + parser->bodyRead, data + used, n);
+                parser->bodyRead += n;
+                used += n;
+                if (parser->bodyRead == req->bodyLen) {
+                    req->body[req->bodyLen] = '\0';
+                    parser->state = HTTP_PARSE_DONE;
+                }
+                break;
+            }
+            default:
+                return used; // The request is complete, anything else belongs to the next one
+        }
+    }
+    return used;
+}
+
+const char *http_get_header(const HTTPRequest *req, const char *name) {
+    for (u32 i = 0; i < req->numHeaders; i++) {
+        if (strcasecmp(req->headers[i].name, name) == 0)
+            return req->headers[i].value;
+    }
+    return NULL;
+}
+
+bool http_get_query(const char *target, const char *key, char *value, u32 size) {
+    const char *param = strchr(target, '?');
+    size_t keyLen = strlen(key);
+    while (param) {
+        param++; // Skip the '?' or '&'
+        if (strncmp(param, key, keyLen) == 0 && param[keyLen] == '=') {
+            const char *start = param + keyLen + 1;
+            size_t len = strcspn(start, "&");
+            if (len >= size)
+                return false;
+            memcpy(value, start, len);
+            value[len] = '\0';
+            return true;
+        }
+        param = strchr(param, '&');
+    }
+    return false;
+}
+
+// Appends a string to a response head, tracking whether it still fits
+static void put(char *buf, u32 size, u32 *len, const char *str, u32 strLen) {
+    if (*len + strLen < size)
+        memcpy(buf + *len, str, strLen);
+    *len += strLen;
+}
+
+u32 http_format_head(char *buf, u32 size, const char *status, const char *type, i32 len, bool keepAlive, const char *extra) {
+    u32 n = 0;
+    put(buf, size, &n, HEAD_VERSION, strlen(HEAD_VERSION));
+    put(buf, size, &n, status, strlen(status));
+    put(buf, size, &n, HEAD_END, strlen(HEAD_END));
+    if (type) {
+        put(buf, size, &n, HEAD_CONTENT_TYPE, strlen(HEAD_CONTENT_TYPE));
+        put(buf, size, &n, type, strlen(type));
+        put(buf, size, &n, HEAD_END, strlen(HEAD_END));
+    }
+    if (len == HTTP_CHUNKED) {
+        put(buf, size, &n, HEAD_CHUNKED, strlen(HEAD_CHUNKED));
+    } else if (len >= 0) {
+        char length[16];
+        i32 lengthLen = snprintf(length, sizeof(length), "%ld\r\n", (long)len);
+        put(buf, size, &n, HEAD_CONTENT_LENGTH, strlen(HEAD_CONTENT_LENGTH));
+        put(buf, size, &n, length, (u32)lengthLen);
+    }
+    if (!keepAlive)
+        put(buf, size, &n, HEAD_CLOSE, strlen(HEAD_CLOSE));
+    if (extra)
+        put(buf, size, &n, extra, strlen(extra));
+    put(buf, size, &n, HEAD_END, strlen(HEAD_END));
+    if (n >= size)
+        return 0;
+    buf[n] = '\0';
+    return n;
+}
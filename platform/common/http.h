@@ -0,0 +1,111 @@
+#pragma once
+
+#include <stdbool.h>
+#include "platform/types.h"
+
+// A small HTTP/1.1 engine shared by the platforms' web servers, which only have to move bytes between it and their sockets.
+// Requests are parsed incrementally, from however many pieces they arrive in (e.g. a chain of lwIP pbufs), into a fixed
+// buffer per connection. The parser stops at the end of each request, so any pipelined requests after it are left with the
+// caller until it's ready for them. Response headers are assembled from preformatted pieces, without allocating.
+
+#define HTTP_HEAD_MAX 2048         // Longest request line and headers of a request, bytes
+#define HTTP_HEADERS_MAX 16        // Headers kept per request (any more are ignored)
+#define HTTP_BODY_MAX (32 * 1024)  // Largest request body that is accepted (e.g. a flightplan), bytes
+#define HTTP_RESPONSE_HEAD_MAX 384 // Response headers always fit into this much space (given a short `extra`)
+
+#define HTTP_CHUNKED -1 // Length of a response whose body is sent with chunked transfer encoding
+#define HTTP_STREAM -2  // Length of a response whose body lasts until the connection closes (e.g. an event stream)
+#define HTTP_NO_BODY -3 // Length of a response that never has a body (e.g. 304 Not Modified)
+
+// clang-format off
+typedef enum HTTPMethod {
+    HTTP_METHOD_UNKNOWN,
+    HTTP_METHOD_GET,
+    HTTP_METHOD_HEAD,
+    HTTP_METHOD_POST,
+} HTTPMethod;
+
+typedef enum HTTPParseState {
+    HTTP_PARSE_HEAD,  // Receiving the request line and headers
+    HTTP_PARSE_BODY,  // Receiving the body
+    HTTP_PARSE_DONE,  // A complete request is available
+    HTTP_PARSE_ERROR, // The request was malformed; respond with `error` and close the connection
+} HTTPParseState;
+// clang-format on
+
+typedef struct HTTPHeader {
+    const char *name;
+    const char *value;
+} HTTPHeader;
+
+typedef struct HTTPRequest {
+    HTTPMethod method;
+    const char *target; // e.g. "/api/v1/get/config?foo=bar"
+    bool keepAlive;     // Whether the connection may be kept open after the response
+    char *body;         // Null-terminated, or NULL if the request has no body
+    u32 bodyLen;
+    HTTPHeader headers[HTTP_HEADERS_MAX];
+    u32 numHeaders;
+} HTTPRequest;
+
+typedef struct HTTPParser {
+    HTTPParseState state;
+    i32 error; // Status code to respond with, if `state` is HTTP_PARSE_ERROR
+    HTTPRequest request;
+    char head[HTTP_HEAD_MAX];
+    u32 headLen;
+    u32 bodyRead;
+} HTTPParser;
+
+/**
+ * Initializes a parser, ready for the first request on a connection.
+ * @param parser the parser
+ */
+void http_parser_init(HTTPParser *parser);
+
+/**
+ * Readies a parser for the next request on a connection, freeing the previous one.
+ * @param parser the parser
+ */
+void http_parser_reset(HTTPParser *parser);
+
+/**
+ * Feeds received data into a parser.
+ * @param parser the parser
+ * @param data the data
+ * @param len the length of the data
+ * @return the number of bytes consumed; this is less than `len` once a request is complete (or malformed), in which case the
+ * rest belongs to the next request and should be fed again after `http_parser_reset()`
+ */
+u32 http_parse(HTTPParser *parser, const char *data, u32 len);
+
+/**
+ * Gets the value of a request header.
+ * @param req the request
+ * @param name the name of the header (case-insensitive)
+ * @return the value of the header, or NULL if the request doesn't have it
+ */
+const char *http_get_header(const HTTPRequest *req, const char *name);
+
+/**
+ * Gets the value of a parameter in the query string of a request's target.
+ * @param target the target (e.g. "/api/v1/stream?channels=gps&rate=10")
+ * @param key the name of the parameter
+ * @param value where to store the value
+ * @param size the size of `value`
+ * @return true if the parameter was found (and its value fit into `value`)
+ */
+bool http_get_query(const char *target, const char *key, char *value, u32 size);
+
+/**
+ * Formats the headers of a response.
+ * @param buf the buffer to format into, at least HTTP_RESPONSE_HEAD_MAX bytes is always enough
+ * @param size the size of the buffer
+ * @param status the status (e.g. "200 OK")
+ * @param type the content type of the body, or NULL if there is none
+ * @param len the length of the body, HTTP_CHUNKED, HTTP_STREAM, or HTTP_NO_BODY
+ * @param keepAlive whether the connection will be kept open after the response
+ * @param extra any other headers, each ending with "\r\n", or NULL
+ * @return the length of the headers, or 0 if they didn't fit into the buffer
+ */
+u32 http_format_head(char *buf, u32 size, const char *status, const char *type, i32 len, bool keepAlive, const char *extra);
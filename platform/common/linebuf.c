@@ -0,0 +1,82 @@
+/**
+ * Source file of pico-fbw: https://github.com/pico-fbw/pico-fbw
+ * Licensed under the GNU AGPL-3.0
+ */
+
+#include "linebuf.h"
+
+#define RING_MASK (LINEBUF_RING_SIZE - 1)
+
+// head and tail are free-running counters (they are only ever masked when indexing), so head - tail is always the number of
+// buffered characters, even across wraparound.
+// The producer publishes characters with a release store of head, which the consumer pairs with an acquire load (and vice
+// versa for tail), so each side always sees the other's data before the index that covers it.
+
+void linebuf_init(LineBuf *lb) {
+    atomic_init(&lb->head, 0);
+    atomic_init(&lb->tail, 0);
+    lb->len = 0;
+    lb->complete = false;
+}
+
+bool linebuf_put(LineBuf *lb, char c) {
+    u32 head = atomic_load_explicit(&lb->head, memory_order_relaxed);
+    if (head - atomic_load_explicit(&lb->tail, memory_order_acquire) >= LINEBUF_RING_SIZE)
+        return false;
+    lb->ring[head & RING_MASK] = c;
+    atomic_store_explicit(&lb->head, head + 1, memory_order_release);
+    return true;
+}
+
+u32 linebuf_space(LineBuf *lb) {
+    return LINEBUF_RING_SIZE -
+           (atomic_load_explicit(&lb->head, memory_order_relaxed) - atomic_load_explicit(&lb->tail, memory_order_acquire));
+}
+
+/**
+ * Moves characters from the ring into the line until a terminator is found.
+ * @param lb the line buffer
+ * @param binary whether to assemble a zero-delimited packet rather than a line
+ * @return whether a complete line or packet was assembled
+ */
+static bool assemble(LineBuf *lb, bool binary) {
+    if (lb->complete) {
+        // The previous line was returned last time, start a new one
+        lb->len = 0;
+        lb->complete = false;
+    }
+    u32 tail = atomic_load_explicit(&lb->tail, memory_order_relaxed);
+    u32 head = atomic_load_explicit(&lb->head, memory_order_acquire);
+    while (tail != head) {
+        char c = lb->ring[tail & RING_MASK];
+        tail++;
+        if (binary ? c == '\0' : (c == '\n' || c == '\r')) {
+            if (lb->len == 0)
+                continue; // Empty line, or the second half of "\r\n"
+            lb->complete = true;
+            break; // Anything after the line is left for the next call
+        }
+        if (!binary && c == '\0')
+            continue; // Zeros can't be part of a string (and are most likely leftovers from a binary session)
+        // Characters past the end of the line's storage are dropped, truncating the line (one byte is always kept free for
+        // the null terminator)
+        if (lb->len < LINEBUF_LINE_SIZE - 1)
+            lb->line[lb->len++] = c;
+    }
+    atomic_store_explicit(&lb->tail, tail, memory_order_release);
+    return lb->complete;
+}
+
+char *linebuf_read(LineBuf *lb) {
+    if (!assemble(lb, false))
+        return NULL;
+    lb->line[lb->len] = '\0';
+    return lb->line;
+}
+
+byte *linebuf_read_packet(LineBuf *lb, u32 *len) {
+    if (!assemble(lb, true))
+        return NULL;
+    *len = lb->len;
+    return (byte *)lb->line;
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include "platform/types.h"
+
+// Non-blocking line (or packet) assembly for input streams (stdin, UARTs, sockets).
+// Characters are pushed into a fixed-size ring by a single producer (an IRQ handler, a background thread, or a poll from the
+// main loop) and assembled into lines by a single consumer, so neither side ever blocks, locks, or allocates. While no input
+// is arriving, reading a line costs a single comparison.
+
+#define LINEBUF_RING_SIZE 512   // Characters that can be buffered between the producer and consumer, must be a power of 2
+#define LINEBUF_LINE_SIZE 8192  // Longest line that can be assembled (including the null terminator), longer lines are truncated
+
+typedef struct LineBuf {
+    char ring[LINEBUF_RING_SIZE];
+    atomic_uint head; // Only ever written by the producer
+    atomic_uint tail; // Only ever written by the consumer
+    // Consumer-side state
+    char line[LINEBUF_LINE_SIZE];
+    u32 len;
+    bool complete; // Whether `line` holds a complete line or packet that has already been returned
+} LineBuf;
+
+/**
+ * Initializes a line buffer.
+ * @param lb the line buffer
+ */
+void linebuf_init(LineBuf *lb);
+
+/**
+ * Pushes a character into a line buffer. Only to be called by the producer.
+ * @param lb the line buffer
+ * @param c the character
+ * @return true if the character was buffered, false if the ring is full (the character is not buffered)
+ */
+bool linebuf_put(LineBuf *lb, char c);
+
+/**
+ * @param lb the line buffer
+ * @return the number of characters that can currently be pushed without the ring overflowing
+ */
+u32 linebuf_space(LineBuf *lb);
+
+/**
+ * Gets the next complete line from a line buffer, if there is one. Only to be called by the consumer.
+ * Lines may end with "\n", "\r", or "\r\n"; empty lines are skipped.
+ * @param lb the line buffer
+ * @return the line (without its terminator, null-terminated), or NULL if no complete line is available yet
+ * @note The line belongs to the line buffer and is only valid until the next call; it may be modified.
+ */
+char *linebuf_read(LineBuf *lb);
+
+/**
+ * Gets the next complete packet from a line buffer, if there is one. Only to be called by the consumer.
+ * Packets are delimited by zero bytes (see lib/cobs.h); empty packets are skipped. Line and packet reads can be mixed, for
+ * example to switch a session between a text and a binary protocol.
+ * @param lb the line buffer
+ * @param len pointer to where the length of the packet should be stored
+ * @return the packet (without its delimiter), or NULL if no complete packet is available yet
+ * @note The packet belongs to the line buffer and is only valid until the next call; it may be modified. Packets longer
+ * than LINEBUF_LINE_SIZE are truncated.
+ */
+byte *linebuf_read_packet(LineBuf *lb, u32 *len);
@@ -0,0 +1,39 @@
+/**
+ * Source file of pico-fbw: https://github.com/pico-fbw/pico-fbw
+ * Licensed under the GNU AGPL-3.0
+ */
+
+#include "ringbuf.h"
+
+#define RING_MASK (RINGBUF_SIZE - 1)
+
+// Same scheme as linebuf.c: head and tail are free-running counters, published with release stores and read with acquire
+// loads, so each side always sees the other's data before the index that covers it.
+
+void ringbuf_init(RingBuf *rb) {
+    atomic_init(&rb->head, 0);
+    atomic_init(&rb->tail, 0);
+    atomic_init(&rb->overruns, 0);
+}
+
+bool ringbuf_put(RingBuf *rb, byte b) {
+    u32 head = atomic_load_explicit(&rb->head, memory_order_relaxed);
+    if (head - atomic_load_explicit(&rb->tail, memory_order_acquire) >= RINGBUF_SIZE) {
+        atomic_fetch_add_explicit(&rb->overruns, 1, memory_order_relaxed);
+        return false;
+    }
+    rb->data[head & RING_MASK] = b;
+    atomic_store_explicit(&rb->head, head + 1, memory_order_release);
+    return true;
+}
+
+u32 ringbuf_read(RingBuf *rb, byte *buf, u32 len) {
+    u32 tail = atomic_load_explicit(&rb->tail, memory_order_relaxed);
+    u32 available = atomic_load_explicit(&rb->head, memory_order_acquire) - tail;
+    if (len > available)
+        len = available;
+    for (u32 i = 0; i < len; i++)
+        buf[i] = rb->data[(tail + i) & RING_MASK];
+    atomic_store_explicit(&rb->tail, tail + len, memory_order_release);
+    return len;
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include "platform/types.h"
+
+// Non-blocking byte ring for raw input streams (e.g. UARTs carrying binary protocols, where lines mean nothing; see linebuf.h
+// for line input). Bytes are pushed by a single producer (typically an IRQ handler) and read in chunks by a single consumer,
+// so neither side ever blocks, locks, or allocates.
+
+#define RINGBUF_SIZE 1024 // Bytes that can be buffered between the producer and consumer, must be a power of 2
+
+typedef struct RingBuf {
+    byte data[RINGBUF_SIZE];
+    atomic_uint head;     // Only ever written by the producer
+    atomic_uint tail;     // Only ever written by the consumer
+    atomic_uint overruns; // Number of bytes dropped because the ring was full
+} RingBuf;
+
+/**
+ * Initializes a ring.
+ * @param rb the ring
+ */
+void ringbuf_init(RingBuf *rb);
+
+/**
+ * Pushes a byte into a ring. Only to be called by the producer.
+ * @param rb the ring
+ * @param b the byte
+ * @return true if the byte was buffered, false if the ring is full (the byte is dropped and counted as an overrun)
+ */
+bool ringbuf_put(RingBuf *rb, byte b);
+
+/**
+ * Takes bytes out of a ring. Only to be called by the consumer.
+ * @param rb the ring
+ * @param buf where to store the bytes
+ * @param len the most bytes to take
+ * @return the number of bytes taken, 0 if the ring is empty
+ */
+u32 ringbuf_read(RingBuf *rb, byte *buf, u32 len);
@@ -0,0 +1,156 @@
+/**
+ * Source file of pico-fbw: https://github.com/pico-fbw/pico-fbw
+ * Licensed under the GNU AGPL-3.0
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "platform/defs.h"
+
+#if PLATFORM_SUPPORTS_WIFI
+
+    #include "platform/flash.h"
+
+    #include "www.h"
+
+    #define FIELDS 6 // Fields in each line of the manifest
+
+    #define CACHE_IMMUTABLE "public, max-age=31536000, immutable"
+    #define CACHE_REVALIDATE "no-cache" // Still cached, but checked with the ETag every time it's used
+
+static char *manifest = NULL; // Contents of the manifest, which the files' strings point into
+static WWWFile *files = NULL; // Sorted by path
+static u32 numFiles = 0;
+
+static int compare_files(const void *a, const void *b) {
+    return strcmp(((const WWWFile *)a)->path, ((const WWWFile *)b)->path);
+}
+
+static int compare_path(const void *path, const void *file) {
+    return strcmp((const char *)path, ((const WWWFile *)file)->path);
+}
+
+/**
+ * Parses a line of the manifest into a file.
+ * @param line the line, which is split up in place
+ * @param file the file to parse into
+ * @return true if the line was valid
+ */
+static bool parse_line(char *line, WWWFile *file) {
+    char *fields[FIELDS];
+    for (u32 i = 0; i < FIELDS; i++) {
+        fields[i] = line;
+        line = strchr(line, '\t');
+        if (i < FIELDS - 1) {
+            if (!line)
+                return false;
+            *line++ = '\0';
+        }
+    }
+    if (fields[0][0] != '/' || strlen(fields[0]) > WWW_PATH_MAX || strlen(fields[4]) > WWW_ETAG_MAX - 3)
+        return false;
+    file->path = fields[0];
+    file->gzipped = fields[1][0] == '1';
+    file->type = fields[2];
+    file->size = strtoul(fields[3], NULL, 10);
+    file->etag[0] = '"';
+    strcpy(file->etag + 1, fields[4]);
+    strcat(file->etag, "\"");
+    file->immutable = fields[5][0] == '1';
+    return true;
+}
+
+bool www_load() {
+    lfs_file_t file;
+    if (lfs_file_open(&wwwfs, &file, WWW_MANIFEST_PATH, LFS_O_RDONLY) != LFS_ERR_OK)
+        return false;
+    lfs_soff_t size = lfs_file_size(&wwwfs, &file);
+    char *contents = size >= 0 ? malloc(size + 1) : NULL;
+    if (!contents || lfs_file_read(&wwwfs, &file, contents, size) != size) {
+        free(contents);
+        lfs_file_close(&wwwfs, &file);
+        return false;
+    }
+    lfs_file_close(&wwwfs, &file);
+    contents[size] = '\0';
+
+    // Every line is a file
+    u32 count = 0;
+    for (const char *c = contents; *c != '\0'; c++) {
+        if (*c == '\n')
+            count++;
+    }
+    WWWFile *parsed = calloc(count > 0 ? count : 1, sizeof(WWWFile));
+    if (!parsed) {
+        free(contents);
+        return false;
+    }
+    u32 numParsed = 0;
+    for (char *line = contents, *next; line && *line != '\0'; line = next) {
+        next = strchr(line, '\n');
+        if (next)
+            *next++ = '\0';
+        if (numParsed >= count || !parse_line(line, &parsed[numParsed])) {
+            free(parsed);
+            free(contents);
+            return false;
+        }
+        numParsed++;
+    }
+    qsort(parsed, numParsed, sizeof(WWWFile), compare_files);
+
+    free(files);
+    free(manifest);
+    files = parsed;
+    manifest = contents;
+    numFiles = numParsed;
+    return true;
+}
+
+const WWWFile *www_find(const char *uri) {
+    char path[WWW_PATH_MAX + sizeof("index.html")];
+    size_t len = strcspn(uri, "?");
+    if (len == 0 || len > WWW_PATH_MAX || !files)
+        return NULL;
+    memcpy(path, uri, len);
+    path[len] = '\0';
+    if (path[len - 1] == '/')
+        strcat(path, "index.html");
+    return bsearch(path, files, numFiles, sizeof(WWWFile), compare_path);
+}
+
+bool www_fs_path(const WWWFile *file, char *buf, u32 size) {
+    size_t len = strlen(WWW_ROOT) + strlen(file->path) + (file->gzipped ? strlen(".gz") : 0);
+    if (len >= size)
+        return false;
+    strcpy(buf, WWW_ROOT);
+    strcat(buf, file->path);
+    if (file->gzipped)
+        strcat(buf, ".gz");
+    return true;
+}
+
+const char *www_cache_control(const WWWFile *file) {
+    return file->immutable ? CACHE_IMMUTABLE : CACHE_REVALIDATE;
+}
+
+bool www_not_modified(const WWWFile *file, const char *ifNoneMatch) {
+    if (!ifNoneMatch)
+        return false;
+    // A list of ETags, e.g. "\"abc\", W/\"def\"", or "*"; weak comparison is used, so W/ prefixes are ignored
+    size_t etagLen = strlen(file->etag);
+    for (const char *tag = ifNoneMatch; *tag != '\0';) {
+        tag += strspn(tag, " \t,");
+        if (*tag == '*')
+            return true;
+        if (strncmp(tag, "W/", strlen("W/")) == 0)
+            tag += strlen("W/");
+        size_t len = strcspn(tag, " \t,");
+        if (len == etagLen && strncmp(tag, file->etag, len) == 0)
+            return true;
+        tag += len;
+    }
+    return false;
+}
+
+#endif // PLATFORM_SUPPORTS_WIFI
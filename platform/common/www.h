@@ -0,0 +1,60 @@
+#pragma once
+
+#include <stdbool.h>
+#include "platform/types.h"
+
+// The web interface's files, as described by the manifest generated when it's built (see www/manifest.cmake).
+// The manifest is loaded once at boot, so the web servers know whether a file exists (and whether it's stored gzipped)
+// without probing the filesystem, and can answer revalidation requests (If-None-Match) without opening the file at all.
+
+#define WWW_MANIFEST_PATH "/manifest" // Path of the manifest in wwwfs
+#define WWW_ROOT "/www"               // Directory of the web interface's files in wwwfs
+#define WWW_PATH_MAX 128              // Longest path of a file that can be served
+#define WWW_ETAG_MAX 19               // Longest ETag of a file (a quoted 16 character hash), plus the null terminator
+
+typedef struct WWWFile {
+    const char *path;        // The path the file is requested at, e.g. "/index.html"
+    const char *type;        // Content type
+    u32 size;                // Size of the file as stored (after compression, if it's gzipped)
+    char etag[WWW_ETAG_MAX]; // Strong ETag, e.g. "\"3bb2abb69ebb27fb\""
+    bool gzipped;            // Whether the file is stored gzipped (as "<path>.gz")
+    bool immutable;          // Whether the file's name contains a hash of its contents, so it never changes
+} WWWFile;
+
+/**
+ * Loads the manifest of the web interface from wwwfs.
+ * @return true if successful
+ * @note wwwfs must already be mounted.
+ */
+bool www_load();
+
+/**
+ * Finds the file that a request is for.
+ * @param uri the request's target (e.g. "/", "/assets/index-2f8a09c1.js?v=1"); any query string is ignored and directories
+ * resolve to their index.html
+ * @return the file, or NULL if there is no such file
+ */
+const WWWFile *www_find(const char *uri);
+
+/**
+ * Gets the path a file is stored at in wwwfs.
+ * @param file the file
+ * @param buf the buffer to write the path to, WWW_PATH_MAX + sizeof(WWW_ROOT) + sizeof(".gz") bytes is always enough
+ * @param size the size of the buffer
+ * @return true if the path fit into the buffer
+ */
+bool www_fs_path(const WWWFile *file, char *buf, u32 size);
+
+/**
+ * @param file the file
+ * @return the value of the Cache-Control header the file should be served with
+ */
+const char *www_cache_control(const WWWFile *file);
+
+/**
+ * Checks whether a client's cached copy of a file is still current, in which case it should be sent 304 Not Modified.
+ * @param file the file
+ * @param ifNoneMatch the value of the request's If-None-Match header, or NULL if it has none
+ * @return true if the client's copy is current
+ */
+bool www_not_modified(const WWWFile *file, const char *ifNoneMatch);
@@ -1,10 +1,7 @@
 #pragma once
 
-#include "esp_timer.h"
 #include "sdkconfig.h"
 
-typedef esp_timer_handle_t __callback_id_t;
-
 // Flight control I/O pins
 #define PIN_INPUT_AIL 15
 #define PIN_SERVO_AIL 4
@@ -6,39 +6,48 @@
 #include <stdarg.h>
 #include <stdbool.h>
 #include <stdio.h>
+#include "esp_vfs_dev.h" // https://docs.espressif.com/projects/esp-idf/en/v5.2/esp32/api-reference/storage/vfs.html
 
-#include "platform/time.h"
+#include "platform/common/linebuf.h"
 
 #include "platform/stdio.h"
 
+static LineBuf stdinBuf;
+
 void stdio_setup() {
-    return; // Nothing to do here, the bootloader already sets up stdio
+    // The bootloader already sets up stdio
     // See https://docs.espressif.com/projects/esp-idf/en/v5.2/esp32/api-guides/startup.html
+    linebuf_init(&stdinBuf);
 }
 
-char *stdin_read() {
-    // Very similar to stdin_read() in pico/stdio.c, take a look at that for documentation
-    char *buf = NULL;
-    u32 i = 0;
-    while (true) {
+// stdin is non-blocking (getchar() returns EOF when there is no input), so whatever has been received can be moved into the
+// line buffer without waiting
+static void poll_stdin() {
+    for (u32 space = linebuf_space(&stdinBuf); space > 0; space--) {
         int c = getchar();
-        if (c == '\n' || c == '\r' || c == 0 || c == EOF) {
+        if (c == EOF)
             break;
-        } else {
-            buf = try_realloc(buf, (i + 1) * sizeof(char));
-            if (!buf)
-                return NULL;
-            buf[i++] = c;
-            sleep_us_blocking(50); // Sleep for a bit to wait for more input (possibly)
-        }
-    }
-    if (i != 0) {
-        buf = try_realloc(buf, (i + 1) * sizeof(char));
-        if (!buf)
-            return NULL;
-        buf[i] = '\0';
+        linebuf_put(&stdinBuf, (char)c);
     }
-    return buf;
+}
+
+char *stdin_read() {
+    poll_stdin();
+    return linebuf_read(&stdinBuf);
+}
+
+byte *stdin_read_packet(u32 *len) {
+    poll_stdin();
+    return linebuf_read_packet(&stdinBuf, len);
+}
+
+void stdout_write(const byte *data, u32 len) {
+    // The console translates "\n" to "\r\n" by default, which would corrupt binary data, so it is turned off for the write
+    fflush(stdout);
+    esp_vfs_dev_uart_port_set_tx_line_endings(CONFIG_ESP_CONSOLE_UART_NUM, ESP_LINE_ENDINGS_LF);
+    fwrite(data, 1, len, stdout);
+    fflush(stdout);
+    esp_vfs_dev_uart_port_set_tx_line_endings(CONFIG_ESP_CONSOLE_UART_NUM, ESP_LINE_ENDINGS_CRLF);
 }
 
 int __printflike(1, 2) wrap_printf(const char *fmt, ...) {
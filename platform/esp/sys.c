@@ -11,6 +11,7 @@
 #include "freertos/task.h"
 #include "nvs_flash.h"
 
+#include "platform/common/callback.h"
 #include "platform/sys.h"
 
 #define THREAD_DELAY_MS 10 // The amount of time to allow for other RTOS tasks to run
@@ -33,6 +34,7 @@ void sys_boot_end() {
 void sys_periodic() {
     if (esp_task_wdt_status(NULL) == ESP_OK)
         esp_task_wdt_reset();
+    callback_dispatch();
     vTaskDelay(pdMS_TO_TICKS(THREAD_DELAY_MS)); // Allow other RTOS tasks to run
     static_assert(pdMS_TO_TICKS(THREAD_DELAY_MS) > 0, "THREAD_DELAY_MS must be at least one tick");
 }
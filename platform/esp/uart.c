@@ -3,13 +3,9 @@
  * Licensed under the GNU AGPL-3.0
  */
 
-#include <stdlib.h>
-#include <string.h>
 #include "driver/uart.h" // https://docs.espressif.com/projects/esp-idf/en/v5.2/esp32/api-reference/peripherals/uart.html
 #include "driver/gpio.h"
 
-#include "platform/stdio.h"
-
 #include "platform/uart.h"
 
 #define UART_RX_BUFFER_SIZE 1024
@@ -62,38 +58,18 @@ bool uart_setup(u32 tx, u32 rx, u32 baud) {
     return false; // No available UART ports
 }
 
-char *uart_read(u32 tx, u32 rx) {
+u32 uart_read(u32 tx, u32 rx, byte *buf, u32 len) {
     UARTInstance *instance = uart_instance_from_pins(tx, rx);
     if (!instance)
-        return NULL;
-    // Very similar to stdin_read() in pico/stdio.c, take a look at that for documentation
-    char *buf = NULL;
-    u32 i = 0;
-    while (i < UART_RX_BUFFER_SIZE - 1) {
-        char c;
-        if (uart_read_bytes(instance->port, (void *)&c, 1, 0) <= 0)
-            break;
-        if (c == '\n' || c == '\r')
-            break;
-        else {
-            buf = try_realloc(buf, (i + 1) * sizeof(char));
-            if (!buf)
-                return NULL;
-            buf[i++] = c;
-        }
-    }
-    if (i != 0) {
-        buf = try_realloc(buf, (i + 1) * sizeof(char));
-        if (!buf)
-            return NULL;
-        buf[i] = '\0';
-    }
-    return buf;
+        return 0;
+    // The driver's interrupt handler has already moved anything received into its ring, so this never waits
+    int read = uart_read_bytes(instance->port, (void *)buf, len, 0);
+    return read > 0 ? (u32)read : 0;
 }
 
-bool uart_write(u32 tx, u32 rx, const char *str) {
+bool uart_write(u32 tx, u32 rx, const byte *data, u32 len) {
     UARTInstance *instance = uart_instance_from_pins(tx, rx);
     if (!instance)
         return false;
-    return uart_write_bytes(instance->port, (const void *)str, strlen(str)) == ESP_OK;
+    return uart_write_bytes(instance->port, (const void *)data, len) == (int)len;
 }
@@ -10,26 +10,53 @@
 // clang-format off
 
 #include <limits.h>
+#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
 #include "esp_event.h"
 
-#include "lib/mimetype.h"
+#include "lib/jsonwriter.h"
 
+#include "platform/common/www.h"
 #include "platform/flash.h"
 #include "platform/helpers.h"
 #include "platform/types.h"
 
 #include "sys/api/api.h"
-#include "sys/api/cmds/GET/get_config.h"
-#include "sys/api/cmds/GET/get_info.h"
-#include "sys/api/cmds/SET/set_config.h"
-#include "sys/api/cmds/SET/set_flightplan.h"
+#include "sys/api/cmds/cmds.h"
+#include "sys/api/stream.h"
 
 #define CHUNK_XFER_SIZE 1024
+#define API_V1_PATH "/api/v1/"
+#define JSON_BUFFER_SIZE 512 // Size of the buffer API responses are assembled in (the server's task has a small stack)
 
 // clang-format on
 
+// Telemetry event streams (GET /api/v1/stream) are opened by the HTTP server's task, but updates are sent from the main loop
+// (where subscriptions live), straight to the stream's socket, so that a stream doesn't tie up the server's only task
+
+// clang-format off
+typedef enum EventStreamState {
+    EVENT_STREAM_FREE,
+    EVENT_STREAM_STARTING, // Opened by the server, waiting to be subscribed from the main loop
+    EVENT_STREAM_ACTIVE,
+    EVENT_STREAM_CLOSED,   // Disconnected, waiting to be unsubscribed from the main loop
+} EventStreamState;
+// clang-format on
+
+typedef struct EventStream {
+    volatile EventStreamState state;
+    int fd;
+    u8 channels;
+    u32 rate;
+    StreamClient client;
+} EventStream;
+
+static httpd_handle_t streamServer = NULL;
+static EventStream eventStreams[STREAM_CLIENTS_MAX];
+
 /**
  * Gets the body of a request and stores it in a buffer.
  * @param req the request
@@ -64,138 +91,141 @@ static esp_err_t get_request_body(httpd_req_t *req, char **response) {
     return ESP_OK;
 }
 
-// GET handlers
+// JSON output of an API handler is sent as it's written: if it all fits into the writer's buffer, it's sent in one piece once
+// the handler is done (with the handler's status); otherwise it's sent in chunks as the buffer fills up
+typedef struct JSONResponse {
+    httpd_req_t *req;
+    bool chunked; // Whether at least one chunk has already been sent
+} JSONResponse;
 
-static esp_err_t handle_api_v1_get_config(httpd_req_t *req) {
-    // Get the request body
-    char *in = NULL;
-    esp_err_t err = get_request_body(req, &in);
-    if (err != ESP_OK)
-        return err;
-    char *out = NULL;
-    // Perform the relavent API call and obtain its output
-    i32 res = api_handle_get_config(in, &out);
-    // Set the status of the HTTP response to the status of the API response
-    httpd_resp_set_status(req, api_res_to_http_status(res));
-    if (!out) {
-        httpd_resp_send_500(req);
-        return ESP_ERR_NO_MEM;
+// Writer sink, called whenever the writer's buffer fills up
+static void send_json_chunk(const char *data, u32 len, void *ctx) {
+    JSONResponse *resp = (JSONResponse *)ctx;
+    if (!resp->chunked) {
+        httpd_resp_set_type(resp->req, HTTPD_TYPE_JSON);
+        resp->chunked = true;
     }
-    free(in);
-    // Set the content type of the HTTP response to JSON and send the output
-    httpd_resp_set_type(req, HTTPD_TYPE_JSON);
-    httpd_resp_sendstr(req, out);
-    free(out);
-    return res < 500 ? ESP_OK : ESP_FAIL;
+    httpd_resp_send_chunk(resp->req, data, len);
 }
 
-static esp_err_t handle_api_v1_get_info(httpd_req_t *req) {
-    char *out = NULL;
-    i32 res = api_handle_get_info(&out);
-    httpd_resp_set_status(req, api_res_to_http_status(res));
-    if (!out) {
-        httpd_resp_send_500(req);
-        return ESP_ERR_NO_MEM;
+/**
+ * Finishes sending the output of an API handler.
+ * @param resp the response
+ * @param json the writer the handler wrote to
+ * @param res the status code returned by the handler
+ * @return ESP_OK if the handler succeeded, ESP_FAIL otherwise
+ */
+static esp_err_t send_json_response(JSONResponse *resp, JSONWriter *json, i32 res) {
+    if (resp->chunked) {
+        jsonw_finish(json);
+        httpd_resp_send_chunk(resp->req, NULL, 0);
+    } else {
+        // Everything the handler wrote (if anything) is still in the buffer
+        httpd_resp_set_status(resp->req, api_res_to_http_status(res));
+        httpd_resp_set_type(resp->req, HTTPD_TYPE_JSON);
+        if (json->len > 0)
+            httpd_resp_send(resp->req, json->buf, json->len);
+        else
+            httpd_resp_sendstr(resp->req, "{}");
     }
-    httpd_resp_set_type(req, HTTPD_TYPE_JSON);
-    httpd_resp_sendstr(req, out);
-    free(out);
     return res < 500 ? ESP_OK : ESP_FAIL;
 }
 
-// SET handlers
-
-static esp_err_t handle_api_v1_set_config(httpd_req_t *req) {
+// Runs the API command served on the requested route (see sys/api/cmds/cmds.h), sending its output as it's written
+static esp_err_t handle_api_v1(httpd_req_t *req) {
     char *in = NULL;
     esp_err_t err = get_request_body(req, &in);
     if (err != ESP_OK)
         return err;
-    i32 res = api_handle_set_config(in);
-    httpd_resp_set_status(req, api_res_to_http_status(res));
+    char buf[JSON_BUFFER_SIZE];
+    JSONResponse resp = {.req = req};
+    JSONWriter json;
+    jsonw_init_sink(&json, buf, sizeof(buf), send_json_chunk, &resp);
+    u8 method = req->method == HTTP_POST ? API_HTTP_POST : API_HTTP_GET;
+    i32 res = api_exec_http(req->uri + strlen(API_V1_PATH), method, in, &json);
     free(in);
-    httpd_resp_set_type(req, HTTPD_TYPE_JSON);
-    httpd_resp_sendstr(req, "{}");
-    return res < 500 ? ESP_OK : ESP_FAIL;
+    return send_json_response(&resp, &json, res);
 }
 
-static esp_err_t handle_api_v1_set_flightplan(httpd_req_t *req) {
-    char *in = NULL;
-    esp_err_t err = get_request_body(req, &in);
-    if (err != ESP_OK)
-        return err;
-    char *out = NULL;
-    i32 res = api_handle_set_flightplan(in, &out);
-    httpd_resp_set_status(req, api_res_to_http_status(res));
-    if (!out) {
-        httpd_resp_send_500(req);
-        return ESP_ERR_NO_MEM;
+// Opens a telemetry event stream, e.g. GET /api/v1/stream?channels=aahrs,gps&rate=10.
+// The response is left open; it is subscribed by http_server_periodic() and receives one "data:" event per update.
+static esp_err_t handle_api_v1_stream(httpd_req_t *req) {
+    char query[96], value[64];
+    u8 channels = 0;
+    u32 rate = 0;
+    if (httpd_req_get_url_query_str(req, query, sizeof(query)) == ESP_OK) {
+        if (httpd_query_key_value(query, "channels", value, sizeof(value)) == ESP_OK)
+            channels = stream_parse_channels(value);
+        if (httpd_query_key_value(query, "rate", value, sizeof(value)) == ESP_OK)
+            rate = strtoul(value, NULL, 10);
     }
-    free(in);
-    httpd_resp_set_type(req, HTTPD_TYPE_JSON);
-    httpd_resp_sendstr(req, out);
-    free(out);
-    return res < 500 ? ESP_OK : ESP_FAIL;
-}
-
-// MISC handlers
-
-static esp_err_t handle_api_v1_ping(httpd_req_t *req) {
-    httpd_resp_set_type(req, HTTPD_TYPE_JSON);
-    httpd_resp_sendstr(req, "{}");
+    if (channels == 0) {
+        httpd_resp_set_status(req, api_res_to_http_status(400));
+        httpd_resp_set_type(req, HTTPD_TYPE_JSON);
+        httpd_resp_sendstr(req, "{}");
+        return ESP_OK;
+    }
+    EventStream *stream = NULL;
+    for (u32 i = 0; i < STREAM_CLIENTS_MAX; i++) {
+        if (eventStreams[i].state == EVENT_STREAM_FREE) {
+            stream = &eventStreams[i];
+            break;
+        }
+    }
+    if (!stream) {
+        httpd_resp_set_status(req, api_res_to_http_status(409));
+        httpd_resp_set_type(req, HTTPD_TYPE_JSON);
+        httpd_resp_sendstr(req, "{}");
+        return ESP_OK;
+    }
+    httpd_resp_set_type(req, "text/event-stream");
+    httpd_resp_set_hdr(req, "Cache-Control", "no-cache");
+    // Sending the first chunk (an SSE comment) sends the headers; the response is never finished, later chunks are written
+    // to the socket directly
+    if (httpd_resp_send_chunk(req, ":\n\n", HTTPD_RESP_USE_STRLEN) != ESP_OK)
+        return ESP_FAIL;
+    stream->fd = httpd_req_to_sockfd(req);
+    stream->channels = channels;
+    stream->rate = rate;
+    stream->state = EVENT_STREAM_STARTING;
     return ESP_OK;
 }
 
 // Fetches the content requested by a GET request from littlefs and responds with the content.
 // Will be called by the HTTP server when a GET request is received.
 static esp_err_t handle_common_get(httpd_req_t *req) {
-    // Allocate a buffer to store the path to the file in the filesystem
-    // Ensure the buffer is large enough to store anything that could be appended to the path
-    size_t pathSize = strlen(req->uri) + sizeof("/www") + sizeof("index.html") + sizeof(".gz");
-    char *path = malloc(pathSize);
-    if (!path) {
-        httpd_resp_send_500(req);
-        return ESP_ERR_NO_MEM;
-    }
-    strcpy(path, "/www"); // Prepend "/www" to the path since web assets are stored in "/www/..." in the filesystem
-    // Append the URI to the path
-    // If the request is for the root path, append "index.html"
-    if (req->uri[strlen(req->uri) - 1] == '/')
-        strlcat(path, "/index.html", pathSize);
-    else
-        strlcat(path, req->uri, pathSize);
-
-    // Check littlefs for the file, both non-gzipped and gzipped variants
-    bool gzipped = false;
-    lfs_file_t file;
-    i32 err;
-    for (u32 i = 0; i < 2; i++) {
-        err = lfs_file_open(&wwwfs, &file, path, LFS_O_RDONLY);
-        if (err == LFS_ERR_NOENT && !gzipped) {
-            // File was not found, try once more with the .gz extension
-            strcat(path, ".gz");
-            gzipped = true;
-            continue;
-        }
-        break;
-    }
-    if (err != LFS_ERR_OK) {
+    // Look the file up in the manifest of the web interface, which also says whether it's stored gzipped
+    const WWWFile *www = www_find(req->uri);
+    if (!www) {
         // Redirect the client to the index page; this provides the captive portal behavior
         httpd_resp_set_status(req, "302 Found");
         httpd_resp_set_hdr(req, "Location", "/");
         // To redirect on ios devices, there must be a response body
         httpd_resp_send(req, "pico-fbw", HTTPD_RESP_USE_STRLEN);
-        free(path);
         return ESP_OK;
     }
-
-    // Set the content type and encoding headers
-    if (gzipped) {
-        // Remove the .gz extension to get the correct content type
-        // Note that this way of removing the extension does destroy the full path, but it's not used at all later
-        path[strlen(path) - 3] = '\0';
+    // Let the client cache the file, and revalidate it with the ETag (unless the file can never change)
+    httpd_resp_set_hdr(req, "ETag", www->etag);
+    httpd_resp_set_hdr(req, "Cache-Control", www_cache_control(www));
+    if (www->gzipped)
         httpd_resp_set_hdr(req, "Content-Encoding", "gzip");
+
+    // The client already has the file cached, so there's no need to send it again
+    char ifNoneMatch[64];
+    if (httpd_req_get_hdr_value_str(req, "If-None-Match", ifNoneMatch, sizeof(ifNoneMatch)) == ESP_OK &&
+        www_not_modified(www, ifNoneMatch)) {
+        httpd_resp_set_status(req, "304 Not Modified");
+        httpd_resp_send(req, NULL, 0);
+        return ESP_OK;
+    }
+
+    char path[WWW_PATH_MAX + sizeof(WWW_ROOT) + sizeof(".gz")];
+    lfs_file_t file;
+    if (!www_fs_path(www, path, sizeof(path)) || lfs_file_open(&wwwfs, &file, path, LFS_O_RDONLY) != LFS_ERR_OK) {
+        httpd_resp_send_500(req);
+        return ESP_FAIL;
     }
-    httpd_resp_set_type(req, get_content_type(path));
+    httpd_resp_set_type(req, www->type);
 
     // Send the file in chunks
     i32 bytesRead = 0;
@@ -208,62 +238,85 @@ static esp_err_t handle_common_get(httpd_req_t *req) {
             httpd_resp_sendstr_chunk(req, NULL);
             httpd_resp_send_500(req);
             lfs_file_close(&wwwfs, &file);
-            free(path);
             return ESP_FAIL;
         }
     } while (bytesRead > 0);
     httpd_resp_send_chunk(req, NULL, 0);
     lfs_file_close(&wwwfs, &file);
-    free(path);
     return ESP_OK;
 }
 
+// Server callback. Will be called from the server's task when a socket is closed.
+static void on_socket_close(httpd_handle_t server, int fd) {
+    for (u32 i = 0; i < STREAM_CLIENTS_MAX; i++) {
+        EventStream *stream = &eventStreams[i];
+        if ((stream->state == EVENT_STREAM_STARTING || stream->state == EVENT_STREAM_ACTIVE) && stream->fd == fd)
+            stream->state = EVENT_STREAM_CLOSED; // The stream is unsubscribed later, from the main loop
+    }
+    close(fd);
+    (void)server;
+}
+
+// Stream write callback, called from the main loop
+static bool event_stream_write(const char *json, u32 len, void *ctx) {
+    EventStream *stream = (EventStream *)ctx;
+    if (stream->state != EVENT_STREAM_ACTIVE)
+        return false;
+    // Each event is its own chunk of the (chunked) response
+    char header[16];
+    i32 headerLen = snprintf(header, sizeof(header), "%lx\r\n", (u32)(len + strlen("data: \n\n")));
+    char *chunk = malloc(headerLen + strlen("data: ") + len + strlen("\n\n\r\n"));
+    if (!chunk)
+        return false;
+    u32 chunkLen = 0;
+    memcpy(chunk + chunkLen, header, headerLen);
+    chunkLen += headerLen;
+    memcpy(chunk + chunkLen, "data: ", strlen("data: "));
+    chunkLen += strlen("data: ");
+    memcpy(chunk + chunkLen, json, len);
+    chunkLen += len;
+    memcpy(chunk + chunkLen, "\n\n\r\n", strlen("\n\n\r\n"));
+    chunkLen += strlen("\n\n\r\n");
+    // Never block the main loop on a slow client; an event that doesn't fit into the socket's buffer is dropped
+    int sent = httpd_socket_send(streamServer, stream->fd, chunk, chunkLen, MSG_DONTWAIT);
+    free(chunk);
+    if (sent > 0 && (u32)sent < chunkLen) {
+        // Only part of the event went out, so the response can't be continued
+        httpd_sess_trigger_close(streamServer, stream->fd);
+        return false;
+    }
+    return sent == (int)chunkLen;
+}
+
 esp_err_t http_server_open(httpd_handle_t *server) {
     httpd_config_t httpdConfig = HTTPD_DEFAULT_CONFIG();
     httpdConfig.uri_match_fn = httpd_uri_match_wildcard;
     httpdConfig.max_open_sockets = 13;
     httpdConfig.lru_purge_enable = true;
+    httpdConfig.close_fn = on_socket_close;
     if (httpd_start(server, &httpdConfig) != ESP_OK)
         return ESP_FAIL;
+    streamServer = *server;
 
-    // API handlers
-    httpd_uri_t apiV1GetConfigURIGet = {
-        .uri = "/api/v1/get/config",
+    // API handlers; the stream must be registered first, as the rest of the API is matched with a wildcard
+    httpd_uri_t apiV1StreamURI = {
+        .uri = API_V1_PATH "stream",
         .method = HTTP_GET,
-        .handler = handle_api_v1_get_config,
-    };
-    httpd_uri_t apiV1GetConfigURIPost = {
-        .uri = "/api/v1/get/config",
-        .method = HTTP_POST,
-        .handler = handle_api_v1_get_config,
+        .handler = handle_api_v1_stream,
     };
-    // get/config supports both GET and POST
-    httpd_register_uri_handler(*server, &apiV1GetConfigURIGet);
-    httpd_register_uri_handler(*server, &apiV1GetConfigURIPost);
-    httpd_uri_t apiV1GetInfoURI = {
-        .uri = "/api/v1/get/info",
+    httpd_register_uri_handler(*server, &apiV1StreamURI);
+    httpd_uri_t apiV1URIGet = {
+        .uri = API_V1_PATH "*",
         .method = HTTP_GET,
-        .handler = handle_api_v1_get_info,
+        .handler = handle_api_v1,
     };
-    httpd_register_uri_handler(*server, &apiV1GetInfoURI);
-    httpd_uri_t apiV1SetConfigURI = {
-        .uri = "/api/v1/set/config",
+    httpd_uri_t apiV1URIPost = {
+        .uri = API_V1_PATH "*",
         .method = HTTP_POST,
-        .handler = handle_api_v1_set_config,
+        .handler = handle_api_v1,
     };
-    httpd_register_uri_handler(*server, &apiV1SetConfigURI);
-    httpd_uri_t apiV1SetFlightplanURI = {
-        .uri = "/api/v1/set/flightplan",
-        .method = HTTP_POST,
-        .handler = handle_api_v1_set_flightplan,
-    };
-    httpd_register_uri_handler(*server, &apiV1SetFlightplanURI);
-    httpd_uri_t apiV1PingURI = {
-        .uri = "/api/v1/ping",
-        .method = HTTP_GET,
-        .handler = handle_api_v1_ping,
-    };
-    httpd_register_uri_handler(*server, &apiV1PingURI);
+    httpd_register_uri_handler(*server, &apiV1URIGet);
+    httpd_register_uri_handler(*server, &apiV1URIPost);
 
     // Common GET handler (for serving files)
     httpd_uri_t commonGETURI = {
@@ -276,7 +329,34 @@ esp_err_t http_server_open(httpd_handle_t *server) {
     return ESP_OK;
 }
 
+void http_server_periodic() {
+    for (u32 i = 0; i < STREAM_CLIENTS_MAX; i++) {
+        EventStream *stream = &eventStreams[i];
+        switch (stream->state) {
+            case EVENT_STREAM_STARTING:
+                stream->client = (StreamClient){.format = STREAM_FORMAT_JSON, .write = event_stream_write, .ctx = stream};
+                stream->state = EVENT_STREAM_ACTIVE;
+                if (!stream_subscribe(&stream->client, stream->channels, stream->rate)) {
+                    // Too many clients are subscribed (e.g. over the serial API), so turn this one away
+                    stream->state = EVENT_STREAM_FREE;
+                    httpd_sess_trigger_close(streamServer, stream->fd);
+                }
+                break;
+            case EVENT_STREAM_CLOSED:
+                stream_unsubscribe(&stream->client);
+                stream->state = EVENT_STREAM_FREE;
+                break;
+            default:
+                break;
+        }
+    }
+}
+
 esp_err_t http_server_close(httpd_handle_t *server) {
+    for (u32 i = 0; i < STREAM_CLIENTS_MAX; i++) {
+        stream_unsubscribe(&eventStreams[i].client);
+        eventStreams[i].state = EVENT_STREAM_FREE;
+    }
     return httpd_stop(*server);
 }
 
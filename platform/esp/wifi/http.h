@@ -19,6 +19,12 @@
  */
 esp_err_t http_server_open(httpd_handle_t *server);
 
+/**
+ * Subscribes and unsubscribes the server's telemetry event streams (GET /api/v1/stream).
+ * @note This must be called periodically from the main loop, as subscriptions can only be changed from there.
+ */
+void http_server_periodic();
+
 /**
  * Stops the HTTP server.
  * @param server pointer to the server handle to close
@@ -75,7 +75,9 @@ bool wifi_setup(const char *ssid, const char *pass) {
 }
 
 void wifi_periodic() {
-    return; // esp wifi handles events in background through tasks
+    // esp wifi handles events in background through tasks, only stream subscriptions (which may only change on the main loop)
+    // are handled here
+    http_server_periodic();
 }
 
 bool wifi_disable() {
@@ -3,9 +3,6 @@
 // Note: for these definitions to take effect, you must add your platform to the #if chain in platform/defs.h.
 // Another note: x is a used as placeholder for an actual value that you should define.
 
-// See time.c for information on what this is and what you should define it as.
-typedef x __callback_id_t;
-
 // Flight control I/O pins
 // These are all required; their numbers depend on your platform and where it allows certain GPIO functions such as PWM.
 #define PIN_INPUT_AIL x
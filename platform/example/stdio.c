@@ -14,9 +14,20 @@ void stdio_setup() {
 char *stdin_read() {
     // This function should read ONE line from all stdin sources and return it as a null-terminated string.
     // Any trailing characters (newline, carriage return, etc.) should be removed.
-    // Memory for this string should be allocated on the heap using malloc(), realloc(), or similar.
-    // It will be free()d by the caller.
-    // If there is no input currently available, this function should return NULL.
+    // It must never block: if there is no complete line available yet, return NULL.
+    // The easiest way to do this is with a LineBuf (see platform/common/linebuf.h): push received characters into it (from an
+    // IRQ handler, or by polling here) with linebuf_put(), and return linebuf_read().
+}
+
+byte *stdin_read_packet(u32 *len) {
+    // This function should work like stdin_read(), but return the next packet delimited by a zero byte instead of a line, and
+    // store its length in `len` (the data may contain any other byte, so nothing should be stripped or translated).
+    // Both functions read from the same input; a LineBuf's linebuf_read_packet() does this for you.
+}
+
+void stdout_write(const byte *data, u32 len) {
+    // This function should write `len` bytes to all initialized stdout sources exactly as given, without translating line
+    // endings, and flush them.
 }
 
 int __printflike(1, 2) wrap_printf(const char *fmt, ...) {
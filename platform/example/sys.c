@@ -3,6 +3,7 @@
  * Licensed under the GNU AGPL-3.0
  */
 
+#include "platform/common/callback.h"
 #include "platform/sys.h"
 
 void sys_boot_begin() {
@@ -23,6 +24,8 @@ void sys_periodic() {
     // Use it to perform any periodic tasks that must occur during normal operation.
     // If your platform has a watchdog timer, it is advisable to update it here.
     // If your platform doesn't need to do anything special periodically, you can leave this function empty.
+    // However, it must always call callback_dispatch() (from platform/common/callback.h) so that callbacks are run.
+    callback_dispatch();
 }
 
 void __attribute__((noreturn)) sys_shutdown() {
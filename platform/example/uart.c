@@ -12,15 +12,15 @@ bool uart_setup(u32 tx, u32 rx, u32 baud) {
     // It should return true if the setup was successful, and false if not.
 }
 
-char *uart_read(u32 tx, u32 rx) {
-    // This function should read ONE line from all the given UART pins and return it as a null-terminated string.
-    // Memory for this string should be allocated on the heap using malloc(), realloc(), or similar.
-    // It will be free()d by the caller.
-    // If there is no input currentlym available, this function should return NULL.
+u32 uart_read(u32 tx, u32 rx, byte *buf, u32 len) {
+    // This function should copy whatever data has been received on the given UART pins into buf (up to len bytes), and return
+    // the number of bytes copied. It must never wait for more data; if there is none, it should return 0.
+    // Data should be buffered from the moment uart_setup() is called (e.g. by an interrupt handler), so that none is lost
+    // between calls. The data may be binary (not only lines of text).
 }
 
-bool uart_write(u32 tx, u32 rx, const char *str) {
-    // This function should write the given string to the specified UART pins.
+bool uart_write(u32 tx, u32 rx, const byte *data, u32 len) {
+    // This function should write the given data (len bytes, which may include zeros) to the specified UART pins.
     // It should return true if the write was successful, and false if not.
     // If your platform has no way to check if the write was successful, just return true.
 }
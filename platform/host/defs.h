@@ -5,36 +5,26 @@
     #if _WIN32_WINNT < _WIN32_WINNT_WIN10
         #error "Windows version not supported, please update to Windows 10 or later."
     #endif
-#elif defined(__APPLE__)
-    #include "time_apple.h"
-#elif defined(__linux__)
-    #include <time.h>
-#else
+#elif !defined(__APPLE__) && !defined(__linux__)
     #warning "Unknown host platform, things may not work as expected."
 #endif
 
-#if defined(_WIN32)
-typedef HANDLE __callback_id_t;
-#elif defined(__APPLE__) || defined(__linux__)
-typedef timer_t __callback_id_t;
-#endif
-
-// Not implemented
-#define PIN_INPUT_AIL 0
-#define PIN_SERVO_AIL 0
-#define PIN_INPUT_ELE 0
-#define PIN_SERVO_ELE 0
-#define PIN_INPUT_RUD 0
-#define PIN_SERVO_RUD 0
-#define PIN_INPUT_THR 0
-#define PIN_ESC_THR 0
-#define PIN_INPUT_SWITCH 0
-#define PIN_SERVO_BAY 0
+// There are no physical pins on a host, but they must be unique so the simulator (see sim/sim.h) can tell them apart
+#define PIN_INPUT_AIL 1
+#define PIN_SERVO_AIL 2
+#define PIN_INPUT_ELE 3
+#define PIN_SERVO_ELE 4
+#define PIN_INPUT_RUD 5
+#define PIN_SERVO_RUD 6
+#define PIN_INPUT_THR 7
+#define PIN_ESC_THR 8
+#define PIN_INPUT_SWITCH 9
+#define PIN_SERVO_BAY 10
 
-#define PIN_AAHRS_SDA 0
-#define PIN_AAHRS_SCL 0
-#define PIN_GPS_TX 0
-#define PIN_GPS_RX 0
+#define PIN_AAHRS_SDA 11
+#define PIN_AAHRS_SCL 12
+#define PIN_GPS_TX 13
+#define PIN_GPS_RX 14
 
 #if defined(_WIN32)
     #define PLATFORM "Windows"
@@ -63,7 +53,12 @@ typedef timer_t __callback_id_t;
 // Platform features
 #define PLATFORM_SUPPORTS_ADC 0
 #define PLATFORM_SUPPORTS_DISPLAY 0
-#define PLATFORM_SUPPORTS_WIFI 0
+// The web server (see wifi.c) is built on epoll, which only Linux has
+#if defined(__linux__)
+    #define PLATFORM_SUPPORTS_WIFI 1
+#else
+    #define PLATFORM_SUPPORTS_WIFI 0
+#endif
 
 // printf format checking
 #if defined(__APPLE__)
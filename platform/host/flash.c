@@ -18,6 +18,9 @@
     #define SEP "/"
 #endif
 
+#include "platform/defs.h"
+#include "platform/types.h"
+
 #include "platform/flash.h"
 
 // FS configuration, littlefs documentation explains these settings in detail (see lib/lfs.h)
@@ -36,6 +39,17 @@
 #define BINNAME "lfs.bin"
 char *filepath; // Will store the full path to the file, set in flash_setup()
 
+#if PLATFORM_SUPPORTS_WIFI
+// The web interface is served out of the littlefs image generated by its build (see www/www.cmake), which is read into
+// memory once; it can be overridden with the PICO_FBW_WWWFS environment variable.
+// These settings must match the LFS_ variables in resources/host.cmake, which the image is generated with.
+    #define WWWFS_READ_SIZE 1
+    #define WWWFS_PROG_SIZE 256
+    #define WWWFS_BLOCK_SIZE 4096
+    #define WWWFS_SIZE 262144 // 256 KB
+static byte *wwwfsImage = NULL; // NULL if there is no image, in which case wwwfs can't be mounted
+#endif
+
 /**
  * Opens the littlefs data file and seeks to the specified offset.
  * @param c the littlefs configuration pertaining to the current operation
@@ -103,13 +117,66 @@ static int flash_sync(const struct lfs_config *c) {
     (void)c;
 }
 
+#if PLATFORM_SUPPORTS_WIFI
+static int wwwfs_read(const struct lfs_config *c, lfs_block_t block, lfs_off_t off, void *buffer, lfs_size_t size) {
+    assert(block < c->block_count);
+    assert(off + size <= c->block_size);
+    if (!wwwfsImage)
+        return LFS_ERR_IO;
+    memcpy(buffer, wwwfsImage + block * c->block_size + off, size);
+    return LFS_ERR_OK;
+}
+
+static int wwwfs_prog(const struct lfs_config *c, lfs_block_t block, lfs_off_t off, const void *buffer, lfs_size_t size) {
+    // The image is only ever read
+    return LFS_ERR_IO;
+    (void)c;
+    (void)block;
+    (void)off;
+    (void)buffer;
+    (void)size;
+}
+
+static int wwwfs_erase(const struct lfs_config *c, lfs_block_t block) {
+    return LFS_ERR_IO;
+    (void)c;
+    (void)block;
+}
+
+/**
+ * Reads the web interface's littlefs image into memory.
+ * @return true if successful
+ */
+static bool wwwfs_load() {
+    const char *path = getenv("PICO_FBW_WWWFS");
+    if (!path)
+        path = WWWFS_IMAGE;
+    FILE *file = fopen(path, "rb");
+    if (!file)
+        return false;
+    wwwfsImage = (byte *)malloc(WWWFS_SIZE);
+    if (!wwwfsImage || fread(wwwfsImage, WWWFS_SIZE, 1, file) != 1) {
+        free(wwwfsImage);
+        wwwfsImage = NULL;
+        fclose(file);
+        return false;
+    }
+    fclose(file);
+    return true;
+}
+#endif
+
 bool flash_setup() {
+#if PLATFORM_SUPPORTS_WIFI
+    wwwfs_load(); // Not fatal, the web interface just won't be available (mounting wwwfs will fail)
+#endif
+
     // Determine the filepath and allocate memory for it
 #if defined(_WIN32)
     const char *appdata = getenv("APPDATA");
     if (!appdata)
         return false;
-    filepath = (char *)malloc(strlen(appdata) + strlen(BINDIR) + strlen(BINNAME) + 2);
+    filepath = (char *)malloc(strlen(appdata) + strlen(BINDIR) + strlen(BINNAME) + 3); // Two separators and a terminator
     if (!filepath)
         return false;
     sprintf(filepath, "%s%s%s", appdata, SEP, BINDIR);
@@ -117,13 +184,13 @@ bool flash_setup() {
     const char *home = getenv("HOME");
     if (!home)
         return false;
-    filepath = (char *)malloc(strlen(home) + strlen(BINDIR) + strlen(BINNAME) + 2);
+    filepath = (char *)malloc(strlen(home) + strlen(BINDIR) + strlen(BINNAME) + 3); // Two separators and a terminator
     if (!filepath)
         return false;
     sprintf(filepath, "%s%s%s", home, SEP, BINDIR);
 #else
     // Unknown platform, create the file in the current directory
-    filepath = (char *)malloc(strlen(BINNAME));
+    filepath = (char *)malloc(strlen(BINNAME) + 1);
     if (!filepath)
         return false;
     strcpy(filepath, BINNAME);
@@ -179,4 +246,21 @@ struct lfs_config lfs_cfg = {
     .block_cycles = BLOCK_CYCLES,
 };
 
+#if PLATFORM_SUPPORTS_WIFI
+lfs_t wwwfs;
+struct lfs_config wwwfs_cfg = {
+    .read = wwwfs_read,
+    .prog = wwwfs_prog,
+    .erase = wwwfs_erase,
+    .sync = flash_sync,
+    .read_size = WWWFS_READ_SIZE,
+    .prog_size = WWWFS_PROG_SIZE,
+    .block_size = WWWFS_BLOCK_SIZE,
+    .block_count = (WWWFS_SIZE / WWWFS_BLOCK_SIZE),
+    .cache_size = WWWFS_PROG_SIZE,
+    .lookahead_size = LOOKAHEAD_SIZE,
+    .block_cycles = BLOCK_CYCLES,
+};
+#endif
+
 // clang-format on
@@ -0,0 +1,496 @@
+/**
+ * Source file of pico-fbw: https://github.com/pico-fbw/pico-fbw
+ * Licensed under the GNU AGPL-3.0
+ */
+
+#include "http.h"
+
+#if PLATFORM_SUPPORTS_WIFI
+
+// clang-format off
+
+#include <errno.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "lib/jsonwriter.h"
+
+#include "platform/common/http.h"
+#include "platform/common/www.h"
+#include "platform/flash.h"
+#include "platform/helpers.h"
+#include "platform/time.h"
+
+#include "sys/api/api.h"
+#include "sys/api/cmds/cmds.h"
+#include "sys/api/stream.h"
+
+#define CLIENTS_MAX 64                 // Connections kept open at once, any more are refused
+#define EVENTS_MAX 64                  // Events handled per epoll_wait()
+#define POLL_ROUNDS_MAX 8              // epoll_wait()s per poll, so a busy server can't hold up the main loop for long
+#define RECV_SIZE 4096                 // Data received from a client that can wait to be parsed, bytes
+#define OUT_HIGH_WATER (256 * 1024)    // Unsent output above which a client's requests wait (pipelined requests pile up)
+#define STREAM_PENDING_MAX (16 * 1024) // Unsent output above which a stream's updates are dropped
+#define IDLE_TIMEOUT_MS 10000          // Time a kept-alive connection may sit idle for before it's closed
+#define JSON_BUFFER_SIZE 1024
+
+#define TYPE_JSON "application/json"
+#define TYPE_EVENT_STREAM "text/event-stream"
+
+#define API_V1_PATH "/api/v1/"
+
+// clang-format on
+
+// The server runs entirely on the main loop (from wifi_periodic()): sockets are non-blocking and watched with epoll, which is
+// polled without waiting, so API commands run exactly as they would from any other transport. Responses are assembled in
+// each connection's output buffer and sent as the socket accepts them; a connection whose client isn't reading stops
+// having its requests handled (and its socket read) until the output drains.
+
+typedef struct Buffer {
+    char *data;
+    u32 len, size;
+} Buffer;
+
+typedef struct Client {
+    int fd; // -1 if the client is free
+    HTTPParser parser;
+    char in[RECV_SIZE]; // Received but not yet parsed (e.g. pipelined requests)
+    u32 inLen;
+    Buffer out;
+    u32 outSent;    // Bytes of `out` already sent
+    u32 events;     // The events currently watched for (EPOLLIN, EPOLLOUT)
+    bool keepAlive; // Whether the connection stays open after the current response
+    bool closing;   // Whether the connection is closed once its output has been sent
+    bool failed;    // Whether the socket failed while writing a stream update (it's closed on the next poll)
+    u64 lastActive; // ms
+    StreamClient *stream; // Set if the connection is a telemetry event stream
+} Client;
+
+static int listenFd = -1, epollFd = -1;
+static Client clients[CLIENTS_MAX];
+static StreamClient streams[STREAM_CLIENTS_MAX];
+static bool streamUsed[STREAM_CLIENTS_MAX];
+static Buffer jsonBody; // Output of the API command being run, reused by every request
+
+/* --- Buffers --- */
+
+/**
+ * Makes room in a buffer.
+ * @param buf the buffer
+ * @param len the number of bytes that need to fit after what's already in it
+ * @return true if successful
+ */
+static bool buffer_reserve(Buffer *buf, u32 len) {
+    if (buf->len + len <= buf->size)
+        return true;
+    u32 size = buf->size > 0 ? buf->size : 1024;
+    while (size < buf->len + len)
+        size *= 2;
+    char *data = realloc(buf->data, size);
+    if (!data)
+        return false;
+    buf->data = data;
+    buf->size = size;
+    return true;
+}
+
+static bool buffer_append(Buffer *buf, const void *data, u32 len) {
+    if (!buffer_reserve(buf, len))
+        return false;
+    memcpy(buf->data + buf->len, data, len);
+    buf->len += len;
+    return true;
+}
+
+static void buffer_free(Buffer *buf) {
+    free(buf->data);
+    *buf = (Buffer){0};
+}
+
+/* --- Connections --- */
+
+static u32 client_pending(const Client *client) {
+    return client->out.len - client->outSent;
+}
+
+// Updates the events watched for on a client's socket, depending on whether it can take more input or has output waiting
+static void client_watch(Client *client) {
+    u32 events = 0;
+    if (client->inLen < sizeof(client->in) && !client->closing)
+        events |= EPOLLIN;
+    if (client_pending(client) > 0)
+        events |= EPOLLOUT;
+    if (events == client->events)
+        return;
+    struct epoll_event event = {.events = events, .data.ptr = client};
+    epoll_ctl(epollFd, EPOLL_CTL_MOD, client->fd, &event);
+    client->events = events;
+}
+
+static void client_close(Client *client) {
+    if (client->stream) {
+        stream_unsubscribe(client->stream);
+        streamUsed[client->stream - streams] = false;
+    }
+    epoll_ctl(epollFd, EPOLL_CTL_DEL, client->fd, NULL);
+    close(client->fd);
+    http_parser_reset(&client->parser);
+    buffer_free(&client->out);
+    *client = (Client){.fd = -1};
+}
+
+/**
+ * Sends as much of a client's output as its socket accepts.
+ * @param client the client
+ * @return false if the socket failed
+ */
+static bool client_flush(Client *client) {
+    while (client_pending(client) > 0) {
+        ssize_t sent =
+            send(client->fd, client->out.data + client->outSent, client_pending(client), MSG_NOSIGNAL | MSG_DONTWAIT);
+        if (sent < 0) {
+            if (errno == EAGAIN || errno == EWOULDBLOCK)
+                break; // Continue once the socket is writable
+            if (errno == EINTR)
+                continue;
+            return false;
+        }
+        client->outSent += sent;
+    }
+    if (client_pending(client) == 0)
+        client->out.len = client->outSent = 0;
+    return true;
+}
+
+/* --- Responses --- */
+
+/**
+ * Queues the headers of a response.
+ * @param client the client
+ * @param status the HTTP status (e.g. "200 OK")
+ * @param type the content type of the body, or NULL if there is none
+ * @param len the length of the body, HTTP_STREAM, or HTTP_NO_BODY
+ * @param extra any other headers, each ending with "\r\n", or NULL
+ * @return true if successful
+ */
+static bool send_head(Client *client, const char *status, const char *type, i32 len, const char *extra) {
+    if (!buffer_reserve(&client->out, HTTP_RESPONSE_HEAD_MAX))
+        return false;
+    u32 headLen = http_format_head(client->out.data + client->out.len, HTTP_RESPONSE_HEAD_MAX, status, type, len,
+                                   client->keepAlive, extra);
+    client->out.len += headLen;
+    return headLen > 0;
+}
+
+/**
+ * Queues a complete response.
+ * @param client the client
+ * @param status the HTTP status (e.g. "200 OK")
+ * @param type the content type of the body, or NULL if there is no body
+ * @param body the body of the response, or NULL if there is none
+ * @param extra any other headers, each ending with "\r\n", or NULL
+ */
+static void send_response(Client *client, const char *status, const char *type, const char *body, const char *extra) {
+    u32 bodyLen = body ? strlen(body) : 0;
+    if (!send_head(client, status, type, (i32)bodyLen, extra) || !buffer_append(&client->out, body, bodyLen))
+        client->closing = true;
+}
+
+// Writer sink, called whenever the writer's buffer fills up
+static void append_json(const char *data, u32 len, void *ctx) {
+    buffer_append((Buffer *)ctx, data, len);
+}
+
+// Runs the API command served on the requested route (see sys/api/cmds/cmds.h)
+static void handle_api_v1(Client *client, const HTTPRequest *req, u8 method) {
+    char buf[JSON_BUFFER_SIZE];
+    JSONWriter json;
+    jsonBody.len = 0;
+    jsonw_init_sink(&json, buf, sizeof(buf), append_json, &jsonBody);
+    i32 res = api_exec_http(req->target + strlen(API_V1_PATH), method, req->body, &json);
+    jsonw_finish(&json);
+    if (jsonBody.len == 0)
+        buffer_append(&jsonBody, "{}", strlen("{}"));
+    if (res >= 500)
+        client->keepAlive = false;
+    if (!send_head(client, api_res_to_http_status(res), TYPE_JSON, (i32)jsonBody.len, NULL) ||
+        !buffer_append(&client->out, jsonBody.data, jsonBody.len))
+        client->closing = true;
+}
+
+// Stream write callback, called from the main loop
+static bool event_stream_write(const char *json, u32 len, void *ctx) {
+    Client *client = (Client *)ctx;
+    // Events that the client isn't keeping up with are dropped rather than queued, so a slow client can't use up memory
+    if (client->failed || client_pending(client) > STREAM_PENDING_MAX)
+        return false;
+    if (!buffer_append(&client->out, "data: ", strlen("data: ")) || !buffer_append(&client->out, json, len) ||
+        !buffer_append(&client->out, "\n\n", strlen("\n\n")))
+        return false;
+    // The stream task may be iterating over its clients, so a failed socket is only closed on the next poll
+    if (!client_flush(client))
+        client->failed = true;
+    else
+        client_watch(client);
+    return true;
+}
+
+// Opens a telemetry event stream, e.g. GET /api/v1/stream?channels=aahrs,gps&rate=10.
+// The connection is left open and receives one "data:" event per update, until the client closes it.
+static void handle_api_v1_stream(Client *client, const char *uri) {
+    char value[64];
+    u8 channels = http_get_query(uri, "channels", value, sizeof(value)) ? stream_parse_channels(value) : 0;
+    u32 rate = http_get_query(uri, "rate", value, sizeof(value)) ? strtoul(value, NULL, 10) : 0;
+    if (channels == 0) {
+        send_response(client, api_res_to_http_status(400), TYPE_JSON, "{}", NULL);
+        return;
+    }
+    StreamClient *stream = NULL;
+    for (u32 i = 0; i < count_of(streams); i++) {
+        if (!streamUsed[i]) {
+            stream = &streams[i];
+            streamUsed[i] = true;
+            break;
+        }
+    }
+    if (!stream) {
+        send_response(client, api_res_to_http_status(409), TYPE_JSON, "{}", NULL);
+        return;
+    }
+    *stream = (StreamClient){.format = STREAM_FORMAT_JSON, .write = event_stream_write, .ctx = client};
+    if (!stream_subscribe(stream, channels, rate)) {
+        // Too many clients are subscribed (e.g. over the serial API), so turn this one away
+        streamUsed[stream - streams] = false;
+        send_response(client, api_res_to_http_status(409), TYPE_JSON, "{}", NULL);
+        return;
+    }
+    client->stream = stream;
+    client->keepAlive = false; // The stream lasts until the connection closes
+    if (!send_head(client, "200 OK", TYPE_EVENT_STREAM, HTTP_STREAM, "Cache-Control: no-cache\r\n"))
+        client->closing = true;
+}
+
+// Responds with a file of the web interface, see platform/common/www.h
+static bool handle_common_get(Client *client, const HTTPRequest *req) {
+    const WWWFile *file = www_find(req->target);
+    if (!file)
+        return false;
+    char extra[128];
+    snprintf(extra, sizeof(extra), "ETag: %s\r\nCache-Control: %s\r\n%s", file->etag, www_cache_control(file),
+             file->gzipped ? "Content-Encoding: gzip\r\n" : "");
+
+    // The client already has the file cached, so there's no need to send it again
+    if (www_not_modified(file, http_get_header(req, "If-None-Match"))) {
+        if (!send_head(client, "304 Not Modified", NULL, HTTP_NO_BODY, extra))
+            client->closing = true;
+        return true;
+    }
+
+    char path[WWW_PATH_MAX + sizeof(WWW_ROOT) + sizeof(".gz")];
+    lfs_file_t lfsFile;
+    if (!www_fs_path(file, path, sizeof(path)) || lfs_file_open(&wwwfs, &lfsFile, path, LFS_O_RDONLY) != LFS_ERR_OK)
+        return false;
+    // The whole file is read straight into the output, so its length is known up front (a HEAD request only gets the head)
+    bool ok = send_head(client, "200 OK", file->type, (i32)file->size, extra) && buffer_reserve(&client->out, file->size);
+    if (ok && req->method != HTTP_METHOD_HEAD) {
+        lfs_ssize_t read = lfs_file_read(&wwwfs, &lfsFile, client->out.data + client->out.len, file->size);
+        ok = read == (lfs_ssize_t)file->size;
+        if (ok)
+            client->out.len += file->size;
+    }
+    lfs_file_close(&wwwfs, &lfsFile);
+    if (!ok)
+        client->closing = true; // The response is incomplete, so the connection can't be used for anything else
+    return true;
+}
+
+/**
+ * Responds to a request.
+ * @param client the client
+ * @param req the request
+ */
+static void handle_request(Client *client, const HTTPRequest *req) {
+    bool res = true;
+    client->keepAlive = req->keepAlive;
+    bool api = strncmp(req->target, API_V1_PATH, strlen(API_V1_PATH)) == 0;
+    if (req->method == HTTP_METHOD_HEAD && !api) {
+        res = handle_common_get(client, req);
+    } else if (req->method == HTTP_METHOD_GET) {
+        if (api) {
+            const char *route = req->target + strlen(API_V1_PATH);
+            if (strcmp(route, "stream") == 0 || strncmp(route, "stream?", strlen("stream?")) == 0)
+                handle_api_v1_stream(client, req->target);
+            else
+                handle_api_v1(client, req, API_HTTP_GET);
+        } else {
+            res = handle_common_get(client, req);
+        }
+    } else if (req->method == HTTP_METHOD_POST && api) {
+        handle_api_v1(client, req, API_HTTP_POST);
+    } else {
+        res = false;
+    }
+    // Redirect the client to the index page, like the other platforms' captive portals
+    if (!res)
+        send_response(client, "302 Found", NULL, NULL, "Location: /\r\n");
+}
+
+/**
+ * Parses and responds to the requests a client has sent, in order, for as long as its output isn't backed up.
+ * @param client the client
+ */
+static void client_process(Client *client) {
+    while (!client->closing && !client->stream && client_pending(client) < OUT_HIGH_WATER) {
+        HTTPParser *parser = &client->parser;
+        u32 used = http_parse(parser, client->in, client->inLen);
+        memmove(client->in, client->in + used, client->inLen - used);
+        client->inLen -= used;
+        if (parser->state == HTTP_PARSE_ERROR) {
+            client->keepAlive = false;
+            send_response(client, api_res_to_http_status(parser->error), NULL, NULL, NULL);
+            client->closing = true;
+            break;
+        }
+        if (parser->state != HTTP_PARSE_DONE)
+            break; // Wait for the rest of the request
+        handle_request(client, &parser->request);
+        http_parser_reset(parser);
+        if (!client->keepAlive && !client->stream)
+            client->closing = true;
+    }
+}
+
+/**
+ * Handles an event on a client's socket.
+ * @param client the client
+ * @param events the epoll events that occurred
+ * @return false if the client should be closed
+ */
+static bool client_event(Client *client, u32 events) {
+    if (events & (EPOLLERR | EPOLLHUP))
+        return false;
+    client->lastActive = time_ms();
+    if (events & EPOLLIN) {
+        ssize_t received = recv(client->fd, client->in + client->inLen, sizeof(client->in) - client->inLen, 0);
+        if (received == 0)
+            return false; // The client closed the connection
+        if (received < 0)
+            return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR;
+        client->inLen += received;
+        if (client->stream)
+            client->inLen = 0; // Nothing is expected from a stream's client, so whatever it sends is ignored
+    }
+    if (!client_flush(client))
+        return false;
+    // Handle requests until the output backs up, and send as much of it as possible right away
+    client_process(client);
+    if (!client_flush(client))
+        return false;
+    if (client->closing && client_pending(client) == 0)
+        return false;
+    client_watch(client);
+    return true;
+}
+
+static void accept_clients() {
+    for (;;) {
+        int fd = accept(listenFd, NULL, NULL);
+        if (fd < 0)
+            return; // No more pending connections (or an error that leaves none to accept)
+        fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+        Client *client = NULL;
+        for (u32 i = 0; i < count_of(clients); i++) {
+            if (clients[i].fd < 0) {
+                client = &clients[i];
+                break;
+            }
+        }
+        if (!client) {
+            close(fd); // Too many connections
+            continue;
+        }
+        int one = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one)); // Responses are written whole, so don't delay them
+        *client = (Client){.fd = fd, .events = EPOLLIN, .lastActive = time_ms()};
+        http_parser_init(&client->parser);
+        struct epoll_event event = {.events = EPOLLIN, .data.ptr = client};
+        if (epoll_ctl(epollFd, EPOLL_CTL_ADD, fd, &event) != 0) {
+            close(fd);
+            client->fd = -1;
+        }
+    }
+}
+
+bool http_server_open(u16 port) {
+    if (listenFd >= 0)
+        return true;
+    for (u32 i = 0; i < count_of(clients); i++)
+        clients[i].fd = -1;
+    listenFd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (listenFd < 0)
+        return false;
+    int one = 1;
+    setsockopt(listenFd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    struct sockaddr_in addr = {.sin_family = AF_INET, .sin_port = htons(port), .sin_addr.s_addr = htonl(INADDR_ANY)};
+    epollFd = epoll_create1(EPOLL_CLOEXEC);
+    struct epoll_event event = {.events = EPOLLIN, .data.ptr = NULL}; // The listening socket is the only one without a client
+    if (bind(listenFd, (struct sockaddr *)&addr, sizeof(addr)) != 0 || listen(listenFd, CLIENTS_MAX) != 0 || epollFd < 0 ||
+        epoll_ctl(epollFd, EPOLL_CTL_ADD, listenFd, &event) != 0) {
+        printf("[http] failed to listen on port %u: %s\n", port, strerror(errno));
+        http_server_close();
+        return false;
+    }
+    return true;
+}
+
+void http_server_poll() {
+    if (epollFd < 0)
+        return;
+    struct epoll_event events[EVENTS_MAX];
+    for (u32 round = 0; round < POLL_ROUNDS_MAX; round++) {
+        int numEvents = epoll_wait(epollFd, events, EVENTS_MAX, 0);
+        if (numEvents <= 0)
+            break;
+        for (int i = 0; i < numEvents; i++) {
+            Client *client = (Client *)events[i].data.ptr;
+            if (!client)
+                accept_clients();
+            else if (client->fd >= 0 && !client_event(client, events[i].events))
+                client_close(client);
+        }
+    }
+    // Close connections whose stream failed, and kept-alive connections that have gone idle
+    u64 now = time_ms();
+    for (u32 i = 0; i < count_of(clients); i++) {
+        Client *client = &clients[i];
+        if (client->fd < 0)
+            continue;
+        bool idle = !client->stream && client_pending(client) == 0 && now - client->lastActive > IDLE_TIMEOUT_MS;
+        if (client->failed || idle)
+            client_close(client);
+    }
+}
+
+void http_server_close() {
+    if (epollFd < 0 && listenFd < 0)
+        return; // Never opened
+    for (u32 i = 0; i < count_of(clients); i++) {
+        if (clients[i].fd >= 0)
+            client_close(&clients[i]);
+    }
+    if (epollFd >= 0)
+        close(epollFd);
+    if (listenFd >= 0)
+        close(listenFd);
+    epollFd = listenFd = -1;
+    buffer_free(&jsonBody);
+}
+
+#endif // PLATFORM_SUPPORTS_WIFI
@@ -0,0 +1,34 @@
+#pragma once
+
+#include "platform/defs.h"
+
+#if PLATFORM_SUPPORTS_WIFI
+
+// clang-format off
+
+#include <stdbool.h>
+#include "platform/types.h"
+
+#define HTTP_PORT_DEFAULT 8080 // Port the web server listens on, unless overridden with PICO_FBW_HTTP_PORT
+
+// clang-format on
+
+/**
+ * Opens the web server, listening on all of the host's interfaces.
+ * @param port the port to listen on
+ * @return true if the server was opened successfully
+ */
+bool http_server_open(u16 port);
+
+/**
+ * Accepts connections, and responds to any requests that have been received.
+ * @note This never blocks, and must be called periodically from the main loop (requests run API commands).
+ */
+void http_server_poll();
+
+/**
+ * Closes the web server and all of its connections.
+ */
+void http_server_close();
+
+#endif // PLATFORM_SUPPORTS_WIFI
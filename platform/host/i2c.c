@@ -5,8 +5,21 @@
 
 #include <string.h>
 
+#include "sim/sim.h"
+#include "sys_shared.h"
+
 #include "platform/i2c.h"
 
+static u32 transactions = 0; // Number of I2C transactions (reads and writes) issued
+static u32 bytes = 0;        // Number of data bytes transferred, not counting addresses and register numbers
+
+void i2c_get_stats(u32 *numTransactions, u32 *numBytes) {
+    if (numTransactions)
+        *numTransactions = transactions;
+    if (numBytes)
+        *numBytes = bytes;
+}
+
 bool i2c_setup(u32 sda, u32 scl, u32 freq) {
     return true; // Not implemented
     (void)sda;
@@ -15,24 +28,24 @@ bool i2c_setup(u32 sda, u32 scl, u32 freq) {
 }
 
 bool i2c_read(u32 sda, u32 scl, byte addr, byte reg, byte dest[], size_t len) {
+    transactions++;
+    bytes += len;
+    if (sim_enabled())
+        return sim_i2c_read(addr, reg, dest, len);
     // Not implemented
     for (u32 i = 0; i < len; i++)
         dest[i] = 0x00;
     return true;
     (void)sda;
     (void)scl;
-    (void)addr;
-    (void)reg;
-    (void)dest;
-    (void)len;
 }
 
 bool i2c_write(u32 sda, u32 scl, byte addr, byte reg, const byte src[], size_t len) {
+    transactions++;
+    bytes += len;
+    if (sim_enabled())
+        return sim_i2c_write(addr, reg, src, len);
     return true; // Not implemented
     (void)sda;
     (void)scl;
-    (void)addr;
-    (void)reg;
-    (void)src;
-    (void)len;
 }
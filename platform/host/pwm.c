@@ -3,6 +3,8 @@
  * Licensed under the GNU AGPL-3.0
  */
 
+#include "sim/sim.h"
+
 #include "platform/pwm.h"
 
 bool pwm_setup_read(const u32 pins[], u32 num_pins) {
@@ -19,12 +21,12 @@ bool pwm_setup_write(const u32 pins[], u32 num_pins, u32 freq) {
 }
 
 f32 pwm_read_raw(u32 pin) {
+    if (sim_enabled())
+        return sim_pwm_read(pin);
     return 0.f; // Not implemented
-    (void)pin;
 }
 
 void pwm_write_raw(u32 pin, f32 pulsewidth) {
-    return; // Not implemented
-    (void)pin;
-    (void)pulsewidth;
+    if (sim_enabled())
+        sim_pwm_write(pin, pulsewidth);
 }
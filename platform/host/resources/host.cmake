@@ -1,14 +1,20 @@
 # See platform/example/resources/example.cmake for comments regarding the structure of this file
 add_definitions(-DFBW_PLATFORM_HOST)
+# Define littlefs filesystem parameters that will be used by mklittlefs to generate the filesystem (must match flash.c)
+set(LFS_BLOCK_SIZE 4096)
+set(LFS_PROG_SIZE 256)
+set(LFS_IMG_SIZE 262144) # 256KB
 
 function(setup_before_subdirs)
     add_executable(${PROJECT_NAME} ${CMAKE_SOURCE_DIR}/src/main.c)
-    set(FBW_BUILD_WWW OFF CACHE BOOL "Build the web interface" FORCE)
+    # Building the web interface requires yarn, so on host it's only built when asked for (-DFBW_BUILD_WWW=ON)
+    set(FBW_BUILD_WWW OFF CACHE BOOL "Build the web interface")
 endfunction()
 
 function(setup_after_subdirs)
     # Link math library on Linux for trig functions
     if (${CMAKE_SYSTEM_NAME} STREQUAL "Linux")
         target_link_libraries(fbw_lib m)
+        target_link_libraries(platform_host m)
     endif()
 endfunction()
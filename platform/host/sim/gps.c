@@ -0,0 +1,254 @@
+/**
+ * Source file of pico-fbw: https://github.com/pico-fbw/pico-fbw
+ * Licensed under the GNU AGPL-3.0
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "sim.h"
+
+// Emulation of a GPS module that speaks both PMTK and u-blox UBX, as far as gps_init() and gps_update() need.
+// It starts out sending GGA, GSA, and VTG sentences; once the NMEA messages are turned off and NAV-PVT/NAV-DOP are turned on
+// (with UBX CFG-MSG), it sends those instead, at the interval set with CFG-RATE.
+// Output goes into a byte queue, which is read like a UART's receive ring.
+
+#define FIX_INTERVAL_US 200000 // 5Hz, until changed by CFG-RATE
+#define QUEUE_SIZE 4096
+#define MAX_SENTENCE_LEN 96
+
+#define MS_TO_KTS 1.943844
+#define MS_TO_KMH 3.6
+#define RAD_TO_DEG (180.0 / 3.14159265358979323846)
+
+// UBX messages that are understood, see lib/ubx.h
+#define UBX_SYNC1 0xB5
+#define UBX_SYNC2 0x62
+#define UBX_CLASS_NAV 0x01
+#define UBX_CLASS_ACK 0x05
+#define UBX_CLASS_CFG 0x06
+#define UBX_CLASS_NMEA 0xF0
+#define UBX_NAV_DOP 0x04
+#define UBX_NAV_PVT 0x07
+#define UBX_ACK_ACK 0x01
+#define UBX_CFG_MSG 0x01
+#define UBX_CFG_RATE 0x08
+#define UBX_NAV_PVT_LEN 92
+#define UBX_NAV_DOP_LEN 18
+
+static byte queue[QUEUE_SIZE];
+static u32 head = 0, tail = 0; // Bytes are written at head and read from tail
+static u64 lastFix = 0;
+static u64 fixInterval = FIX_INTERVAL_US;
+static bool nmeaEnabled = true, pvtEnabled = false, dopEnabled = false;
+
+/**
+ * Queues data for reading.
+ * @param data the data
+ * @param len the length of the data
+ */
+static void queue_bytes(const byte *data, u32 len) {
+    for (u32 i = 0; i < len; i++) {
+        if (head - tail >= QUEUE_SIZE)
+            tail++; // Drop the oldest byte, like a UART FIFO overrun would
+        queue[head % QUEUE_SIZE] = data[i];
+        head++;
+    }
+}
+
+/**
+ * Appends the checksum to an NMEA sentence body (everything after the $) and queues it for reading.
+ * @param body the sentence body
+ */
+static void queue_sentence(const char *body) {
+    byte checksum = 0;
+    for (const char *c = body; *c; c++)
+        checksum ^= (byte)*c;
+    char sentence[MAX_SENTENCE_LEN + 8];
+    int len = snprintf(sentence, sizeof(sentence), "$%s*%02X\r\n", body, checksum);
+    queue_bytes((const byte *)sentence, (u32)len);
+}
+
+/**
+ * Frames a UBX message and queues it for reading.
+ * @param cls the message's class
+ * @param id the message's ID
+ * @param payload the message's payload
+ * @param len the length of the payload
+ */
+static void queue_ubx(byte cls, byte id, const byte *payload, u16 len) {
+    byte header[6] = {UBX_SYNC1, UBX_SYNC2, cls, id, (byte)(len & 0xFF), (byte)(len >> 8)};
+    byte ckA = 0, ckB = 0;
+    for (u32 i = 2; i < sizeof(header); i++) {
+        ckA += header[i];
+        ckB += ckA;
+    }
+    for (u32 i = 0; i < len; i++) {
+        ckA += payload[i];
+        ckB += ckA;
+    }
+    const byte checksum[2] = {ckA, ckB};
+    queue_bytes(header, sizeof(header));
+    queue_bytes(payload, len);
+    queue_bytes(checksum, sizeof(checksum));
+}
+
+static void put_u16(byte *p, u16 v) {
+    p[0] = (byte)(v & 0xFF);
+    p[1] = (byte)(v >> 8);
+}
+
+static void put_i32(byte *p, i32 v) {
+    u32 u = (u32)v;
+    for (u32 i = 0; i < 4; i++)
+        p[i] = (byte)(u >> (i * 8));
+}
+
+/**
+ * Formats a coordinate in NMEA's (d)ddmm.mmmm format.
+ * @param buf the buffer to write to
+ * @param size the size of the buffer
+ * @param coord the coordinate [deg]
+ * @param degDigits number of digits to use for the degrees (2 for latitude, 3 for longitude)
+ */
+static void format_coord(char *buf, size_t size, f64 coord, u32 degDigits) {
+    coord = fabs(coord);
+    u32 deg = (u32)coord;
+    f64 min = (coord - deg) * 60.0;
+    snprintf(buf, size, "%0*u%07.4f", (int)degDigits, deg, min);
+}
+
+static void queue_nmea_fix(u64 now_us) {
+    const SimState *s = sim_state();
+    char body[MAX_SENTENCE_LEN];
+    char lat[16], lng[16];
+    format_coord(lat, sizeof(lat), s->lat, 2);
+    format_coord(lng, sizeof(lng), s->lng, 3);
+    u32 secs = (u32)(now_us / 1000000);
+    u32 centis = (u32)((now_us / 10000) % 100);
+
+    snprintf(body, sizeof(body), "GPGGA,%02u%02u%02u.%02u,%s,%c,%s,%c,1,10,0.8,%.1f,M,0.0,M,,", (secs / 3600) % 24,
+             (secs / 60) % 60, secs % 60, centis, lat, s->lat >= 0 ? 'N' : 'S', lng, s->lng >= 0 ? 'E' : 'W', s->alt);
+    queue_sentence(body);
+    queue_sentence("GPGSA,A,3,02,05,07,09,13,15,18,20,27,30,,,1.4,0.8,1.1");
+
+    f64 groundSpeed = sqrt(s->velNED[0] * s->velNED[0] + s->velNED[1] * s->velNED[1]);
+    f64 track = atan2(s->velNED[1], s->velNED[0]) * RAD_TO_DEG;
+    if (track < 0)
+        track += 360.0;
+    snprintf(body, sizeof(body), "GPVTG,%.1f,T,,M,%.2f,N,%.2f,K,A", track, groundSpeed * MS_TO_KTS, groundSpeed * MS_TO_KMH);
+    queue_sentence(body);
+}
+
+static void queue_ubx_fix(u64 now_us) {
+    const SimState *s = sim_state();
+    u32 iTOW = (u32)((now_us / 1000) % (7 * 24 * 3600 * 1000ULL)); // Time of week
+    f64 groundSpeed = sqrt(s->velNED[0] * s->velNED[0] + s->velNED[1] * s->velNED[1]);
+    f64 track = atan2(s->velNED[1], s->velNED[0]) * RAD_TO_DEG;
+    if (track < 0)
+        track += 360.0;
+    if (pvtEnabled) {
+        byte pvt[UBX_NAV_PVT_LEN] = {0};
+        put_i32(&pvt[0], (i32)iTOW);
+        pvt[11] = 0x07; // Date, time, and time of day all valid
+        pvt[20] = 3;    // 3D fix
+        pvt[21] = 0x01; // gnssFixOK
+        pvt[23] = 10;   // Satellites
+        put_i32(&pvt[24], (i32)lround(s->lng * 1e7));
+        put_i32(&pvt[28], (i32)lround(s->lat * 1e7));
+        put_i32(&pvt[32], (i32)lround(s->alt * 1e3)); // Height above the ellipsoid, no geoid separation is simulated
+        put_i32(&pvt[36], (i32)lround(s->alt * 1e3));
+        put_i32(&pvt[40], 1500); // hAcc
+        put_i32(&pvt[44], 2500); // vAcc
+        for (u32 i = 0; i < 3; i++)
+            put_i32(&pvt[48 + i * 4], (i32)lround(s->velNED[i] * 1e3));
+        put_i32(&pvt[60], (i32)lround(groundSpeed * 1e3));
+        put_i32(&pvt[64], (i32)lround(track * 1e5));
+        put_i32(&pvt[68], 300);     // sAcc
+        put_i32(&pvt[72], 1000000); // headAcc
+        put_u16(&pvt[76], 140);     // pDOP
+        queue_ubx(UBX_CLASS_NAV, UBX_NAV_PVT, pvt, sizeof(pvt));
+    }
+    if (dopEnabled) {
+        byte dop[UBX_NAV_DOP_LEN] = {0};
+        put_i32(&dop[0], (i32)iTOW);
+        put_u16(&dop[4], 160);  // gDOP
+        put_u16(&dop[6], 140);  // pDOP
+        put_u16(&dop[8], 90);   // tDOP
+        put_u16(&dop[10], 110); // vDOP
+        put_u16(&dop[12], 80);  // hDOP
+        put_u16(&dop[14], 60);  // nDOP
+        put_u16(&dop[16], 50);  // eDOP
+        queue_ubx(UBX_CLASS_NAV, UBX_NAV_DOP, dop, sizeof(dop));
+    }
+}
+
+/**
+ * Handles a UBX message sent to the GPS.
+ * @param cls the message's class
+ * @param id the message's ID
+ * @param payload the message's payload
+ * @param len the length of the payload
+ */
+static void handle_ubx(byte cls, byte id, const byte *payload, u16 len) {
+    if (cls != UBX_CLASS_CFG)
+        return;
+    if (id == UBX_CFG_MSG && len >= 3) {
+        bool enabled = payload[2] != 0;
+        if (payload[0] == UBX_CLASS_NMEA)
+            nmeaEnabled = enabled; // Close enough, turning any of them off means NMEA is no longer wanted
+        else if (payload[0] == UBX_CLASS_NAV && payload[1] == UBX_NAV_PVT)
+            pvtEnabled = enabled;
+        else if (payload[0] == UBX_CLASS_NAV && payload[1] == UBX_NAV_DOP)
+            dopEnabled = enabled;
+    } else if (id == UBX_CFG_RATE && len >= 6) {
+        u16 measRate = (u16)(payload[0] | (payload[1] << 8));
+        if (measRate > 0)
+            fixInterval = (u64)measRate * 1000;
+    } else {
+        return;
+    }
+    const byte ack[2] = {cls, id};
+    queue_ubx(UBX_CLASS_ACK, UBX_ACK_ACK, ack, sizeof(ack));
+}
+
+void sim_gps_step(u64 now_us) {
+    if (now_us - lastFix < fixInterval)
+        return;
+    lastFix = now_us;
+    if (nmeaEnabled)
+        queue_nmea_fix(now_us);
+    queue_ubx_fix(now_us);
+}
+
+u32 sim_uart_read(byte *buf, u32 len) {
+    u32 n = 0;
+    while (n < len && tail != head) {
+        buf[n++] = queue[tail % QUEUE_SIZE];
+        tail++;
+    }
+    return n;
+}
+
+bool sim_uart_write(const byte *data, u32 len) {
+    // Acknowledge PMTK commands and UBX configuration messages, which is all that is needed for gps_init()
+    // Each write is assumed to hold whole commands, as gps_init() sends them
+    for (u32 i = 0; i < len; i++) {
+        if (data[i] == '$' && len - i > 5 && memcmp(&data[i + 1], "PMTK", 4) == 0) {
+            u32 cmd = 0;
+            for (u32 j = i + 5; j < len && data[j] >= '0' && data[j] <= '9'; j++)
+                cmd = cmd * 10 + (data[j] - '0');
+            char body[MAX_SENTENCE_LEN];
+            snprintf(body, sizeof(body), "PMTK001,%u,3", cmd);
+            queue_sentence(body);
+        } else if (data[i] == UBX_SYNC1 && len - i >= 8 && data[i + 1] == UBX_SYNC2) {
+            u16 payloadLen = (u16)(data[i + 4] | (data[i + 5] << 8));
+            if (len - i < 8u + payloadLen)
+                break;
+            handle_ubx(data[i + 2], data[i + 3], &data[i + 6], payloadLen);
+            i += 7 + payloadLen;
+        }
+    }
+    return true;
+}
@@ -0,0 +1,285 @@
+/**
+ * Source file of pico-fbw: https://github.com/pico-fbw/pico-fbw
+ * Licensed under the GNU AGPL-3.0
+ */
+
+#include <math.h>
+#include <string.h>
+
+#include "sim.h"
+
+// Register-level emulation of an ICM20948 and the AK09916 magnetometer inside of it.
+// The IMU is mounted with its X axis pointing out of the right wing, Y axis out of the nose, and Z axis up, which is the
+// orientation the fusion code expects.
+
+#define ICM_ADDR 0x68
+#define ICM_DEVID 0xEA
+#define AK_ADDR 0x0C
+#define AK_DEVID 0x09
+
+#define REG_BANK_SEL 0x7F
+#define REG0_WHO_AM_I 0x00
+#define REG0_USER_CTRL 0x03
+#define REG0_PWR_MGMT_1 0x06
+#define REG0_INT_PIN_CFG 0x0F
+#define REG0_ACCEL_XOUT_H 0x2D
+#define REG0_TEMP_OUT_L 0x3A
+#define REG0_EXT_SLV_SENS_DATA_00 0x3B
+#define REG0_EXT_SLV_SENS_DATA_23 0x52
+#define REG0_FIFO_EN_2 0x67
+#define REG0_FIFO_RST 0x68
+#define REG0_FIFO_COUNTH 0x70
+#define REG0_FIFO_COUNTL 0x71
+#define REG0_FIFO_R_W 0x72
+#define REG2_GYRO_SMPLRT_DIV 0x00
+#define REG2_GYRO_CONFIG_1 0x01
+#define REG2_ACCEL_CONFIG 0x14
+#define REG3_I2C_SLV0_ADDR 0x03
+#define REG3_I2C_SLV0_REG 0x04
+#define REG3_I2C_SLV0_CTRL 0x05
+
+#define AK_WIA2 0x01
+#define AK_ST1 0x10
+#define AK_HXL 0x11
+#define AK_ST2 0x18
+#define AK_CNTL3 0x32
+
+#define MAG_LSB 0.15 // uT
+
+#define FIFO_SIZE 512
+#define GYRO_BASE_ODR 1100.0 // Hz
+
+#define RAD_TO_DEG (180.0 / 3.14159265358979323846)
+
+static byte banks[4][128];
+static byte magRegs[0x40];
+static bool initialized = false;
+
+// The FIFO behaves like the real one in snapshot mode: samples that do not fit are dropped
+static byte fifo[FIFO_SIZE];
+static u32 fifoCount = 0, fifoHead = 0; // Bytes are read from fifoHead
+static u64 lastSample = 0;
+
+static void reset() {
+    memset(banks, 0, sizeof(banks));
+    banks[0][REG0_WHO_AM_I] = ICM_DEVID;
+    banks[0][REG0_PWR_MGMT_1] = 0x41; // SLEEP=1, CLKSEL=1
+    banks[2][REG2_GYRO_CONFIG_1] = 0x01;
+    banks[2][REG2_ACCEL_CONFIG] = 0x01;
+    memset(magRegs, 0, sizeof(magRegs));
+    magRegs[AK_WIA2] = AK_DEVID;
+    magRegs[0x00] = 0x48; // WIA1 (company ID)
+    fifoCount = 0;
+    fifoHead = 0;
+    initialized = true;
+}
+
+static inline u8 current_bank() {
+    return (banks[0][REG_BANK_SEL] >> 4) & 0x03;
+}
+
+static inline void put_be16(byte *dest, f64 value, f64 fullScale) {
+    f64 raw = fmin(fmax(value / fullScale * 32767.0, -32768.0), 32767.0);
+    i16 v = (i16)lround(raw);
+    dest[0] = (byte)((u16)v >> 8);
+    dest[1] = (byte)((u16)v & 0xFF);
+}
+
+static inline void put_le16(byte *dest, f64 value) {
+    i16 v = (i16)lround(fmin(fmax(value, -32768.0), 32767.0));
+    dest[0] = (byte)((u16)v & 0xFF);
+    dest[1] = (byte)((u16)v >> 8);
+}
+
+/**
+ * Converts a body-frame (forward, right, down) vector into the IMU's frame.
+ */
+static inline void body_to_imu(const f64 body[3], f64 imu[3]) {
+    imu[0] = body[1];
+    imu[1] = body[0];
+    imu[2] = -body[2];
+}
+
+/**
+ * Refreshes the accelerometer, gyroscope, and temperature output registers from the simulator's state.
+ */
+static void refresh_accgyro() {
+    const SimState *s = sim_state();
+    static const f64 accelScales[] = {2, 4, 8, 16};
+    static const f64 gyroScales[] = {250, 500, 1000, 2000};
+    f64 accelFS = accelScales[(banks[2][REG2_ACCEL_CONFIG] >> 1) & 0x03];
+    f64 gyroFS = gyroScales[(banks[2][REG2_GYRO_CONFIG_1] >> 1) & 0x03];
+
+    f64 accel[3], gyro[3], body[3];
+    for (u32 i = 0; i < 3; i++)
+        body[i] = s->accel[i] / SIM_GRAVITY;
+    body_to_imu(body, accel);
+    for (u32 i = 0; i < 3; i++)
+        body[i] = s->rates[i] * RAD_TO_DEG;
+    body_to_imu(body, gyro);
+
+    byte *out = &banks[0][REG0_ACCEL_XOUT_H];
+    for (u32 i = 0; i < 3; i++)
+        put_be16(&out[i * 2], accel[i], accelFS);
+    for (u32 i = 0; i < 3; i++)
+        put_be16(&out[6 + i * 2], gyro[i], gyroFS);
+    // TEMP_OUT: 25degC reads as 0
+    out[12] = 0;
+    out[13] = 0;
+}
+
+/**
+ * Refreshes the magnetometer's output registers from the simulator's state.
+ */
+static void refresh_mag() {
+    f64 mag[3];
+    body_to_imu(sim_state()->mag, mag);
+    for (u32 i = 0; i < 3; i++)
+        put_le16(&magRegs[AK_HXL + i * 2], mag[i] / MAG_LSB);
+    magRegs[AK_ST1] = 0x01; // DRDY
+    magRegs[AK_ST2] = 0x00;
+}
+
+/**
+ * Emulates the ICM20948's I2C master reading the AK09916 through slave 0 into the EXT_SLV_SENS_DATA registers.
+ * The real master does this at the sample rate; doing it on demand is indistinguishable from the host's point of view.
+ */
+static void refresh_ext_sens() {
+    if (!(banks[0][REG0_USER_CTRL] & 0x20)) // I2C_MST_EN
+        return;
+    byte slvAddr = banks[3][REG3_I2C_SLV0_ADDR];
+    byte slvCtrl = banks[3][REG3_I2C_SLV0_CTRL];
+    if (!(slvCtrl & 0x80) || !(slvAddr & 0x80) || (slvAddr & 0x7F) != AK_ADDR) // I2C_SLV0_EN, I2C_SLV0_RNW
+        return;
+    refresh_mag();
+    byte *ext = &banks[0][REG0_EXT_SLV_SENS_DATA_00];
+    for (u32 i = 0; i < (slvCtrl & 0x0F); i++)
+        ext[i] = magRegs[(banks[3][REG3_I2C_SLV0_REG] + i) % sizeof(magRegs)];
+}
+
+/**
+ * Pushes a whole frame into the FIFO, or drops it if it does not fit.
+ */
+static void fifo_push(const byte *src, u32 len) {
+    if (fifoCount + len > FIFO_SIZE)
+        return;
+    for (u32 i = 0; i < len; i++)
+        fifo[(fifoHead + fifoCount + i) % FIFO_SIZE] = src[i];
+    fifoCount += len;
+}
+
+static byte fifo_pop() {
+    if (fifoCount == 0)
+        return 0xFF; // The real FIFO reads 0xFF when empty
+    byte b = fifo[fifoHead];
+    fifoHead = (fifoHead + 1) % FIFO_SIZE;
+    fifoCount--;
+    return b;
+}
+
+void sim_imu_step(u64 now_us) {
+    if (!initialized)
+        reset();
+    // The sample rate follows the gyro's ODR
+    u64 period = (u64)(1E6 / (GYRO_BASE_ODR / (1 + banks[2][REG2_GYRO_SMPLRT_DIV])));
+    if (now_us - lastSample < period)
+        return;
+    u32 due = (u32)((now_us - lastSample) / period);
+    lastSample += (u64)due * period;
+    byte fifoEn = banks[0][REG0_FIFO_EN_2];
+    if (!(banks[0][REG0_USER_CTRL] & 0x40) || !(fifoEn & 0x1E)) // FIFO_EN; ACCEL_FIFO_EN or any GYRO_x_FIFO_EN
+        return;
+    if (due > FIFO_SIZE)
+        due = FIFO_SIZE; // Nothing more would fit anyway
+    // The simulation only advances in physics steps, so samples that fall within the same step are identical
+    refresh_accgyro();
+    const byte *out = &banks[0][REG0_ACCEL_XOUT_H];
+    byte frame[12];
+    u32 len = 0;
+    if (fifoEn & 0x10) {
+        memcpy(&frame[len], out, 6);
+        len += 6;
+    }
+    for (u32 i = 0; i < 3; i++) {
+        if (fifoEn & (0x02 << i)) {
+            memcpy(&frame[len], &out[6 + i * 2], 2);
+            len += 2;
+        }
+    }
+    for (u32 n = 0; n < due; n++)
+        fifo_push(frame, len);
+}
+
+bool sim_i2c_read(byte addr, byte reg, byte dest[], size_t len) {
+    if (!initialized)
+        reset();
+    switch (addr) {
+        case ICM_ADDR: {
+            u8 bank = current_bank();
+            if (bank == 0 && reg <= REG0_TEMP_OUT_L && reg + len > REG0_ACCEL_XOUT_H)
+                refresh_accgyro();
+            if (bank == 0 && reg <= REG0_EXT_SLV_SENS_DATA_23 && reg + len > REG0_EXT_SLV_SENS_DATA_00)
+                refresh_ext_sens();
+            if (bank == 0 && reg == REG0_FIFO_R_W) {
+                // FIFO_R_W does not auto-increment, every byte read pops from the FIFO
+                for (size_t i = 0; i < len; i++)
+                    dest[i] = fifo_pop();
+                return true;
+            }
+            banks[0][REG0_FIFO_COUNTH] = (byte)(fifoCount >> 8);
+            banks[0][REG0_FIFO_COUNTL] = (byte)(fifoCount & 0xFF);
+            for (size_t i = 0; i < len; i++) {
+                byte r = (byte)((reg + i) & 0x7F);
+                dest[i] = r == REG_BANK_SEL ? banks[0][REG_BANK_SEL] : banks[bank][r];
+            }
+            return true;
+        }
+        case AK_ADDR:
+            if (!(banks[0][REG0_INT_PIN_CFG] & 0x02))
+                return false; // Not in bypass mode, the AK09916 is only reachable through the ICM20948's I2C master
+            if (reg <= AK_ST2 && reg + len > AK_ST1)
+                refresh_mag();
+            for (size_t i = 0; i < len; i++)
+                dest[i] = magRegs[(reg + i) % sizeof(magRegs)];
+            return true;
+        default:
+            return false; // Nothing at this address, NACK
+    }
+}
+
+bool sim_i2c_write(byte addr, byte reg, const byte src[], size_t len) {
+    if (!initialized)
+        reset();
+    switch (addr) {
+        case ICM_ADDR:
+            for (size_t i = 0; i < len; i++) {
+                byte r = (byte)((reg + i) & 0x7F);
+                if (r == REG_BANK_SEL) {
+                    banks[0][REG_BANK_SEL] = src[i];
+                } else if (current_bank() == 0 && r == REG0_PWR_MGMT_1 && (src[i] & 0x80)) {
+                    reset(); // DEVICE_RESET
+                } else if (current_bank() == 0 && r == REG0_FIFO_RST && (src[i] & 0x1F)) {
+                    fifoCount = 0;
+                    fifoHead = 0;
+                } else
+                    banks[current_bank()][r] = src[i];
+            }
+            return true;
+        case AK_ADDR:
+            if (!(banks[0][REG0_INT_PIN_CFG] & 0x02))
+                return false;
+            for (size_t i = 0; i < len; i++) {
+                byte r = (byte)((reg + i) % sizeof(magRegs));
+                if (r == AK_CNTL3 && (src[i] & 0x01)) {
+                    // SRST
+                    memset(magRegs, 0, sizeof(magRegs));
+                    magRegs[0x00] = 0x48;
+                    magRegs[AK_WIA2] = AK_DEVID;
+                } else
+                    magRegs[r] = src[i];
+            }
+            return true;
+        default:
+            return false;
+    }
+}
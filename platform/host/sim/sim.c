@@ -0,0 +1,340 @@
+/**
+ * Source file of pico-fbw: https://github.com/pico-fbw/pico-fbw
+ * Licensed under the GNU AGPL-3.0
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "platform/defs.h"
+
+#include "sim.h"
+
+#ifndef M_PI
+    #define M_PI 3.14159265358979323846
+#endif
+
+#define DEG_TO_RAD (M_PI / 180.0)
+#define RAD_TO_DEG (180.0 / M_PI)
+#define EARTH_RADIUS 6378137.0 // m
+
+#define STEP_US 1000              // Physics integration step
+#define MAX_CATCHUP_US 100000     // Longest stretch of time that will be simulated in one call to sim_step()
+#define LOG_INTERVAL_US 100000    // Interval between CSV trace entries
+#define INITIAL_HEIGHT 100.0      // Height above home the aircraft starts at [m]
+#define INITIAL_SPEED 15.0        // Airspeed the aircraft starts at [m/s]
+#define SERVO_LINKAGE_RATIO 0.5   // Control surface deflection per degree of servo travel
+#define DEFAULT_HOME 47.397742, 8.545594, 488.0
+
+// Airframe: a generic ~1.2kg, 1.2m span foam trainer
+#define MASS 1.2          // kg
+#define WING_AREA 0.26    // m^2
+#define WING_SPAN 1.2     // m
+#define CHORD 0.22        // m
+#define IXX 0.04          // kg*m^2
+#define IYY 0.06          // kg*m^2
+#define IZZ 0.09          // kg*m^2
+#define MAX_THRUST 12.0   // Static thrust at full throttle [N]
+#define PROP_MAX_SPEED 30 // Airspeed at which the propeller stops producing thrust [m/s]
+#define AIR_DENSITY 1.225 // kg/m^3
+#define OSWALD 0.8
+#define STALL_ALPHA 0.26 // rad
+#define STALL_BLEND 50.0
+
+// Aerodynamic coefficients (per radian where applicable)
+#define CL0 0.28
+#define CL_ALPHA 3.45
+#define CL_Q 7.0
+#define CL_DE -0.36 // Trailing edge up (nose-up) elevator loses some tail lift
+#define CD0 0.03
+#define CY_BETA -0.3
+#define CY_DR -0.1
+#define CM0 0.0
+#define CM_ALPHA -0.5
+#define CM_Q -8.0
+#define CM_DE 0.9
+#define CLL_BETA -0.08
+#define CLL_P -0.5
+#define CLL_R 0.1
+#define CLL_DA 0.2
+#define CN_BETA 0.08
+#define CN_P -0.03
+#define CN_R -0.1
+#define CN_DA -0.01
+#define CN_DR 0.06
+
+// Earth's magnetic field (roughly central Europe), NED frame [uT]
+static const f64 magNED[3] = {21.0, 1.5, 43.0};
+
+static bool enabled = false;
+static SimState state;
+static f64 home[3];           // lat [deg], lng [deg], alt [m]
+static f64 wind[3] = {0};     // Steady wind the air mass moves with, NED frame [m/s]
+static f32 switchPulse = 1500; // Pulsewidth of the simulated mode switch
+static u64 switchTime = 0;     // Simulated time the mode switch is moved to switchPulse at (it's centered until then) [us]
+static f32 throttlePulse = 1500;
+static u64 lastStep = 0;
+static u64 lastLog = 0;
+static FILE *logFile = NULL;
+
+/**
+ * Computes the rotation matrix from the body frame to the NED frame.
+ * @param att Euler angles (roll, pitch, yaw) [rad]
+ * @param R output matrix
+ */
+static void body_to_ned(const f64 att[3], f64 R[3][3]) {
+    f64 cr = cos(att[0]), sr = sin(att[0]);
+    f64 cp = cos(att[1]), sp = sin(att[1]);
+    f64 cy = cos(att[2]), sy = sin(att[2]);
+    R[0][0] = cp * cy;
+    R[0][1] = sr * sp * cy - cr * sy;
+    R[0][2] = cr * sp * cy + sr * sy;
+    R[1][0] = cp * sy;
+    R[1][1] = sr * sp * sy + cr * cy;
+    R[1][2] = cr * sp * sy - sr * cy;
+    R[2][0] = -sp;
+    R[2][1] = sr * cp;
+    R[2][2] = cr * cp;
+}
+
+/**
+ * Recomputes all quantities in the state that are derived from the kinematic state.
+ * @param force specific force acting on the aircraft, body frame [m/s^2]
+ */
+static void update_derived(const f64 force[3]) {
+    f64 R[3][3];
+    body_to_ned(state.att, R);
+    for (u32 i = 0; i < 3; i++) {
+        // The body velocity is relative to the air, which itself moves with the wind
+        state.velNED[i] = R[i][0] * state.vel[0] + R[i][1] * state.vel[1] + R[i][2] * state.vel[2] + wind[i];
+        // Transpose of R rotates NED into body
+        state.mag[i] = R[0][i] * magNED[0] + R[1][i] * magNED[1] + R[2][i] * magNED[2];
+        state.accel[i] = force[i];
+    }
+    state.lat = home[0] + (state.pos[0] / EARTH_RADIUS) * RAD_TO_DEG;
+    state.lng = home[1] + (state.pos[1] / (EARTH_RADIUS * cos(home[0] * DEG_TO_RAD))) * RAD_TO_DEG;
+    state.alt = home[2] - state.pos[2];
+}
+
+/**
+ * Integrates the aircraft's equations of motion over one step.
+ * @param dt the length of the step [s]
+ */
+static void integrate(f64 dt) {
+    f64 u = state.vel[0], v = state.vel[1], w = state.vel[2];
+    f64 p = state.rates[0], q = state.rates[1], r = state.rates[2];
+    f64 roll = state.att[0], pitch = state.att[1];
+
+    // Aerodynamic angles and dynamic pressure
+    f64 Va = sqrt(u * u + v * v + w * w);
+    f64 alpha = 0, beta = 0;
+    f64 F[3] = {0, 0, 0}, M[3] = {0, 0, 0};
+    if (Va > 1.0) {
+        alpha = atan2(w, u);
+        beta = asin(v / Va);
+        f64 qS = 0.5 * AIR_DENSITY * Va * Va * WING_AREA;
+        // Lift blends from linear to flat-plate past the stall
+        f64 blendLo = exp(-STALL_BLEND * (alpha - STALL_ALPHA)), blendHi = exp(STALL_BLEND * (alpha + STALL_ALPHA));
+        f64 sigma = (1 + blendLo + blendHi) / ((1 + blendLo) * (1 + blendHi));
+        f64 linearCL = CL0 + CL_ALPHA * alpha;
+        f64 CL = (1 - sigma) * linearCL + sigma * 2.0 * copysign(1.0, alpha) * sin(alpha) * sin(alpha) * cos(alpha);
+        CL += CL_Q * (CHORD / (2 * Va)) * q + CL_DE * state.elevator;
+        f64 CD = CD0 + (linearCL * linearCL) / (M_PI * OSWALD * (WING_SPAN * WING_SPAN / WING_AREA));
+        f64 CY = CY_BETA * beta + CY_DR * state.rudder;
+        F[0] = qS * (-CD * cos(alpha) + CL * sin(alpha));
+        F[1] = qS * CY;
+        F[2] = qS * (-CD * sin(alpha) - CL * cos(alpha));
+
+        f64 bOver2V = WING_SPAN / (2 * Va), cOver2V = CHORD / (2 * Va);
+        M[0] = qS * WING_SPAN * (CLL_BETA * beta + CLL_P * bOver2V * p + CLL_R * bOver2V * r + CLL_DA * state.aileron);
+        M[1] = qS * CHORD * (CM0 + CM_ALPHA * alpha + CM_Q * cOver2V * q + CM_DE * state.elevator);
+        M[2] = qS * WING_SPAN *
+               (CN_BETA * beta + CN_P * bOver2V * p + CN_R * bOver2V * r + CN_DA * state.aileron + CN_DR * state.rudder);
+    }
+    // Propeller thrust decreases with airspeed
+    f64 thrust = MAX_THRUST * state.throttle * (1.0 - Va / PROP_MAX_SPEED);
+    if (thrust > 0)
+        F[0] += thrust;
+
+    f64 force[3] = {F[0] / MASS, F[1] / MASS, F[2] / MASS};
+    f64 gravity[3] = {-SIM_GRAVITY * sin(pitch), SIM_GRAVITY * cos(pitch) * sin(roll), SIM_GRAVITY * cos(pitch) * cos(roll)};
+
+    // Translational dynamics (body frame)
+    state.vel[0] += (r * v - q * w + force[0] + gravity[0]) * dt;
+    state.vel[1] += (p * w - r * u + force[1] + gravity[1]) * dt;
+    state.vel[2] += (q * u - p * v + force[2] + gravity[2]) * dt;
+    // Rotational dynamics (products of inertia are neglected)
+    state.rates[0] += (((IYY - IZZ) * q * r + M[0]) / IXX) * dt;
+    state.rates[1] += (((IZZ - IXX) * p * r + M[1]) / IYY) * dt;
+    state.rates[2] += (((IXX - IYY) * p * q + M[2]) / IZZ) * dt;
+    // Attitude kinematics (using the updated rates)
+    p = state.rates[0];
+    q = state.rates[1];
+    r = state.rates[2];
+    f64 cosPitch = cos(pitch);
+    if (fabs(cosPitch) < 1E-3)
+        cosPitch = copysign(1E-3, cosPitch);
+    state.att[0] += (p + (q * sin(roll) + r * cos(roll)) * tan(pitch)) * dt;
+    state.att[1] += (q * cos(roll) - r * sin(roll)) * dt;
+    state.att[2] += ((q * sin(roll) + r * cos(roll)) / cosPitch) * dt;
+    state.att[0] = remainder(state.att[0], 2 * M_PI);
+    state.att[2] = remainder(state.att[2], 2 * M_PI);
+    if (state.att[2] < 0)
+        state.att[2] += 2 * M_PI;
+
+    update_derived(force);
+    for (u32 i = 0; i < 3; i++)
+        state.pos[i] += state.velNED[i] * dt;
+    state.airspeed = Va;
+
+    // Ground contact ends the flight
+    if (state.pos[2] > 0) {
+        state.pos[2] = 0;
+        state.crashed = true;
+        printf("[sim] aircraft hit the ground at t=%.2fs (descent rate %.1fm/s)\n", state.time / 1E6, state.velNED[2]);
+    }
+}
+
+static void write_log() {
+    if (!logFile)
+        return;
+    fprintf(logFile, "%.3f,%.7f,%.7f,%.2f,%.2f,%.2f,%.2f,%.2f,%.3f,%.3f,%.3f,%.2f\n", state.time / 1E6, state.lat, state.lng,
+            state.alt, state.att[0] * RAD_TO_DEG, state.att[1] * RAD_TO_DEG, state.att[2] * RAD_TO_DEG, state.airspeed,
+            state.aileron * RAD_TO_DEG, state.elevator * RAD_TO_DEG, state.rudder * RAD_TO_DEG, state.throttle);
+}
+
+bool sim_enabled() {
+    return enabled;
+}
+
+void sim_init() {
+    const char *env = getenv("PICO_FBW_SIM");
+    enabled = env && strcmp(env, "0") != 0;
+    if (!enabled)
+        return;
+
+    home[0] = (f64[]){DEFAULT_HOME}[0];
+    home[1] = (f64[]){DEFAULT_HOME}[1];
+    home[2] = (f64[]){DEFAULT_HOME}[2];
+    env = getenv("PICO_FBW_SIM_HOME");
+    if (env && sscanf(env, "%lf,%lf,%lf", &home[0], &home[1], &home[2]) != 3)
+        printf("[sim] ignoring invalid PICO_FBW_SIM_HOME \"%s\"\n", env);
+    env = getenv("PICO_FBW_SIM_SWITCH");
+    if (env) {
+        char position[8] = "";
+        f64 delay = 0;
+        if (sscanf(env, "%7[^,],%lf", position, &delay) >= 1 && delay >= 0) {
+            if (strcasecmp(position, "low") == 0)
+                switchPulse = 1000;
+            else if (strcasecmp(position, "high") == 0)
+                switchPulse = 2000;
+            switchTime = (u64)(delay * 1E6);
+        } else
+            printf("[sim] ignoring invalid PICO_FBW_SIM_SWITCH \"%s\"\n", env);
+    }
+    env = getenv("PICO_FBW_SIM_WIND");
+    if (env) {
+        f64 speed, from;
+        if (sscanf(env, "%lf,%lf", &speed, &from) == 2) {
+            // Wind is given as the direction it blows from, so it moves the air the opposite way
+            wind[0] = -speed * cos(from * DEG_TO_RAD);
+            wind[1] = -speed * sin(from * DEG_TO_RAD);
+        } else
+            printf("[sim] ignoring invalid PICO_FBW_SIM_WIND \"%s\"\n", env);
+    }
+    env = getenv("PICO_FBW_SIM_LOG");
+    if (env) {
+        logFile = fopen(env, "w");
+        if (logFile) {
+            setvbuf(logFile, NULL, _IOLBF, 0); // The process is usually killed rather than exited, so don't lose the trace
+            fprintf(logFile, "t,lat,lng,alt,roll,pitch,yaw,airspeed,aileron,elevator,rudder,throttle\n");
+        }
+    }
+
+    memset(&state, 0, sizeof(state));
+    state.pos[2] = -INITIAL_HEIGHT;
+    // Start in trimmed-ish level flight, heading north
+    state.vel[0] = INITIAL_SPEED;
+    state.throttle = 0.3;
+    f64 force[3] = {0, 0, -SIM_GRAVITY};
+    update_derived(force);
+    state.airspeed = INITIAL_SPEED;
+    printf("[sim] simulator enabled, home is %.6f, %.6f (%.0fm)\n", home[0], home[1], home[2]);
+}
+
+void sim_start() {
+    if (!enabled)
+        return;
+    state.running = true;
+}
+
+void sim_step(u64 now_us) {
+    if (!enabled)
+        return;
+    // The GPS keeps outputting sentences even while the aircraft is held, so it can be initialized during boot
+    sim_gps_step(now_us);
+    if (!state.running || state.crashed) {
+        lastStep = now_us;
+        sim_imu_step(now_us);
+        return;
+    }
+    if (now_us - lastStep > MAX_CATCHUP_US)
+        lastStep = now_us - MAX_CATCHUP_US;
+    while (now_us - lastStep >= STEP_US && !state.crashed) {
+        integrate(STEP_US / 1E6);
+        lastStep += STEP_US;
+        state.time += STEP_US;
+        sim_imu_step(lastStep);
+        if (state.time - lastLog >= LOG_INTERVAL_US) {
+            write_log();
+            lastLog = state.time;
+        }
+    }
+}
+
+const SimState *sim_state() {
+    return &state;
+}
+
+void sim_pwm_write(u32 pin, f32 pulsewidth) {
+    // Real servos hold their last position when given a garbage pulse
+    if (!isfinite(pulsewidth))
+        return;
+    pulsewidth = fminf(fmaxf(pulsewidth, 500.f), 2500.f);
+    // Servos are 500-2500us for 0-180deg, 1500us being centered (see servo.c)
+    f64 servoDeg = (pulsewidth - 1500.0) * (180.0 / 2000.0);
+    f64 deflection = servoDeg * SERVO_LINKAGE_RATIO * DEG_TO_RAD;
+    switch (pin) {
+        case PIN_SERVO_AIL:
+            state.aileron = deflection;
+            break;
+        case PIN_SERVO_ELE:
+            state.elevator = deflection;
+            break;
+        case PIN_SERVO_RUD:
+            state.rudder = deflection;
+            break;
+        case PIN_ESC_THR:
+            // ESCs are 1000-2000us for 0-100% (see esc.c)
+            state.throttle = fmin(fmax((pulsewidth - 1000.0) / 1000.0, 0.0), 1.0);
+            break;
+        default:
+            break;
+    }
+}
+
+f32 sim_pwm_read(u32 pin) {
+    switch (pin) {
+        case PIN_INPUT_AIL:
+        case PIN_INPUT_ELE:
+        case PIN_INPUT_RUD:
+            return 1500; // Sticks centered
+        case PIN_INPUT_THR:
+            return throttlePulse;
+        case PIN_INPUT_SWITCH:
+            return state.time >= switchTime ? switchPulse : 1500;
+        default:
+            return -1;
+    }
+}
@@ -0,0 +1,110 @@
+#pragma once
+
+// Software-in-the-loop (SITL) flight simulator for the host platform.
+// When enabled (by setting the environment variable PICO_FBW_SIM=1), the host HAL's I/O functions are backed by a simulated
+// fixed-wing aircraft instead of doing nothing:
+// - pwm_write_raw() drives the aircraft's control surfaces and motor
+// - pwm_read_raw() returns the pulsewidths of a simulated receiver (sticks centered, mode switch from PICO_FBW_SIM_SWITCH)
+// - i2c_read()/i2c_write() talk to an emulated ICM20948 (including its FIFO and I2C master) and AK09916 magnetometer
+// - uart_read()/uart_write() talk to an emulated GPS that outputs NMEA GGA/GSA/VTG sentences, or UBX NAV-PVT/NAV-DOP messages
+//   once configured to (it acknowledges both PMTK and UBX configuration commands)
+// Other environment variables:
+// - PICO_FBW_SIM_HOME="lat,lng,alt" sets the starting position (alt is MSL in meters, the aircraft starts 100m above it)
+// - PICO_FBW_SIM_SWITCH="position[,time]" sets the mode switch to low, mid, or high (the default is mid); with a time (in
+//   seconds of simulated time), the switch is only moved there at that time, as a pilot would once the aircraft is flying
+// - PICO_FBW_SIM_WIND="speed,direction" adds a steady wind (speed in m/s, blowing from direction in degrees)
+// - PICO_FBW_SIM_LOG=<path> writes a CSV trace of the aircraft's state to <path> every 100ms of simulated time
+// Combine with PICO_FBW_VIRTUAL_TIME=1 (see time.c) to fly faster than real time and get reproducible results.
+
+#include <stdbool.h>
+#include "platform/types.h"
+
+#define SIM_GRAVITY 9.80665 // m/s^2
+
+typedef struct SimState {
+    // Kinematic state
+    f64 pos[3];   // Position relative to home, NED frame [m]
+    f64 vel[3];   // Velocity relative to the air, body frame (forward, right, down) [m/s]
+    f64 att[3];   // Euler angles (roll, pitch, yaw) [rad]
+    f64 rates[3]; // Angular rates, body frame (p, q, r) [rad/s]
+    // Derived quantities
+    f64 velNED[3];   // Velocity over the ground, NED frame [m/s]
+    f64 accel[3];    // Specific force (what an accelerometer would read), body frame [m/s^2]
+    f64 mag[3];      // Earth's magnetic field, body frame [uT]
+    f64 lat, lng;    // Geodetic position [deg]
+    f64 alt;         // Altitude above mean sea level [m]
+    f64 airspeed;    // True airspeed [m/s]
+    // Actuators
+    f64 aileron, elevator, rudder; // Surface deflections (positive rolls right, pitches up, yaws right) [rad]
+    f64 throttle;                  // Motor throttle [0-1]
+    // Simulation status
+    u64 time;     // Simulated time since the simulation started [us]
+    bool running; // Whether the simulation is being stepped (it is held until the system has finished booting)
+    bool crashed; // Whether the aircraft has hit the ground
+} SimState;
+
+/**
+ * @return true if the simulator is enabled
+ */
+bool sim_enabled();
+
+/**
+ * Initializes the simulator if it has been enabled through the environment.
+ * @note This must be called before any other HAL function.
+ */
+void sim_init();
+
+/**
+ * Starts stepping the simulation; until this is called, the aircraft is held in its initial state.
+ */
+void sim_start();
+
+/**
+ * Advances the simulation to the given system time.
+ * @param now_us the current system time, in microseconds
+ */
+void sim_step(u64 now_us);
+
+/**
+ * @return the current state of the simulated aircraft
+ */
+const SimState *sim_state();
+
+/* --- Receiver and actuators (sim.c) --- */
+
+/**
+ * Sets the output of a PWM pin (servo or ESC).
+ * @param pin the pin
+ * @param pulsewidth the pulsewidth in us
+ */
+void sim_pwm_write(u32 pin, f32 pulsewidth);
+
+/**
+ * @param pin the pin
+ * @return the pulsewidth in us that the simulated receiver outputs on `pin`, or -1 if it is not a receiver pin
+ */
+f32 sim_pwm_read(u32 pin);
+
+/* --- IMU (imu.c) --- */
+
+/**
+ * Writes samples into the IMU's FIFO for any sample periods that have elapsed.
+ * @param now_us the current system time, in microseconds
+ */
+void sim_imu_step(u64 now_us);
+
+bool sim_i2c_read(byte addr, byte reg, byte dest[], size_t len);
+
+bool sim_i2c_write(byte addr, byte reg, const byte src[], size_t len);
+
+/* --- GPS (gps.c) --- */
+
+/**
+ * Generates NMEA sentences or UBX messages for any GPS fixes that are due.
+ * @param now_us the current simulated time, in microseconds
+ */
+void sim_gps_step(u64 now_us);
+
+u32 sim_uart_read(byte *buf, u32 len);
+
+bool sim_uart_write(const byte *data, u32 len);
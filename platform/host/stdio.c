@@ -9,13 +9,56 @@
 #include <string.h>
 #if defined(_WIN32)
     #include <windows.h>
-    #include "stdio_windows.h"
+#elif defined(__APPLE__) || defined(__linux__)
+    #include <pthread.h>
+    #include <unistd.h>
 #endif
 
+#include "platform/common/linebuf.h"
+
 #include "platform/stdio.h"
 
-void stdio_setup() {
+// Reading from stdin blocks, so it is done on a background thread that feeds characters into a line buffer; stdin_read()
+// then only ever has to check that buffer
+
+static LineBuf stdinBuf;
+
+static void wait_for_space() {
+#if defined(_WIN32)
+    Sleep(1);
+#elif defined(__APPLE__) || defined(__linux__)
+    usleep(1000);
+#endif
+}
+
+static void reader_loop() {
+    int c;
+    while ((c = getchar()) != EOF) {
+        // The consumer is behind (e.g. a long line is being pasted in), wait for it instead of dropping input
+        while (!linebuf_put(&stdinBuf, (char)c))
+            wait_for_space();
+    }
+    // Terminate whatever was typed last, in case the input ended without a newline
+    while (!linebuf_put(&stdinBuf, '\n'))
+        wait_for_space();
+}
+
 #if defined(_WIN32)
+static DWORD WINAPI reader_thread(LPVOID arg) {
+    (void)arg;
+    reader_loop();
+    return 0;
+}
+#elif defined(__APPLE__) || defined(__linux__)
+static void *reader_thread(void *arg) {
+    (void)arg;
+    reader_loop();
+    return NULL;
+}
+#endif
+
+#if defined(_WIN32)
+static void enable_escape_codes() {
     // To be able to use ANSI escape codes, we need to enable virtual terminal processing
     HANDLE hOut = GetStdHandle(STD_OUTPUT_HANDLE);
     if (hOut == INVALID_HANDLE_VALUE)
@@ -24,23 +67,35 @@ void stdio_setup() {
     if (!GetConsoleMode(hOut, &dwMode))
         return;
     dwMode |= ENABLE_VIRTUAL_TERMINAL_PROCESSING;
-    if (!SetConsoleMode(hOut, dwMode))
-        return;
-#else
-    return;
+    SetConsoleMode(hOut, dwMode);
+}
+#endif
+
+void stdio_setup() {
+    linebuf_init(&stdinBuf);
+#if defined(_WIN32)
+    enable_escape_codes();
+    HANDLE thread = CreateThread(NULL, 0, reader_thread, NULL, 0, NULL);
+    if (thread)
+        CloseHandle(thread);
+#elif defined(__APPLE__) || defined(__linux__)
+    pthread_t thread;
+    if (pthread_create(&thread, NULL, reader_thread, NULL) == 0)
+        pthread_detach(thread);
 #endif
 }
 
 char *stdin_read() {
-    char *line = NULL;
-    size_t len = 0;
-    ssize_t read = getline(&line, &len, stdin);
-    if (read == -1) {
-        free(line);
-        return NULL;
-    }
-    line[strcspn(line, "\n")] = 0; // Remove trailing newline
-    return line;
+    return linebuf_read(&stdinBuf);
+}
+
+byte *stdin_read_packet(u32 *len) {
+    return linebuf_read_packet(&stdinBuf, len);
+}
+
+void stdout_write(const byte *data, u32 len) {
+    fwrite(data, 1, len, stdout);
+    fflush(stdout);
 }
 
 int __printflike(1, 2) wrap_printf(const char *fmt, ...) {
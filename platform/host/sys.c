@@ -15,7 +15,12 @@ LARGE_INTEGER tStart, tFreq;
 u64 tStart;
 #endif
 
+#include "sim/sim.h"
+#include "sys_shared.h"
+
+#include "platform/common/callback.h"
 #include "platform/sys.h"
+#include "platform/time.h"
 
 // The term_handler function catches termination signals by the OS and calls sys_shutdown.
 #if defined(_WIN32)
@@ -42,19 +47,29 @@ void sys_boot_begin() {
     gettimeofday(&tv, NULL);
     tStart = tv.tv_sec * 1000000 + tv.tv_usec;
     signal(SIGINT, term_handler);
+    signal(SIGTERM, term_handler);
 #endif
+    time_virtual_init();
+    sim_init();
 }
 
 void sys_boot_end() {
-    return;
+    // Let the aircraft fly once the system is ready to control it
+    sim_start();
 }
 
 void sys_periodic() {
-    return;
+    time_virtual_step();
+    callback_dispatch();
+    sim_step(time_us());
 }
 
 void __attribute__((noreturn)) sys_shutdown() {
     printf("\n");
+    u32 transactions, bytes;
+    i2c_get_stats(&transactions, &bytes);
+    if (transactions > 0)
+        printf("I2C: %u transactions, %u bytes\n", transactions, bytes);
     exit(0);
 }
 
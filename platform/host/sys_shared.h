@@ -2,11 +2,31 @@
 
 // The purpose of sys_shared.h is to allow tStart (and tFreq) to be shared between sys.c and time.c
 // This is because tStart needs to be set in sys_boot_begin() in sys.c, but used in time_us() in time.c
+// It also shares the I2C bus statistics from i2c.c, which are reported in sys_shutdown()
 
+#include "platform/types.h"
 #if defined(_WIN32)
     #include <windows.h>
 extern LARGE_INTEGER tStart, tFreq;
 #elif defined(__APPLE__) || defined(__linux__)
-    #include "platform/types.h"
 extern u64 tStart;
 #endif
+
+// Virtual time is likewise set up in sys_boot_begin() and stepped in sys_periodic(), but implemented in time.c
+
+/**
+ * Enables virtual time if it has been selected through the environment (PICO_FBW_VIRTUAL_TIME=1).
+ */
+void time_virtual_init();
+
+/**
+ * Advances virtual time by one step; does nothing in real time.
+ */
+void time_virtual_step();
+
+/**
+ * Gets the number of I2C transactions and data bytes that have been issued since boot, for measuring bus usage.
+ * @param numTransactions pointer to where the number of transactions should be stored, may be NULL
+ * @param numBytes pointer to where the number of data bytes should be stored, may be NULL
+ */
+void i2c_get_stats(u32 *numTransactions, u32 *numBytes);
@@ -3,18 +3,14 @@
  * Licensed under the GNU AGPL-3.0
  */
 
+#include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
 #if defined(_WIN32)
     #include <windows.h>
-#elif defined(__APPLE__)
-    #include <sys/time.h>
-    #include <unistd.h>
-    #include "time_apple.h" // Compatibility layer for <time.h> on macOS
-#elif defined(__linux__)
-    #include <signal.h>
+#elif defined(__APPLE__) || defined(__linux__)
     #include <sys/time.h>
-    #include <time.h>
     #include <unistd.h>
 #endif
 
@@ -22,73 +18,32 @@
 
 #include "platform/time.h"
 
-#if defined(_WIN32)
-
-VOID CALLBACK callback_to_WAITORTIMERCALLBACK(PVOID lp_param, BOOLEAN timer_or_wait_fired) {
-    CallbackData *data = (CallbackData *)lp_param;
-    if (!data)
-        return;
-    i32 reschedule = data->callback(data->data);
-    if (reschedule <= 0) {
-        DeleteTimerQueueTimer(NULL, data->id, NULL);
-        free(data);
-    }
-    (void)timer_or_wait_fired;
-}
+// Virtual time: when PICO_FBW_VIRTUAL_TIME=1 is set, time no longer follows the host's clock but only advances when the
+// main loop steps it (see time_virtual_step()), so simulations run as fast as the host can go and are reproducible.
+// Callbacks are dispatched from sys_periodic() on the main thread either way, so they follow virtual time too.
 
-#elif defined(__APPLE__) || defined(__linux__)
+#define VIRTUAL_STEP_US 1000 // Amount of time that passes each time the main loop steps the virtual clock
 
-static void callback_to_sigevent(union sigval sv); // Forward declaration
+static bool virtualTime = false;
+static u64 virtualNow = 0; // Current virtual time, in us
 
-/**
- * Creates a system timer from the given data and schedules it to fire after `ms` milliseconds.
- * @param data the CallbackData struct that the timer is associated with
- * @param ms the time after which the timer should fire (in ms)
- * @return true if the timer was successfully created and scheduled
- */
-static bool create_timer(CallbackData *data, u32 ms) {
-    struct sigevent sev = {
-        .sigev_notify = SIGEV_THREAD,
-        .sigev_notify_function = callback_to_sigevent,
-        .sigev_value.sival_ptr = data,
-    };
-    if (timer_create(CLOCK_REALTIME, &sev, &data->id) != 0) {
-        free(data);
-        return false;
-    }
-    // clang-format off
-    struct itimerspec its = {
-        .it_interval = {0},
-        .it_value = {ms / 1000, (ms % 1000) * 1000000}
-    };
-    // clang-format on
-    if (timer_settime(data->id, 0, &its, NULL) != 0) {
-        timer_delete(data->id);
-        free(data);
-        return false;
-    }
-    return true;
+void time_virtual_init() {
+    const char *env = getenv("PICO_FBW_VIRTUAL_TIME");
+    virtualTime = env && strcmp(env, "0") != 0;
+    if (virtualTime)
+        printf("[time] using virtual time\n");
 }
 
-// Wrapper function to convert the callback signature from `i32 (*)()` to `void (*)(union sigval)`
-static void callback_to_sigevent(union sigval sv) {
-    CallbackData *data = sv.sival_ptr;
-    if (!data)
-        return;
-    i32 reschedule = data->callback(data->data);
-    if (reschedule > 0) {
-        timer_delete(data->id);
-        if (!create_timer(data, reschedule))
-            free(data);
-    } else {
-        timer_delete(data->id);
-        free(data);
-    }
+void time_virtual_step() {
+    if (virtualTime)
+        virtualNow += VIRTUAL_STEP_US;
 }
 
-#endif // defined(__APPLE__) || defined(__linux__)
-
 u64 time_us() {
+    // Each read of the virtual clock advances it slightly, so code that busy-waits on the time without stepping the main
+    // loop still terminates
+    if (virtualTime)
+        return virtualNow++;
 #if defined(_WIN32)
     LARGE_INTEGER tNow;
     QueryPerformanceCounter(&tNow);
@@ -100,38 +55,11 @@ u64 time_us() {
 #endif
 }
 
-CallbackData *callback_in_ms(u32 ms, Callback callback, void *data) {
-    CallbackData *cbData = malloc(sizeof(CallbackData));
-    if (!cbData)
-        return NULL;
-    cbData->callback = callback;
-    cbData->data = data;
-#if defined(_WIN32)
-    if (!CreateTimerQueueTimer(&cbData->id, NULL, callback_to_WAITORTIMERCALLBACK, cbData, ms, ms, 0)) {
-        free(cbData);
-        return NULL;
-    }
-#elif defined(__APPLE__) || defined(__linux__)
-    if (!create_timer(cbData, ms)) {
-        free(cbData);
-        return NULL;
-    }
-#endif
-    return cbData;
-}
-
-void cancel_callback(CallbackData *data) {
-    if (!data)
-        return;
-#if defined(_WIN32)
-    DeleteTimerQueueTimer(NULL, data->id, NULL);
-#elif defined(__APPLE__) || defined(__linux__)
-    timer_delete(data->id);
-#endif
-    free(data);
-}
-
 void sleep_us_blocking(u64 us) {
+    if (virtualTime) {
+        virtualNow += us;
+        return;
+    }
 #if defined(_WIN32)
     Sleep(us / 1000);
 #elif defined(__APPLE__) || defined(__linux__)
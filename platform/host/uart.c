@@ -3,6 +3,8 @@
  * Licensed under the GNU AGPL-3.0
  */
 
+#include "sim/sim.h"
+
 #include "platform/uart.h"
 
 bool uart_setup(u32 tx, u32 rx, u32 baud) {
@@ -12,15 +14,18 @@ bool uart_setup(u32 tx, u32 rx, u32 baud) {
     (void)baud;
 }
 
-char *uart_read(u32 tx, u32 rx) {
-    return NULL; // Not implemented
+u32 uart_read(u32 tx, u32 rx, byte *buf, u32 len) {
+    if (sim_enabled())
+        return sim_uart_read(buf, len);
+    return 0; // Not implemented
     (void)tx;
     (void)rx;
 }
 
-bool uart_write(u32 tx, u32 rx, const char *str) {
+bool uart_write(u32 tx, u32 rx, const byte *data, u32 len) {
+    if (sim_enabled())
+        return sim_uart_write(data, len);
     return true; // Not implemented
     (void)tx;
     (void)rx;
-    (void)str;
 }
@@ -0,0 +1,54 @@
+/**
+ * Source file of pico-fbw: https://github.com/pico-fbw/pico-fbw
+ * Licensed under the GNU AGPL-3.0
+ */
+
+#include "platform/wifi.h"
+
+#if PLATFORM_SUPPORTS_WIFI
+
+// clang-format off
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "http.h"
+
+// clang-format on
+
+// A host has no access point to create, so "Wi-Fi" on a host is just the web server, opened on the host's own network. It
+// serves the web interface and the same /api/v1 as the Pico W and ESP32, so the real interface can be used (and load-tested)
+// against the real firmware.
+// The server is disabled by default; it's enabled like Wi-Fi on any other platform (through the GENERAL wifiEnabled config
+// value), and needs the web interface to have been built (-DFBW_BUILD_WWW=ON, or an image given with PICO_FBW_WWWFS).
+// It listens on port HTTP_PORT_DEFAULT, or the port given with PICO_FBW_HTTP_PORT.
+
+bool wifi_setup(const char *ssid, const char *pass) {
+    u16 port = HTTP_PORT_DEFAULT;
+    const char *env = getenv("PICO_FBW_HTTP_PORT");
+    if (env) {
+        long value = strtol(env, NULL, 10);
+        if (value <= 0 || value > UINT16_MAX) {
+            printf("[http] invalid PICO_FBW_HTTP_PORT \"%s\"\n", env);
+            return false;
+        }
+        port = (u16)value;
+    }
+    if (!http_server_open(port))
+        return false;
+    printf("[http] web interface available at http://localhost:%u/\n", port);
+    return true;
+    (void)ssid;
+    (void)pass;
+}
+
+void wifi_periodic() {
+    http_server_poll();
+}
+
+bool wifi_disable() {
+    http_server_close();
+    return true;
+}
+
+#endif // PLATFORM_SUPPORTS_WIFI
@@ -1,12 +1,9 @@
 #pragma once
 
 #include "pico/config.h" // For platform-specific defines (e.g. RASPBERRYPI_PICO_W)
-#include "pico/time.h"
 
 #include "platform/types.h"
 
-typedef alarm_id_t __callback_id_t;
-
 // Flight control I/O pins
 #define PIN_INPUT_AIL 1
 #define PIN_SERVO_AIL 2
@@ -7,40 +7,42 @@
 #include <stdio.h>
 #include "pico/stdio.h"
 
+#include "platform/common/linebuf.h"
+
 #include "platform/stdio.h"
 
-// Timeout between waiting for characters in the stdio read function (in microseconds)
-#define STDIO_TIMEOUT_US 1000
+static LineBuf stdinBuf;
 
 void stdio_setup() {
     stdio_init_all(); // The stdio types that are initializes here depend on what gets defined in platform/pico/CMakeLists.txt
+    linebuf_init(&stdinBuf);
 }
 
-char *stdin_read() {
-    char *buf = NULL;
-    u32 i = 0;
-    while (true) {
-        // Try to get a character from stdin before the timeout
-        i32 c = getchar_timeout_us(STDIO_TIMEOUT_US);
-        if (c == '\n' || c == '\r' || c == PICO_ERROR_TIMEOUT) {
-            // Either timed out or met the end of a line, end
+// Moves whatever characters the SDK has already received into the line buffer, without waiting for any more
+static void poll_stdin() {
+    for (u32 space = linebuf_space(&stdinBuf); space > 0; space--) {
+        i32 c = getchar_timeout_us(0);
+        if (c == PICO_ERROR_TIMEOUT)
             break;
-        } else {
-            // Recieved a valid character, resize the buffer and store it
-            buf = try_realloc(buf, (i + 1) * sizeof(char));
-            if (!buf)
-                return NULL;
-            buf[i++] = c;
-        }
-    }
-    // Done reading, null-terminate the buffer if we read a line
-    if (i != 0) {
-        buf = try_realloc(buf, (i + 1) * sizeof(char));
-        if (!buf)
-            return NULL; // Nothing was read
-        buf[i] = '\0';
+        linebuf_put(&stdinBuf, (char)c);
     }
-    return buf;
+}
+
+char *stdin_read() {
+    poll_stdin();
+    return linebuf_read(&stdinBuf);
+}
+
+byte *stdin_read_packet(u32 *len) {
+    poll_stdin();
+    return linebuf_read_packet(&stdinBuf, len);
+}
+
+void stdout_write(const byte *data, u32 len) {
+    // putchar_raw() skips the SDK's "\n" -> "\r\n" translation, which would corrupt binary data
+    for (u32 i = 0; i < len; i++)
+        putchar_raw(data[i]);
+    stdio_flush();
 }
 
 int __printflike(1, 2) wrap_printf(const char *fmt, ...) {
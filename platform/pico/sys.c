@@ -13,6 +13,7 @@
 #endif
 #include "hardware/watchdog.h"
 
+#include "platform/common/callback.h"
 #include "platform/sys.h"
 
 #define WATCHDOG_TIMEOUT_MS 2000
@@ -34,6 +35,7 @@ void sys_boot_end() {
 
 void sys_periodic() {
     watchdog_update();
+    callback_dispatch();
 }
 
 void __attribute__((noreturn)) sys_shutdown() {
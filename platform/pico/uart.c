@@ -3,17 +3,32 @@
  * Licensed under the GNU AGPL-3.0
  */
 
-#include <string.h>
-#include "hardware/uart.h"
 #include "hardware/gpio.h"
+#include "hardware/irq.h"
+#include "hardware/uart.h"
 
-#include "platform/stdio.h"
+#include "platform/common/ringbuf.h"
 
 #include "platform/uart.h"
 
-// Timeout between waiting for characters in the UART read function (in microseconds)
-// This is typically used for GPS modules which operate at a lower baud, so this value must be decently high
-#define UART_TIMEOUT_US 4000
+// Received data is moved out of each UART's (32 byte) FIFO by its interrupt handler, into a ring that uart_read() takes from;
+// at 115200 baud, the ring holds ~90ms of data, so it never overruns as long as it's read at least every few runtime loops
+static RingBuf rings[2]; // One per UART instance
+static bool handlerAdded[2] = {false, false};
+
+static void on_uart_rx(uart_inst_t *uart, RingBuf *ring) {
+    // The interrupt fires when the FIFO is half full, or when data has been sitting in it for 32 bit periods
+    while (uart_is_readable(uart))
+        ringbuf_put(ring, (byte)uart_get_hw(uart)->dr);
+}
+
+static void on_uart0_rx() {
+    on_uart_rx(uart0, &rings[0]);
+}
+
+static void on_uart1_rx() {
+    on_uart_rx(uart1, &rings[1]);
+}
 
 /**
  * @param tx the pin number of the TX pin
@@ -61,40 +76,32 @@ bool uart_setup(u32 tx, u32 rx, u32 baud) {
     uart_set_format(uart, 8, 1, UART_PARITY_NONE); // NMEA-0183 format
     // Clear FIFO
     uart_set_fifo_enabled(uart, false);
-    irq_set_enabled(uart == uart0 ? UART0_IRQ : UART1_IRQ, true);
     uart_set_fifo_enabled(uart, true);
+    // Buffer everything received from now on
+    u32 index = uart_get_index(uart);
+    ringbuf_init(&rings[index]);
+    u32 irq = uart == uart0 ? UART0_IRQ : UART1_IRQ;
+    if (!handlerAdded[index]) {
+        // The handler is shared, as the SDK's stdio may also be using the UART
+        irq_add_shared_handler(irq, index == 0 ? on_uart0_rx : on_uart1_rx, PICO_SHARED_IRQ_HANDLER_DEFAULT_ORDER_PRIORITY);
+        handlerAdded[index] = true;
+    }
+    irq_set_enabled(irq, true);
+    uart_set_irq_enables(uart, true, false);
     return true;
 }
 
-char *uart_read(u32 tx, u32 rx) {
+u32 uart_read(u32 tx, u32 rx, byte *buf, u32 len) {
     uart_inst_t *uart = uart_inst_from_pins(tx, rx);
     if (!uart)
-        return NULL;
-    // Very similar to stdin_read() in pico/stdio.c, take a look at that for documentation
-    char *buf = NULL;
-    if (uart_is_readable(uart)) {
-        u32 i = 0;
-        while (uart_is_readable_within_us(uart, UART_TIMEOUT_US)) {
-            char c = uart_getc(uart);
-            if (c == '\r' || c == '\n')
-                break;
-            buf = try_realloc(buf, (i + 1) * sizeof(char));
-            if (!buf)
-                return NULL;
-            buf[i++] = c;
-        }
-        buf = try_realloc(buf, (i + 1) * sizeof(char));
-        if (!buf)
-            return NULL;
-        buf[i] = '\0';
-    }
-    return buf;
+        return 0;
+    return ringbuf_read(&rings[uart_get_index(uart)], buf, len);
 }
 
-bool uart_write(u32 tx, u32 rx, const char *str) {
+bool uart_write(u32 tx, u32 rx, const byte *data, u32 len) {
     uart_inst_t *uart = uart_inst_from_pins(tx, rx);
     if (!uart)
         return false;
-    uart_write_blocking(uart, (const u8 *)str, strlen(str) + 1); // +1 to include the null terminator
+    uart_write_blocking(uart, data, len);
     return true;
 }
@@ -0,0 +1,186 @@
+/**
+ * Source file of pico-fbw: https://github.com/pico-fbw/pico-fbw
+ * Licensed under the GNU AGPL-3.0
+ */
+
+#include "binapi.h"
+
+#if PLATFORM_SUPPORTS_WIFI
+
+// clang-format off
+
+#include "lwip/debug.h"
+#include "lwip/pbuf.h"
+#include "lwip/tcp.h"
+#include "pico/cyw43_arch.h"
+
+#include "platform/common/linebuf.h"
+
+#include "sys/api/binary.h"
+#include "sys/api/stream.h"
+
+// clang-format on
+
+// Only one client is served at a time, which keeps the (large) receive buffer static
+typedef struct BinAPIClient {
+    struct tcp_pcb *pcb; // NULL if no client is connected
+    LineBuf rx;
+    struct pbuf *pending; // Data received from the client that didn't fit into `rx` yet
+    BinarySession session;
+    StreamClient stream;
+    bool busy; // Whether a frame from the client is being handled (its data lives in `rx` until then)
+} BinAPIClient;
+
+static struct tcp_pcb *serverPcb = NULL;
+static BinAPIClient client;
+
+// Disconnects the client; must be called with lwIP locked
+static err_t client_close() {
+    struct tcp_pcb *pcb = client.pcb;
+    if (!pcb)
+        return ERR_OK;
+    client.pcb = NULL;
+    if (client.pending) {
+        pbuf_free(client.pending);
+        client.pending = NULL;
+    }
+    tcp_recv(pcb, NULL);
+    tcp_err(pcb, NULL);
+    if (tcp_close(pcb) != ERR_OK) {
+        tcp_abort(pcb);
+        return ERR_ABRT;
+    }
+    return ERR_OK;
+}
+
+// Session write callback, called from the main loop
+static bool client_write(const byte *data, u32 len, void *ctx) {
+    bool written = false;
+    cyw43_arch_lwip_begin();
+    // Frames that don't fit in the send buffer are dropped rather than waited for, so a slow client can't stall the loop
+    if (client.pcb && tcp_sndbuf(client.pcb) >= len) {
+        written = tcp_write(client.pcb, data, len, TCP_WRITE_FLAG_COPY) == ERR_OK;
+        tcp_output(client.pcb);
+    }
+    cyw43_arch_lwip_end();
+    return written;
+    (void)ctx;
+}
+
+// Moves as much of the data waiting in `client.pending` as fits into the receive buffer; must be called with lwIP locked
+static void client_drain() {
+    if (!client.pending)
+        return;
+    u32 space = linebuf_space(&client.rx);
+    u16 n = client.pending->tot_len < space ? client.pending->tot_len : (u16)space;
+    u16 moved = 0;
+    for (struct pbuf *q = client.pending; q && moved < n; q = q->next) {
+        for (u16 i = 0; i < q->len && moved < n; i++, moved++)
+            linebuf_put(&client.rx, ((char *)q->payload)[i]);
+    }
+    client.pending = pbuf_free_header(client.pending, n);
+    tcp_recved(client.pcb, n); // Only data that was buffered opens the receive window, so a busy client is slowed down
+}
+
+// lwIP callback. Will be called when data is received from the client.
+static err_t binapi_recv(void *arg, struct tcp_pcb *pcb, struct pbuf *p, err_t err) {
+    if (!p)
+        return client_close(); // The client closed the connection
+    if (err != ERR_OK || pcb != client.pcb) {
+        pbuf_free(p);
+        return ERR_OK;
+    }
+    // Whatever doesn't fit into the receive buffer (a segment can be larger than all of it) is kept until there's room
+    if (client.pending)
+        pbuf_cat(client.pending, p);
+    else
+        client.pending = p;
+    client_drain();
+    return ERR_OK;
+    (void)arg;
+}
+
+// lwIP callback. Will be called when an error occurs on the connection (the pcb has already been freed).
+static void binapi_err(void *arg, err_t err) {
+    LWIP_DEBUGF(TCP_DEBUG, ("binapi: connection error %d\n", err));
+    client.pcb = NULL;
+    if (client.pending) {
+        pbuf_free(client.pending);
+        client.pending = NULL;
+    }
+    (void)arg;
+}
+
+// lwIP callback. Will be called when a new connection is to be accepted.
+static err_t binapi_accept(void *arg, struct tcp_pcb *pcb, err_t err) {
+    if (err != ERR_OK || !pcb)
+        return ERR_VAL;
+    if (client.pcb || client.busy || stream_is_subscribed(&client.stream)) {
+        // Already serving a client (or still tearing down the last one's stream)
+        tcp_abort(pcb);
+        return ERR_ABRT;
+    }
+    linebuf_init(&client.rx);
+    client.session = (BinarySession){.write = client_write, .ctx = NULL, .active = true, .stream = &client.stream};
+    client.pcb = pcb;
+    tcp_arg(pcb, NULL);
+    tcp_recv(pcb, binapi_recv);
+    tcp_err(pcb, binapi_err);
+    tcp_nagle_disable(pcb); // Frames are small and latency matters more than efficiency
+    LWIP_DEBUGF(TCP_DEBUG, ("binapi: client connected\n"));
+    return ERR_OK;
+    (void)arg;
+}
+
+bool binapi_server_open(ip_addr_t *ip, u16 port) {
+    struct tcp_pcb *pcb = tcp_new_ip_type(IPADDR_TYPE_V4);
+    if (!pcb)
+        return false;
+    if (tcp_bind(pcb, ip ? ip : IP_ANY_TYPE, port) != ERR_OK) {
+        tcp_close(pcb);
+        return false;
+    }
+    serverPcb = tcp_listen_with_backlog(pcb, 1);
+    if (!serverPcb) {
+        tcp_close(pcb);
+        return false;
+    }
+    tcp_accept(serverPcb, binapi_accept);
+    return true;
+}
+
+void binapi_server_poll() {
+    cyw43_arch_lwip_begin();
+    bool connected = client.pcb != NULL;
+    if (connected)
+        client_drain(); // Make room for anything that was held back
+    u32 len = 0;
+    byte *packet = connected ? linebuf_read_packet(&client.rx, &len) : NULL;
+    client.busy = packet != NULL;
+    cyw43_arch_lwip_end();
+    // Subscriptions can only be changed from the main loop, so a client that has gone away is unsubscribed here
+    if (!connected && stream_is_subscribed(&client.stream))
+        stream_unsubscribe(&client.stream);
+    if (!packet)
+        return;
+    // The command may take a while, so lwIP is left unlocked while it runs
+    binary_handle(&client.session, packet, len);
+    cyw43_arch_lwip_begin();
+    client.busy = false;
+    if (!client.session.active)
+        client_close(); // Network sessions are binary-only, so asking for text ends the session
+    cyw43_arch_lwip_end();
+}
+
+void binapi_server_close() {
+    stream_unsubscribe(&client.stream);
+    cyw43_arch_lwip_begin();
+    client_close();
+    if (serverPcb) {
+        tcp_close(serverPcb);
+        serverPcb = NULL;
+    }
+    cyw43_arch_lwip_end();
+}
+
+#endif // PLATFORM_SUPPORTS_WIFI
@@ -0,0 +1,39 @@
+#pragma once
+
+#include "platform/defs.h"
+
+#if PLATFORM_SUPPORTS_WIFI
+
+// clang-format off
+
+#include <stdbool.h>
+#include "lwip/ip_addr.h"
+
+#include "platform/types.h"
+
+// clang-format on
+
+// TCP server for the binary API protocol (see sys/api/binary.h).
+// Received bytes are only queued from lwIP's callbacks; frames are handled by `binapi_server_poll()` on the main loop, so
+// commands never run in interrupt context.
+
+/**
+ * Opens the binary API server on the given port.
+ * @param ip the IP address to open the server on, or NULL for any
+ * @param port the port to open the server on
+ * @return true if the server was opened successfully
+ */
+bool binapi_server_open(ip_addr_t *ip, u16 port);
+
+/**
+ * Handles the next frame received from the connected client, if there is one.
+ * @note This must be called periodically from the main loop.
+ */
+void binapi_server_poll();
+
+/**
+ * Closes the binary API server and its connection, if any.
+ */
+void binapi_server_close();
+
+#endif // PLATFORM_SUPPORTS_WIFI
@@ -8,6 +8,7 @@
 #define MEM_ALIGNMENT 4
 #define MEM_SIZE 16384 // 16K
 #define MEMP_NUM_TCP_SEG 32
+#define MEMP_NUM_TCP_PCB 8 // The web server keeps up to 4 connections open, plus binary API clients and closing connections
 #define MEMP_NUM_ARP_QUEUE 10
 #define PBUF_POOL_SIZE 24
 
@@ -26,371 +26,503 @@
 #include "lwip/err.h"
 #include "lwip/pbuf.h"
 #include "lwip/tcp.h"
+#include "pico/cyw43_arch.h"
 
-#include "lib/mimetype.h"
+#include "lib/jsonwriter.h"
 
+#include "platform/common/www.h"
 #include "platform/flash.h"
+#include "platform/helpers.h"
 
 #include "sys/api/api.h"
-#include "sys/api/cmds/GET/get_config.h"
-#include "sys/api/cmds/GET/get_info.h"
-#include "sys/api/cmds/SET/set_config.h"
-#include "sys/api/cmds/SET/set_flightplan.h"
+#include "sys/api/cmds/cmds.h"
+#include "sys/api/stream.h"
 
 #define CHUNK_XFER_SIZE 1024 // Size of each chunk to send in a chunked transfer
+#define FILE_BUFFER_COUNT (TCP_SND_BUF / TCP_MSS) // Buffers in the file pool, enough to fill a connection's send window
+#define FILE_CHUNK_HEADER_MAX 6 // Longest chunk size line ("5ac\r\n" with room to spare)
+#define FILE_CHUNK_DATA_MAX (TCP_MSS - FILE_CHUNK_HEADER_MAX - 2) // File data in a chunk, so that each chunk is one segment
+#define PENDING_MAX 16384 // Most of a response that may wait for room in the send buffer (the connection is closed beyond it)
 #define POLL_TIME_S 5 // Interval to poll a TCP connection for activity
 
+#define IDLE_POLLS_MAX 2 // Polls a kept-alive connection may sit idle for before it's closed
+
 #define TYPE_JSON "application/json"
+#define TYPE_EVENT_STREAM "text/event-stream"
 
 #define API_V1_PATH "/api/v1/"
-#define HTTP_GET "GET"
-#define HTTP_POST "POST"
-
-#define HEADER_302 "HTTP/1.1 302 Redirect\r\nLocation: http://%s/\r\nContent-Length: 0\r\n\r\n"
-#define HEADER_404 "HTTP/1.1 404 Not Found\r\nContent-Length: 0\r\n\r\n"
-#define HEADER_500 "HTTP/1.1 500 Internal Server Error\r\nContent-Length: 0\r\n\r\n"
 
 // clang-format on
 
+// Files are sent straight out of a pool of buffers without being copied by lwIP, so a buffer stays referenced from the moment
+// it's read into until lwIP reports that the chunk in it has been acknowledged
+typedef struct FileBuffer {
+    u8 refs; // Free when 0
+    char data[TCP_MSS];
+} FileBuffer;
+
+// Something written to a connection, in the order it was written, so acknowledgements can be matched to buffers
+typedef struct FileSegment {
+    FileBuffer *buf; // NULL if the data wasn't from the pool (static, or copied by lwIP)
+    u16 remaining;   // Bytes not yet acknowledged
+} FileSegment;
+
 typedef struct FileState {
-    char *path;
-    i32 offset;
+    lfs_file_t file; // Kept open for the whole transfer
+    struct tcp_pcb *pcb;
+    FileSegment queue[FILE_BUFFER_COUNT + 2]; // Chunks in flight, plus the response's header and trailer
+    u32 head, count;
+    bool eof;        // Whether the whole file has been queued
+    bool done;       // Whether the trailer has been queued (the connection is closed once it's acknowledged)
+    bool progressed; // Whether anything was acknowledged since the last poll
+    struct FileState *next;
 } FileState;
 
+static TCPConnection connections[TCP_CONNECTIONS_MAX];
+static FileBuffer fileBuffers[FILE_BUFFER_COUNT];
+static FileState *fileTransfers = NULL; // All ongoing transfers, which share the pool
+
+// clang-format off
+typedef enum EventStreamState {
+    EVENT_STREAM_FREE,
+    EVENT_STREAM_STARTING, // Accepted by lwIP, waiting to be subscribed from the main loop
+    EVENT_STREAM_ACTIVE,
+    EVENT_STREAM_CLOSED,   // Disconnected, waiting to be unsubscribed from the main loop
+} EventStreamState;
+// clang-format on
+
+typedef struct EventStream {
+    volatile EventStreamState state;
+    struct tcp_pcb *pcb;       // NULL once the connection is gone
+    TCPConnection *con_state;
+    u8 channels;
+    u32 rate;
+    StreamClient client;
+} EventStream;
+
+static EventStream eventStreams[STREAM_CLIENTS_MAX];
+
 /* --- Miscellaneous helpers --- */
 
 /**
- * Extracts the URI of an HTTP request.
- * @param req the HTTP request
- * @param method the HTTP method used in the request
- * @return the URI from the request
- * @note The URI will be allocated by this function and must be freed by the caller.
+ * Sends a complete response.
+ * @param con_state the connection state data
+ * @param status the HTTP status (e.g. "200 OK")
+ * @param type the content type of the body, or NULL if there is no body
+ * @param body the body of the response, or NULL if there is none
+ * @param extra any other headers, each ending with "\r\n", or NULL
  */
-static char *extract_uri(const char *req, char *method) {
-    const char *request = req + strlen(method) + 1; // +1 to skip the space
-    char *end = strchr(request, ' ');
-    if (end == NULL)
-        return NULL;
-    size_t uri_length = end - request;
-    char *uri = malloc(uri_length + 1);
-    if (uri != NULL) {
-        strncpy(uri, request, uri_length);
-        uri[uri_length] = '\0';
-    }
-    return uri;
+static void send_response(TCPConnection *con_state, const char *status, const char *type, const char *body,
+                          const char *extra) {
+    char head[HTTP_RESPONSE_HEAD_MAX];
+    u32 bodyLen = body ? strlen(body) : 0;
+    u32 headLen = http_format_head(head, sizeof(head), status, type, (i32)bodyLen, con_state->keepAlive, extra);
+    tcp_write(con_state->pcb, head, headLen, TCP_WRITE_FLAG_COPY);
+    if (bodyLen > 0)
+        tcp_write(con_state->pcb, body, bodyLen, TCP_WRITE_FLAG_COPY);
 }
 
-/**
- * Extracts the body of an HTTP request.
- * @param req the HTTP request
- * @return the body of the request, or NULL if there is no body
- */
-static const char *get_request_body(const char *req) {
-    const char *body = strstr(req, "\r\n\r\n");
-    if (body && *(body + 4) != '\0')
-        return body + 4;
-    return NULL;
+/* --- Pending data --- */
+
+static void pending_free(TCPConnection *con_state) {
+    free(con_state->pending);
+    con_state->pending = NULL;
+    con_state->pendingLen = 0;
+    con_state->pendingSent = 0;
 }
 
 /**
- * Creates an HTTP response.
- * @param status the HTTP status code, as a string (e.g. "200 OK")
- * @param content_type the content type of the response
- * @param body the body of the response, or NULL if not needed
- * @return the response, or NULL on error
- * @note The response will be allocated by this function and must be freed by the caller.
+ * Sends as much of a connection's pending data as fits into its send buffer.
+ * @param con_state the connection state data
  */
-static char *create_response(const char *status, const char *content_type, const char *body) {
-    char contentLength[32];
-    if (body)
-        snprintf(contentLength, sizeof(contentLength), "%u", strlen(body));
-    else
-        strcpy(contentLength, "0");
-
-    char *response =
-        malloc(strlen("HTTP/1.1 ") + strlen(status) + strlen("\r\nContent-Type: ") + strlen(content_type) +
-               strlen("\r\nContent-Length: ") + strlen(contentLength) + strlen("\r\n\r\n") + (body ? strlen(body) : 0) + 1);
-    if (!response)
-        return NULL;
-    strcpy(response, "HTTP/1.1 ");
-    strcat(response, status);
-    strcat(response, "\r\nContent-Type: ");
-    strcat(response, content_type);
-    strcat(response, "\r\nContent-Length: ");
-    strcat(response, contentLength);
-    strcat(response, "\r\n\r\n");
-    if (body)
-        strcat(response, body);
-    return response;
+static void pending_flush(TCPConnection *con_state) {
+    struct tcp_pcb *pcb = con_state->pcb;
+    while (con_state->pending && tcp_sndqueuelen(pcb) < TCP_SND_QUEUELEN - 1) {
+        u32 len = LWIP_MIN(LWIP_MIN(con_state->pendingLen - con_state->pendingSent, tcp_sndbuf(pcb)), TCP_MSS);
+        if (len == 0 || tcp_write(pcb, con_state->pending + con_state->pendingSent, len, TCP_WRITE_FLAG_COPY) != ERR_OK)
+            break; // Continue once some of the send buffer is acknowledged
+        con_state->pendingSent += len;
+        if (con_state->pendingSent == con_state->pendingLen)
+            pending_free(con_state);
+    }
 }
 
 /**
- * Sends a chunk of a file to a client.
+ * Writes part of a response to a connection. Whatever doesn't fit into the send buffer is kept, and sent from
+ * tcp_server_sent() as earlier data is acknowledged; the connection doesn't handle any more requests until it's all sent.
  * @param con_state the connection state data
- * @param pcb the lwIP protocol control block for the connection
- * @param path the path to the file to send
- * @param offset the offset in the file to start sending from
- * @return positive (# of bytes sent), 0 if there are no more bytes to send, or negative on error
+ * @param data the data to write
+ * @param len the length of the data
+ * @return false if the data could neither be written nor kept (the response is incomplete, so the connection must be closed)
  */
-static i32 send_file_chunk(TCPConnection *con_state, struct tcp_pcb *pcb, const char *path, i32 offset) {
-    lfs_file_t file;
-    i32 err = lfs_file_open(&wwwfs, &file, path, LFS_O_RDONLY);
-    LWIP_DEBUGF(TCP_DEBUG, ("send_file_chunk(%p, %p, %s, %ld): lfs_open -> %ld\n", con_state, pcb, path, offset, err));
-    if (err != LFS_ERR_OK) {
-        LWIP_DEBUGF(TCP_DEBUG, ("send_file_chunk: failed to open file (%ld)\n", err));
-        return err;
-    }
-    if (offset >= lfs_file_size(&wwwfs, &file)) {
-        LWIP_DEBUGF(TCP_DEBUG, ("send_file_chunk: no more data\n"));
-        lfs_file_close(&wwwfs, &file);
-        return 0;
-    }
-    lfs_file_seek(&wwwfs, &file, offset, LFS_SEEK_SET);
-    char chunk[CHUNK_XFER_SIZE];
-    i32 bytesRead = lfs_file_read(&wwwfs, &file, chunk, sizeof(chunk));
-    LWIP_DEBUGF(TCP_DEBUG, ("send_file_chunk: read %ld bytes\n", bytesRead));
-    if (bytesRead < 0) {
-        lfs_file_close(&wwwfs, &file);
-        return -1;
-    }
-    char chunkBegin[16] = "";
-    snprintf(chunkBegin, sizeof(chunkBegin), "%lx\r\n", bytesRead);
-    // No need to use TCP_WRITE_FLAG_COPY, since the chunk data will not be modified until it is sent anyway
-    tcp_write(pcb, chunkBegin, strlen(chunkBegin), 0);
-    tcp_write(pcb, chunk, bytesRead, 0);
-    tcp_write(pcb, "\r\n", strlen("\r\n"), 0);
-    lfs_file_close(&wwwfs, &file);
-    return bytesRead;
+static bool pending_write(TCPConnection *con_state, const char *data, u32 len) {
+    struct tcp_pcb *pcb = con_state->pcb;
+    if (!con_state->pending && tcp_sndqueuelen(pcb) < TCP_SND_QUEUELEN - 1) {
+        u32 n = LWIP_MIN(len, tcp_sndbuf(pcb));
+        if (n > 0 && tcp_write(pcb, data, n, TCP_WRITE_FLAG_COPY) == ERR_OK) {
+            data += n;
+            len -= n;
+        }
+    }
+    if (len == 0)
+        return true;
+    u32 kept = con_state->pendingLen - con_state->pendingSent;
+    if (kept + len > PENDING_MAX)
+        return false;
+    // Whatever was already sent is dropped from the front as the rest is grown
+    char *pending = malloc(kept + len);
+    if (!pending)
+        return false;
+    if (kept > 0)
+        memcpy(pending, con_state->pending + con_state->pendingSent, kept);
+    memcpy(pending + kept, data, len);
+    free(con_state->pending);
+    con_state->pending = pending;
+    con_state->pendingLen = kept + len;
+    con_state->pendingSent = 0;
+    return true;
 }
 
-/* --- API GET handlers --- */
+/* --- File transfers --- */
 
-static bool handle_api_v1_get_config(TCPConnection *con_state, struct tcp_pcb *pcb, const char *req) {
-    char *out = NULL;
-    // Perform the relavent API call using the request body and obtain its output
-    i32 res = api_handle_get_config(get_request_body(req), &out);
-    if (!out) {
-        tcp_write(pcb, HEADER_500, strlen(HEADER_500), 0);
-        return false;
+static FileBuffer *file_buffer_take() {
+    for (u32 i = 0; i < count_of(fileBuffers); i++) {
+        if (fileBuffers[i].refs == 0) {
+            fileBuffers[i].refs = 1;
+            return &fileBuffers[i];
+        }
     }
-    // Create and send the HTTP response
-    char *resp = create_response(api_res_to_http_status(res), TYPE_JSON, out);
-    if (!resp) {
-        free(out);
-        tcp_write(pcb, HEADER_500, strlen(HEADER_500), 0);
-        return false;
+    return NULL;
+}
+
+static void file_buffer_release(FileBuffer *buf) {
+    if (buf->refs > 0)
+        buf->refs--;
+}
+
+/**
+ * Records something written to a transfer's connection.
+ * @param state the transfer
+ * @param buf the buffer the data is in, or NULL if it isn't from the pool
+ * @param len the length of the data
+ */
+static void file_transfer_push(FileState *state, FileBuffer *buf, u32 len) {
+    state->queue[(state->head + state->count) % count_of(state->queue)] = (FileSegment){.buf = buf, .remaining = (u16)len};
+    state->count++;
+}
+
+/**
+ * @param state the transfer
+ * @return whether lwIP still references any of the transfer's buffers
+ */
+static bool file_transfer_in_flight(FileState *state) {
+    for (u32 i = 0; i < state->count; i++) {
+        if (state->queue[(state->head + i) % count_of(state->queue)].buf)
+            return true;
     }
-    // Ensure to copy the response data into lwIP's memory space, since we free it immediately,
-    // but lwIP may not have sent it yet
-    tcp_write(pcb, resp, strlen(resp), TCP_WRITE_FLAG_COPY);
-    free(resp);
-    free(out);
-    return res < 500 ? true : false;
-    (void)con_state;
+    return false;
 }
 
-static bool handle_api_v1_get_info(TCPConnection *con_state, struct tcp_pcb *pcb, const char *req) {
-    char *out = NULL;
-    i32 res = api_handle_get_info(&out);
-    if (!out) {
-        tcp_write(pcb, HEADER_500, strlen(HEADER_500), 0);
-        return false;
+/**
+ * Queues as much of a file as the connection's send window (and the pool) allows.
+ * @param state the transfer
+ * @return false if the file could not be read
+ */
+static bool file_transfer_fill(FileState *state) {
+    struct tcp_pcb *pcb = state->pcb;
+    while (!state->eof && state->count < count_of(state->queue) - 1) {
+        u32 space = tcp_sndbuf(pcb);
+        if (space <= FILE_CHUNK_HEADER_MAX + 2 || tcp_sndqueuelen(pcb) >= TCP_SND_QUEUELEN - 1)
+            break; // The send window is full, continue once some of it is acknowledged
+        FileBuffer *buf = file_buffer_take();
+        if (!buf)
+            break; // Another transfer holds the pool, continue once some of it is released
+        // Read the data in after room for the chunk size, which is filled in once the size is known
+        char *data = buf->data + FILE_CHUNK_HEADER_MAX;
+        u32 size = LWIP_MIN(space - FILE_CHUNK_HEADER_MAX - 2, FILE_CHUNK_DATA_MAX);
+        i32 read = lfs_file_read(&wwwfs, &state->file, data, size);
+        if (read <= 0) {
+            file_buffer_release(buf);
+            if (read < 0) {
+                LWIP_DEBUGF(TCP_DEBUG, ("file_transfer_fill: read failed (%ld)\n", read));
+                return false;
+            }
+            state->eof = true;
+            break;
+        }
+        char header[FILE_CHUNK_HEADER_MAX + 1];
+        i32 headerLen = snprintf(header, sizeof(header), "%lx\r\n", read);
+        char *chunk = data - headerLen;
+        memcpy(chunk, header, headerLen);
+        memcpy(data + read, "\r\n", strlen("\r\n"));
+        u32 len = headerLen + read + strlen("\r\n");
+        // No copy is made, the buffer is released once lwIP reports that the chunk has been acknowledged
+        if (tcp_write(pcb, chunk, len, 0) != ERR_OK) {
+            // Out of memory in lwIP, so give the data back and try again later
+            file_buffer_release(buf);
+            lfs_file_seek(&wwwfs, &state->file, -read, LFS_SEEK_CUR);
+            break;
+        }
+        file_transfer_push(state, buf, len);
     }
-    char *resp = create_response(api_res_to_http_status(res), TYPE_JSON, out);
-    if (!resp) {
-        free(out);
-        tcp_write(pcb, HEADER_500, strlen(HEADER_500), 0);
-        return false;
+    if (state->eof && !state->done) {
+        // Send a zero-length chunk to indicate the end of the transfer
+        if (tcp_write(pcb, "0\r\n\r\n", strlen("0\r\n\r\n"), 0) == ERR_OK) {
+            file_transfer_push(state, NULL, strlen("0\r\n\r\n"));
+            state->done = true;
+        }
     }
-    tcp_write(pcb, resp, strlen(resp), TCP_WRITE_FLAG_COPY);
-    free(resp);
-    free(out);
-    return res < 500 ? true : false;
-    (void)con_state;
-    (void)req;
+    tcp_output(pcb);
+    return true;
 }
 
-/* --- API SET handlers --- */
+/**
+ * Handles data being acknowledged on a transfer's connection, releasing any buffers that are no longer needed.
+ * @param state the transfer
+ * @param len the number of bytes acknowledged
+ */
+static void file_transfer_acked(FileState *state, u32 len) {
+    if (len > 0)
+        state->progressed = true;
+    while (len > 0 && state->count > 0) {
+        FileSegment *seg = &state->queue[state->head];
+        u32 n = LWIP_MIN(len, seg->remaining);
+        seg->remaining -= n;
+        len -= n;
+        if (seg->remaining == 0) {
+            if (seg->buf)
+                file_buffer_release(seg->buf);
+            state->head = (state->head + 1) % count_of(state->queue);
+            state->count--;
+        }
+    }
+}
 
-static bool handle_api_v1_set_config(TCPConnection *con_state, struct tcp_pcb *pcb, const char *req) {
-    i32 res = api_handle_set_config(get_request_body(req));
-    char *resp = create_response(api_res_to_http_status(res), TYPE_JSON, "{}");
-    if (!resp) {
-        tcp_write(pcb, HEADER_500, strlen(HEADER_500), 0);
-        return false;
+// Continues transfers that may have been waiting for buffers from the pool
+static void file_transfers_resume(FileState *except) {
+    for (FileState *state = fileTransfers; state; state = state->next) {
+        if (state != except && state->pcb && !state->eof)
+            file_transfer_fill(state); // A failed read will be picked up by the connection's poll
     }
-    tcp_write(pcb, resp, strlen(resp), TCP_WRITE_FLAG_COPY);
-    free(resp);
-    return res < 500 ? true : false;
-    (void)con_state;
 }
 
-static bool handle_api_v1_set_flightplan(TCPConnection *con_state, struct tcp_pcb *pcb, const char *req) {
-    char *out = NULL;
-    i32 res = api_handle_set_flightplan(get_request_body(req), &out);
-    if (!out) {
-        tcp_write(pcb, HEADER_500, strlen(HEADER_500), 0);
-        return false;
+/**
+ * Ends a transfer and releases all of its resources.
+ * @param state the transfer
+ * @note Only call this once lwIP no longer references the transfer's buffers (they were acknowledged, or the connection was
+ * aborted).
+ */
+static void file_transfer_end(FileState *state) {
+    while (state->count > 0) {
+        FileSegment *seg = &state->queue[state->head];
+        if (seg->buf)
+            file_buffer_release(seg->buf);
+        state->head = (state->head + 1) % count_of(state->queue);
+        state->count--;
     }
-    char *resp = create_response(api_res_to_http_status(res), TYPE_JSON, out);
-    if (!resp) {
-        free(out);
-        tcp_write(pcb, HEADER_500, strlen(HEADER_500), 0);
-        return false;
+    lfs_file_close(&wwwfs, &state->file);
+    for (FileState **s = &fileTransfers; *s; s = &(*s)->next) {
+        if (*s == state) {
+            *s = state->next;
+            break;
+        }
     }
-    tcp_write(pcb, resp, strlen(resp), TCP_WRITE_FLAG_COPY);
-    free(resp);
-    free(out);
-    return res < 500 ? true : false;
-    (void)con_state;
+    free(state);
+    file_transfers_resume(NULL);
 }
 
-/* --- API MISC handlers --- */
+/* --- API responses --- */
+
+// JSON output of an API handler is sent as it's written: if it all fits into the writer's buffer, it's sent in one piece once
+// the handler is done (with the handler's status); otherwise it's sent in chunks as the buffer fills up (any chunks that don't
+// fit into the send buffer are kept, see pending_write())
+typedef struct JSONResponse {
+    TCPConnection *con_state;
+    bool chunked; // Whether the header (and at least one chunk) has already been sent
+    bool failed;  // Whether a chunk was lost, in which case nothing more is sent and the connection is closed
+} JSONResponse;
+
+// Writer sink, called whenever the writer's buffer fills up
+static void send_json_chunk(const char *data, u32 len, void *ctx) {
+    JSONResponse *resp = (JSONResponse *)ctx;
+    TCPConnection *con_state = resp->con_state;
+    if (resp->failed)
+        return;
+    if (!resp->chunked) {
+        char head[HTTP_RESPONSE_HEAD_MAX];
+        u32 headLen = http_format_head(head, sizeof(head), "200 OK", TYPE_JSON, HTTP_CHUNKED, con_state->keepAlive, NULL);
+        resp->failed = !pending_write(con_state, head, headLen);
+        resp->chunked = true;
+    }
+    char chunkBegin[16];
+    snprintf(chunkBegin, sizeof(chunkBegin), "%lx\r\n", len);
+    if (resp->failed || !pending_write(con_state, chunkBegin, strlen(chunkBegin)) || !pending_write(con_state, data, len) ||
+        !pending_write(con_state, "\r\n", strlen("\r\n"))) {
+        LWIP_DEBUGF(TCP_DEBUG, ("send_json_chunk: response too large, closing connection\n"));
+        resp->failed = true;
+    }
+}
 
-static bool handle_api_v1_ping(TCPConnection *con_state, struct tcp_pcb *pcb, const char *req) {
-    char *resp = create_response("200 OK", TYPE_JSON, "{}");
-    if (!resp) {
-        tcp_write(pcb, HEADER_500, strlen(HEADER_500), 0);
-        return false;
+/**
+ * Finishes sending the output of an API handler.
+ * @param resp the response
+ * @param json the writer the handler wrote to
+ * @param res the status code returned by the handler
+ * @return whether the handler succeeded
+ */
+static bool send_json_response(JSONResponse *resp, JSONWriter *json, i32 res) {
+    if (resp->chunked) {
+        jsonw_finish(json);
+        // Without its last chunk, the client can tell that the response is incomplete
+        if (resp->failed || !pending_write(resp->con_state, "0\r\n\r\n", strlen("0\r\n\r\n")))
+            resp->con_state->keepAlive = false;
+    } else {
+        // Everything the handler wrote (if anything) is still in the buffer
+        if (json->len > 0)
+            json->buf[json->len] = '\0'; // The writer always leaves room for this
+        send_response(resp->con_state, api_res_to_http_status(res), TYPE_JSON, json->len > 0 ? json->buf : "{}", NULL);
     }
-    tcp_write(pcb, resp, strlen(resp), TCP_WRITE_FLAG_COPY);
-    free(resp);
+    return res < 500;
+}
+
+/* --- API handlers --- */
+
+// Runs the API command served on the requested route (see sys/api/cmds/cmds.h), sending its output as it's written
+static bool handle_api_v1(TCPConnection *con_state, const HTTPRequest *req, u8 method) {
+    char buf[CHUNK_XFER_SIZE];
+    JSONResponse resp = {.con_state = con_state};
+    JSONWriter json;
+    jsonw_init_sink(&json, buf, sizeof(buf), send_json_chunk, &resp);
+    i32 res = api_exec_http(req->target + strlen(API_V1_PATH), method, req->body, &json);
+    return send_json_response(&resp, &json, res);
+}
+
+// Opens a telemetry event stream, e.g. GET /api/v1/stream?channels=aahrs,gps&rate=10.
+// The connection is left open; it is subscribed by tcp_server_periodic() and receives one "data:" event per update.
+static bool handle_api_v1_stream(TCPConnection *con_state, const char *uri) {
+    char value[64];
+    u8 channels = http_get_query(uri, "channels", value, sizeof(value)) ? stream_parse_channels(value) : 0;
+    u32 rate = http_get_query(uri, "rate", value, sizeof(value)) ? strtoul(value, NULL, 10) : 0;
+    if (channels == 0) {
+        send_response(con_state, "400 Bad Request", TYPE_JSON, "{}", NULL);
+        return true;
+    }
+    EventStream *stream = NULL;
+    for (u32 i = 0; i < STREAM_CLIENTS_MAX; i++) {
+        if (eventStreams[i].state == EVENT_STREAM_FREE) {
+            stream = &eventStreams[i];
+            break;
+        }
+    }
+    if (!stream) {
+        send_response(con_state, "409 Conflict", TYPE_JSON, "{}", NULL);
+        return true;
+    }
+    stream->pcb = con_state->pcb;
+    stream->con_state = con_state;
+    stream->channels = channels;
+    stream->rate = rate;
+    stream->state = EVENT_STREAM_STARTING;
+    con_state->stream = stream;
+    con_state->keepAlive = false; // The stream lasts until the connection closes
+    char head[HTTP_RESPONSE_HEAD_MAX];
+    u32 headLen = http_format_head(head, sizeof(head), "200 OK", TYPE_EVENT_STREAM, HTTP_STREAM, false,
+                                   "Cache-Control: no-cache\r\n");
+    tcp_nagle_disable(con_state->pcb); // Updates are small and should arrive as soon as they're sent
+    tcp_write(con_state->pcb, head, headLen, TCP_WRITE_FLAG_COPY);
+    tcp_output(con_state->pcb);
     return true;
-    (void)con_state;
-    (void)req;
 }
 
 // Generic GET handler.
 // Fetches the content requested by a GET request from littlefs and responds with the content.
 // Will be called by the TCP server when a GET request is received that doesn't match any of the API paths.
-static bool handle_common_get(TCPConnection *con_state, struct tcp_pcb *pcb, const char *req) {
+static bool handle_common_get(TCPConnection *con_state, const HTTPRequest *req) {
     // This function is very similar to the esp32's handle_common_get, so take a look at that for more details/documentation
-    char *uri = extract_uri(req, HTTP_GET);
-    size_t pathSize = strlen(uri) + strlen("/www") + strlen("index.html") + strlen(".gz");
-    char *path = malloc(pathSize);
-    if (!path) {
-        free(uri);
-        tcp_write(pcb, HEADER_500, strlen(HEADER_500), 0);
+    const WWWFile *file = www_find(req->target);
+    if (!file)
         return false;
+    LWIP_DEBUGF(TCP_DEBUG, ("handle_common_get: GET path: %s\n", file->path));
+    char extra[128];
+    snprintf(extra, sizeof(extra), "ETag: %s\r\nCache-Control: %s\r\n%s", file->etag, www_cache_control(file),
+             file->gzipped ? "Content-Encoding: gzip\r\n" : "");
+    char head[HTTP_RESPONSE_HEAD_MAX];
+
+    // The client already has the file cached, so there's no need to send it again
+    if (www_not_modified(file, http_get_header(req, "If-None-Match"))) {
+        u32 headLen =
+            http_format_head(head, sizeof(head), "304 Not Modified", NULL, HTTP_NO_BODY, con_state->keepAlive, extra);
+        tcp_write(con_state->pcb, head, headLen, TCP_WRITE_FLAG_COPY);
+        return true;
     }
-    strcpy(path, "/www");
-    if (uri[strlen(uri) - 1] == '/')
-        strlcat(path, "/index.html", pathSize);
-    else
-        strlcat(path, uri, pathSize);
-    free(uri);
-    LWIP_DEBUGF(TCP_DEBUG, ("handle_common_get: GET path: %s\n", path));
-
-    bool gzipped = false;
-    lfs_file_t file;
-    i32 err;
-    for (u32 i = 0; i < 2; i++) {
-        err = lfs_file_open(&wwwfs, &file, path, LFS_O_RDONLY);
-        if (err == LFS_ERR_NOENT && !gzipped) {
-            strcat(path, ".gz");
-            gzipped = true;
-            continue;
-        }
-        break;
-    }
-    if (err != LFS_ERR_OK) {
-        LWIP_DEBUGF(TCP_DEBUG, ("handle_common_get: file %s not found\n", path));
-        free(path);
-        return false;
-    } else
-        lfs_file_close(&wwwfs, &file);
 
     // Create a state object to keep track of the file transfer
-    // This is because the transfer happens in chunks, and later chunks are handled in the tcp_server_sent callback,
-    // so it needs to know the file path and the current offset in the file to continue sending the file
-    con_state->state = malloc(sizeof(FileState));
-    if (!con_state->state) {
-        lfs_file_close(&wwwfs, &file);
-        free(path);
-        tcp_write(pcb, HEADER_500, strlen(HEADER_500), 0);
-        return false;
+    // This is because the transfer happens in chunks, and later chunks are sent from the tcp_server_sent callback as earlier
+    // ones are acknowledged, so the file stays open until the entire file is sent
+    FileState *state = calloc(1, sizeof(FileState));
+    if (!state) {
+        con_state->keepAlive = false;
+        send_response(con_state, "500 Internal Server Error", NULL, NULL, NULL);
+        return true;
     }
-    FileState *state = (FileState *)con_state->state;
-    state->path = strdup(path);
-    state->offset = 0;
-
-    // Construct and send the HTTP header
-    char header[512] = "HTTP/1.1 200 OK\r\n";
-    if (gzipped) {
-        path[strlen(path) - 3] = '\0';
-        strcat(header, "Content-Encoding: gzip\r\n");
-    }
-    strcat(header, "Content-Type: ");
-    strcat(header, get_content_type(path));
-    strcat(header, "\r\n");
-    strcat(header, "Transfer-Encoding: chunked\r\n");
-    strcat(header, "\r\n");
-    LWIP_DEBUGF(TCP_DEBUG, ("handle_common_get: sending header:\n%s\n", header));
-    tcp_write(pcb, header, strlen(header), 0);
-
-    // Send the first chunk of the file
-    // As mentioned earlier, subsequent chunks will be sent in the tcp_server_sent callback until the entire file is sent
-    i32 sent = send_file_chunk(con_state, pcb, state->path, state->offset);
-    if (sent <= 0) {
-        free(state->path);
+    char path[WWW_PATH_MAX + sizeof(WWW_ROOT) + sizeof(".gz")];
+    if (!www_fs_path(file, path, sizeof(path)) || lfs_file_open(&wwwfs, &state->file, path, LFS_O_RDONLY) != LFS_ERR_OK) {
+        LWIP_DEBUGF(TCP_DEBUG, ("handle_common_get: file %s not found\n", path));
         free(state);
-        free(path);
         return false;
     }
-    state->offset += sent;
+    state->pcb = con_state->pcb;
+    state->next = fileTransfers;
+    fileTransfers = state;
+    con_state->file = state;
 
-    free(path);
-    return true;
+    // Construct and send the HTTP header
+    u32 headLen = http_format_head(head, sizeof(head), "200 OK", file->type, HTTP_CHUNKED, con_state->keepAlive, extra);
+    LWIP_DEBUGF(TCP_DEBUG, ("handle_common_get: sending header:\n%s\n", head));
+    tcp_write(con_state->pcb, head, headLen, TCP_WRITE_FLAG_COPY);
+    file_transfer_push(state, NULL, headLen);
+
+    // Send as much of the file as fits into the send window
+    // As mentioned earlier, the rest is sent from the tcp_server_sent callback until the entire file is sent
+    return file_transfer_fill(state);
 }
 
 /* --- High-level request handling --- */
 
-static bool handle_request(TCPConnection *con_state, struct tcp_pcb *pcb, const char *request) {
+/**
+ * Responds to a request.
+ * @param con_state the connection state data
+ * @param req the request
+ * @return false if the connection should be closed
+ */
+static bool handle_request(TCPConnection *con_state, const HTTPRequest *req) {
     bool res = false;
-    char *uri = NULL;
+    con_state->keepAlive = req->keepAlive;
+    LWIP_DEBUGF(TCP_DEBUG, ("handle_request: %d %s\n", req->method, req->target));
+    bool api = strncmp(req->target, API_V1_PATH, strlen(API_V1_PATH)) == 0;
     // Filter by request type
-    if (strncmp(HTTP_GET, request, strlen(HTTP_GET)) == 0) {
+    if (req->method == HTTP_METHOD_GET) {
         // Filter based on the URI
-        uri = extract_uri(request, HTTP_GET);
-        if (!uri) {
-            tcp_write(pcb, HEADER_500, strlen(HEADER_500), 0);
-            return false;
-        }
-        LWIP_DEBUGF(TCP_DEBUG, ("handle_request: GET URI: %s\n", uri));
-        if (strncmp(uri, API_V1_PATH, strlen(API_V1_PATH)) == 0) {
-            if (strcmp(uri + strlen(API_V1_PATH), "get/config") == 0)
-                res = handle_api_v1_get_config(con_state, pcb, request);
-            else if (strcmp(uri + strlen(API_V1_PATH), "get/info") == 0)
-                res = handle_api_v1_get_info(con_state, pcb, uri);
-            else if (strcmp(uri + strlen(API_V1_PATH), "ping") == 0)
-                res = handle_api_v1_ping(con_state, pcb, request);
+        if (api) {
+            const char *route = req->target + strlen(API_V1_PATH);
+            if (strcmp(route, "stream") == 0 || strncmp(route, "stream?", strlen("stream?")) == 0)
+                res = handle_api_v1_stream(con_state, req->target);
+            else
+                res = handle_api_v1(con_state, req, API_HTTP_GET);
         } else {
             // No other requests mathed, so it's probably a request for a file
-            res = handle_common_get(con_state, pcb, request);
-        }
-    } else if (strncmp(HTTP_POST, request, strlen(HTTP_POST)) == 0) {
-        uri = extract_uri(request, HTTP_POST);
-        if (!uri) {
-            tcp_write(pcb, HEADER_500, strlen(HEADER_500), 0);
-            return false;
-        }
-        LWIP_DEBUGF(TCP_DEBUG, ("handle_request: POST URI: %s\n", uri));
-        if (strncmp(uri, API_V1_PATH, strlen(API_V1_PATH)) == 0) {
-            if (strcmp(uri + strlen(API_V1_PATH), "get/config") == 0)
-                // GET_CONFIG can also be called with a POST request (in addition to a GET request, handled above)
-                res = handle_api_v1_get_config(con_state, pcb, request);
-            else if (strcmp(uri + strlen(API_V1_PATH), "set/config") == 0)
-                res = handle_api_v1_set_config(con_state, pcb, request);
-            else if (strcmp(uri + strlen(API_V1_PATH), "set/flightplan") == 0)
-                res = handle_api_v1_set_flightplan(con_state, pcb, request);
+            res = handle_common_get(con_state, req);
         }
+    } else if (req->method == HTTP_METHOD_POST) {
+        if (api)
+            res = handle_api_v1(con_state, req, API_HTTP_POST);
     }
-    free(uri);
-    if (!res) {
+    if (!res && !con_state->file) {
         // Redirect the client to the index page; this provides the captive portal behavior
-        char header[sizeof(HEADER_302) + 32] = "";
-        snprintf(header, sizeof(header), HEADER_302, ipaddr_ntoa(con_state->ip));
-        tcp_write(pcb, header, strlen(header), 0);
+        char location[48];
+        snprintf(location, sizeof(location), "Location: http://%s/\r\n", ipaddr_ntoa(con_state->ip));
+        send_response(con_state, "302 Redirect", NULL, NULL, location);
+        return con_state->keepAlive;
     }
     return res;
 }
@@ -408,47 +540,114 @@ static err_t tcp_close_client_connection(TCPConnection *con_state, struct tcp_pc
     if (client_pcb) {
         assert(con_state && con_state->pcb == client_pcb);
         LWIP_DEBUGF(TCP_DEBUG, ("client disconnected, reason: %d\n", close_err));
+        if (con_state->stream) {
+            // The stream is unsubscribed later, from the main loop
+            con_state->stream->pcb = NULL;
+            con_state->stream->state = EVENT_STREAM_CLOSED;
+        }
         // Unregister callbacks and close the connection
         tcp_arg(client_pcb, NULL);
         tcp_poll(client_pcb, NULL, 0);
         tcp_sent(client_pcb, NULL);
         tcp_recv(client_pcb, NULL);
         tcp_err(client_pcb, NULL);
-        err_t err = tcp_close(client_pcb);
-        if (err != ERR_OK) {
-            // Failed to gracefully close the connection, we must abort
-            LWIP_DEBUGF(TCP_DEBUG, ("close failed (%d), aborting!\n", err));
+        if (con_state->file && file_transfer_in_flight(con_state->file)) {
+            // lwIP would keep sending from the transfer's buffers after a graceful close, but they're about to be released
             tcp_abort(client_pcb);
             close_err = ERR_ABRT;
+        } else {
+            err_t err = tcp_close(client_pcb);
+            if (err != ERR_OK) {
+                // Failed to gracefully close the connection, we must abort
+                LWIP_DEBUGF(TCP_DEBUG, ("close failed (%d), aborting!\n", err));
+                tcp_abort(client_pcb);
+                close_err = ERR_ABRT;
+            }
         }
-        if (con_state)
-            free(con_state);
+        if (con_state->file)
+            file_transfer_end(con_state->file);
+        if (con_state->rx)
+            pbuf_free(con_state->rx);
+        pending_free(con_state);
+        http_parser_reset(&con_state->parser);
+        *con_state = (TCPConnection){0}; // Free for the next client
     }
     return close_err;
 }
 
+/**
+ * Parses and responds to the requests received on a connection, in order, for as long as the connection is free to respond
+ * (i.e. isn't still sending a file).
+ * @param con_state the connection state data
+ * @return the error to return from the lwIP callback (ERR_ABRT if the connection was aborted)
+ */
+static err_t tcp_server_process(TCPConnection *con_state) {
+    struct tcp_pcb *pcb = con_state->pcb;
+    while (con_state->rx && !con_state->file && !con_state->stream && !con_state->pending) {
+        // Parse across the received pbuf chain until a request is complete, leaving anything after it for later
+        u32 used = 0;
+        for (struct pbuf *q = con_state->rx; q; q = q->next) {
+            u32 n = http_parse(&con_state->parser, (const char *)q->payload, q->len);
+            used += n;
+            if (n < q->len)
+                break;
+        }
+        con_state->rx = pbuf_free_header(con_state->rx, (u16_t)used);
+        tcp_recved(pcb, (u16_t)used); // Only parsed data opens the receive window, so a busy connection slows its client down
+
+        HTTPParser *parser = &con_state->parser;
+        if (parser->state == HTTP_PARSE_ERROR) {
+            con_state->keepAlive = false;
+            send_response(con_state, api_res_to_http_status(parser->error), NULL, NULL, NULL);
+            return tcp_close_client_connection(con_state, pcb, ERR_OK);
+        }
+        if (parser->state != HTTP_PARSE_DONE)
+            break; // Wait for the rest of the request
+        bool res = handle_request(con_state, &parser->request);
+        http_parser_reset(parser);
+        if (!res || (!con_state->keepAlive && !con_state->file && !con_state->stream && !con_state->pending)) {
+            tcp_output(pcb);
+            return tcp_close_client_connection(con_state, pcb, ERR_OK);
+        }
+    }
+    tcp_output(pcb);
+    return ERR_OK;
+}
+
 // lwIP callback. Will be called when TCP data has been successfully sent.
 static err_t tcp_server_sent(void *arg, struct tcp_pcb *pcb, u16_t len) {
     TCPConnection *con_state = (TCPConnection *)arg;
     LWIP_DEBUGF(TCP_DEBUG, ("tcp_server_sent %d\n", len));
-
-    // There is an ongoing send operation
-    if (con_state->state) {
-        FileState *state = (FileState *)con_state->state;
-        // Continue sending the file
-        i32 sent = send_file_chunk(con_state, pcb, state->path, state->offset);
-        if (sent <= 0) {
-            free(state->path);
-            free(state);
+    con_state->idlePolls = 0;
+
+    // There is an ongoing file transfer
+    if (con_state->file) {
+        FileState *state = con_state->file;
+        file_transfer_acked(state, len);
+        if (state->done && state->count == 0) {
+            // Everything was acknowledged, so the connection can move on to the next request (if it's kept alive)
+            if (!con_state->keepAlive)
+                return tcp_close_client_connection(con_state, pcb, ERR_OK);
+            file_transfer_end(state);
+            con_state->file = NULL;
+            return tcp_server_process(con_state);
         }
-        if (sent < 0)
+        // Refill the send window, and let any other transfers use the buffers that were just released
+        if (!file_transfer_fill(state))
             return tcp_close_client_connection(con_state, pcb, ERR_ABRT);
-        else if (sent == 0) {
-            tcp_write(pcb, "0\r\n\r\n", strlen("0\r\n\r\n"), 0); // Send a zero-length chunk to indicate the end of the transfer
-            tcp_output(pcb);                                     // Flush output buffer
+        file_transfers_resume(state);
+    }
+
+    // Part of an API response is still waiting to be sent
+    if (con_state->pending) {
+        pending_flush(con_state);
+        tcp_output(pcb);
+        if (con_state->pending)
+            return ERR_OK;
+        // Everything was queued, so the connection can move on to the next request (if it's kept alive)
+        if (!con_state->keepAlive)
             return tcp_close_client_connection(con_state, pcb, ERR_OK);
-        }
-        state->offset += sent;
+        return tcp_server_process(con_state);
     }
 
     return ERR_OK;
@@ -458,52 +657,68 @@ static err_t tcp_server_sent(void *arg, struct tcp_pcb *pcb, u16_t len) {
 // This is also where we send data back to the client.
 static err_t tcp_server_recv(void *arg, struct tcp_pcb *pcb, struct pbuf *p, err_t err) {
     TCPConnection *con_state = (TCPConnection *)arg;
-    if (!p || p->tot_len <= 0)
-        return tcp_close_client_connection(con_state, pcb, ERR_OK);
+    if (!p)
+        return tcp_close_client_connection(con_state, pcb, ERR_OK); // The client closed the connection
     assert(con_state && con_state->pcb == pcb);
+    if (err != ERR_OK) {
+        pbuf_free(p);
+        return tcp_close_client_connection(con_state, pcb, err);
+    }
 
     LWIP_DEBUGF(TCP_DEBUG, ("tcp_server_recv %d err %d\n", p->tot_len, err));
     for (struct pbuf *q = p; q != NULL; q = q->next)
         LWIP_DEBUGF(TCP_INPUT_DEBUG, ("in: %.*s\n\n\n", q->len, (char *)q->payload));
+    con_state->idlePolls = 0;
 
-    // Transfer the received data from the pbuf to our buffer
-    char *received = malloc(p->tot_len + 1);
-    if (!received) {
-        LWIP_DEBUGF(TCP_DEBUG, ("ERROR: failed to allocate received buffer\n"));
-        goto close;
-    }
-    pbuf_copy_partial(p, (void *)received, p->tot_len, 0);
-    received[p->tot_len] = '\0';
-
-    bool res = handle_request(con_state, pcb, received);
-    tcp_recved(pcb, p->tot_len);
-    pbuf_free(p);
-    if (!res)
-        goto close;
-
-    if (received)
-        free(received);
-    return ERR_OK;
-close:
-    if (received)
-        free(received);
-    return tcp_close_client_connection(con_state, pcb, err);
+    // Queue the data behind anything that hasn't been parsed yet; it's parsed straight out of the pbufs
+    if (con_state->rx)
+        pbuf_cat(con_state->rx, p);
+    else
+        con_state->rx = p;
+    return tcp_server_process(con_state);
 }
 
 // lwIP callback. Will be called when a connection is idle and needs to be polled.
 static err_t tcp_server_poll(void *arg, struct tcp_pcb *pcb) {
     TCPConnection *con_state = (TCPConnection *)arg;
     LWIP_DEBUGF(TCP_DEBUG, ("tcp server polling\n"));
+    if (con_state->stream)
+        return ERR_OK; // Event streams are expected to be quiet in the client's direction
+    if (con_state->pending) {
+        // Retry anything that couldn't be queued earlier
+        pending_flush(con_state);
+        tcp_output(pcb);
+    }
+    FileState *file = con_state->file;
+    if (file && file->progressed) {
+        // Still transferring; this also retries anything that couldn't be queued earlier
+        file->progressed = false;
+        if (file_transfer_fill(file))
+            return ERR_OK;
+    } else if (!file && ++con_state->idlePolls < IDLE_POLLS_MAX)
+        return ERR_OK; // Kept alive, waiting for the next request
     return tcp_close_client_connection(con_state, pcb, ERR_OK);
 }
 
 // lwIP callback. Will be called when an error occurs on the connection.
 static void tcp_server_err(void *arg, err_t err) {
     TCPConnection *con_state = (TCPConnection *)arg;
-    if (err != ERR_ABRT) {
-        LWIP_DEBUGF(TCP_DEBUG, ("ERROR: %d\n", err));
-        tcp_close_client_connection(con_state, con_state->pcb, err);
+    LWIP_DEBUGF(TCP_DEBUG, ("ERROR: %d\n", err));
+    if (!con_state)
+        return;
+    // The pcb (and everything it had queued) has already been freed by lwIP, so only our side of the connection is left
+    if (con_state->file)
+        file_transfer_end(con_state->file);
+    if (con_state->stream) {
+        // Make sure the stream stops writing to the pcb
+        con_state->stream->pcb = NULL;
+        con_state->stream->state = EVENT_STREAM_CLOSED;
     }
+    if (con_state->rx)
+        pbuf_free(con_state->rx);
+    pending_free(con_state);
+    http_parser_reset(&con_state->parser);
+    *con_state = (TCPConnection){0};
 }
 
 // lwIP callback. Will be called when a new connection is to be accepted.
@@ -515,15 +730,21 @@ static err_t tcp_server_accept(void *arg, struct tcp_pcb *client_pcb, err_t err)
         return ERR_VAL;
     }
 
-    // Create some data to help keep track of the connection
-    TCPConnection *con_state = calloc(1, sizeof(TCPConnection));
+    // Take a free connection from the pool to keep track of the connection
+    TCPConnection *con_state = NULL;
+    for (u32 i = 0; i < count_of(connections); i++) {
+        if (!connections[i].pcb) {
+            con_state = &connections[i];
+            break;
+        }
+    }
     if (!con_state) {
-        LWIP_DEBUGF(TCP_DEBUG, ("ERROR: failed to allocate connection state\n"));
-        return ERR_MEM;
+        LWIP_DEBUGF(TCP_DEBUG, ("ERROR: too many connections\n"));
+        tcp_abort(client_pcb);
+        return ERR_ABRT;
     }
-    con_state->pcb = client_pcb;
-    con_state->ip = &state->ip;
-    con_state->state = NULL;
+    *con_state = (TCPConnection){.pcb = client_pcb, .ip = &state->ip};
+    http_parser_init(&con_state->parser);
 
     // Set up callbacks
     tcp_arg(client_pcb, con_state);
@@ -550,7 +771,7 @@ bool tcp_server_open(TCPServer *state, ip_addr_t *ip, u16 port) {
         LWIP_DEBUGF(TCP_DEBUG, ("ERROR: failed to bind PCB\n"));
         return false;
     }
-    state->server_pcb = tcp_listen_with_backlog(tempPcb, 1);
+    state->server_pcb = tcp_listen_with_backlog(tempPcb, TCP_CONNECTIONS_MAX);
     state->ip = *ip;
     if (!state->server_pcb) {
         LWIP_DEBUGF(TCP_DEBUG, ("ERROR: failed to listen\n"));
@@ -567,11 +788,54 @@ bool tcp_server_open(TCPServer *state, ip_addr_t *ip, u16 port) {
 bool tcp_server_close(TCPServer *state) {
     if (state->server_pcb) {
         tcp_arg(state->server_pcb, NULL);
-        if (!tcp_close(state->server_pcb) != ERR_OK)
+        if (tcp_close(state->server_pcb) != ERR_OK)
             return false;
         state->server_pcb = NULL;
     }
     return true;
 }
 
+// Stream write callback, called from the main loop
+static bool event_stream_write(const char *json, u32 len, void *ctx) {
+    EventStream *stream = (EventStream *)ctx;
+    bool written = false;
+    cyw43_arch_lwip_begin();
+    // Events that don't fit in the send buffer are dropped rather than waited for, so a slow client can't stall the loop
+    if (stream->pcb && tcp_sndbuf(stream->pcb) >= len + strlen("data: \n\n")) {
+        written = tcp_write(stream->pcb, "data: ", strlen("data: "), 0) == ERR_OK &&
+                  tcp_write(stream->pcb, json, len, TCP_WRITE_FLAG_COPY) == ERR_OK &&
+                  tcp_write(stream->pcb, "\n\n", strlen("\n\n"), 0) == ERR_OK;
+        tcp_output(stream->pcb);
+    }
+    cyw43_arch_lwip_end();
+    return written;
+}
+
+void tcp_server_periodic() {
+    for (u32 i = 0; i < STREAM_CLIENTS_MAX; i++) {
+        EventStream *stream = &eventStreams[i];
+        switch (stream->state) {
+            case EVENT_STREAM_STARTING:
+                stream->client = (StreamClient){.format = STREAM_FORMAT_JSON, .write = event_stream_write, .ctx = stream};
+                if (stream_subscribe(&stream->client, stream->channels, stream->rate)) {
+                    stream->state = EVENT_STREAM_ACTIVE;
+                    break;
+                }
+                // Too many clients are subscribed (e.g. over the serial or binary API), so turn this one away
+                cyw43_arch_lwip_begin();
+                if (stream->pcb)
+                    tcp_close_client_connection(stream->con_state, stream->pcb, ERR_OK);
+                cyw43_arch_lwip_end();
+                stream->state = EVENT_STREAM_FREE;
+                break;
+            case EVENT_STREAM_CLOSED:
+                stream_unsubscribe(&stream->client);
+                stream->state = EVENT_STREAM_FREE;
+                break;
+            default:
+                break;
+        }
+    }
+}
+
 #endif // PLATFORM_SUPPORTS_WIFI
@@ -9,8 +9,11 @@
 #include <stdbool.h>
 #include "lwip/ip_addr.h"
 
+#include "platform/common/http.h"
 #include "platform/types.h"
 
+#define TCP_CONNECTIONS_MAX 4 // Connections the web server keeps open at once (browsers reuse them for every request)
+
 // clang-format on
 
 typedef struct TCPServer {
@@ -19,9 +22,16 @@ typedef struct TCPServer {
 } TCPServer;
 
 typedef struct TCPConnection {
-    struct tcp_pcb *pcb;
+    struct tcp_pcb *pcb; // NULL if the connection is free
     ip_addr_t *ip;
-    void *state;
+    HTTPParser parser;
+    struct pbuf *rx;            // Data received but not yet parsed (e.g. pipelined requests), or NULL
+    bool keepAlive;             // Whether the connection stays open after the current response
+    u8 idlePolls;               // Polls since anything was last received or acknowledged
+    struct FileState *file;     // Set while a file is being sent
+    struct EventStream *stream; // Set if the connection is a telemetry event stream
+    char *pending;              // Part of a response that didn't fit into the send buffer yet, or NULL
+    u32 pendingLen, pendingSent;
 } TCPConnection;
 
 /**
@@ -40,4 +50,10 @@ bool tcp_server_open(TCPServer *state, ip_addr_t *ip, u16 port);
  */
 bool tcp_server_close(TCPServer *state);
 
+/**
+ * Subscribes and unsubscribes the server's telemetry event streams (GET /api/v1/stream).
+ * @note This must be called periodically from the main loop, as subscriptions can only be changed from there.
+ */
+void tcp_server_periodic();
+
 #endif // PLATFORM_SUPPORTS_WIFI
@@ -13,11 +13,13 @@
 #include "lwip/ip_addr.h"
 #include "pico/cyw43_arch.h"
 
+#include "binapi.h"
 #include "dhcp.h"
 #include "dns.h"
 #include "tcp.h"
 
 #define TCP_PORT 80
+#define BINAPI_PORT 5760
 
 // clang-format on
 
@@ -44,16 +46,22 @@ bool wifi_setup(const char *ssid, const char *pass) {
         return false;
     if (!dns_server_init(&dns, &gateway))
         return false;
+    if (!binapi_server_open(&gateway, BINAPI_PORT))
+        return false;
     return tcp_server_open(&server, &gateway, TCP_PORT);
 }
 
 void wifi_periodic() {
-    return; // Nothing to do, all wifi tasks are handled in the background through interrupts
+    // Networking is handled in the background through interrupts; only binary API frames (which run commands) and stream
+    // subscriptions (which may only change on the main loop) are handled here
+    binapi_server_poll();
+    tcp_server_periodic();
 }
 
 bool wifi_disable() {
     if (!tcp_server_close(&server))
         return false;
+    binapi_server_close();
     dns_server_deinit(&dns);
     dhcp_server_deinit(&dhcp);
     cyw43_arch_disable_ap_mode();
@@ -19,13 +19,30 @@
 void stdio_setup();
 
 /**
- * Reads a line from the stdin, if available.
- * @return A pointer to the line read if there was one (automatically null-terminated),
- *         or NULL if there was no input available.
- * @note This function does not free the memory allocated for the line if read, ensure to free() it after use.
+ * Reads a line from the stdin, if available. This must never block.
+ * @return A pointer to the line read if there was one (automatically null-terminated, without its line ending),
+ *         or NULL if there was no complete line available.
+ * @note The line belongs to the platform and is only valid until the next call; the caller may modify it but must not free it.
  */
 char *stdin_read();
 
+/**
+ * Reads a zero-delimited packet (see lib/cobs.h) from the stdin, if available. This must never block.
+ * Shares its input with `stdin_read()`; a session uses one or the other depending on which protocol it speaks.
+ * @param len pointer to where the length of the packet should be stored
+ * @return A pointer to the packet read if there was one (without its delimiter), or NULL if there was no complete packet
+ *         available.
+ * @note The packet belongs to the platform and is only valid until the next call; the caller may modify it but must not free it.
+ */
+byte *stdin_read_packet(u32 *len);
+
+/**
+ * Writes raw bytes to all initialized stdout sources, exactly as given (no line ending translation) and without buffering.
+ * @param data the bytes to write
+ * @param len the number of bytes to write
+ */
+void stdout_write(const byte *data, u32 len);
+
 /**
  * A wrapper for the printf() function that outputs to all initialized stdout sources.
  * @param fmt the format string
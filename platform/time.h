@@ -1,16 +1,11 @@
 #pragma once
 
 #include <stdbool.h>
-#include "platform/defs.h"
 #include "platform/types.h"
 
 typedef i32 (*Callback)(void *data);
 
-typedef struct CallbackData {
-    __callback_id_t id;
-    Callback callback;
-    void *data;
-} CallbackData;
+typedef u32 CallbackID; // Identifies a scheduled callback, 0 is never a valid ID
 
 typedef struct Timestamp {
     u64 us;
@@ -26,21 +21,23 @@ u64 time_us();
  * @param ms the number of milliseconds to wait before calling the callback
  * @param callback the callback to call
  * @param data optional data to pass to the callback
- * @return some `CallbackData` that can be used to cancel the callback, or NULL if the callback could not be scheduled
+ * @return the ID of the callback, which can be used to cancel it, or 0 if the callback could not be scheduled
  * @note The Callback function must have the signature `i32 (*)(void *data)`, aka it must return an `i32` and take a void *
  * argument. Within the function, returning a positive value will reschedule the callback in that many milliseconds, and
  * returning 0 will not reschedule the callback. The `data` argument of the function will be the same as the `data` argument
  * passed to this function.
+ * @note Callbacks are run from sys_periodic(), never concurrently with the main loop, and this function should only be
+ * called from the main loop (or a callback) as well.
  */
-CallbackData *callback_in_ms(u32 ms, Callback callback, void *data);
+CallbackID callback_in_ms(u32 ms, Callback callback, void *data);
 
 /**
  * Cancels a callback with the given ID.
  * @param id the ID of the callback to cancel
- * @note This function only works with repeating timers (aka timers that return a positive value in the callback).
- * Attempting to call this function on a non-repeating timer will result in undefined behavior.
+ * @note It is safe to call this function on a callback that has already run or been cancelled (it will do nothing), and from
+ * within the callback itself (it will not be rescheduled).
  */
-void cancel_callback(CallbackData *data);
+void cancel_callback(CallbackID id);
 
 /**
  * Sleeps for `us` microseconds, blocking the current core.
@@ -5,6 +5,7 @@
 
 /**
  * Sets up the given TX and RX pins for UART communication at the given baudrate.
+ * Received data should be buffered from then on (e.g. by an interrupt handler), so that it isn't lost between reads.
  * @param tx the transmit pin to use
  * @param rx the recieve pin to use
  * @param baud the baudrate to run the UART at
@@ -15,20 +16,21 @@
 bool uart_setup(u32 tx, u32 rx, u32 baud);
 
 /**
- * Reads a line from the specifed UART pins, if available.
+ * Reads whatever data has been received on the specified UART pins, up to a maximum length. This must never block.
  * @param tx the transmit pin to use
  * @param rx the recieve pin to use
- * @return A pointer to the line read if there was one (automatically null-terminated),
- *        or NULL if there was no input available.
- * @note This function does not free the memory allocated for the line if read, ensure to free() it after use.
+ * @param buf the buffer to read the data into
+ * @param len the maximum number of bytes to read
+ * @return the number of bytes read, 0 if there was no data available
  */
-char *uart_read(u32 tx, u32 rx);
+u32 uart_read(u32 tx, u32 rx, byte *buf, u32 len);
 
 /**
- * Writes the given string to the specified UART pins.
+ * Writes the given data to the specified UART pins.
  * @param tx the transmit pin to use
  * @param rx the recieve pin to use
- * @param str the string to write
+ * @param data the data to write
+ * @param len the number of bytes to write
  * @return true if the write was successful
  */
-bool uart_write(u32 tx, u32 rx, const char *str);
+bool uart_write(u32 tx, u32 rx, const byte *data, u32 len);
@@ -3,13 +3,17 @@
  * Licensed under the GNU AGPL-3.0
  */
 
+#include <math.h>
 #include <string.h>
 #include "platform/helpers.h"
 #include "platform/i2c.h"
 #include "platform/time.h"
 
+#include "lib/fusion/deadreckon.h"
+#include "lib/fusion/estimator.h"
 #include "lib/fusion/fusion.h"
-#include "lib/fusion/madgwick.h"
+
+#include "io/gps.h"
 
 #include "modes/aircraft.h"
 
@@ -19,23 +23,33 @@
 
 #include "aahrs.h"
 
-// https://ardupilot.org/copter/docs/deadreckoning-failsafe.html
+// Dead reckoning after losing GPS works much like ArduPilot's: https://ardupilot.org/copter/docs/deadreckoning-failsafe.html
 
 static IMU *imu;
-static Madgwick *filter;
+static const Estimator *estimator;
+static void *estimatorState;
+static DeadReckoner dr;
+static u64 lastSample = 0; // Timestamp of the last sample polled from the IMU, in us (FIFO samples come with their dt)
+static u32 lastFix = 0;    // Value of gps.fixes when a fix was last fed into the estimator
+static u64 gpsLatency = 0; // us
 
-// Sensor and fusion parameters
+// Sensor and fusion parameters; the accelerometer and gyroscope ODRs follow the fusion rate
 #define ACC_SCALE 16    // G
-#define ACC_ODR 100     // Output data rate in Hz
 #define GYRO_SCALE 2000 // deg/s
-#define GYRO_ODR 100
-#define MAG_SCALE 12 // gauss
-#define MAG_ODR 100
-#define FUSION_RATE 100 // Hz
-#define FUSION_BETA 0.1 // Madgwick filter beta parameter
+#define MAG_SCALE 12    // gauss
+#define MAG_ODR 100     // Output data rate in Hz
 #define FUSION_CALIBRATION_SAMPLES 5000
 
-// TODO: add magnetometer calibration to fusion (need this before it can be used in the filter)
+#define GRAVITY 9.80665f    // m/s^2
+#define GPS_UERE 2.5f       // GPS ranging error, m (times HDOP gives the horizontal accuracy)
+#define GPS_HACC_DEFAULT 10 // Horizontal accuracy to assume if there is no HDOP, m
+#define M_TO_FT 3.28084f    // Meters to feet conversion constant
+#define KTS_TO_MS 0.514444f // Knots to meters per second conversion constant
+#define NAV_STALE_S 2.f     // Fixes older than this mean the GPS has been lost, s
+#define NAV_SPEED_MIN 1.f   // Below this groundspeed, the track is held instead of following the velocity, m/s
+
+// TODO: add magnetometer calibration to fusion (need this before Madgwick can use it; the EKF already does, but its declination
+// estimate can only absorb a constant heading offset, not hard/soft iron distortion)
 
 bool aahrs_init() {
     // Check the state of any previous calibration
@@ -55,6 +69,14 @@ bool aahrs_init() {
                   (u32)config.sensors[SENSORS_AAHRS_BUS_FREQ] * 1000);
         i2cInitialized = true;
     }
+    // Get the fusion rate, falling back to the default if it was never set (for example, in a config from an older version)
+    f32 rate = config.sensors[SENSORS_FUSION_RATE];
+    if (!(rate >= AAHRS_FUSION_RATE_MIN && rate <= AAHRS_FUSION_RATE_MAX)) {
+        printfbw(aahrs, "invalid fusion rate %f, using %dHz", rate, AAHRS_FUSION_RATE_DEFAULT);
+        rate = AAHRS_FUSION_RATE_DEFAULT;
+    }
+    aahrs.fusionRate = (u32)rate;
+
     imu = fusion_imu_create();
     if (imu == NULL) {
         printfbw(aahrs, "failed to create IMU instance");
@@ -63,7 +85,7 @@ bool aahrs_init() {
 
     AccelerometerOptions accOpts;
     accOpts.scale = ACC_SCALE;
-    accOpts.odr = ACC_ODR;
+    accOpts.odr = aahrs.fusionRate;
     accOpts.no_rst = false;
     if (!fusion_accelerometer_find(imu, &accOpts)) {
         printfbw(aahrs, "failed to create accelerometer instance");
@@ -72,7 +94,7 @@ bool aahrs_init() {
 
     GyroscopeOptions gyroOpts;
     gyroOpts.scale = GYRO_SCALE; // deg/s
-    gyroOpts.odr = GYRO_ODR;
+    gyroOpts.odr = aahrs.fusionRate;
     if (!fusion_gyroscope_find(imu, &gyroOpts)) {
         printfbw(aahrs, "failed to create gyroscope instance");
         return false;
@@ -86,11 +108,42 @@ bool aahrs_init() {
         return false;
     }
 
-    // Set up the Madgwick filter
-    filter = madgwick_create();
-    madgwick_set_params(filter, FUSION_RATE, FUSION_BETA);
+    // Set up the estimator
+    switch ((EstimatorType)config.sensors[SENSORS_ESTIMATOR]) {
+        case ESTIMATOR_EKF:
+            estimator = &estimator_ekf;
+            break;
+        case ESTIMATOR_MADGWICK:
+        default:
+            estimator = &estimator_madgwick;
+            break;
+    }
+    estimatorState = estimator->create(aahrs.fusionRate);
+    if (estimatorState == NULL) {
+        printfbw(aahrs, "failed to create %s estimator", estimator->name);
+        return false;
+    }
+    lastFix = gps.fixes;
+    printfbw(aahrs, "using %s estimator", estimator->name);
+    f32 latency = config.sensors[SENSORS_GPS_LATENCY];
+    if (!(latency >= AAHRS_GPS_LATENCY_MIN && latency <= AAHRS_GPS_LATENCY_MAX))
+        latency = AAHRS_GPS_LATENCY_DEFAULT;
+    gpsLatency = (u64)latency * 1000;
+    dr_reset(&dr);
+    aahrs.nav.valid = false;
     // TODO: load calibration data once saving works
 
+    // Prefer batching samples in the IMU's FIFO if it has one, so that none are lost if an update is late and updates don't
+    // need to keep up with the fusion rate
+    lastSample = 0;
+    if (fusion_fifo_enable(imu, true)) {
+        aahrs.updateRate = aahrs.fusionRate < AAHRS_UPDATE_RATE ? aahrs.fusionRate : AAHRS_UPDATE_RATE;
+        printfbw(aahrs, "using IMU FIFO, fusing at %luHz", aahrs.fusionRate);
+    } else {
+        aahrs.updateRate = aahrs.fusionRate;
+        printfbw(aahrs, "fusing at %luHz", aahrs.fusionRate);
+    }
+
     aahrs.isInitialized = true;
     return true;
 }
@@ -101,30 +154,158 @@ void aahrs_deinit() {
     aahrs.pitch = INFINITY;
     aahrs.yaw = INFINITY;
     aahrs.alt = -1;
-    madgwick_destroy(&filter);
+    aahrs.nav.valid = false;
+    estimator->destroy(estimatorState);
+    estimatorState = NULL;
     fusion_imu_destroy(&imu);
     aahrs.isInitialized = false;
 }
 
-void aahrs_update() {
-    static Timestamp lastUpdate;
-    // Throttle the update rate
-    if (time_since_s(&lastUpdate) < (1.f / FUSION_RATE))
+/**
+ * Feeds a sample into the estimator, converting it from the IMU's frame (X right wing, Y nose, Z up) and units into the
+ * estimator's (see estimator.h).
+ * @param dt time elapsed since the previous sample, s
+ * @param acc accelerometer sample, G
+ * @param gyro gyroscope sample, deg/s
+ * @param mag magnetometer sample, or NULL if there is none
+ * @return true if successful, false if not
+ */
+static bool fuse_sample(f32 dt, const f32 acc[3], const f32 gyro[3], const f32 mag[3]) {
+    EstimatorIMU sample;
+    sample.gyro[0] = radians(gyro[1]);
+    sample.gyro[1] = radians(gyro[0]);
+    sample.gyro[2] = -radians(gyro[2]);
+    // The IMU reads +1G up when level, which is the specific force in the estimator's Z-down frame
+    sample.acc[0] = acc[1] * GRAVITY;
+    sample.acc[1] = acc[0] * GRAVITY;
+    sample.acc[2] = -acc[2] * GRAVITY;
+    if (mag) {
+        sample.mag[0] = mag[1];
+        sample.mag[1] = mag[0];
+        sample.mag[2] = -mag[2];
+    } else
+        memset(sample.mag, 0, sizeof(sample.mag));
+    return estimator->update_imu(estimatorState, dt, &sample);
+}
+
+/**
+ * Drains the IMU's FIFO, feeding every sample into the estimator with the time elapsed since the previous one.
+ * @param acc pointer to where the newest accelerometer sample should be stored
+ * @param gyro pointer to where the newest gyroscope sample should be stored
+ * @param mag magnetometer sample to fuse alongside the first sample, or NULL if there is none
+ * @return the number of samples fused, or -1 on error
+ */
+static i32 fuse_fifo(f32 acc[3], f32 gyro[3], const f32 mag[3]) {
+    IMUSample samples[FUSION_FIFO_BATCH];
+    i32 total = 0, n;
+    do {
+        bool overflow;
+        n = fusion_fifo_read(imu, samples, count_of(samples), &overflow);
+        if (n < 0)
+            return -1;
+        if (overflow)
+            printfbw(aahrs, "IMU FIFO overflowed, samples were lost");
+        // Samples come with the time they cover, which doesn't span any gap left by an overflow
+        for (i32 i = 0; i < n; i++) {
+            bool first = total == 0 && i == 0;
+            fuse_sample(samples[i].dt, samples[i].acc, samples[i].gyro, first ? mag : NULL);
+        }
+        if (n > 0) {
+            memcpy(acc, samples[n - 1].acc, sizeof(samples[n - 1].acc));
+            memcpy(gyro, samples[n - 1].gyro, sizeof(samples[n - 1].gyro));
+        }
+        total += n;
+    } while (n == (i32)count_of(samples));
+    return total;
+}
+
+/**
+ * Takes the latest GPS fix, if there is a new (usable) one, and feeds it into the estimator if the estimator uses GPS.
+ * @param fix pointer to where the fix should be stored
+ * @return true if there was a new (and usable) fix
+ */
+static bool fuse_gps(EstimatorGPS *fix) {
+    if (!gps.is_supported() || gps.fixes == lastFix)
+        return false;
+    lastFix = gps.fixes;
+    if (!aircraft.gpsSafe || gps.sats < 4)
+        return false;
+    fix->lat = gps.lat;
+    fix->lng = gps.lng;
+    fix->alt = (f32)gps.alt / M_TO_FT;
+    fix->hasVel = gps.speed >= 0.f && gps.track >= 0.f;
+    if (fix->hasVel) {
+        fix->vel[0] = gps.speed * KTS_TO_MS * cosf(radians(gps.track));
+        fix->vel[1] = gps.speed * KTS_TO_MS * sinf(radians(gps.track));
+    }
+    fix->hAcc = gps.hdop > 0.f ? gps.hdop * GPS_UERE : GPS_HACC_DEFAULT;
+    if (estimator->update_gps)
+        estimator->update_gps(estimatorState, fix);
+    return true;
+}
+
+/**
+ * Propagates the navigation state up to the present, and corrects it with a new GPS fix if there is one.
+ * @param pitch the estimated pitch, rad
+ * @param yaw the estimated heading, rad
+ * @param acc newest accelerometer sample, G
+ * @param fix the new GPS fix, or NULL if there is none
+ */
+static void update_nav(f32 pitch, f32 yaw, const f32 acc[3], const EstimatorGPS *fix) {
+    u64 now = time_us();
+    // The IMU's Y axis is the nose (see fuse_sample())
+    dr_predict(&dr, now, yaw, pitch, acc[1] * GRAVITY);
+    if (fix)
+        dr_fix(&dr, now, gpsLatency, fix->lat, fix->lng, fix->alt, fix->hasVel ? fix->vel : NULL);
+
+    f32 alt, vel[3];
+    if (!dr_get(&dr, &aahrs.nav.lat, &aahrs.nav.lng, &alt, vel)) {
+        aahrs.nav.valid = false;
         return;
+    }
+    aahrs.nav.alt = alt * M_TO_FT;
+    f32 speed = sqrtf(vel[0] * vel[0] + vel[1] * vel[1]);
+    aahrs.nav.speed = speed / KTS_TO_MS;
+    if (speed >= NAV_SPEED_MIN) {
+        aahrs.nav.track = degrees(atan2f(vel[1], vel[0]));
+        if (aahrs.nav.track < 0.f)
+            aahrs.nav.track += 360.f;
+    }
+    aahrs.nav.fixAge = dr_fix_age(&dr, now);
+    aahrs.nav.deadReckoning = !aircraft.gpsSafe || aahrs.nav.fixAge > NAV_STALE_S;
+    f32 limit = config.sensors[SENSORS_DEAD_RECKON_TIME];
+    if (limit > 0 && limit <= AAHRS_DEAD_RECKON_MAX)
+        aahrs.nav.valid = aahrs.nav.fixAge <= fmaxf(limit, NAV_STALE_S);
+    else
+        aahrs.nav.valid = !aahrs.nav.deadReckoning; // Without dead reckoning, the state is only good while fixes keep coming
+}
 
+void aahrs_update() {
     f32 acc[3], gyro[3], mag[3];
-    fusion_accelerometer_get(imu, &acc[0], &acc[1], &acc[2]);
-    fusion_gyroscope_get(imu, &gyro[0], &gyro[1], &gyro[2]);
-    fusion_magnetometer_get(imu, &mag[0], &mag[1], &mag[2]);
-
-    madgwick_update(filter, radians(gyro[0]), radians(gyro[1]), radians(gyro[2]), acc[0], acc[1], acc[2], 0.f, 0.f, 0.f);
-    // FIXME: For when magnetometer calibration is added:
-    // madgwick_update(filter, radians(gyro[0]), radians(gyro[1]), radians(gyro[2]), acc[0], acc[1], acc[2], mag[0],
-    //                          mag[1], mag[2]);
-    lastUpdate = timestamp_now();
+    if (imu->fifo_enabled) {
+        // The magnetometer isn't in the FIFO, so read it once per update for the estimators that use it
+        bool haveMag = estimator->usesMag && fusion_magnetometer_get(imu, &mag[0], &mag[1], &mag[2]);
+        i32 fused = fuse_fifo(acc, gyro, haveMag ? mag : NULL);
+        if (fused < 0) {
+            printfbw(aahrs, "failed to read IMU FIFO");
+            aircraft.set_aahrs_safe(false);
+            return;
+        }
+        if (fused == 0)
+            return; // No new samples yet
+    } else {
+        fusion_imu_get(imu, acc, gyro, estimator->usesMag ? mag : NULL);
+        // Integrate over the time that actually passed since the last update, not the nominal period
+        u64 now = time_us();
+        f32 dt = lastSample != 0 ? (f32)(now - lastSample) / 1E6f : 1.f / aahrs.fusionRate;
+        lastSample = now;
+        fuse_sample(dt, acc, gyro, estimator->usesMag ? mag : NULL);
+    }
+    EstimatorGPS fix;
+    bool newFix = fuse_gps(&fix);
 
     f32 roll, pitch, yaw;
-    if (!madgwick_get_angles(filter, &roll, &pitch, &yaw)) {
+    if (!estimator->get_attitude(estimatorState, &roll, &pitch, &yaw)) {
         printfbw(aahrs, "failed to get angles");
         aircraft.set_aahrs_safe(false);
         return;
@@ -132,11 +313,15 @@ void aahrs_update() {
     aahrs.roll = degrees(roll);
     aahrs.pitch = degrees(pitch);
     aahrs.yaw = degrees(yaw);
-    // TODO: are the rates pulled from gyro confirmed to be same axes as angles?
-    aahrs.rollRate = gyro[0];
-    aahrs.pitchRate = gyro[1];
-    aahrs.yawRate = gyro[2];
+    // Same frame conversion as in fuse_sample()
+    aahrs.rollRate = gyro[1];
+    aahrs.pitchRate = gyro[0];
+    aahrs.yawRate = -gyro[2];
     memcpy(aahrs.accel, acc, sizeof(aahrs.accel));
+    f32 alt;
+    if (estimator->get_position && estimator->get_position(estimatorState, NULL, NULL, &alt))
+        aahrs.alt = alt * M_TO_FT;
+    update_nav(pitch, yaw, acc, newFix ? &fix : NULL);
 }
 
 bool aahrs_calibrate() {
@@ -148,8 +333,7 @@ bool aahrs_calibrate() {
     f64 ao[3] = {0.0, 0.0, 0.0}, go[3] = {0.0, 0.0, 0.0};
     for (u32 i = 0; i < FUSION_CALIBRATION_SAMPLES; i++) {
         f32 a[3], g[3];
-        fusion_accelerometer_get(imu, &a[0], &a[1], &a[2]);
-        fusion_gyroscope_get(imu, &g[0], &g[1], &g[2]);
+        fusion_imu_get(imu, a, g, NULL);
         ao[0] += a[0];
         ao[1] += a[1];
         ao[2] += a[2];
@@ -191,6 +375,9 @@ AAHRS aahrs = {
     .yawRate = INFINITY,
     .accel = {0.f, 0.f, 0.f},
     .alt = -1,
+    .nav = {.valid = false},
+    .fusionRate = AAHRS_FUSION_RATE_DEFAULT,
+    .updateRate = AAHRS_UPDATE_RATE,
     .init = aahrs_init,
     .deinit = aahrs_deinit,
     .update = aahrs_update,
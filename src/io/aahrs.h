@@ -17,6 +17,29 @@ typedef enum IMUAxis {
     IMU_AXIS_YAW,
 } IMUAxis;
 
+#define AAHRS_UPDATE_RATE 100 // Default rate at which aahrs.update() is expected to be called, in Hz (see `aahrs.updateRate`)
+
+// Range of the fusion rate (which is also the IMU's ODR), in Hz
+#define AAHRS_FUSION_RATE_MIN 50
+#define AAHRS_FUSION_RATE_DEFAULT 100
+#define AAHRS_FUSION_RATE_MAX 1000
+
+// Range of the GPS's latency (time from a fix being measured to it being received) that is compensated for, in ms
+#define AAHRS_GPS_LATENCY_MIN 0
+#define AAHRS_GPS_LATENCY_DEFAULT 100
+#define AAHRS_GPS_LATENCY_MAX 500
+// Range of how long the position is dead reckoned for after GPS is lost, in s (0 disables dead reckoning)
+#define AAHRS_DEAD_RECKON_MIN 0
+#define AAHRS_DEAD_RECKON_DEFAULT 20
+#define AAHRS_DEAD_RECKON_MAX 120
+
+#define ESTIMATOR_MIN ESTIMATOR_MADGWICK
+typedef enum EstimatorType {
+    ESTIMATOR_MADGWICK, // Attitude only
+    ESTIMATOR_EKF,      // Attitude and position, using GPS
+} EstimatorType;
+#define ESTIMATOR_MAX ESTIMATOR_EKF
+
 #define BARO_MODEL_MIN BARO_MODEL_NONE // No barometer is a valid configuration
 typedef enum BaroModel {
     BARO_MODEL_NONE,
@@ -24,6 +47,17 @@ typedef enum BaroModel {
 } BaroModel;
 #define BARO_MODEL_MAX BARO_MODEL_DPS310
 
+// Navigation state, propagated from the GPS's fixes at the AAHRS's update rate (see lib/fusion/deadreckon.h)
+typedef struct AAHRSNav {
+    f64 lat, lng;       // -90 to 90 deg, -180 to 180 deg
+    f32 alt;            // MSL, ft
+    f32 speed;          // Groundspeed, kts
+    f32 track;          // True (NOT magnetic) track, 0 to 360 deg
+    f32 fixAge;         // Time since the last GPS fix was measured, s
+    bool valid;         // Whether the state can be used: there has been a fix, and it isn't older than dead reckoning allows
+    bool deadReckoning; // Whether the GPS has been lost, so the state is only dead reckoned from the last fix
+} AAHRSNav;
+
 typedef bool (*aahrs_init_t)();
 typedef void (*aahrs_deinit_t)();
 typedef void (*aahrs_update_t)();
@@ -31,12 +65,15 @@ typedef bool (*aahrs_calibrate_t)();
 
 // Altitude-Attitude Heading Reference System (AAHRS)
 typedef struct AAHRS {
-    f32 roll, pitch, yaw;             // (Read-only), deg
-    f32 rollRate, pitchRate, yawRate; // (Read-only), deg/s
+    f32 roll, pitch, yaw;             // (Read-only), deg, positive right wing down, nose up, and clockwise (yaw is the heading)
+    f32 rollRate, pitchRate, yawRate; // (Read-only), deg/s, same directions as the angles
     // Note that while roll, pitch, and yaw are guaranteed to be abstracted by AAHRS to indicate the correct axes,
     // accelerations are not. This means that the directions of X, Y, and Z can very between aircraft.
     f32 accel[3];       // [X, Y, Z] (Read-only), g
-    f32 alt;            // (Read-only)
+    f32 alt;            // (Read-only), MSL, ft, or -1 if the estimator does not know it (yet)
+    AAHRSNav nav;       // (Read-only)
+    u32 fusionRate;     // (Read-only), rate at which sensor samples are fused, Hz
+    u32 updateRate;     // (Read-only), rate at which aahrs.update() should be called, Hz
     bool isCalibrated;  // (Read-only)
     bool isInitialized; // (Read-only)
     /**
@@ -49,8 +86,11 @@ typedef struct AAHRS {
      */
     aahrs_deinit_t deinit;
     /**
-     * Polls sensors for updated data and periodically runs the AAHRS fusion algorithm when applicable.
-     * @note This function must be called as often as possible to obtain many sensor readings for the algorithms to work with!
+     * Polls sensors for updated data and runs the AAHRS fusion algorithm.
+     * @note This function should be called at `aahrs.updateRate`. If the IMU has a FIFO, that is `AAHRS_UPDATE_RATE` and
+     * samples taken at the fusion rate are buffered in between calls; otherwise it is the fusion rate itself, as each call only
+     * fuses one sample. Either way, every sample is fused with the time that actually elapsed since the previous one, so late
+     * calls do not throw off the attitude (but without a FIFO, they do skip samples).
      */
     aahrs_update_t update;
     /**
@@ -66,13 +66,10 @@ void esc_enable(u32 pin) {
 }
 
 void esc_set(u32 pin, f32 speed) {
-    // Ensure speed is within range 0-100% and convert from percentage to duty cycle
-    // See servo.c for more information on how the duty cycle is calculated
+    // Ensure speed is within range 0-100% and convert from percentage to pulsewidth (1000-2000μs)
+    // The HAL takes care of converting the pulsewidth to a duty cycle
     speed = clampf(speed, 0, 100);
-    f32 pulsewidth = 1E3f + ((f32)speed / 100.0f) * 1E3f;
-    f32 period = 1E6f / config.general[GENERAL_ESC_HZ];
-    u16 duty = (u16)((pulsewidth / period) * UINT16_MAX);
-    pwm_write_raw(pin, duty);
+    pwm_write_raw(pin, 1E3f + (speed / 100.0f) * 1E3f);
 }
 
 bool esc_calibrate(u32 pin) {
@@ -4,12 +4,13 @@
  */
 
 #include <math.h>
-#include <stdlib.h>
 #include <string.h>
+#include "platform/helpers.h"
 #include "platform/time.h"
 #include "platform/uart.h"
 
-#include "lib/minmea.h"
+#include "lib/nmea.h"
+#include "lib/ubx.h"
 
 #include "modes/aircraft.h"
 #include "modes/flight.h"
@@ -26,9 +27,36 @@
 #define GPS_SAFE_HDOP_THRESHOLD 5
 #define GPS_SAFE_VDOP_THRESHOLD 3
 
-#define M_TO_FT 3.28084f // Meters to feet conversion constant
+#define M_TO_FT 3.28084f    // Meters to feet conversion constant
+#define MS_TO_KTS 1.943844f // Meters per second to knots conversion constant
 
-static inline bool pos_valid(f32 lat, f32 lng) {
+#define READ_CHUNK 64        // Bytes read from the UART at a time
+#define FIX_TIMEOUT_MS 2000 // Without a fix for this long, the GPS is considered lost
+
+// u-blox configuration
+#define UBX_FAST_BAUDRATE 38400 // Lowest baudrate that can carry NAV-PVT and NAV-DOP at 10Hz
+#define UBX_ACK_TIMEOUT_MS 1000
+#define UBX_ACK_ATTEMPTS 3
+
+static NMEAParser nmea;
+static UBXParser ubx;
+static bool hasFix = false;       // Whether the receiver reported a valid (3D) position fix in its last solution
+static bool altUnitsValid = true; // Whether the last GGA sentence gave its altitude in meters
+static Timestamp lastFix;         // When the last fix was received
+
+static inline u32 tx_pin() {
+    return (u32)config.pins[PINS_GPS_TX];
+}
+
+static inline u32 rx_pin() {
+    return (u32)config.pins[PINS_GPS_RX];
+}
+
+static inline GPSCommandType command_type() {
+    return (GPSCommandType)config.sensors[SENSORS_GPS_COMMAND_TYPE];
+}
+
+static inline bool pos_valid(f64 lat, f64 lng) {
     return lat <= 90 && lat >= -90 && lng <= 180 && lng >= -180 && isfinite(lat) && isfinite(lng);
 }
 
@@ -49,106 +77,256 @@ static inline bool dop_valid(f32 pdop, f32 hdop, f32 vdop) {
     return pdop < GPS_SAFE_PDOP_THRESHOLD && hdop < GPS_SAFE_HDOP_THRESHOLD && vdop < GPS_SAFE_VDOP_THRESHOLD;
 }
 
-static inline bool data_valid(f32 lat, f32 lng, i32 alt, f32 speed, f32 track, f32 pdop, f32 hdop, f32 vdop) {
-    return pos_valid(lat, lng) && alt_valid(alt) && speed_valid(speed) && track_valid(track) && dop_valid(pdop, hdop, vdop);
+static inline bool data_valid(f64 lat, f64 lng, i32 alt, f32 speed, f32 track, f32 pdop, f32 hdop, f32 vdop) {
+    return hasFix && pos_valid(lat, lng) && alt_valid(alt) && speed_valid(speed) && track_valid(track) &&
+           dop_valid(pdop, hdop, vdop);
 }
 
-bool gps_init() {
-    printfbw(gps, "initializing uart at baudrate %lu, on pins %lu (tx) and %lu (rx)", (u32)config.sensors[SENSORS_GPS_BAUDRATE],
-             (u32)config.pins[PINS_GPS_TX], (u32)config.pins[PINS_GPS_RX]);
-    uart_setup((u32)config.pins[PINS_GPS_TX], (u32)config.pins[PINS_GPS_RX], (u32)config.sensors[SENSORS_GPS_BAUDRATE]);
-    printfbw(gps, "configuring...");
-    // Send a command and wait until UART is ready to read, then read back the command response
-    // Useful tool for calculating command checksums: https://nmeachecksum.eqth.net/
-    printfbw(gps, "setting up query schedule");
-    switch ((GPSCommandType)config.sensors[SENSORS_GPS_COMMAND_TYPE]) {
-        case GPS_COMMAND_TYPE_PMTK:
-            // PMTK manual: https://cdn.sparkfun.com/assets/parts/1/2/2/8/0/PMTK_Packet_User_Manual.pdf
-            // Enable the correct sentences
-            sleep_ms_blocking(1800); // Acknowledgement is a hit or miss without a delay
-            // VTG enabled 5x per fix (for fast track updates), GGA, GSA enabled once per fix
-            uart_write((u32)config.pins[PINS_GPS_TX], (u32)config.pins[PINS_GPS_RX],
-                       "$PMTK314,0,0,5,1,1,0,0,0,0,0,0,0,0,0,0,0,0*2D\r\n");
-            // Check up to 30 sentences or up to 3 seconds for the acknowledgement
-            u8 lines = 0;
-            Timestamp timeout = timestamp_in_ms(3000);
-            while (lines < 30 && !timestamp_reached(&timeout)) {
-                char *line = uart_read((u32)config.pins[PINS_GPS_TX], (u32)config.pins[PINS_GPS_RX]);
-                if (!line)
+/**
+ * Handles a $xxGGA (fix data) sentence.
+ */
+static void handle_gga() {
+    i32 quality;
+    if (!nmea_to_int(nmea_field(&nmea, 6), &quality) || quality == 0) {
+        hasFix = false; // Position fields are empty without a fix
+        return;
+    }
+    f64 lat, lng;
+    f32 alt;
+    i32 sats;
+    if (!nmea_to_coord(nmea_field(&nmea, 2), nmea_field(&nmea, 3), &lat) ||
+        !nmea_to_coord(nmea_field(&nmea, 4), nmea_field(&nmea, 5), &lng) || !nmea_to_float(nmea_field(&nmea, 9), &alt)) {
+        printfbw(gps, "ERROR: failed parsing $xxGGA sentence");
+        hasFix = false;
+        return;
+    }
+    altUnitsValid = strcmp(nmea_field(&nmea, 10), "M") == 0;
+    if (!altUnitsValid) {
+        printfbw(gps, "ERROR: incorrect altitude units!");
+        hasFix = false;
+        return;
+    }
+    gps.lat = lat;
+    gps.lng = lng;
+    gps.alt = (i32)(alt * M_TO_FT);
+    if (nmea_to_int(nmea_field(&nmea, 7), &sats))
+        gps.sats = sats;
+    hasFix = true;
+    lastFix = timestamp_now();
+    gps.fixes++;
+}
+
+/**
+ * Handles a $xxGSA (DOP and active satellites) sentence.
+ */
+static void handle_gsa() {
+    // The DOPs are always the last three fields, after the mode, fix type, and 12 satellite IDs
+    f32 pdop, hdop, vdop;
+    if (!nmea_to_float(nmea_field(&nmea, 15), &pdop) || !nmea_to_float(nmea_field(&nmea, 16), &hdop) ||
+        !nmea_to_float(nmea_field(&nmea, 17), &vdop))
+        return; // Empty without a fix
+    gps.pdop = pdop;
+    gps.hdop = hdop;
+    gps.vdop = vdop;
+}
+
+/**
+ * Handles a $xxVTG (track and ground speed) sentence.
+ */
+static void handle_vtg() {
+    f32 speed, track;
+    if (!nmea_to_float(nmea_field(&nmea, 5), &speed))
+        return;
+    gps.speed = speed;
+    // Some modules leave the track empty when stationary, so keep the last one
+    if (nmea_to_float(nmea_field(&nmea, 1), &track))
+        gps.track = track;
+}
+
+/**
+ * Handles the last complete NMEA sentence.
+ */
+static void handle_nmea() {
+    // Other sentences (and PMTK responses) are simply ignored
+    if (nmea_is(&nmea, "GGA"))
+        handle_gga();
+    else if (nmea_is(&nmea, "GSA"))
+        handle_gsa();
+    else if (nmea_is(&nmea, "VTG"))
+        handle_vtg();
+}
+
+/**
+ * Handles the last complete UBX message.
+ */
+static void handle_ubx() {
+    UBXNavPVT pvt;
+    UBXNavDOP dop;
+    if (ubx_decode_nav_pvt(&ubx, &pvt)) {
+        hasFix = pvt.fixOk && pvt.fixType >= UBX_FIX_3D;
+        if (!hasFix)
+            return;
+        gps.lat = pvt.lat;
+        gps.lng = pvt.lng;
+        gps.alt = (i32)(pvt.hMSL * M_TO_FT);
+        gps.speed = pvt.gSpeed * MS_TO_KTS;
+        gps.track = pvt.headMot;
+        gps.sats = pvt.numSV;
+        lastFix = timestamp_now();
+        gps.fixes++;
+    } else if (ubx_decode_nav_dop(&ubx, &dop)) {
+        gps.pdop = dop.pDOP;
+        gps.hdop = dop.hDOP;
+        gps.vdop = dop.vDOP;
+    }
+}
+
+/**
+ * Parses all data that the GPS has sent since the last call.
+ */
+static void process_input() {
+    byte buf[READ_CHUNK];
+    u32 len;
+    while ((len = uart_read(tx_pin(), rx_pin(), buf, sizeof(buf))) > 0) {
+        for (u32 i = 0; i < len; i++) {
+            if (command_type() == GPS_COMMAND_TYPE_UBX) {
+                if (ubx_feed(&ubx, buf[i]))
+                    handle_ubx();
+            } else if (nmea_feed(&nmea, (char)buf[i])) {
+                handle_nmea();
+            }
+        }
+    }
+}
+
+/**
+ * Sends a UBX message to the GPS and waits for it to be acknowledged, retrying if it isn't.
+ * @param cls the message's class
+ * @param id the message's ID
+ * @param payload the message's payload
+ * @param len the length of the payload
+ * @return true if the message was acknowledged
+ */
+static bool ubx_send(u8 cls, u8 id, const byte *payload, u16 len) {
+    byte frame[UBX_FRAME_OVERHEAD + 8];
+    u32 frameLen = ubx_frame(cls, id, payload, len, frame);
+    for (u32 attempt = 0; attempt < UBX_ACK_ATTEMPTS; attempt++) {
+        uart_write(tx_pin(), rx_pin(), frame, frameLen);
+        Timestamp timeout = timestamp_in_ms(UBX_ACK_TIMEOUT_MS);
+        while (!timestamp_reached(&timeout)) {
+            byte buf[READ_CHUNK];
+            u32 read = uart_read(tx_pin(), rx_pin(), buf, sizeof(buf));
+            for (u32 i = 0; i < read; i++) {
+                if (!ubx_feed(&ubx, buf[i]))
                     continue;
-                printfbw(gps, "response %d: %s", lines, line);
-                bool result =
-                    (strncmp(line, "$PMTK001,314,3*36", 17) == 0); // Acknowledged and successful execution of the command
-                free(line);
-                if (result)
+                i32 ack = ubx_ack(&ubx, cls, id);
+                if (ack == 1)
                     return true;
-                lines++;
+                if (ack == 0) {
+                    printfbw(gps, "ERROR: message %02X %02X was rejected", cls, id);
+                    return false;
+                }
             }
-            if (timestamp_reached(&timeout)) {
-                printfbw(gps, "ERROR: communication with GPS timed out!");
-            } else
-                printfbw(gps, "ERROR: %d responses were checked but none were valid!", lines);
+        }
+    }
+    printfbw(gps, "ERROR: message %02X %02X was not acknowledged", cls, id);
+    return false;
+}
+
+/**
+ * Configures a PMTK-compatible GPS module.
+ * @return true if successful
+ */
+static bool init_pmtk() {
+    // PMTK manual: https://cdn.sparkfun.com/assets/parts/1/2/2/8/0/PMTK_Packet_User_Manual.pdf
+    // Useful tool for calculating command checksums: https://nmeachecksum.eqth.net/
+    sleep_ms_blocking(1800); // Acknowledgement is a hit or miss without a delay
+    // VTG enabled 5x per fix (for fast track updates), GGA, GSA enabled once per fix
+    const char *cmd = "$PMTK314,0,0,5,1,1,0,0,0,0,0,0,0,0,0,0,0,0*2D\r\n";
+    uart_write(tx_pin(), rx_pin(), (const byte *)cmd, strlen(cmd));
+    // Check up to 30 sentences or up to 3 seconds for the acknowledgement
+    u32 sentences = 0;
+    Timestamp timeout = timestamp_in_ms(3000);
+    while (sentences < 30 && !timestamp_reached(&timeout)) {
+        byte buf[READ_CHUNK];
+        u32 len = uart_read(tx_pin(), rx_pin(), buf, sizeof(buf));
+        for (u32 i = 0; i < len; i++) {
+            if (!nmea_feed(&nmea, (char)buf[i]))
+                continue;
+            printfbw(gps, "response %lu: %s,%s,%s", sentences, nmea_field(&nmea, 0), nmea_field(&nmea, 1),
+                     nmea_field(&nmea, 2));
+            // Acknowledged and successful execution of the command
+            if (nmea_is(&nmea, "PMTK001") && strcmp(nmea_field(&nmea, 1), "314") == 0 &&
+                strcmp(nmea_field(&nmea, 2), "3") == 0)
+                return true;
+            handle_nmea();
+            sentences++;
+        }
+    }
+    if (timestamp_reached(&timeout)) {
+        printfbw(gps, "ERROR: communication with GPS timed out!");
+    } else
+        printfbw(gps, "ERROR: %lu responses were checked but none were valid!", sentences);
+    return false;
+}
+
+/**
+ * Configures a u-blox GPS module to send NAV-PVT and NAV-DOP messages instead of NMEA sentences.
+ * @return true if successful
+ */
+static bool init_ubx() {
+    // Protocol manual: https://content.u-blox.com/sites/default/files/products/documents/u-blox8-M8_ReceiverDescrProtSpec_UBX-13003221.pdf
+    // CFG-MSG payloads are class, ID, and rate (messages per navigation solution) on the port the message is sent on
+    const byte enable[][3] = {
+        {UBX_CLASS_NAV, UBX_NAV_PVT, 1},
+        {UBX_CLASS_NAV, UBX_NAV_DOP, 1},
+    };
+    for (u32 i = 0; i < count_of(enable); i++) {
+        if (!ubx_send(UBX_CLASS_CFG, UBX_CFG_MSG, enable[i], sizeof(enable[i])))
             return false;
+    }
+    // NMEA output (GGA, GLL, GSA, GSV, RMC, VTG) is on by default and would only waste bandwidth
+    for (u8 id = 0x00; id <= 0x05; id++) {
+        const byte disable[3] = {UBX_CLASS_NMEA, id, 0};
+        if (!ubx_send(UBX_CLASS_CFG, UBX_CFG_MSG, disable, sizeof(disable)))
+            return false;
+    }
+    // Measure as quickly as the link allows: NAV-PVT and NAV-DOP come out to 126 bytes per solution
+    u16 measRate = config.sensors[SENSORS_GPS_BAUDRATE] >= UBX_FAST_BAUDRATE ? 100 : 200; // ms
+    const byte rate[6] = {
+        (byte)(measRate & 0xFF), (byte)(measRate >> 8), // measRate
+        1, 0,                                           // navRate (measurements per solution)
+        1, 0,                                           // timeRef (GPS time)
+    };
+    if (!ubx_send(UBX_CLASS_CFG, UBX_CFG_RATE, rate, sizeof(rate)))
+        return false;
+    printfbw(gps, "solutions at %uHz", 1000 / measRate);
+    return true;
+}
+
+bool gps_init() {
+    printfbw(gps, "initializing uart at baudrate %lu, on pins %lu (tx) and %lu (rx)", (u32)config.sensors[SENSORS_GPS_BAUDRATE],
+             tx_pin(), rx_pin());
+    uart_setup(tx_pin(), rx_pin(), (u32)config.sensors[SENSORS_GPS_BAUDRATE]);
+    nmea_init(&nmea);
+    ubx_init(&ubx);
+    printfbw(gps, "configuring...");
+    switch (command_type()) {
+        case GPS_COMMAND_TYPE_PMTK:
+            return init_pmtk();
+        case GPS_COMMAND_TYPE_UBX:
+            return init_ubx();
         default:
             return false;
     }
 }
 
 void gps_update() {
-    // Read line(s) from the GPS and parse them until there are none remaining
-    char *line = uart_read((u32)config.pins[PINS_GPS_TX], (u32)config.pins[PINS_GPS_RX]);
-    while (line) {
-        switch (minmea_sentence_id(line, false)) {
-            case MINMEA_SENTENCE_GGA: {
-                struct minmea_sentence_gga gga;
-                if (minmea_parse_gga(&gga, line)) {
-                    gps.lat = minmea_tocoord(&gga.latitude);
-                    gps.lng = minmea_tocoord(&gga.longitude);
-                    if (strncmp(&gga.altitude_units, "M", 1) == 0) {
-                        gps.alt = (i32)(minmea_tofloat(&gga.altitude) * M_TO_FT);
-                    } else {
-                        aircraft.set_gps_safe(false);
-                        printfbw(gps, "ERROR: incorrect altitude units!");
-                        return;
-                    }
-                    gps.sats = gga.satellites_tracked;
-                } else {
-                    printfbw(gps, "ERROR: failed parsing $xxGGA sentence");
-                }
-                break;
-            }
-            case MINMEA_SENTENCE_GSA: {
-                struct minmea_sentence_gsa gsa;
-                if (minmea_parse_gsa(&gsa, line)) {
-                    gps.pdop = minmea_tofloat(&gsa.pdop);
-                    gps.hdop = minmea_tofloat(&gsa.hdop);
-                    gps.vdop = minmea_tofloat(&gsa.vdop);
-                } else {
-                    printfbw(gps, "ERROR: failed parsing $xxGSA sentence");
-                }
-                break;
-            }
-            case MINMEA_SENTENCE_VTG: {
-                struct minmea_sentence_vtg vtg;
-                if (minmea_parse_vtg(&vtg, line)) {
-                    gps.speed = minmea_tofloat(&vtg.speed_knots);
-                    gps.track = minmea_tofloat(&vtg.true_track_degrees);
-                } else {
-                    printfbw(gps, "ERROR: failed parsing $xxVTG sentence");
-                }
-                break;
-            }
-
-            // All of these indicate parse errors but happen every so often and don't really mean anything, so they do not
-            // warrant a message
-            case MINMEA_INVALID:
-            case MINMEA_UNKNOWN:
-            default:
-                break;
-        }
-        // Clear the line and attempt to read in a new one
-        free(line);
-        line = uart_read((u32)config.pins[PINS_GPS_TX], (u32)config.pins[PINS_GPS_RX]);
+    process_input();
+    // A GPS that stops talking altogether (e.g. a loose wire) is just as lost as one without a fix
+    if (hasFix && time_since_ms(&lastFix) > FIX_TIMEOUT_MS) {
+        printfbw(gps, "ERROR: no fix received for %dms", FIX_TIMEOUT_MS);
+        hasFix = false;
     }
     aircraft.set_gps_safe(data_valid(gps.lat, gps.lng, gps.alt, gps.speed, gps.track, gps.pdop, gps.hdop, gps.vdop));
 }
@@ -158,36 +336,24 @@ i32 gps_calibrate_alt_offset(u32 num_samples) {
     // GPS updates should be at 1Hz (give or take 2s) so if the calibration takes longer we cut it short
     Timestamp calibrationTimeout = timestamp_in_ms((num_samples * 1000) + 2000);
     u32 samples = 0;
+    u32 lastFix = gps.fixes;
     i64 alts = 0;
     while (samples < num_samples && !timestamp_reached(&calibrationTimeout)) {
-        char *line = uart_read((u32)config.pins[PINS_GPS_TX], (u32)config.pins[PINS_GPS_RX]);
-        if (line) {
-            switch (minmea_sentence_id(line, false)) {
-                case MINMEA_SENTENCE_GGA: {
-                    struct minmea_sentence_gga gga;
-                    if (minmea_parse_gga(&gga, line)) {
-                        if (strncmp(&gga.altitude_units, "M", 1) == 0) {
-                            i32 cAlt = (i32)(minmea_tofloat(&gga.altitude) * 3.28084f);
-                            alts += cAlt;
-                            printfbw(gps, "altitude: %ld (%lu of %lu)", cAlt, samples + 1, num_samples);
-                        } else {
-                            printfbw(gps, "ERROR: invalid altitude units during calibration");
-                            return -2;
-                        }
-                    } else {
-                        printfbw(gps, "ERROR: failed parsing $xxGGA sentence during calibration");
-                    }
-                    samples++;
-                }
-                default: {
-                    break;
-                }
-            }
-            free(line);
+        process_input();
+        if (!altUnitsValid) {
+            printfbw(gps, "ERROR: invalid altitude units during calibration");
+            log_clear(TYPE_INFO);
+            return -2;
         }
+        if (gps.fixes == lastFix)
+            continue;
+        lastFix = gps.fixes;
+        alts += gps.alt;
+        samples++;
+        printfbw(gps, "altitude: %ld (%lu of %lu)", gps.alt, samples, num_samples);
     }
     log_clear(TYPE_INFO);
-    if (timestamp_reached(&calibrationTimeout)) {
+    if (samples < num_samples) {
         printfbw(gps, "ERROR: altitude calibration timed out");
         return -1;
     } else {
@@ -199,7 +365,7 @@ i32 gps_calibrate_alt_offset(u32 num_samples) {
 }
 
 bool gps_is_supported() {
-    return ((GPSCommandType)config.sensors[SENSORS_GPS_COMMAND_TYPE] != GPS_COMMAND_TYPE_NONE);
+    return (command_type() != GPS_COMMAND_TYPE_NONE);
 }
 
 // clang-format off
@@ -212,6 +378,7 @@ GPS gps = {
     .pdop = -1.0f,
     .hdop = -1.0f,
     .vdop = -1.0f,
+    .fixes = 0,
     .altOffset = 0,
     .altOffsetCalibrated = false,
     .init = gps_init,
@@ -7,9 +7,9 @@
 typedef enum GPSCommandType {
     GPS_COMMAND_TYPE_NONE,
     GPS_COMMAND_TYPE_PMTK,
-    // What is the command type used for ublox modules?
+    GPS_COMMAND_TYPE_UBX, // u-blox binary protocol (NAV-PVT)
 } GPSCommandType;
-#define GPS_COMMAND_TYPE_MAX GPS_COMMAND_TYPE_PMTK
+#define GPS_COMMAND_TYPE_MAX GPS_COMMAND_TYPE_UBX
 
 typedef bool (*gps_init_t)();
 typedef void (*gps_update_t)();
@@ -24,6 +24,7 @@ typedef struct GPS {
     f32 track;            // True (NOT magnetic) heading, 0 to 360 deg. (Read-only)
     f32 pdop, hdop, vdop; // GPS DOP (dilution of precision) measurements for position, horizontal, and vertical (Read-only)
     int sats;             // Number of satellites in view (Read-only)
+    u32 fixes;            // Number of position fixes received, can be used to detect new fixes (Read-only)
     i32 altOffset; // This is a positive value (basically where the GPS is MSL) or possibly zero if no calibration has been
                    // performed. (Read-only)
     bool altOffsetCalibrated; // (Read-only)
@@ -6,6 +6,7 @@
 #include <stdbool.h>
 #include <string.h>
 #include "platform/adc.h"
+#include "platform/common/www.h"
 #include "platform/defs.h"
 #include "platform/flash.h"
 #include "platform/helpers.h"
@@ -24,8 +25,10 @@
 
 #include "sys/boot.h"
 #include "sys/configuration.h"
+#include "sys/flightplan.h"
 #include "sys/log.h"
 #include "sys/print.h"
+#include "sys/recorder.h"
 #include "sys/runtime.h"
 #include "sys/version.h"
 
@@ -45,6 +48,9 @@ int main() {
     }
     boot_set_progress(5, "Loading configuration");
     config_load();
+    if (!log_persist_init())
+        log_message(TYPE_WARNING, "Unable to save logs!", -1, 0, false);
+    flightplan_load();
 
     // Check version
     boot_set_progress(10, "Checking for updates");
@@ -148,7 +154,8 @@ int main() {
         severity = TYPE_ERROR;
 #endif
         log_message(severity, "AAHRS initialization failed!", 1000, 0, false);
-    }
+    } else
+        aircraft.set_aahrs_safe(true);
     if (!(bool)config.general[GENERAL_SKIP_CALIBRATION]) {
         printpre("boot", "validating AAHRS calibration");
         if (!aahrs.isCalibrated) {
@@ -180,23 +187,14 @@ int main() {
     // Platform-specific feature setup
 
 #if PLATFORM_SUPPORTS_WIFI
-    boot_set_progress(85, "Initializing Wi-Fi");
-    bool setup = false;
-    if (lfs_mount(&wwwfs, &wwwfs_cfg) != LFS_ERR_OK)
-        goto fail;
-    switch ((WifiEnabled)config.general[GENERAL_WIFI_ENABLED]) {
-        case WIFI_ENABLED_OPEN:
-            setup = wifi_setup(config.wifi.ssid, NULL);
-            break;
-        case WIFI_ENABLED_PASS:
-            setup = wifi_setup(config.wifi.ssid, config.wifi.pass);
-        /* fall through */
-        default:
-            break;
+    WifiEnabled wifiEnabled = (WifiEnabled)config.general[GENERAL_WIFI_ENABLED];
+    if (wifiEnabled != WIFI_DISABLED) {
+        boot_set_progress(85, "Initializing Wi-Fi");
+        // The web interface is loaded first, as it's served as soon as the access point is up
+        if (lfs_mount(&wwwfs, &wwwfs_cfg) != LFS_ERR_OK || !www_load() ||
+            !wifi_setup(config.wifi.ssid, wifiEnabled == WIFI_ENABLED_PASS ? config.wifi.pass : NULL))
+            log_message(TYPE_ERROR, "Wi-Fi setup failed!", 2000, 0, false);
     }
-    if (!setup)
-    fail:
-        log_message(TYPE_ERROR, "Wi-Fi setup failed!", 2000, 0, false);
 #endif
 
 // ADC
@@ -204,6 +202,10 @@ int main() {
     adc_setup(ADC_PINS, ADC_NUM_CHANNELS);
 #endif
 
+    // Flight data recorder
+    if (!recorder_init())
+        log_message(TYPE_ERROR, "Flight data recorder failed to start!", 2000, 0, false);
+
     boot_set_progress(90, "Finishing up");
     // Final platform-specific setup tasks
     boot_complete();
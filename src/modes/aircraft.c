@@ -32,6 +32,7 @@
 #define STILL_FLYING_TIMEOUT 15
 
 static Timestamp lastNonzeroInput; // Last time a control input was detected
+static bool deadReckoning = false; // Whether auto or hold mode is carrying on without GPS
 
 /**
  * Determines whether or not the aircraft is currently flying.
@@ -51,6 +52,11 @@ static bool is_flying() {
 }
 
 void update() {
+    // Dead reckoning only lasts so long (see aahrs.nav), after that the position can't be trusted to navigate by
+    if ((aircraft.mode == MODE_AUTO || aircraft.mode == MODE_HOLD) && !aahrs.nav.valid) {
+        printfbw(aircraft, "navigation state is no longer valid");
+        aircraft.change_to(MODE_NORMAL);
+    }
     switch (aircraft.mode) {
         default:
         case MODE_DIRECT:
@@ -131,7 +137,7 @@ void change_to(Mode new_mode) {
         case MODE_AUTO:
             if (!tune_is_tuned())
                 goto TUNE; // Automatically enter tune mode if necessary
-            if (!GPS_OK())
+            if (!GPS_OK() || !aahrs.nav.valid)
                 goto NORMAL; // GPS is required to be safe for auto and hold modes, fallback to normal mode
             if ((bool)config.general[GENERAL_LAUNCHASSIST_ENABLED])
                 goto LAUNCH;
@@ -155,7 +161,7 @@ void change_to(Mode new_mode) {
             aircraft.mode = MODE_TUNE;
             break;
         case MODE_HOLD:
-            if (!GPS_OK())
+            if (!GPS_OK() || !aahrs.nav.valid)
                 goto NORMAL;
             printfbw(aircraft, "entering hold mode");
             if (hold_init())
@@ -203,10 +209,22 @@ void set_gps_safe(bool state) {
     if (state) {
         printfbw(aircraft, "GPS set as safe");
         log_clear(TYPE_INFO);
+        if (deadReckoning) {
+            log_clear(TYPE_WARNING);
+            deadReckoning = false;
+        }
     } else {
         printfbw(aircraft, "GPS set as unsafe");
-        if (aircraft.mode == MODE_AUTO || aircraft.mode == MODE_HOLD)
-            change_to(MODE_NORMAL); // Return to normal mode if GPS is deemed unsafe in Auto or Hold modes (require GPS)
+        if (aircraft.mode == MODE_AUTO || aircraft.mode == MODE_HOLD) {
+            // Auto and hold modes require GPS, but can keep going on dead reckoning for a while (until update() sees the
+            // navigation state expire); otherwise, return to normal mode
+            if (config.sensors[SENSORS_DEAD_RECKON_TIME] > 0 && aahrs.nav.valid) {
+                printfbw(aircraft, "dead reckoning");
+                log_message(TYPE_WARNING, "GPS lost, dead reckoning!", 5000, 0, false);
+                deadReckoning = true;
+            } else
+                change_to(MODE_NORMAL);
+        }
     }
 }
 
@@ -3,11 +3,14 @@
  * Licensed under the GNU AGPL-3.0
  */
 
+#include "platform/helpers.h"
 #include "platform/time.h"
 
+#include "io/aahrs.h"
 #include "io/gps.h"
 #include "io/servo.h"
 
+#include "lib/l1.h"
 #include "lib/nav.h"
 #include "lib/pid.h"
 
@@ -19,13 +22,13 @@
 #include "sys/configuration.h"
 #include "sys/flightplan.h"
 #include "sys/log.h"
+#include "sys/print.h"
 #include "sys/throttle.h"
 
 #include "auto.h"
 
-#define INTERCEPT_BASE_RADIUS 25 // The baseline radius at which to consider a Waypoint incercepted, in meters
-#define INTERCEPT_BASE_SPEED 50  // INTERCEPT_BASE_RADIUS will apply at this speed, kts
-#define MIN_RADIUS 5             // The minimum radius that is possible (after being calculated), in meters
+#define KTS_TO_MS 0.514444f // Knots to meters per second conversion constant
+#define MIN_RADIUS 5        // The radius within which a Waypoint is always considered intercepted, in meters
 
 typedef enum GuidanceSource {
     SOURCE_FLIGHTPLAN,
@@ -36,10 +39,12 @@ static bool autoComplete = false;
 
 // Details of the current Waypoint we're tracking to
 static u32 currentWaypoint = 0;
-static f64 distance;
-static f64 bearing;
+static NavLeg leg;      // The leg leading to the current Waypoint
+static NavLeg nextLeg;  // The leg leading on from the current Waypoint, set up when it's loaded
+static bool hasNextLeg; // Whether there's a leg after the current one (i.e. the current Waypoint isn't the last)
+static NavTrack track;  // Position relative to the current leg
 static i32 alt;
-static PIDController latGuid;
+static L1Controller latGuid;
 static PIDController vertGuid;
 
 // Allows auto mode to be externally controlled (by API setting a custom Waypoint and callback)
@@ -54,6 +59,14 @@ static i32 callback_drop(void *data) {
     (void)data;
 }
 
+/**
+ * Sets up the current leg from the aircraft's current position to a Waypoint.
+ * @param wpt the Waypoint at the end of the leg
+ */
+static void enter_leg(Waypoint *wpt) {
+    nav_leg_init(&leg, aahrs.nav.lat, aahrs.nav.lng, wpt->lat, wpt->lng);
+}
+
 /**
  * Load the given Waypoint and begin tracking to it.
  * @param wpt the Waypoint to load
@@ -75,6 +88,25 @@ static inline void load_waypoint(Waypoint *wpt) {
     }
 }
 
+/**
+ * Reads a Waypoint of the flightplan from flash (along with the one after it, to set up the leg between them) and loads it.
+ * @param index the index of the Waypoint
+ * @param wpt pointer to where the Waypoint should be stored
+ * @return true if the Waypoint was loaded
+ */
+static bool load_flightplan_waypoint(u32 index, Waypoint *wpt) {
+    Waypoint wpts[2];
+    u32 read = flightplan_read_waypoints(index, wpts, count_of(wpts));
+    if (read == 0)
+        return false;
+    hasNextLeg = read > 1;
+    if (hasNextLeg)
+        nav_leg_init(&nextLeg, wpts[0].lat, wpts[0].lng, wpts[1].lat, wpts[1].lng);
+    *wpt = wpts[0];
+    load_waypoint(wpt);
+    return true;
+}
+
 bool auto_init() {
     // Import flightplan data
     if (!flightplan_was_parsed()) {
@@ -95,14 +127,18 @@ bool auto_init() {
 // The PIDController struct contains some internal variables that we don't initialize, so we suppress the warning
 #pragma GCC diagnostic push
 #pragma GCC diagnostic ignored "-Wmissing-field-initializers"
-    latGuid = (PIDController){LATGD_KP, LATGD_KI, LATGD_KD, LATGD_TAU, -LATGD_LIM, LATGD_LIM, -LATGD_INTEGLIM, LATGD_INTEGLIM};
+    latGuid = (L1Controller){LATGD_PERIOD, LATGD_DAMPING, config.control[CONTROL_ROLL_LIMIT]};
     vertGuid = (PIDController){VERTGD_KP,    VERTGD_KI,    VERTGD_KD,        VERTGD_TAU,
                                VERTGD_LOLIM, VERTGD_HILIM, -VERTGD_INTEGLIM, VERTGD_INTEGLIM};
 #pragma GCC diagnostic pop
-    pid_init(&latGuid);
     pid_init(&vertGuid);
     // Load the first Waypoint from the flightplan (subsequent waypoints will be loaded on waypoint interception)
-    load_waypoint(&(flightplan_get()->waypoints[currentWaypoint]));
+    Waypoint wpt;
+    if (!load_flightplan_waypoint(currentWaypoint, &wpt)) {
+        log_message(TYPE_ERROR, "Unable to read flightplan!", 2000, 0, false);
+        return false;
+    }
+    enter_leg(&wpt);
     return true;
 }
 
@@ -113,48 +149,49 @@ void auto_update() {
         return;
     }
 
-    // Calculate the bearing and distance...
-    switch (guidanceSource) {
-        case SOURCE_FLIGHTPLAN:
-            // ...to the current Waypoint in the flightplan
-            bearing = calculate_bearing(gps.lat, gps.lng, flightplan_get()->waypoints[currentWaypoint].lat,
-                                        flightplan_get()->waypoints[currentWaypoint].lng);
-            distance = calculate_distance(gps.lat, gps.lng, flightplan_get()->waypoints[currentWaypoint].lat,
-                                          flightplan_get()->waypoints[currentWaypoint].lng);
-            break;
-        case SOURCE_EXTERNAL:
-            // ...to the current Waypoint (temporarily set)
-            bearing = calculate_bearing(gps.lat, gps.lng, externWpt.lat, externWpt.lng);
-            distance = calculate_distance(gps.lat, gps.lng, externWpt.lat, externWpt.lng);
-            break;
-    }
+    // Work out where we are relative to the current leg (from the navigation state, which moves smoothly between GPS fixes)
+    nav_leg_track(&leg, aahrs.nav.lat, aahrs.nav.lng, &track);
 
-    // Nested PIDs; latGuid and vertGuid use gps data to command bank/pitch angles which the flight PIDs then use to actuate
-    // servos
-    pid_update(&latGuid, bearing,
-               gps.track); // Don't use IMU heading because that's not always going to be navigational (more likely magnetic)
-    pid_update(&vertGuid, alt, gps.alt);
+    // Nested controllers; latGuid and vertGuid use navigation data to command bank/pitch angles which the flight PIDs then use
+    // to actuate servos
+    // Don't use IMU heading because that's not always going to be navigational (more likely magnetic)
+    f32 speed = aahrs.nav.speed * KTS_TO_MS;
+    l1_update(&latGuid, &leg, &track, speed, aahrs.nav.track);
+    pid_update(&vertGuid, alt, aahrs.nav.alt);
     flight_update(latGuid.out, vertGuid.out, 0, false);
     throttle.update();
 
-    // Calculate the radius at which to consider the Waypoint intercepted
-    // This must be calculated every loop as we need to turn sooner if we're going faster to stay on course
-    f64 radius = INTERCEPT_BASE_RADIUS + (throttle.target - INTERCEPT_BASE_SPEED) * 5;
+    // Calculate the distance at which to consider the Waypoint intercepted
+    // If there's another leg after this one, this is where the turn onto it needs to start (which depends on our speed and
+    // how sharp the turn is) so that we roll out on it instead of overshooting it
+    f32 radius = 0;
+    if (guidanceSource == SOURCE_FLIGHTPLAN && hasNextLeg) {
+        f32 courseIn = leg.greatCircle ? track.bearing : leg.course;
+        radius = l1_turn_distance(&latGuid, speed, courseIn, nextLeg.course);
+    }
     radius = (radius < MIN_RADIUS) ? MIN_RADIUS : radius;
-    // If we've intercepted the waypoint,
-    if (distance < radius) {
+    // If we've intercepted the waypoint (or passed it without getting within the radius),
+    if (track.distance < radius || track.alongTrack >= leg.length) {
         switch (guidanceSource) {
             case SOURCE_FLIGHTPLAN:
                 // then advance to the next one
+                printfbw(aircraft, "captured Waypoint %lu of %lu", (unsigned long)currentWaypoint + 1,
+                         (unsigned long)flightplan_get()->waypoint_count);
                 currentWaypoint++;
                 // Check if the flightplan is over
-                if (currentWaypoint > flightplan_get()->waypoint_count) {
+                if (!hasNextLeg) {
                     // Auto mode ends here, we enter a holding pattern
                     autoComplete = true;
                     aircraft.change_to(MODE_HOLD);
-                } else
-                    // More waypoints to go, load the next one
-                    load_waypoint(&flightplan_get()->waypoints[currentWaypoint]);
+                } else {
+                    // More waypoints to go, load the next one (the leg leading to it was set up with the last one)
+                    leg = nextLeg;
+                    Waypoint wpt;
+                    if (!load_flightplan_waypoint(currentWaypoint, &wpt)) {
+                        log_message(TYPE_ERROR, "Unable to read flightplan!", 2000, 0, false);
+                        aircraft.change_to(MODE_HOLD);
+                    }
+                }
                 break;
             case SOURCE_EXTERNAL:
                 // then execute the callback function and enter a holding pattern
@@ -172,6 +209,7 @@ void auto_set(Waypoint wpt, void (*callback)(void)) {
     externWpt = wpt;
     captureCallback = callback;
     load_waypoint(&externWpt);
+    enter_leg(&externWpt);
 }
 
 void auto_set_bay_position(BayPosition pos) {
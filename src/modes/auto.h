@@ -3,13 +3,9 @@
 #include <stdbool.h>
 #include "platform/types.h"
 
-/* PID constants for the autopilot's lateral guidance. */
-#define LATGD_KP 0.005
-#define LATGD_KI 0.008
-#define LATGD_KD 0.002
-#define LATGD_TAU 0.001
-#define LATGD_LIM 33 // The maximum roll angle the autopilot can command
-#define LATGD_INTEGLIM 50.0
+/* L1 constants for the autopilot's lateral guidance (the maximum roll angle it can command is the roll limit). */
+#define LATGD_PERIOD 17.f   // Period of the response to being off the leg, seconds
+#define LATGD_DAMPING 0.75f // Damping ratio of the response to being off the leg
 
 /* PID constants for the autopilot's vertical guidance. */
 #define VERTGD_KP 0.05
@@ -28,6 +28,7 @@ static f32 ailOut, eleOut, rudOut;
 static f32 lElevonOut, rElevonOut;
 
 static f32 yawOutput;
+static f32 rollSetpoint, pitchSetpoint, yawSetpoint;
 static f32 flightYawSetpoint;
 static bool yawDamperOn;
 
@@ -117,6 +118,9 @@ void flight_update(f64 roll, f64 pitch, f64 yaw, bool override) {
         aircraft.set_aahrs_safe(false);
     }
 
+    rollSetpoint = (f32)roll;
+    pitchSetpoint = (f32)pitch;
+    yawSetpoint = (f32)yaw;
     // Update PID controllers
     pid_update(&rollC, roll, (f64)aahrs.roll);
     pid_update(&pitchC, pitch, (f64)aahrs.pitch);
@@ -206,3 +210,23 @@ void flight_params_update(Axis axis, f64 kP, f64 kI, f64 kD, bool reset) {
             break;
     }
 }
+
+// Splits a PID's last output into its proportional, integral, and derivative terms
+static void pid_terms(const PIDController *pid, f32 terms[3]) {
+    terms[0] = (f32)(pid->Kp * pid->prevError);
+    terms[1] = (f32)pid->integrator;
+    terms[2] = (f32)pid->differentiator;
+}
+
+void flight_get_state(FlightState *state) {
+    state->rollSetpoint = rollSetpoint;
+    state->pitchSetpoint = pitchSetpoint;
+    state->yawSetpoint = yawSetpoint;
+    pid_terms(&rollC, state->roll);
+    pid_terms(&pitchC, state->pitch);
+    pid_terms(&yawC, state->yaw);
+    state->ailOut = ailOut;
+    state->eleOut = eleOut;
+    state->rudOut = rudOut;
+    state->yawDamperOn = yawDamperOn;
+}
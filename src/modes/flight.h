@@ -5,6 +5,13 @@
 
 #include "sys/control.h"
 
+typedef struct FlightState {
+    f32 rollSetpoint, pitchSetpoint, yawSetpoint; // Setpoints given to the last `flight_update()`, deg
+    f32 roll[3], pitch[3], yaw[3];                // Proportional, integral, and derivative terms of each axis's PID
+    f32 ailOut, eleOut, rudOut;                   // Outputs sent to the servos (before elevon mixing), deg
+    bool yawDamperOn;                             // Whether the yaw damper is active
+} FlightState;
+
 /**
  * Initializes the flight system (axis PIDs).
  */
@@ -47,3 +54,9 @@ void flight_params_get(Axis axis, f64 *kP, f64 *kI, f64 *kD);
  * @param reset whether or not to reset the PID
  */
 void flight_params_update(Axis axis, f64 kP, f64 kI, f64 kD, bool reset);
+
+/**
+ * Gets the state of the flight system as of the last `flight_update()`.
+ * @param state pointer to where the state should be stored
+ */
+void flight_get_state(FlightState *state);
@@ -7,7 +7,7 @@
 #include "platform/time.h"
 #include "platform/types.h"
 
-#include "io/gps.h"
+#include "io/aahrs.h"
 
 #include "lib/pid.h"
 
@@ -45,6 +45,7 @@ typedef enum HoldStatus {
 } HoldStatus;
 
 static HoldStatus turnStatus = HOLD_TURN_UNSCHEDULED;
+static CallbackID turnCallback = 0;
 
 static f32 oldTrack;
 static f32 targetTrack;
@@ -57,7 +58,7 @@ static PIDController vertGuid;
 // Callback for when a turnaround should be completed in a holding pattern
 static i32 turn_around(void *data) {
     // Get current track (beginning of the turn)
-    oldTrack = gps.track;
+    oldTrack = aahrs.nav.track;
     // Set our target heading based on this (with wrap protection)
     targetTrack = (oldTrack + 180);
     if (targetTrack > 360)
@@ -68,6 +69,9 @@ static i32 turn_around(void *data) {
 }
 
 bool hold_init() {
+    // Start a fresh leg, in case a turn from a previous holding pattern is still pending
+    cancel_callback(turnCallback);
+    turnStatus = HOLD_TURN_UNSCHEDULED;
     flight_init();
     throttle.init();
     if (throttle.supportedMode < THRMODE_SPEED) {
@@ -76,7 +80,7 @@ bool hold_init() {
     }
     throttle.mode = THRMODE_SPEED;
     // We try to maintain the speed of the aircraft as it was entering the holding pattern
-    throttle.target = gps.speed;
+    throttle.target = aahrs.nav.speed;
 // We use a vertical guidance PID here so that we can keep the aircraft level; 0deg pitch does not equal 0 altitude change
 // (sadly)
 #pragma GCC diagnostic push
@@ -85,12 +89,12 @@ bool hold_init() {
                                VERTGD_LOLIM, VERTGD_HILIM, -VERTGD_INTEGLIM, VERTGD_INTEGLIM};
 #pragma GCC diagnostic pop
     pid_init(&vertGuid);
-    targetAlt = gps.alt; // targetAlt is just the current alt from whenever we enter the mode
+    targetAlt = (i32)aahrs.nav.alt; // targetAlt is just the current alt from whenever we enter the mode
     return true;
 }
 
 void hold_update() {
-    pid_update(&vertGuid, targetAlt, gps.alt);
+    pid_update(&vertGuid, targetAlt, aahrs.nav.alt);
     flight_update(rollSet, vertGuid.out, 0, false);
     throttle.update();
 
@@ -106,7 +110,7 @@ void hold_update() {
             break;
         case HOLD_TURN_INPROGRESS:
             // Wait until it is time to decrease the turn
-            if (fabsf(targetTrack - gps.track) <= HOLD_HEADING_DECREASE_WITHIN)
+            if (fabsf(targetTrack - aahrs.nav.track) <= HOLD_HEADING_DECREASE_WITHIN)
                 turnStatus = HOLD_TURN_ENDING;
             break;
         case HOLD_TURN_ENDING:
@@ -114,7 +118,7 @@ void hold_update() {
             if (rollSet >= HOLD_TURN_SLOW_BANK_ANGLE)
                 rollSet -= (HOLD_TURN_BANK_ANGLE * config.control[CONTROL_RUDDER_SENSITIVITY]);
             // Move on to stabilization once we've intercepted the target heading
-            if (fabsf(targetTrack - gps.track) <= HOLD_HEADING_INTERCEPT_WITHIN) {
+            if (fabsf(targetTrack - aahrs.nav.track) <= HOLD_HEADING_INTERCEPT_WITHIN) {
                 turnStatus = HOLD_TURN_STABILIZING;
             }
             break;
@@ -124,7 +128,7 @@ void hold_update() {
                 rollSet -= (HOLD_TURN_BANK_ANGLE * config.control[CONTROL_RUDDER_SENSITIVITY]);
             break;
         case HOLD_TURN_UNSCHEDULED:
-            callback_in_ms((HOLD_TIME_PER_LEG_S * 1000), turn_around, NULL);
+            turnCallback = callback_in_ms((HOLD_TIME_PER_LEG_S * 1000), turn_around, NULL);
             turnStatus = HOLD_AWAITING_TURN;
             break;
         default:
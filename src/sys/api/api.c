@@ -3,60 +3,142 @@
  * Licensed under the GNU AGPL-3.0
  */
 
+#include <stdarg.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
+#include "sys/api/binary.h"
 #include "sys/api/cmds/cmds.h"
+#include "sys/api/stream.h"
 #include "sys/print.h"
 
 #include "api.h"
 
-/**
- * Executes an API command.
- * @param cmd command to execute
- * @param args arguments to the command
- * @return status code of the command
- */
-static i32 api_exec(const char *cmd, const char *args) {
-    i32 status;
-    if (strncasecmp(cmd, "GET_", 4) == 0) {
-        status = api_handle_get(cmd, args);
-    } else if (strncasecmp(cmd, "SET_", 4) == 0) {
-        status = api_handle_set(cmd, args);
-    } else if (strncasecmp(cmd, "TEST_", 5) == 0) {
-        status = api_handle_test(cmd, args);
-    } else
-        status = api_handle_misc(cmd, args);
-    return status;
+#define CAPTURE_INITIAL_SIZE 256
+
+// Output of the command being run by a binary session
+static char *capture = NULL;
+static u32 captureLen = 0, captureSize = 0;
+static bool capturing = false;
+
+static bool write_stdout(const byte *data, u32 len, void *ctx) {
+    stdout_write(data, len);
+    return true;
+    (void)ctx;
+}
+
+static bool write_json_line(const char *json, u32 len, void *ctx) {
+    printraw("%s\n", json);
+    return true;
+    (void)len;
+    (void)ctx;
+}
+
+// The serial session speaks text until it is switched over with the BINARY command; it can stream in either protocol
+static StreamClient serialStream = {.format = STREAM_FORMAT_JSON, .write = write_json_line};
+static BinarySession serial = {.write = write_stdout, .ctx = NULL, .active = false, .stream = &serialStream};
+
+i32 api_exec(const char *cmd, const char *args) {
+    const ApiCommand *command = api_find_command(cmd);
+    if (!command || !command->run)
+        return 404; // Unknown, or a command that only the session itself can handle
+    i32 status = api_check_command(command, args);
+    if (status != 200)
+        return status;
+    return command->run(args);
 }
 
 i32 api_poll() {
+    if (serial.active) {
+        u32 len;
+        byte *packet = stdin_read_packet(&len);
+        return packet ? binary_handle(&serial, packet, len) : 0;
+    }
     char *line = stdin_read();
     if (line) {
-        if (strlen(line) < 1) {
-            free(line);
-            return 0;
-        }
         // Seperate the command and arguments
         char *cmd = strtok(line, " ");
         char *args = strtok(NULL, "");
-        if (!cmd) {
-            // Out of memory?
-            printraw("pico-fbw 500\n");
-            free(line);
-            return 500;
-        }
-
-        i32 status = api_exec(cmd, args);
+        if (!cmd)
+            return 0; // Only whitespace
+
+        // Commands that change the session itself are handled here rather than by api_exec()
+        i32 status;
+        if (strcasecmp(cmd, "BINARY") == 0) {
+            // Acknowledged in text, everything after this is binary (including any stream, which must be resubscribed)
+            stream_unsubscribe(&serialStream);
+            serial.active = true;
+            status = 200;
+        } else if (strcasecmp(cmd, "SUBSCRIBE") == 0) {
+            serialStream.format = STREAM_FORMAT_JSON;
+            serialStream.write = write_json_line;
+            status = stream_subscribe_args(&serialStream, args);
+        } else
+            status = api_exec(cmd, args);
         if (status != -1)
             printraw("pico-fbw %ld\n", status);
-        free(line);
         return status;
     }
     return 0;
 }
 
+void api_capture_begin() {
+    captureLen = 0;
+    if (capture)
+        capture[0] = '\0';
+    capturing = true;
+}
+
+char *api_capture_end(u32 *len) {
+    capturing = false;
+    *len = captureLen;
+    return captureLen > 0 ? capture : NULL;
+}
+
+bool api_is_capturing() {
+    return capturing;
+}
+
+int __printflike(1, 2) api_capture(const char *fmt, ...) {
+    va_list args;
+    va_start(args, fmt);
+    int needed = vsnprintf(NULL, 0, fmt, args);
+    va_end(args);
+    if (needed <= 0)
+        return needed;
+    if (captureLen + needed + 1 > captureSize) {
+        // Grow the buffer (it is kept between captures, so this rarely happens)
+        u32 size = captureSize ? captureSize : CAPTURE_INITIAL_SIZE;
+        while (size < captureLen + needed + 1)
+            size *= 2;
+        char *nbuf = realloc(capture, size);
+        if (!nbuf)
+            return 0; // Output is dropped, but what was captured so far is kept
+        capture = nbuf;
+        captureSize = size;
+    }
+    va_start(args, fmt);
+    vsnprintf(capture + captureLen, captureSize - captureLen, fmt, args);
+    va_end(args);
+    captureLen += needed;
+    return needed;
+}
+
+static void print_json(const char *data, u32 len, void *ctx) {
+    api_print("%.*s", (int)len, data);
+    (void)ctx;
+}
+
+void api_json_begin(JSONWriter *json, char *buf, u32 size) {
+    jsonw_init_sink(json, buf, size, print_json, NULL);
+}
+
+void api_json_end(JSONWriter *json) {
+    jsonw_finish(json);
+    api_print("\n");
+}
+
 const char *api_res_to_http_status(i32 res) {
     switch (res) {
         case -1: // -1 is an alternate API code which more or less means the same as 200
@@ -72,8 +154,16 @@ const char *api_res_to_http_status(i32 res) {
             return "403 Forbidden";
         case 404:
             return "404 Not Found";
+        case 405:
+            return "405 Method Not Allowed";
         case 409:
             return "409 Conflict";
+        case 413:
+            return "413 Content Too Large";
+        case 431:
+            return "431 Request Header Fields Too Large";
+        case 501:
+            return "501 Not Implemented";
         case 500:
         default:
             return "500 Internal Server Error";
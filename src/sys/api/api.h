@@ -1,11 +1,75 @@
 #pragma once
 
+#include <stdbool.h>
+#include "platform/types.h"
+
+#include "lib/jsonwriter.h"
+
+#include "sys/print.h"
+
+#define API_JSON_BUFFER_SIZE 128 // Size of the buffer that JSON output is assembled in before it's printed
+
+/**
+ * printf wrapper for API command output.
+ * Prints to the stdout, unless the output is being captured (see `api_capture_begin()`).
+ * @param ... the format string and arguments to print (same as printf)
+ */
+#define api_print(...) (api_is_capturing() ? api_capture(__VA_ARGS__) : printraw(__VA_ARGS__))
+
 /**
  * Polls the API for new data (incoming commands) and responds if necessary.
  * @return the status code of the executed command, or 0 if no command was executed
  */
 i32 api_poll();
 
+/**
+ * Executes an API command.
+ * @param cmd command to execute
+ * @param args arguments to the command
+ * @return status code of the command
+ */
+i32 api_exec(const char *cmd, const char *args);
+
+/**
+ * Starts capturing the output of API commands into a buffer instead of printing it.
+ */
+void api_capture_begin();
+
+/**
+ * Stops capturing the output of API commands.
+ * @param len pointer to where the length of the captured output should be stored
+ * @return the captured output (null-terminated), or NULL if nothing was captured or it could not be stored
+ * @note The output belongs to the API and is only valid until the next capture begins.
+ */
+char *api_capture_end(u32 *len);
+
+/**
+ * @return whether the output of API commands is currently being captured
+ */
+bool api_is_capturing();
+
+/**
+ * Appends formatted output to the current capture.
+ * @param fmt the format string
+ * @param ... the arguments to be formatted
+ * @return the number of characters captured
+ */
+int __printflike(1, 2) api_capture(const char *fmt, ...);
+
+/**
+ * Sets up a JSON writer whose output is printed like `api_print()`'s.
+ * @param json the writer
+ * @param buf the buffer that output is assembled in, typically API_JSON_BUFFER_SIZE bytes on the stack
+ * @param size the size of the buffer
+ */
+void api_json_begin(JSONWriter *json, char *buf, u32 size);
+
+/**
+ * Finishes a document started with `api_json_begin()` and ends its line.
+ * @param json the writer
+ */
+void api_json_end(JSONWriter *json);
+
 /**
  * Converts an API response code to an HTTP status code.
  * @param res the API response code
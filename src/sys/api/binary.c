@@ -0,0 +1,245 @@
+/**
+ * Source file of pico-fbw: https://github.com/pico-fbw/pico-fbw
+ * Licensed under the GNU AGPL-3.0
+ */
+
+#include <math.h>
+#include <string.h>
+#include "platform/helpers.h"
+
+#include "io/aahrs.h"
+#include "io/gps.h"
+#include "io/receiver.h"
+
+#include "lib/cobs.h"
+
+#include "modes/aircraft.h"
+
+#include "sys/api/api.h"
+#include "sys/api/stream.h"
+#include "sys/configuration.h"
+#include "sys/perf.h"
+
+#include "binary.h"
+
+// Frames are assembled and encoded here; this is only ever used from the main loop, so one of each is enough
+static byte frame[BINARY_FRAME_MAX];
+static byte encoded[1 + COBS_ENCODED_MAX(BINARY_FRAME_MAX) + 1];
+
+static void sample_attitude(BinaryAttitude *att) {
+    *att = (BinaryAttitude){
+        .valid = aircraft.aahrsSafe,
+        .roll = aahrs.roll,
+        .pitch = aahrs.pitch,
+        .yaw = aahrs.yaw,
+        .rollRate = aahrs.rollRate,
+        .pitchRate = aahrs.pitchRate,
+        .yawRate = aahrs.yawRate,
+        .accel = {aahrs.accel[0], aahrs.accel[1], aahrs.accel[2]},
+        .alt = aahrs.alt,
+    };
+}
+
+static void sample_gps(BinaryGPS *fix) {
+    *fix = (BinaryGPS){.valid = aircraft.gpsSafe && gps.is_supported()};
+    if (!fix->valid)
+        return;
+    fix->lat = (i32)llround(gps.lat * 1E7);
+    fix->lng = (i32)llround(gps.lng * 1E7);
+    fix->alt = gps.alt;
+    fix->speed = gps.speed;
+    fix->track = gps.track;
+    fix->pdop = gps.pdop;
+    fix->hdop = gps.hdop;
+    fix->vdop = gps.vdop;
+    fix->sats = (u8)clamp(gps.sats, 0, UINT8_MAX);
+}
+
+static void sample_inputs(BinaryInputs *in) {
+    // Same inputs as GET_INPUT reports
+    *in = (BinaryInputs){
+        .ail = receiver_get(config.pins[PINS_INPUT_AIL], RECEIVER_MODE_DEGREE),
+        .ele = receiver_get(config.pins[PINS_INPUT_ELE], RECEIVER_MODE_DEGREE),
+    };
+    switch ((ControlMode)config.general[GENERAL_CONTROL_MODE]) {
+        case CTRLMODE_3AXIS_ATHR:
+            in->present |= BINARY_INPUT_THR;
+            in->thr = receiver_get(config.pins[PINS_INPUT_THROTTLE], RECEIVER_MODE_PERCENT);
+        /* fall through */
+        case CTRLMODE_3AXIS:
+            in->present |= BINARY_INPUT_RUD | BINARY_INPUT_SWITCH;
+            in->rud = receiver_get(config.pins[PINS_INPUT_RUD], RECEIVER_MODE_DEGREE);
+            in->sw = receiver_get(config.pins[PINS_INPUT_SWITCH], RECEIVER_MODE_DEGREE);
+            break;
+        case CTRLMODE_2AXIS_ATHR:
+        case CTRLMODE_FLYINGWING_ATHR:
+            in->present |= BINARY_INPUT_THR;
+            in->thr = receiver_get(config.pins[PINS_INPUT_THROTTLE], RECEIVER_MODE_PERCENT);
+        /* fall through */
+        case CTRLMODE_2AXIS:
+        case CTRLMODE_FLYINGWING:
+            in->present |= BINARY_INPUT_SWITCH;
+            in->sw = receiver_get(config.pins[PINS_INPUT_SWITCH], RECEIVER_MODE_DEGREE);
+            break;
+    }
+}
+
+static void sample_mode(BinaryMode *mode) {
+    *mode = (BinaryMode){
+        .mode = (u8)aircraft.mode,
+        .flags = (aircraft.aahrsSafe ? BINARY_MODE_AAHRS_SAFE : 0) | (aircraft.gpsSafe ? BINARY_MODE_GPS_SAFE : 0) |
+                 (aircraft.isFlying ? BINARY_MODE_FLYING : 0),
+    };
+}
+
+static void sample_perf(BinaryPerf *perf) {
+    for (PerfStage s = 0; s < PERF_STAGE_COUNT; s++) {
+        PerfStats stats;
+        perf_get(s, &stats);
+        perf->mean[s] = stats.mean;
+        perf->max[s] = stats.max;
+        perf->p99[s] = stats.p99;
+        perf->overruns[s] = stats.overruns;
+    }
+}
+
+/**
+ * Subscribes a session's stream to the requested channels.
+ * @return the status code of the request
+ */
+static i32 subscribe(BinarySession *session, const byte *payload, u32 len) {
+    if (!session->stream)
+        return 403; // The transport can't stream
+    BinarySubscribe sub;
+    if (len < sizeof(sub))
+        return 400;
+    memcpy(&sub, payload, sizeof(sub));
+    session->stream->format = STREAM_FORMAT_BINARY;
+    session->stream->session = session;
+    return stream_subscribe(session->stream, sub.channels, sub.rate) ? 200 : 409;
+}
+
+/**
+ * Runs a text API command and sends its output back as one or more BINARY_RESULT frames.
+ * @return the status code of the command
+ */
+static i32 run_command(BinarySession *session, u8 seq, char *line) {
+    char *cmd = strtok(line, " ");
+    char *args = strtok(NULL, "");
+    i32 status;
+    char *out = NULL;
+    u32 outLen = 0;
+    if (!cmd) {
+        status = 400;
+    } else {
+        api_capture_begin();
+        status = api_exec(cmd, args);
+        out = api_capture_end(&outLen);
+    }
+    // Split the output across as many frames as it takes
+    byte payload[BINARY_PAYLOAD_MAX];
+    const u32 chunkMax = BINARY_PAYLOAD_MAX - sizeof(BinaryResult);
+    u32 sent = 0;
+    do {
+        u32 chunk = outLen - sent < chunkMax ? outLen - sent : chunkMax;
+        BinaryResult result = {
+            .status = status,
+            .flags = sent + chunk < outLen ? BINARY_RESULT_MORE : 0,
+        };
+        memcpy(payload, &result, sizeof(result));
+        if (chunk > 0)
+            memcpy(payload + sizeof(result), out + sent, chunk);
+        binary_send(session, BINARY_RESULT, seq, payload, sizeof(result) + chunk);
+        sent += chunk;
+    } while (sent < outLen);
+    return status;
+}
+
+i32 binary_handle(BinarySession *session, byte *packet, u32 len) {
+    u32 frameLen;
+    if (!cobs_decode(packet, len, packet, &frameLen) || frameLen < 4)
+        return 0;
+    u16 crc = (u16)(packet[frameLen - 2] | (packet[frameLen - 1] << 8));
+    if (crc16_ccitt(packet, frameLen - 2) != crc)
+        return 0;
+    u8 type = packet[0];
+    u8 seq = packet[1];
+    byte *payload = packet + 2;
+    u32 payloadLen = frameLen - 4;
+
+    switch (type) {
+        case BINARY_COMMAND:
+            // The CRC is no longer needed, so its space terminates the command string
+            payload[payloadLen] = '\0';
+            return run_command(session, seq, (char *)payload);
+        case BINARY_REQUEST: {
+            if (payloadLen < 1)
+                break;
+            byte sample[STREAM_SNAPSHOT_MAX];
+            for (u32 i = 0; i < BINARY_CHANNELS; i++) {
+                if (!(payload[0] & (1 << i)))
+                    continue;
+                BinaryType channel = (BinaryType)(BINARY_ATTITUDE + i);
+                binary_send(session, channel, seq, sample, binary_telemetry(channel, sample));
+            }
+            return 200;
+        }
+        case BINARY_TEXT: {
+            BinaryResult result = {.status = 200};
+            binary_send(session, BINARY_RESULT, seq, &result, sizeof(result));
+            session->active = false;
+            if (session->stream)
+                stream_unsubscribe(session->stream);
+            return 200;
+        }
+        case BINARY_SUBSCRIBE: {
+            BinaryResult result = {.status = subscribe(session, payload, payloadLen)};
+            binary_send(session, BINARY_RESULT, seq, &result, sizeof(result));
+            return result.status;
+        }
+        default:
+            break;
+    }
+    BinaryResult result = {.status = type == BINARY_REQUEST ? 400 : 404};
+    binary_send(session, BINARY_RESULT, seq, &result, sizeof(result));
+    return result.status;
+}
+
+bool binary_send(BinarySession *session, BinaryType type, u8 seq, const void *payload, u32 len) {
+    if (len > BINARY_PAYLOAD_MAX)
+        return false;
+    frame[0] = (byte)type;
+    frame[1] = seq;
+    if (len > 0)
+        memcpy(frame + 2, payload, len);
+    u16 crc = crc16_ccitt(frame, len + 2);
+    frame[len + 2] = (byte)(crc & 0xFF);
+    frame[len + 3] = (byte)(crc >> 8);
+    // The leading delimiter ends whatever text might have been printed since the last frame, so it can't corrupt this one
+    encoded[0] = 0x00;
+    u32 encodedLen = 1 + cobs_encode(frame, len + 4, encoded + 1);
+    encoded[encodedLen++] = 0x00;
+    return session->write(encoded, encodedLen, session->ctx);
+}
+
+u32 binary_telemetry(BinaryType type, void *out) {
+    switch (type) {
+        case BINARY_ATTITUDE:
+            sample_attitude(out);
+            return sizeof(BinaryAttitude);
+        case BINARY_GPS:
+            sample_gps(out);
+            return sizeof(BinaryGPS);
+        case BINARY_INPUTS:
+            sample_inputs(out);
+            return sizeof(BinaryInputs);
+        case BINARY_MODE:
+            sample_mode(out);
+            return sizeof(BinaryMode);
+        case BINARY_PERF:
+            sample_perf(out);
+            return sizeof(BinaryPerf);
+        default:
+            return 0;
+    }
+}
@@ -0,0 +1,164 @@
+#pragma once
+
+#include <stdbool.h>
+#include "platform/types.h"
+
+#include "sys/perf.h"
+
+// Binary API protocol, a compact alternative to the text API for ground stations that poll at high rates.
+//
+// Every frame is [type (u8)][seq (u8)][payload][CRC (u16)], COBS-encoded (see lib/cobs.h) and delimited by zero bytes (the
+// aircraft sends one before and after each frame; clients only need to send one after). The CRC is the CRC-16/CCITT-FALSE of
+// the type, sequence number, and payload. Frames that fail to decode or whose CRC does not match are silently dropped, so any
+// text that ends up on the same link (e.g. log messages) is harmless.
+//
+// Replies carry the sequence number of the frame they answer. Payloads are the packed structs below; all values are
+// little-endian. New fields may only ever be appended, so clients should accept payloads longer than they expect.
+//
+// A serial session starts out speaking text and is switched over with the BINARY command; it goes back to text with a
+// BINARY_TEXT frame. Network sessions (where available) speak binary from the start, and are closed by BINARY_TEXT.
+//
+// Telemetry can either be polled with BINARY_REQUEST or streamed with BINARY_SUBSCRIBE (see sys/api/stream.h), in which case
+// it arrives as BINARY_UPDATE frames holding only the fields that changed.
+
+#define BINARY_FRAME_MAX 1024                            // Largest frame (before encoding), bytes
+#define BINARY_PAYLOAD_MAX (BINARY_FRAME_MAX - 1 - 1 - 2) // Largest payload, bytes
+
+// clang-format off
+typedef enum BinaryType {
+    // Client -> aircraft
+    BINARY_COMMAND = 0x01,   // A text API command line (e.g. "GET_CONFIG {...}"), answered with BINARY_RESULT
+    BINARY_REQUEST = 0x02,   // A u8 mask of BINARY_CHANNEL_* flags, answered with one telemetry frame per channel
+    BINARY_TEXT = 0x03,      // Switches the session back to the text protocol (answered with BINARY_RESULT)
+    BINARY_SUBSCRIBE = 0x04, // BinarySubscribe, answered with BINARY_RESULT
+    // Aircraft -> client
+    BINARY_RESULT = 0x80,    // BinaryResult followed by the command's output text (not null-terminated)
+    BINARY_ATTITUDE = 0x81,  // BinaryAttitude
+    BINARY_GPS = 0x82,       // BinaryGPS
+    BINARY_INPUTS = 0x83,    // BinaryInputs
+    BINARY_MODE = 0x84,      // BinaryMode
+    BINARY_PERF = 0x85,      // BinaryPerf
+    BINARY_UPDATE = 0x86,    // BinaryUpdate followed by the fields it holds, pushed to subscribers
+} BinaryType;
+// clang-format on
+
+// Telemetry channels, in the same order as their BinaryTypes (channel n is answered with BINARY_ATTITUDE + n)
+#define BINARY_CHANNEL_ATTITUDE (1 << 0)
+#define BINARY_CHANNEL_GPS (1 << 1)
+#define BINARY_CHANNEL_INPUTS (1 << 2)
+#define BINARY_CHANNEL_MODE (1 << 3)
+#define BINARY_CHANNEL_PERF (1 << 4)
+#define BINARY_CHANNELS 5
+
+// Flags of BinaryResult
+#define BINARY_RESULT_MORE (1 << 0) // More output follows in another BINARY_RESULT frame with the same sequence number
+
+// Flags of BinaryInputs (which inputs exist in the current control mode)
+#define BINARY_INPUT_RUD (1 << 0)
+#define BINARY_INPUT_THR (1 << 1)
+#define BINARY_INPUT_SWITCH (1 << 2)
+
+// Flags of BinaryMode
+#define BINARY_MODE_AAHRS_SAFE (1 << 0)
+#define BINARY_MODE_GPS_SAFE (1 << 1)
+#define BINARY_MODE_FLYING (1 << 2)
+
+typedef struct __attribute__((packed)) BinaryResult {
+    i32 status; // Status code of the command (-1 for success with output, same as the text API)
+    u8 flags;   // BINARY_RESULT_*
+} BinaryResult;
+
+typedef struct __attribute__((packed)) BinaryAttitude {
+    u8 valid;                         // Whether the AAHRS is safe to use; if not, the other values are meaningless
+    f32 roll, pitch, yaw;             // deg
+    f32 rollRate, pitchRate, yawRate; // deg/s
+    f32 accel[3];                     // Accelerometer reading (IMU frame), g
+    f32 alt;                          // MSL, ft, or -1 if unknown
+} BinaryAttitude;
+
+typedef struct __attribute__((packed)) BinaryGPS {
+    u8 valid;             // Whether a GPS is present and safe to use; if not, the other values are meaningless
+    i32 lat, lng;         // 1e-7 deg
+    i32 alt;              // MSL, ft
+    f32 speed;            // kts
+    f32 track;            // deg
+    f32 pdop, hdop, vdop; // Dilution of precision
+    u8 sats;              // Number of satellites
+} BinaryGPS;
+
+typedef struct __attribute__((packed)) BinaryInputs {
+    u8 present;        // BINARY_INPUT_* (aileron and elevator are always present)
+    f32 ail, ele, rud; // deg
+    f32 thr;           // %
+    f32 sw;            // Switch position, deg
+} BinaryInputs;
+
+typedef struct __attribute__((packed)) BinaryMode {
+    u8 mode;  // Mode
+    u8 flags; // BINARY_MODE_*
+} BinaryMode;
+
+typedef struct __attribute__((packed)) BinaryPerf {
+    // One entry per PerfStage, in order (see GET_PERF for their names), us
+    u32 mean[PERF_STAGE_COUNT];
+    u32 max[PERF_STAGE_COUNT];
+    u32 p99[PERF_STAGE_COUNT];
+    u32 overruns[PERF_STAGE_COUNT]; // Total count
+} BinaryPerf;
+
+typedef struct __attribute__((packed)) BinarySubscribe {
+    u8 channels; // BINARY_CHANNEL_* flags, or 0 to unsubscribe
+    u8 rate;     // Hz (clamped to what the aircraft allows)
+} BinarySubscribe;
+
+typedef struct __attribute__((packed)) BinaryUpdate {
+    u8 channel; // BinaryType of the channel's struct
+    u32 fields; // Bit n is set if the struct's nth member (arrays count as one) follows; all bits are set in a keyframe
+} BinaryUpdate;
+
+struct StreamClient;
+
+/**
+ * Writes an encoded frame to a session's transport.
+ * @param data the encoded frame, including its delimiters
+ * @param len the length of the frame
+ * @param ctx the session's context
+ * @return true if the frame was written, false if it was dropped (e.g. the transport's buffer is full)
+ */
+typedef bool (*binary_write_t)(const byte *data, u32 len, void *ctx);
+
+typedef struct BinarySession {
+    binary_write_t write;
+    void *ctx;                   // Passed to `write`
+    bool active;                 // Whether the session is (still) speaking binary
+    struct StreamClient *stream; // Used for BINARY_SUBSCRIBE, or NULL if the transport can't stream
+} BinarySession;
+
+/**
+ * Handles a frame received on a session, replying if necessary.
+ * @param session the session
+ * @param packet the received packet (COBS-encoded, without its delimiter); it is decoded in place
+ * @param len the length of the packet
+ * @return the status code of the command that was executed, or 0 if none was
+ * @note If the client asked to go back to the text protocol, `session->active` is cleared.
+ */
+i32 binary_handle(BinarySession *session, byte *packet, u32 len);
+
+/**
+ * Sends a frame on a session.
+ * @param session the session
+ * @param type the frame's type
+ * @param seq the frame's sequence number
+ * @param payload the frame's payload, may be NULL if `len` is 0
+ * @param len the length of the payload, at most BINARY_PAYLOAD_MAX
+ * @return true if the frame was sent, false if it was too large or dropped by the transport
+ */
+bool binary_send(BinarySession *session, BinaryType type, u8 seq, const void *payload, u32 len);
+
+/**
+ * Samples the current value of a telemetry channel.
+ * @param type the channel's type (BINARY_ATTITUDE through BINARY_PERF)
+ * @param out where to store the channel's struct (STREAM_SNAPSHOT_MAX bytes are always enough)
+ * @return the size of the struct, or 0 if `type` is not a telemetry channel
+ */
+u32 binary_telemetry(BinaryType type, void *out);
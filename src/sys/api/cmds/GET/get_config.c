@@ -9,8 +9,8 @@
 
 #include "lib/parson.h"
 
+#include "sys/api/api.h"
 #include "sys/configuration.h"
-#include "sys/print.h"
 
 #include "get_config.h"
 
@@ -68,78 +68,62 @@ static bool parse_args(const char *args, char **section, char **key) {
 
 /**
  * Helper to get a config value.
+ * @param json the writer to write the value to
  * @param section the section to get the value from
  * @param key the key to get the value of
- * @return the serialized JSON object containing the value
- * @note The caller is responsible for freeing the memory allocated for the output.
+ * @return true if the value exists (and was written)
  */
-static char *get_config_value(const char *section_name, const char *key) {
+static bool get_config_value(JSONWriter *json, const char *section_name, const char *key) {
     void *value = NULL;
     ConfigSectionType type = config_get(section_name, key, &value);
-    if (!value || type == SECTION_TYPE_NONE)
-        return NULL;
+    if (!value || (type != SECTION_TYPE_FLOAT && type != SECTION_TYPE_STRING))
+        return false;
     // The requested config value exists and we now have it + its type
     // Now, generate our response
-    JSON_Value *root = json_value_init_object();
-    JSON_Object *obj = json_value_get_object(root);
-    JSON_Value *sectionsArr = json_value_init_array();
-    JSON_Array *sections = json_value_get_array(sectionsArr);
-    JSON_Value *sectionObj = json_value_init_object();
-    JSON_Object *section = json_value_get_object(sectionObj);
-    json_object_set_string(section, "name", section_name);
-    JSON_Value *valuesArr = json_value_init_array();
-    JSON_Array *values = json_value_get_array(valuesArr);
-    switch (type) {
-        case SECTION_TYPE_FLOAT:
-            json_array_append_number(values, *(f32 *)value);
-            break;
-        case SECTION_TYPE_STRING:
-            json_array_append_string(values, (char *)value);
-            break;
-        default:
-            json_value_free(root);
-            return NULL; // This should never happen
-    }
-    json_object_set_value(section, "values", valuesArr);
-    json_array_append_value(sections, sectionObj);
-    json_object_set_value(obj, "sections", sectionsArr);
-    char *serialized = json_serialize_to_string(root);
-    json_value_free(root);
-    return serialized;
+    jsonw_object_begin(json);
+    jsonw_key(json, "sections");
+    jsonw_array_begin(json);
+    jsonw_object_begin(json);
+    jsonw_key_string(json, "name", section_name);
+    jsonw_key(json, "values");
+    jsonw_array_begin(json);
+    if (type == SECTION_TYPE_FLOAT)
+        jsonw_number(json, *(f32 *)value);
+    else
+        jsonw_string(json, (char *)value);
+    jsonw_array_end(json);
+    jsonw_object_end(json);
+    jsonw_array_end(json);
+    jsonw_object_end(json);
+    return true;
 }
 
 /**
  * Helper to get the entire config.
- * @return the serialized JSON object containing the entire config
- * @note The caller is responsible for freeing the memory allocated for the output.
+ * @param json the writer to write the config to
  */
-static char *get_entire_config() {
-    JSON_Value *root = json_value_init_object();
-    JSON_Object *obj = json_value_get_object(root);
-    JSON_Value *sectionsArr = json_value_init_array();
-    JSON_Array *sections = json_value_get_array(sectionsArr);
+static void get_entire_config(JSONWriter *json) {
+    jsonw_object_begin(json);
+    jsonw_key(json, "sections");
+    jsonw_array_begin(json);
     // For every config section...
     for (ConfigSection s = 0; s < NUM_CONFIG_SECTIONS; s++) {
-        JSON_Value *sectionObj = json_value_init_object();
-        JSON_Object *section = json_value_get_object(sectionObj);
         const char *sectionStr;
         ConfigSectionType type = config_to_string(s, &sectionStr);
-        json_object_set_string(section, "name", sectionStr);
-        JSON_Value *valuesArr = json_value_init_array();
-        JSON_Array *values = json_value_get_array(valuesArr);
+        jsonw_object_begin(json);
+        jsonw_key_string(json, "name", sectionStr);
+        jsonw_key(json, "values");
+        jsonw_array_begin(json);
         // ...and for every key in the section, add it to the array
         switch (type) {
             case SECTION_TYPE_FLOAT: {
                 f32 *section = get_section_mem(s);
                 if (!section)
-                    return NULL;
+                    break;
                 for (u32 v = 0; v < CONFIG_SECTION_SIZE; v++) {
-                    if (section[v + 1] != CONFIG_END_MAGIC && v < CONFIG_SECTION_SIZE - 1) {
-                        json_array_append_number(values, section[v]);
-                    } else {
-                        json_array_append_number(values, section[v]);
+                    jsonw_number(json, section[v]);
+                    if (v + 1 >= CONFIG_SECTION_SIZE || section[v + 1] == CONFIG_END_MAGIC)
                         break;
-                    }
                 }
                 break;
             }
@@ -147,8 +131,8 @@ static char *get_entire_config() {
                 // I didn't feel like looping this and plus, there's only one string section
                 switch (s) {
                     case CONFIG_WIFI:
-                        json_array_append_string(values, config.wifi.ssid);
-                        json_array_append_string(values, config.wifi.pass);
+                        jsonw_string(json, config.wifi.ssid);
+                        jsonw_string(json, config.wifi.pass);
                         break;
                     default:
                         break;
@@ -156,34 +140,30 @@ static char *get_entire_config() {
                 break;
             }
             default:
-                return NULL; // This should never happen
+                break; // This should never happen
         }
-        json_object_set_value(section, "values", valuesArr);
-        json_array_append_value(sections, sectionObj);
+        jsonw_array_end(json);
+        jsonw_object_end(json);
     }
-    json_object_set_value(obj, "sections", sectionsArr);
-    char *serialized = json_serialize_to_string(root);
-    json_value_free(root);
-    return serialized;
+    jsonw_array_end(json);
+    jsonw_object_end(json);
 }
 
-i32 api_handle_get_config(const char *input, char **output) {
-    char *serialized = NULL;
+i32 api_handle_get_config(const char *input, JSONWriter *json) {
     if (input) {
         // Arguments are present, parse them to figure out what config value to get
         char *section = NULL, *key = NULL;
         if (!parse_args(input, &section, &key))
             return 400;
-        serialized = get_config_value(section, key);
+        bool found = get_config_value(json, section, key);
         free(section);
         free(key);
-        if (!serialized)
+        if (!found)
             return 400;
     } else {
         // No arguments were given, return all config values
-        serialized = get_entire_config();
+        get_entire_config(json);
     }
-    *output = serialized;
     return 200;
 }
 
@@ -194,14 +174,12 @@ i32 api_handle_get_config(const char *input, char **output) {
 // {"sections":[{"name":"","keys":[number|""]}]}
 
 i32 api_get_config(const char *args) {
-    char *output = NULL;
-    i32 res = api_handle_get_config(args, &output);
-    if (res != 200 || !output) {
-        if (output)
-            json_free_serialized_string(output);
-        return res;
-    }
-    printraw("%s\n", output);
-    json_free_serialized_string(output);
+    char buf[API_JSON_BUFFER_SIZE];
+    JSONWriter json;
+    api_json_begin(&json, buf, sizeof(buf));
+    i32 res = api_handle_get_config(args, &json);
+    if (res != 200)
+        return res; // Nothing was written
+    api_json_end(&json);
     return -1;
 }
@@ -2,14 +2,15 @@
 
 #include "platform/types.h"
 
+#include "lib/jsonwriter.h"
+
 /**
- * Internal use version of the API command GET_CONFIG, which returns output directly.
+ * Internal use version of the API command GET_CONFIG, which writes its output to a JSON writer.
  * @param input the input to the command, same as it would be passed to the API
- * @param output pointer to where the output should be stored, allocated by the function
+ * @param json the writer to write the output to
  * @return the status code of the operation
- * @note The caller is responsible for freeing the memory allocated for the output.
- * Both json_free_serialized_string() and free() can be used.
+ * @note Nothing is written unless the operation succeeds; the document is written but not finished (see `jsonw_finish()`).
  */
-i32 api_handle_get_config(const char *input, char **output);
+i32 api_handle_get_config(const char *input, JSONWriter *json);
 
 i32 api_get_config(const char *args);
@@ -3,16 +3,60 @@
  * Licensed under the GNU AGPL-3.0
  */
 
+#include "platform/helpers.h"
+
+#include "sys/api/api.h"
 #include "sys/flightplan.h"
-#include "sys/print.h"
 
 #include "get_flightplan.h"
 
+static void write_waypoint(JSONWriter *json, const Waypoint *wpt) {
+    jsonw_object_begin(json);
+    jsonw_key_number(json, "lat", wpt->lat);
+    jsonw_key_number(json, "lng", wpt->lng);
+    jsonw_key_number(json, "alt", wpt->alt);
+    jsonw_key_number(json, "speed", wpt->speed);
+    jsonw_key_number(json, "drop", wpt->drop);
+    jsonw_object_end(json);
+}
+
+i32 api_handle_get_flightplan(const char *input, JSONWriter *json) {
+    Flightplan *fplan = flightplan_get();
+    if (!fplan)
+        return 403;
+    jsonw_object_begin(json);
+    jsonw_key_string(json, "version", fplan->version);
+    jsonw_key_string(json, "version_fw", fplan->version_fw);
+    jsonw_key_number(json, "alt_samples", fplan->alt_samples);
+    jsonw_key(json, "waypoints");
+    jsonw_array_begin(json);
+    // Waypoints are read from flash a few at a time, so the whole Flightplan is never held in memory
+    Waypoint wpts[4];
+    for (u32 i = 0; i < fplan->waypoint_count;) {
+        u32 read = flightplan_read_waypoints(i, wpts, count_of(wpts));
+        if (read == 0)
+            break;
+        for (u32 w = 0; w < read; w++)
+            write_waypoint(json, &wpts[w]);
+        i += read;
+    }
+    jsonw_array_end(json);
+    jsonw_object_end(json);
+    return 200;
+    (void)input;
+}
+
+// Output:
+// {"version":"","version_fw":"","alt_samples":number,"waypoints":[{"lat":number,"lng":number,"alt":number,"speed":number,
+// "drop":number}]}
+
 i32 api_get_flightplan(const char *args) {
-    if (flightplan_was_parsed()) {
-        printraw("%s\n", flightplan_get()->json);
-        return -1;
-    } else
+    if (!flightplan_was_parsed())
         return 403;
-    (void)args;
+    char buf[API_JSON_BUFFER_SIZE];
+    JSONWriter json;
+    api_json_begin(&json, buf, sizeof(buf));
+    api_handle_get_flightplan(args, &json);
+    api_json_end(&json);
+    return -1;
 }
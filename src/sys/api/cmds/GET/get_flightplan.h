@@ -2,4 +2,15 @@
 
 #include "platform/types.h"
 
+#include "lib/jsonwriter.h"
+
+/**
+ * Internal use version of the API command GET_FLIGHTPLAN, which writes its output to a JSON writer.
+ * @param input the input to the command, same as it would be passed to the API
+ * @param json the writer to write the output to
+ * @return the status code of the operation
+ * @note Nothing is written unless the operation succeeds; the document is written but not finished (see `jsonw_finish()`).
+ */
+i32 api_handle_get_flightplan(const char *input, JSONWriter *json);
+
 i32 api_get_flightplan(const char *args);
@@ -5,40 +5,30 @@
 
 #include "platform/defs.h"
 
-#include "lib/parson.h"
-
-#include "sys/print.h"
+#include "sys/api/api.h"
 #include "sys/version.h"
 
 #include "get_info.h"
 
-i32 api_handle_get_info(char **output) {
-    JSON_Value *root = json_value_init_object();
-    JSON_Object *obj = json_value_get_object(root);
-    json_object_set_string(obj, "version", PICO_FBW_VERSION);
-    json_object_set_string(obj, "version_api", PICO_FBW_API_VERSION);
-    json_object_set_string(obj, "version_flightplan", FLIGHTPLAN_VERSION);
-    json_object_set_string(obj, "platform", PLATFORM_NAME);
-    json_object_set_string(obj, "platform_version", PLATFORM_VERSION);
-    char *serialized = json_serialize_to_string(root);
-    json_value_free(root);
-    *output = serialized;
+i32 api_handle_get_info(const char *input, JSONWriter *json) {
+    jsonw_object_begin(json);
+    jsonw_key_string(json, "version", PICO_FBW_VERSION);
+    jsonw_key_string(json, "version_api", PICO_FBW_API_VERSION);
+    jsonw_key_string(json, "version_flightplan", FLIGHTPLAN_VERSION);
+    jsonw_key_string(json, "platform", PLATFORM_NAME);
+    jsonw_key_string(json, "platform_version", PLATFORM_VERSION);
+    jsonw_object_end(json);
     return 200;
+    (void)input;
 }
 
 // {"version":"","version_api":"","version_flightplan":"","platform":"","platform_version":""}
 
 i32 api_get_info(const char *args) {
-    char *output = NULL;
-    i32 res = api_handle_get_info(&output);
-    if (!output)
-        return 500;
-    if (res != 200) {
-        json_free_serialized_string(output);
-        return res;
-    }
-    printraw("%s\n", output);
-    json_free_serialized_string(output);
+    char buf[API_JSON_BUFFER_SIZE];
+    JSONWriter json;
+    api_json_begin(&json, buf, sizeof(buf));
+    api_handle_get_info(args, &json);
+    api_json_end(&json);
     return -1;
-    (void)args;
 }
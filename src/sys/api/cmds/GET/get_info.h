@@ -2,13 +2,15 @@
 
 #include "platform/types.h"
 
+#include "lib/jsonwriter.h"
+
 /**
- * Internal use version of the API command GET_INFO, which returns output directly.
- * @param output pointer to where the output should be stored, allocated by the function
+ * Internal use version of the API command GET_INFO, which writes its output to a JSON writer.
+ * @param input the input to the command (unused)
+ * @param json the writer to write the output to
  * @return the status code of the operation
- * @note The caller is responsible for freeing the memory allocated for the output.
- * Both json_free_serialized_string() and free() can be used.
+ * @note The document is written but not finished (see `jsonw_finish()`).
  */
-i32 api_handle_get_info(char **output);
+i32 api_handle_get_info(const char *input, JSONWriter *json);
 
 i32 api_get_info(const char *args);
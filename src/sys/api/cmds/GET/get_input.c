@@ -5,10 +5,8 @@
 
 #include "io/receiver.h"
 
-#include "lib/parson.h"
-
+#include "sys/api/api.h"
 #include "sys/configuration.h"
-#include "sys/print.h"
 
 #include "get_input.h"
 
@@ -16,31 +14,31 @@
 // Only "ail" and "ele" are guaranteed to be present
 
 i32 api_get_input(const char *args) {
-    JSON_Value *root = json_value_init_object();
-    JSON_Object *obj = json_value_get_object(root);
-    json_object_set_number(obj, "ail", receiver_get(config.pins[PINS_INPUT_AIL], RECEIVER_MODE_DEGREE));
-    json_object_set_number(obj, "ele", receiver_get(config.pins[PINS_INPUT_ELE], RECEIVER_MODE_DEGREE));
+    char buf[API_JSON_BUFFER_SIZE];
+    JSONWriter json;
+    api_json_begin(&json, buf, sizeof(buf));
+    jsonw_object_begin(&json);
+    jsonw_key_number(&json, "ail", receiver_get(config.pins[PINS_INPUT_AIL], RECEIVER_MODE_DEGREE));
+    jsonw_key_number(&json, "ele", receiver_get(config.pins[PINS_INPUT_ELE], RECEIVER_MODE_DEGREE));
     switch ((ControlMode)config.general[GENERAL_CONTROL_MODE]) {
         case CTRLMODE_3AXIS_ATHR:
-            json_object_set_number(obj, "thr", receiver_get(config.pins[PINS_INPUT_THROTTLE], RECEIVER_MODE_PERCENT));
+            jsonw_key_number(&json, "thr", receiver_get(config.pins[PINS_INPUT_THROTTLE], RECEIVER_MODE_PERCENT));
         /* fall through */
         case CTRLMODE_3AXIS:
-            json_object_set_number(obj, "rud", receiver_get(config.pins[PINS_INPUT_RUD], RECEIVER_MODE_DEGREE));
-            json_object_set_number(obj, "switch", receiver_get(config.pins[PINS_INPUT_SWITCH], RECEIVER_MODE_DEGREE));
+            jsonw_key_number(&json, "rud", receiver_get(config.pins[PINS_INPUT_RUD], RECEIVER_MODE_DEGREE));
+            jsonw_key_number(&json, "switch", receiver_get(config.pins[PINS_INPUT_SWITCH], RECEIVER_MODE_DEGREE));
             break;
         case CTRLMODE_2AXIS_ATHR:
         case CTRLMODE_FLYINGWING_ATHR:
-            json_object_set_number(obj, "thr", receiver_get(config.pins[PINS_INPUT_THROTTLE], RECEIVER_MODE_PERCENT));
+            jsonw_key_number(&json, "thr", receiver_get(config.pins[PINS_INPUT_THROTTLE], RECEIVER_MODE_PERCENT));
         /* fall through */
         case CTRLMODE_2AXIS:
         case CTRLMODE_FLYINGWING:
-            json_object_set_number(obj, "switch", receiver_get(config.pins[PINS_INPUT_SWITCH], RECEIVER_MODE_DEGREE));
+            jsonw_key_number(&json, "switch", receiver_get(config.pins[PINS_INPUT_SWITCH], RECEIVER_MODE_DEGREE));
             break;
     }
-    char *serialized = json_serialize_to_string(root);
-    printraw("%s\n", serialized);
-    json_free_serialized_string(serialized);
-    json_value_free(root);
+    jsonw_object_end(&json);
+    api_json_end(&json);
     return -1;
     (void)args;
 }
@@ -3,38 +3,131 @@
  * Licensed under the GNU AGPL-3.0
  */
 
+#include <stdbool.h>
+
+#include "platform/helpers.h"
+
 #include "lib/parson.h"
 
+#include "sys/api/api.h"
 #include "sys/log.h"
-#include "sys/print.h"
 
 #include "get_logs.h"
 
-// {"logs":[{"type":number,"msg":"","code":number,"timestamp":number}]}
+typedef struct LogsPage {
+    u32 offset; // Index of the first entry
+    u32 limit;  // Most entries in the page
+    bool saved; // Whether the entries are the ones saved to the filesystem (including previous boots) or the ones in RAM
+} LogsPage;
 
-i32 api_get_logs(const char *args) {
-    u32 logCount = log_count();
-    if (logCount == 0)
-        return 204;
-    JSON_Value *root = json_value_init_object();
+/**
+ * Helper to parse command arguments.
+ * @param args command arguments, or NULL if none were given
+ * @param page pointer to store the requested page
+ * @return true if the arguments were parsed successfully
+ */
+static bool parse_args(const char *args, LogsPage *page) {
+    *page = (LogsPage){.offset = 0, .limit = GET_LOGS_LIMIT_MAX, .saved = false};
+    if (!args)
+        return true;
+    JSON_Value *root = json_parse_string(args);
+    if (!root)
+        return false;
     JSON_Object *obj = json_value_get_object(root);
-    JSON_Value *logs = json_value_init_array();
-    JSON_Array *arr = json_value_get_array(logs);
-    for (u32 i = 0; i < logCount; i++) {
-        LogEntry *entry = log_get(i);
-        JSON_Value *log = json_value_init_object();
-        JSON_Object *logObj = json_value_get_object(log);
-        json_object_set_number(logObj, "type", entry->type);
-        json_object_set_string(logObj, "msg", entry->msg);
-        json_object_set_number(logObj, "code", entry->code);
-        json_object_set_number(logObj, "timestamp", entry->timestamp);
-        json_array_append_value(arr, log);
+    if (!obj) {
+        json_value_free(root);
+        return false;
     }
-    json_object_set_value(obj, "logs", logs);
-    char *serialized = json_serialize_to_string(root);
-    printraw("%s\n", serialized);
-    json_free_serialized_string(serialized);
+    bool valid = true;
+    if (json_object_has_value(obj, "offset")) {
+        f64 offset = json_object_get_number(obj, "offset");
+        valid = valid && offset >= 0;
+        page->offset = (u32)offset;
+    }
+    if (json_object_has_value(obj, "limit")) {
+        f64 limit = json_object_get_number(obj, "limit");
+        valid = valid && limit >= 1;
+        page->limit = limit > GET_LOGS_LIMIT_MAX ? GET_LOGS_LIMIT_MAX : (u32)limit;
+    }
+    page->saved = json_object_get_boolean(obj, "saved") == 1;
     json_value_free(root);
+    return valid;
+}
+
+static void write_entry(JSONWriter *json, const LogEntry *entry) {
+    jsonw_object_begin(json);
+    jsonw_key_number(json, "type", entry->type);
+    jsonw_key_string(json, "msg", entry->msg);
+    jsonw_key_number(json, "code", entry->code);
+    jsonw_key_number(json, "timestamp", entry->timestamp);
+    jsonw_object_end(json);
+}
+
+static void write_record(JSONWriter *json, const LogRecord *record) {
+    jsonw_object_begin(json);
+    jsonw_key_number(json, "type", record->type);
+    jsonw_key_string(json, "msg", record->msg);
+    jsonw_key_number(json, "code", record->code);
+    jsonw_key_number(json, "timestamp", record->timestamp);
+    jsonw_key_number(json, "boot", record->boot);
+    jsonw_object_end(json);
+}
+
+i32 api_handle_get_logs(const char *input, JSONWriter *json) {
+    LogsPage page;
+    if (!parse_args(input, &page))
+        return 400;
+    u32 total = page.saved ? log_count_saved() : log_count();
+    u32 end = page.offset < total ? page.offset + page.limit : page.offset;
+    if (end > total)
+        end = total;
+
+    jsonw_object_begin(json);
+    jsonw_key(json, "logs");
+    jsonw_array_begin(json);
+    if (page.saved) {
+        // Saved entries are read from flash a few at a time
+        LogRecord records[4];
+        for (u32 i = page.offset; i < end;) {
+            u32 max = end - i < count_of(records) ? end - i : count_of(records);
+            u32 read = log_read_saved(i, records, max);
+            if (read == 0)
+                break;
+            for (u32 r = 0; r < read; r++)
+                write_record(json, &records[r]);
+            i += read;
+        }
+    } else {
+        for (u32 i = page.offset; i < end; i++)
+            write_entry(json, log_get(i));
+    }
+    jsonw_array_end(json);
+    jsonw_key_number(json, "total", total);
+    if (page.saved)
+        jsonw_key_number(json, "boot", log_boot());
+    if (end < total)
+        jsonw_key_number(json, "next", end);
+    jsonw_object_end(json);
+    return 200;
+}
+
+// Input (optional):
+// {"offset":number,"limit":number,"saved":bool}
+
+// Output:
+// {"logs":[{"type":number,"msg":"","code":number,"timestamp":number,"boot":number}],"total":number,"boot":number,
+// "next":number}
+// "boot" is only present for saved entries, and "next" (the offset of the next page) only if there are more entries
+
+i32 api_get_logs(const char *args) {
+    if (!args && log_count() == 0)
+        return 204;
+    char buf[API_JSON_BUFFER_SIZE];
+    JSONWriter json;
+    api_json_begin(&json, buf, sizeof(buf));
+    i32 res = api_handle_get_logs(args, &json);
+    if (res != 200)
+        return res; // Nothing was written
+    api_json_end(&json);
     return -1;
-    (void)args;
 }
@@ -3,24 +3,22 @@
  * Licensed under the GNU AGPL-3.0
  */
 
-#include "lib/parson.h"
-
 #include "modes/aircraft.h"
 
-#include "sys/print.h"
+#include "sys/api/api.h"
 
 #include "get_mode.h"
 
 // {"mode":number}
 
 i32 api_get_mode(const char *args) {
-    JSON_Value *root = json_value_init_object();
-    JSON_Object *obj = json_value_get_object(root);
-    json_object_set_number(obj, "mode", aircraft.mode);
-    char *serialized = json_serialize_to_string(root);
-    printraw("%s\n", serialized);
-    json_free_serialized_string(serialized);
-    json_value_free(root);
+    char buf[API_JSON_BUFFER_SIZE];
+    JSONWriter json;
+    api_json_begin(&json, buf, sizeof(buf));
+    jsonw_object_begin(&json);
+    jsonw_key_number(&json, "mode", aircraft.mode);
+    jsonw_object_end(&json);
+    api_json_end(&json);
     return -1;
     (void)args;
 }
@@ -0,0 +1,64 @@
+/**
+ * Source file of pico-fbw: https://github.com/pico-fbw/pico-fbw
+ * Licensed under the GNU AGPL-3.0
+ */
+
+#include "sys/api/api.h"
+#include "sys/perf.h"
+#include "sys/scheduler.h"
+
+#include "get_perf.h"
+
+i32 api_handle_get_perf(const char *input, JSONWriter *json) {
+    jsonw_object_begin(json);
+    jsonw_key(json, "stages");
+    jsonw_array_begin(json);
+    for (PerfStage s = 0; s < PERF_STAGE_COUNT; s++) {
+        PerfStats stats;
+        perf_get(s, &stats);
+        jsonw_object_begin(json);
+        jsonw_key_string(json, "name", perf_stage_name(s));
+        jsonw_key_number(json, "min", stats.min);
+        jsonw_key_number(json, "max", stats.max);
+        jsonw_key_number(json, "mean", stats.mean);
+        jsonw_key_number(json, "p99", stats.p99);
+        jsonw_key_number(json, "samples", stats.samples);
+        jsonw_key_number(json, "overruns", stats.overruns);
+        jsonw_key_number(json, "budget", stats.budget);
+        jsonw_object_end(json);
+    }
+    jsonw_array_end(json);
+
+    jsonw_key(json, "tasks");
+    jsonw_array_begin(json);
+    for (u32 i = 0; i < scheduler_count(); i++) {
+        const Task *t = scheduler_get((i32)i);
+        jsonw_object_begin(json);
+        jsonw_key_string(json, "name", t->name);
+        jsonw_key_number(json, "period", t->period);
+        jsonw_key_number(json, "deadline", t->deadline);
+        jsonw_key_number(json, "priority", t->priority);
+        jsonw_key_number(json, "runs", t->runs);
+        jsonw_key_number(json, "overruns", t->overruns);
+        jsonw_key_number(json, "skips", t->skips);
+        jsonw_key_number(json, "max", t->maxRuntime);
+        jsonw_object_end(json);
+    }
+    jsonw_array_end(json);
+    jsonw_object_end(json);
+    return 200;
+    (void)input;
+}
+
+// {"stages":[{"name":"","min":number,"max":number,"mean":number,"p99":number,"samples":number,"overruns":number,
+// "budget":number}],"tasks":[{"name":"","period":number,"deadline":number,"priority":number,"runs":number,"overruns":number,
+// "skips":number,"max":number}]}
+
+i32 api_get_perf(const char *args) {
+    char buf[API_JSON_BUFFER_SIZE];
+    JSONWriter json;
+    api_json_begin(&json, buf, sizeof(buf));
+    api_handle_get_perf(args, &json);
+    api_json_end(&json);
+    return -1;
+}
@@ -0,0 +1,16 @@
+#pragma once
+
+#include "platform/types.h"
+
+#include "lib/jsonwriter.h"
+
+/**
+ * Internal use version of the API command GET_PERF, which writes its output to a JSON writer.
+ * @param input the input to the command (unused)
+ * @param json the writer to write the output to
+ * @return the status code of the operation
+ * @note The document is written but not finished (see `jsonw_finish()`).
+ */
+i32 api_handle_get_perf(const char *input, JSONWriter *json);
+
+i32 api_get_perf(const char *args);
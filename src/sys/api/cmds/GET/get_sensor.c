@@ -14,8 +14,8 @@
 
 #include "modes/aircraft.h"
 
+#include "sys/api/api.h"
 #include "sys/configuration.h"
-#include "sys/print.h"
 
 #include "get_sensor.h"
 
@@ -27,86 +27,66 @@ typedef enum SensorData {
     DATA_BATT,
 } SensorData;
 
-/**
- * @return JSON object with AAHRS data, or NULL on error
- */
-static JSON_Value *create_aahrs_obj() {
-    JSON_Value *aahrsObj = json_value_init_object();
-    if (!aahrsObj)
-        return NULL;
-    JSON_Object *obj = json_value_get_object(aahrsObj);
+static void write_aahrs(JSONWriter *json) {
+    jsonw_object_begin(json);
     if (aircraft.aahrsSafe) {
-        json_object_set_number(obj, "roll", aahrs.roll);
-        json_object_set_number(obj, "pitch", aahrs.pitch);
-        json_object_set_number(obj, "yaw", aahrs.yaw);
-        json_object_set_number(obj, "roll_rate", aahrs.rollRate);
-        json_object_set_number(obj, "pitch_rate", aahrs.pitchRate);
-        json_object_set_number(obj, "yaw_rate", aahrs.yawRate);
-        json_object_set_number(obj, "accel_x", aahrs.accel[0]);
-        json_object_set_number(obj, "accel_y", aahrs.accel[1]);
-        json_object_set_number(obj, "accel_z", aahrs.accel[2]);
+        jsonw_key_number(json, "roll", aahrs.roll);
+        jsonw_key_number(json, "pitch", aahrs.pitch);
+        jsonw_key_number(json, "yaw", aahrs.yaw);
+        jsonw_key_number(json, "roll_rate", aahrs.rollRate);
+        jsonw_key_number(json, "pitch_rate", aahrs.pitchRate);
+        jsonw_key_number(json, "yaw_rate", aahrs.yawRate);
+        jsonw_key_number(json, "accel_x", aahrs.accel[0]);
+        jsonw_key_number(json, "accel_y", aahrs.accel[1]);
+        jsonw_key_number(json, "accel_z", aahrs.accel[2]);
     } else {
-        json_object_set_null(obj, "roll");
-        json_object_set_null(obj, "pitch");
-        json_object_set_null(obj, "yaw");
-        json_object_set_null(obj, "roll_rate");
-        json_object_set_null(obj, "pitch_rate");
-        json_object_set_null(obj, "yaw_rate");
-        json_object_set_null(obj, "accel_x");
-        json_object_set_null(obj, "accel_y");
-        json_object_set_null(obj, "accel_z");
+        jsonw_key_null(json, "roll");
+        jsonw_key_null(json, "pitch");
+        jsonw_key_null(json, "yaw");
+        jsonw_key_null(json, "roll_rate");
+        jsonw_key_null(json, "pitch_rate");
+        jsonw_key_null(json, "yaw_rate");
+        jsonw_key_null(json, "accel_x");
+        jsonw_key_null(json, "accel_y");
+        jsonw_key_null(json, "accel_z");
     }
-    return aahrsObj;
+    jsonw_object_end(json);
 }
 
-/**
- * @return JSON object with GPS data, or NULL on error
- */
-static JSON_Value *create_gps_obj() {
-    JSON_Value *gpsObj = json_value_init_object();
-    if (!gpsObj)
-        return NULL;
-    JSON_Object *obj = json_value_get_object(gpsObj);
+static void write_gps(JSONWriter *json) {
+    jsonw_object_begin(json);
     if (aircraft.gpsSafe && gps.is_supported()) {
-        json_object_set_number(obj, "lat", gps.lat);
-        json_object_set_number(obj, "lng", gps.lng);
-        json_object_set_number(obj, "alt", gps.alt);
-        json_object_set_number(obj, "speed", gps.speed);
-        json_object_set_number(obj, "track", gps.track);
-        json_object_set_number(obj, "pdop", gps.pdop);
-        json_object_set_number(obj, "hdop", gps.hdop);
-        json_object_set_number(obj, "vdop", gps.vdop);
-        json_object_set_number(obj, "sats", gps.sats);
+        jsonw_key_number(json, "lat", gps.lat);
+        jsonw_key_number(json, "lng", gps.lng);
+        jsonw_key_number(json, "alt", gps.alt);
+        jsonw_key_number(json, "speed", gps.speed);
+        jsonw_key_number(json, "track", gps.track);
+        jsonw_key_number(json, "pdop", gps.pdop);
+        jsonw_key_number(json, "hdop", gps.hdop);
+        jsonw_key_number(json, "vdop", gps.vdop);
+        jsonw_key_number(json, "sats", gps.sats);
     } else {
-        json_object_set_null(obj, "lat");
-        json_object_set_null(obj, "lng");
-        json_object_set_null(obj, "alt");
-        json_object_set_null(obj, "speed");
-        json_object_set_null(obj, "track");
-        json_object_set_null(obj, "pdop");
-        json_object_set_null(obj, "hdop");
-        json_object_set_null(obj, "vdop");
-        json_object_set_null(obj, "sats");
+        jsonw_key_null(json, "lat");
+        jsonw_key_null(json, "lng");
+        jsonw_key_null(json, "alt");
+        jsonw_key_null(json, "speed");
+        jsonw_key_null(json, "track");
+        jsonw_key_null(json, "pdop");
+        jsonw_key_null(json, "hdop");
+        jsonw_key_null(json, "vdop");
+        jsonw_key_null(json, "sats");
     }
-    return gpsObj;
+    jsonw_object_end(json);
 }
 
-/**
- * @return JSON array with battery data, or NULL on error
- */
-static JSON_Value *create_batt_arr() {
 #if PLATFORM_SUPPORTS_ADC
-    JSON_Value *battArr = json_value_init_array();
-    if (!battArr)
-        return NULL;
-    JSON_Array *arr = json_value_get_array(battArr);
+static void write_batt(JSONWriter *json) {
+    jsonw_array_begin(json);
     for (u32 i = 0; i < ADC_NUM_CHANNELS; i++)
-        json_array_append_number(arr, adc_read_raw(ADC_PINS[i]));
-    return battArr;
-#else
-    return json_value_init_array();
-#endif
+        jsonw_number(json, adc_read_raw(ADC_PINS[i]));
+    jsonw_array_end(json);
 }
+#endif
 
 static SensorData parse_args(const char *args) {
     JSON_Value *root = json_parse_string(args);
@@ -152,54 +132,33 @@ i32 api_get_sensor(const char *args) {
     SensorData data = parse_args(args);
     if (data == DATA_INVALID)
         return 400;
-
-    // Generate all response data, regardless of the request
-    JSON_Value *root = json_value_init_object();
-    JSON_Object *obj = json_value_get_object(root);
-    JSON_Value *aahrsObj = create_aahrs_obj();
-    JSON_Value *gpsObj = create_gps_obj();
-    JSON_Value *battArr = create_batt_arr();
-    if (!aahrsObj || !gpsObj || !battArr)
-        return 500;
-
-    // Now, include response data selectively based on the request
-    switch (data) {
-        default:
-        case DATA_ALL:
-            json_object_set_value(obj, "aahrs", aahrsObj);
-            json_object_set_value(obj, "gps", gpsObj);
-#if PLATFORM_SUPPORTS_ADC
-            json_object_set_value(obj, "batt", battArr);
+    if (data == DATA_GPS && !gps.is_supported())
+        return 403;
+#if !PLATFORM_SUPPORTS_ADC
+    if (data == DATA_BATT)
+        return 403;
 #endif
-            break;
-        case DATA_AAHRS:
-            json_object_set_value(obj, "aahrs", aahrsObj);
-            break;
-        case DATA_GPS:
-            if (!gps.is_supported()) {
-                json_value_free(battArr);
-                json_value_free(gpsObj);
-                json_value_free(aahrsObj);
-                json_value_free(root);
-                return 403;
-            }
-            json_object_set_value(obj, "gps", gpsObj);
-            break;
-        case DATA_BATT:
+
+    // Include response data selectively based on the request
+    char buf[API_JSON_BUFFER_SIZE];
+    JSONWriter json;
+    api_json_begin(&json, buf, sizeof(buf));
+    jsonw_object_begin(&json);
+    if (data == DATA_ALL || data == DATA_AAHRS) {
+        jsonw_key(&json, "aahrs");
+        write_aahrs(&json);
+    }
+    if (data == DATA_ALL || data == DATA_GPS) {
+        jsonw_key(&json, "gps");
+        write_gps(&json);
+    }
 #if PLATFORM_SUPPORTS_ADC
-            json_object_set_value(obj, "batt", battArr);
-#else
-            json_value_free(battArr);
-            json_value_free(gpsObj);
-            json_value_free(aahrsObj);
-            json_value_free(root);
-            return 403;
-#endif
-            break;
+    if (data == DATA_ALL || data == DATA_BATT) {
+        jsonw_key(&json, "batt");
+        write_batt(&json);
     }
-    char *serialized = json_serialize_to_string(root);
-    printraw("%s\n", serialized);
-    json_free_serialized_string(serialized);
-    json_value_free(root);
+#endif
+    jsonw_object_end(&json);
+    api_json_end(&json);
     return -1;
 }
@@ -5,16 +5,16 @@
 
 #include "platform/defs.h"
 
-#include "sys/print.h"
+#include "sys/api/api.h"
 #include "sys/version.h"
 
 #include "about.h"
 
 i32 api_about(const char *args) {
-    printraw("pico-fbw v%s, API v%s\n", PICO_FBW_VERSION, PICO_FBW_API_VERSION);
-    printraw("Built on %s at %s (C%ld) for \"%s\", HAL v%s\n\n", __DATE__, __TIME__, __STDC_VERSION__, PLATFORM_NAME,
+    api_print("pico-fbw v%s, API v%s\n", PICO_FBW_VERSION, PICO_FBW_API_VERSION);
+    api_print("Built on %s at %s (C%ld) for \"%s\", HAL v%s\n\n", __DATE__, __TIME__, __STDC_VERSION__, PLATFORM_NAME,
              PLATFORM_VERSION);
-    printraw("Copyright (C) 2023-2024 pico-fbw\n\n"
+    api_print("Copyright (C) 2023-2024 pico-fbw\n\n"
              "This program is free software: you can redistribute it and/or modify "
              "it under the terms of the GNU Affero General Public License as published by "
              "the Free Software Foundation, either version 3 of the License, or "
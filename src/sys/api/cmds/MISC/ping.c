@@ -3,14 +3,20 @@
  * Licensed under the GNU AGPL-3.0
  */
 
-#include "sys/print.h"
+#include "sys/api/api.h"
 
 #include "ping.h"
 
 // I know, this file is crazy, you can thank me later :)
 
+i32 api_handle_ping(const char *input, JSONWriter *json) {
+    return 200;
+    (void)input;
+    (void)json;
+}
+
 i32 api_ping(const char *args) {
-    printraw("PONG\n");
+    api_print("PONG\n");
     return -1;
     (void)args;
 }
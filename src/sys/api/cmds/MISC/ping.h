@@ -2,4 +2,14 @@
 
 #include "platform/types.h"
 
+#include "lib/jsonwriter.h"
+
+/**
+ * Internal use version of the API command PING.
+ * @param input the input to the command (unused)
+ * @param json the writer to write the output to (nothing is written)
+ * @return the status code of the operation
+ */
+i32 api_handle_ping(const char *input, JSONWriter *json);
+
 i32 api_ping(const char *args);
@@ -7,18 +7,18 @@
 #include "platform/gpio.h"
 #include "platform/sys.h"
 
+#include "sys/api/api.h"
 #include "sys/configuration.h"
-#include "sys/print.h"
 #include "sys/runtime.h"
 
 #include "reset.h"
 
 i32 api_reset(const char *args) {
-    printraw("This will erase ALL user data stored on the device!\nReset will occur in 10 seconds...power off the device to "
+    api_print("This will erase ALL user data stored on the device!\nReset will occur in 10 seconds...power off the device to "
              "cancel.\n");
     runtime_sleep_ms(10000, false);
     config_reset();
-    printraw("Reset complete. Shutting down...\n");
+    api_print("Reset complete. Shutting down...\n");
 #ifdef PIN_LED
     gpio_set(PIN_LED, STATE_LOW);
 #endif
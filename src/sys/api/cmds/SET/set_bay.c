@@ -7,7 +7,6 @@
 
 #include "lib/parson.h"
 
-#include "modes/aircraft.h"
 #include "modes/auto.h"
 
 #include "set_bay.h"
@@ -47,9 +46,6 @@ static BayPosition parse_args(const char *args) {
 // {"position":"open|closed"}
 
 i32 api_set_bay(const char *args) {
-    if (aircraft.mode != MODE_NORMAL)
-        return 403;
-
     BayPosition position = parse_args(args);
     if (position == POS_INVALID)
         return 400;
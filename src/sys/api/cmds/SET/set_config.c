@@ -12,7 +12,7 @@
 
 #include "set_config.h"
 
-i32 api_handle_set_config(const char *input) {
+i32 api_handle_set_config(const char *input, JSONWriter *json) {
     if (!input)
         goto save; // No input, trigger a save to flash
 
@@ -58,6 +58,7 @@ save:
         return 400;
     config_save();
     return 200;
+    (void)json;
 }
 
 // {"changes":[{"section":"","key":"","value":""}, ...], "save":boolean}
@@ -68,5 +69,5 @@ save:
 // and save the changes to flash
 
 i32 api_set_config(const char *args) {
-    return api_handle_set_config(args);
+    return api_handle_set_config(args, NULL);
 }
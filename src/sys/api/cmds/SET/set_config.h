@@ -2,11 +2,14 @@
 
 #include "platform/types.h"
 
+#include "lib/jsonwriter.h"
+
 /**
  * Internal use version of the API command SET_CONFIG.
  * @param input the input to the command, same as it would be passed to the API
+ * @param json the writer to write the output to (nothing is written)
  * @return the status code of the operation
  */
-i32 api_handle_set_config(const char *input);
+i32 api_handle_set_config(const char *input, JSONWriter *json);
 
 i32 api_set_config(const char *args);
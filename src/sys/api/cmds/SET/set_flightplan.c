@@ -3,34 +3,27 @@
  * Licensed under the GNU AGPL-3.0
  */
 
-#include "lib/parson.h"
-
-#include "modes/aircraft.h"
-
+#include "sys/api/api.h"
 #include "sys/flightplan.h"
-#include "sys/print.h"
 
 #include "set_flightplan.h"
 
-i32 api_handle_set_flightplan(const char *input, char **output) {
+i32 api_handle_set_flightplan(const char *input, JSONWriter *json) {
     if (!input)
         return 400;
-    if (aircraft.mode == MODE_AUTO)
-        return 403;
-    JSON_Value *root = json_value_init_object();
-    JSON_Object *obj = json_value_get_object(root);
     i32 res;
+    const char *message = "";
     FlightplanError err = flightplan_parse(input, true);
     switch (err) {
         case FLIGHTPLAN_STATUS_OK:
             res = 200;
             break;
         case FLIGHTPLAN_STATUS_GPS_OFFSET:
-            json_object_set_string(obj, "message", FLIGHTPLAN_MSG_STATUS_GPS_OFFSET);
+            message = FLIGHTPLAN_MSG_STATUS_GPS_OFFSET;
             res = -1;
             break;
         case FLIGHTPLAN_WARN_FW_VERSION:
-            json_object_set_string(obj, "message", FLIGHTPLAN_MSG_WARN_FW_VERSION);
+            message = FLIGHTPLAN_MSG_WARN_FW_VERSION;
             res = 200;
             break;
         case FLIGHTPLAN_ERR_PARSE:
@@ -41,11 +34,9 @@ i32 api_handle_set_flightplan(const char *input, char **output) {
             res = 500;
             break;
     }
-    if (json_object_get_string(obj, "message") == NULL)
-        json_object_set_string(obj, "message", "");
-    char *serialized = json_serialize_to_string(root);
-    json_value_free(root);
-    *output = serialized;
+    jsonw_object_begin(json);
+    jsonw_key_string(json, "message", message);
+    jsonw_object_end(json);
     return res;
 }
 
@@ -53,15 +44,15 @@ i32 api_handle_set_flightplan(const char *input, char **output) {
 // {"message":""}
 
 i32 api_set_flightplan(const char *args) {
-    char *output = NULL;
-    i32 res = api_handle_set_flightplan(args, &output);
-    if (!output)
-        return 500;
-    if (res != 200 && res != -1) {
-        json_free_serialized_string(output);
+    // The output is short, and only printed on success, so it's held in the buffer until then
+    char buf[API_JSON_BUFFER_SIZE];
+    JSONWriter json;
+    jsonw_init(&json, buf, sizeof(buf));
+    i32 res = api_handle_set_flightplan(args, &json);
+    if (res != 200 && res != -1)
         return res;
-    }
-    printraw("%s\n", output);
-    json_free_serialized_string(output);
+    if (jsonw_finish(&json) == 0)
+        return 500;
+    api_print("%s\n", buf);
     return res;
 }
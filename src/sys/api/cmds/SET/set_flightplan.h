@@ -2,14 +2,16 @@
 
 #include "platform/types.h"
 
+#include "lib/jsonwriter.h"
+
 /**
- * Internal use version of the API command SET_FLIGHTPLAN.
+ * Internal use version of the API command SET_FLIGHTPLAN, which writes its output to a JSON writer.
  * @param input the input to the command, same as it would be passed to the API
- * @param output pointer to where the output should be stored, allocated by the function
+ * @param json the writer to write the output to
  * @return the status code of the operation
- * @note The caller is responsible for freeing the memory allocated for the output.
- * Both json_free_serialized_string() and free() can be used.
+ * @note Nothing is written if there is no input (400); the document is written but not
+ * finished (see `jsonw_finish()`).
  */
-i32 api_handle_set_flightplan(const char *input, char **output);
+i32 api_handle_set_flightplan(const char *input, JSONWriter *json);
 
 i32 api_set_flightplan(const char *args);
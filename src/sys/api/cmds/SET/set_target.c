@@ -8,7 +8,6 @@
 
 #include "lib/parson.h"
 
-#include "modes/aircraft.h"
 #include "modes/normal.h"
 
 #include "sys/configuration.h"
@@ -64,9 +63,6 @@ static bool parse_args(const char *args, f32 *roll, f32 *pitch, f32 *yaw, f32 *t
 // {"roll":number,"pitch":number,"yaw":number,"throttle":number}
 
 i32 api_set_target(const char *args) {
-    if (aircraft.mode != MODE_NORMAL)
-        return 403;
-
     f32 roll, pitch, yaw, throttle;
     if (!parse_args(args, &roll, &pitch, &yaw, &throttle))
         return 400;
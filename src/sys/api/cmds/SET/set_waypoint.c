@@ -8,7 +8,6 @@
 
 #include "lib/parson.h"
 
-#include "modes/aircraft.h"
 #include "modes/auto.h"
 
 #include "sys/flightplan.h"
@@ -73,9 +72,6 @@ static bool parse_args(const char *args, Waypoint *wpt) {
 // {"lat":number,"lng":number,"alt":number,"speed":number,"drop":number}
 
 i32 api_set_waypoint(const char *args) {
-    if (aircraft.mode != MODE_AUTO)
-        return 403;
-
     Waypoint wpt;
     if (!parse_args(args, &wpt) || !waypoint_is_valid(&wpt))
         return 400;
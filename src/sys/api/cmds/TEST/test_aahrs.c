@@ -5,7 +5,6 @@
 
 #include <stdbool.h>
 #include <stdlib.h>
-#include "platform/sys.h"
 #include "platform/time.h"
 
 #include "io/aahrs.h"
@@ -55,8 +54,8 @@ static bool wait_for_axis(IMUAxis axis, u32 breakpoint, u32 timeout_ms) {
             moved = IMU_AXIS_YAW;
             break;
         }
-        aahrs.update();
-        sys_periodic();
+        // AAHRS is updated by the runtime at its fixed rate
+        runtime_loop(false);
     }
     return moved == axis;
 }
@@ -5,7 +5,7 @@
 
 #include "platform/helpers.h"
 
-#include "sys/print.h"
+#include "sys/api/api.h"
 
 #include "test_aahrs.h"
 #include "test_gps.h"
@@ -27,26 +27,26 @@ i32 api_test_all(const char *args) {
         if (status[i] == 200)
             passed++;
     }
-    printraw("========== TEST RESULTS ==========");
-    printraw("\nAAHRS: %lu", status[0]);
+    api_print("========== TEST RESULTS ==========");
+    api_print("\nAAHRS: %lu", status[0]);
     if (status[0] == 200)
-        printraw(" (PASSED)");
-    printraw("\nGPS:   %lu", status[1]);
+        api_print(" (PASSED)");
+    api_print("\nGPS:   %lu", status[1]);
     if (status[1] == 200)
-        printraw(" (PASSED, VERIFY)"); // "PASSED, VERIFY" results require more manual verification
-    printraw("\nPWM:   %lu", status[2]);
+        api_print(" (PASSED, VERIFY)"); // "PASSED, VERIFY" results require more manual verification
+    api_print("\nPWM:   %lu", status[2]);
     if (status[2] == 200)
-        printraw(" (PASSED)");
-    printraw("\nSERVO: %lu", status[3]);
+        api_print(" (PASSED)");
+    api_print("\nSERVO: %lu", status[3]);
     if (status[3] == 200)
-        printraw(" (PASSED, VERIFY)");
-    printraw("\nTHROTTLE: %lu", status[4]);
+        api_print(" (PASSED, VERIFY)");
+    api_print("\nTHROTTLE: %lu", status[4]);
     if (status[4] == 200)
-        printraw(" (PASSED, VERIFY)");
-    printraw("\nTOTAL: %lu/%i", passed, count_of(status));
+        api_print(" (PASSED, VERIFY)");
+    api_print("\nTOTAL: %lu/%i", passed, count_of(status));
     if (passed == count_of(status))
-        printraw(" PASS");
-    printraw("\n==================================\n");
+        api_print(" PASS");
+    api_print("\n==================================\n");
     if (passed == count_of(status)) {
         return 200;
     } else
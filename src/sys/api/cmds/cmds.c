@@ -3,14 +3,21 @@
  * Licensed under the GNU AGPL-3.0
  */
 
+#include <ctype.h>
+#include <stdlib.h>
 #include <string.h>
 
+#include "platform/helpers.h"
+
+#include "modes/aircraft.h"
+
 #include "GET/get_config.h"
 #include "GET/get_flightplan.h"
 #include "GET/get_info.h"
 #include "GET/get_input.h"
 #include "GET/get_logs.h"
 #include "GET/get_mode.h"
+#include "GET/get_perf.h"
 #include "GET/get_sensor.h"
 
 #include "SET/set_bay.h"
@@ -35,70 +42,118 @@
 
 #include "cmds.h"
 
-i32 api_handle_get(const char *cmd, const char *args) {
-    if (strcasecmp(cmd, "GET_CONFIG") == 0) {
-        return api_get_config(args);
-    } else if (strcasecmp(cmd, "GET_FLIGHTPLAN") == 0) {
-        return api_get_flightplan(args);
-    } else if (strcasecmp(cmd, "GET_INFO") == 0) {
-        return api_get_info(args);
-    } else if (strcasecmp(cmd, "GET_INPUT") == 0) {
-        return api_get_input(args);
-    } else if (strcasecmp(cmd, "GET_LOGS") == 0) {
-        return api_get_logs(args);
-    } else if (strcasecmp(cmd, "GET_MODE") == 0) {
-        return api_get_mode(args);
-    } else if (strcasecmp(cmd, "GET_SENSOR") == 0) {
-        return api_get_sensor(args);
-    } else
-        return 404;
+#define ROUTE_MAX 32 // Longest command name that can be served over HTTP
+
+// Every built-in command, which MUST be kept sorted by name (in strcasecmp() order) so it can be binary searched; adding a
+// command only takes an entry here
+// clang-format off
+static const ApiCommand commands[] = {
+    {"ABOUT", "Display system information", api_about, API_ARGS_NONE, API_MODES_ALL, 0, NULL},
+    {"BINARY", "Switch this session to the binary protocol", NULL, API_ARGS_NONE, API_MODES_ALL, 0, NULL},
+    {"GET_CONFIG", "Get system configuration value(s)", api_get_config, API_ARGS_OPTIONAL, API_MODES_ALL,
+     API_HTTP_GET | API_HTTP_POST, api_handle_get_config},
+    {"GET_FLIGHTPLAN", "Get raw flightplan data", api_get_flightplan, API_ARGS_NONE, API_MODES_ALL, API_HTTP_GET,
+     api_handle_get_flightplan},
+    {"GET_INFO", "Get system information", api_get_info, API_ARGS_NONE, API_MODES_ALL, API_HTTP_GET, api_handle_get_info},
+    {"GET_INPUT", "Get current control inputs", api_get_input, API_ARGS_NONE, API_MODES_ALL, 0, NULL},
+    {"GET_LOGS", "Get system logs", api_get_logs, API_ARGS_OPTIONAL, API_MODES_ALL, API_HTTP_GET | API_HTTP_POST,
+     api_handle_get_logs},
+    {"GET_MODE", "Get the current flight mode", api_get_mode, API_ARGS_NONE, API_MODES_ALL, 0, NULL},
+    {"GET_PERF", "Get runtime performance statistics", api_get_perf, API_ARGS_NONE, API_MODES_ALL, API_HTTP_GET,
+     api_handle_get_perf},
+    {"GET_SENSOR", "Get sensor data", api_get_sensor, API_ARGS_REQUIRED, API_MODES_ALL, 0, NULL},
+    {"HELP", "Display this help message", api_help, API_ARGS_NONE, API_MODES_ALL, 0, NULL},
+    {"PING", "Pong!", api_ping, API_ARGS_NONE, API_MODES_ALL, API_HTTP_GET, api_handle_ping},
+    {"REBOOT", "Reboot the system", api_reboot, API_ARGS_REQUIRED, API_MODES_ALL, 0, NULL},
+    {"RESET", "Reset pico-fbw to \"factory\" defaults", api_reset, API_ARGS_NONE, API_MODES_ALL, 0, NULL},
+    {"SET_BAY", "Set the current position of the drop bay", api_set_bay, API_ARGS_REQUIRED, API_MODE(MODE_NORMAL), 0,
+     NULL},
+    {"SET_CONFIG", "Set system configuration value(s)", api_set_config, API_ARGS_OPTIONAL, API_MODES_ALL, API_HTTP_POST,
+     api_handle_set_config},
+    {"SET_FLIGHTPLAN", "Set raw flightplan data", api_set_flightplan, API_ARGS_REQUIRED, API_MODES_ALL & ~API_MODE(MODE_AUTO),
+     API_HTTP_POST, api_handle_set_flightplan},
+    {"SET_MODE", "Set the current flight mode", api_set_mode, API_ARGS_REQUIRED, API_MODES_ALL, 0, NULL},
+    {"SET_TARGET", "Set the desired attitude/thrust target", api_set_target, API_ARGS_REQUIRED, API_MODE(MODE_NORMAL), 0,
+     NULL},
+    {"SET_WAYPOINT", "Create and track onto a Waypoint", api_set_waypoint, API_ARGS_REQUIRED, API_MODE(MODE_AUTO), 0, NULL},
+    {"SUBSCRIBE", "Stream sensor data, inputs, mode, or performance statistics", NULL, API_ARGS_OPTIONAL, API_MODES_ALL, 0,
+     NULL},
+    {"TEST_AAHRS", "Tests the AAHRS", api_test_aahrs, API_ARGS_NONE, API_MODES_ALL, 0, NULL},
+    {"TEST_ALL", "Runs all possible system tests using default values", api_test_all, API_ARGS_NONE, API_MODES_ALL, 0, NULL},
+    {"TEST_GPS", "Tests the GPS module", api_test_gps, API_ARGS_NONE, API_MODES_ALL, 0, NULL},
+    {"TEST_PWM", "Tests the PWM input system", api_test_pwm, API_ARGS_OPTIONAL, API_MODE(MODE_DIRECT), 0, NULL},
+    {"TEST_SERVO", "Tests the servo(s)", api_test_servo, API_ARGS_OPTIONAL, API_MODE(MODE_DIRECT), 0, NULL},
+    {"TEST_THROTTLE", "Tests the throttle", api_test_throttle, API_ARGS_OPTIONAL, API_MODE(MODE_DIRECT), 0, NULL},
+};
+// clang-format on
+
+// Commands registered at runtime, also kept sorted by name
+static const ApiCommand *registered[API_REGISTERED_MAX];
+static u32 numRegistered = 0;
+
+static int compare_builtin(const void *name, const void *cmd) {
+    return strcasecmp((const char *)name, ((const ApiCommand *)cmd)->name);
 }
 
-i32 api_handle_set(const char *cmd, const char *args) {
-    if (strcasecmp(cmd, "SET_BAY") == 0) {
-        return api_set_bay(args);
-    } else if (strcasecmp(cmd, "SET_CONFIG") == 0) {
-        return api_set_config(args);
-    } else if (strcasecmp(cmd, "SET_FLIGHTPLAN") == 0) {
-        return api_set_flightplan(args);
-    } else if (strcasecmp(cmd, "SET_MODE") == 0) {
-        return api_set_mode(args);
-    } else if (strcasecmp(cmd, "SET_TARGET") == 0) {
-        return api_set_target(args);
-    } else if (strcasecmp(cmd, "SET_WAYPOINT") == 0) {
-        return api_set_waypoint(args);
-    } else
-        return 404;
+static int compare_registered(const void *name, const void *cmd) {
+    return strcasecmp((const char *)name, (*(const ApiCommand *const *)cmd)->name);
 }
 
-i32 api_handle_test(const char *cmd, const char *args) {
-    if (strcasecmp(cmd, "TEST_AAHRS") == 0) {
-        return api_test_aahrs(args);
-    } else if (strcasecmp(cmd, "TEST_ALL") == 0) {
-        return api_test_all(args);
-    } else if (strcasecmp(cmd, "TEST_GPS") == 0) {
-        return api_test_gps(args);
-    } else if (strcasecmp(cmd, "TEST_PWM") == 0) {
-        return api_test_pwm(args);
-    } else if (strcasecmp(cmd, "TEST_SERVO") == 0) {
-        return api_test_servo(args);
-    } else if (strcasecmp(cmd, "TEST_THROTTLE") == 0) {
-        return api_test_throttle(args);
-    } else
-        return 404;
+const ApiCommand *api_find_command(const char *name) {
+    const ApiCommand *cmd = bsearch(name, commands, count_of(commands), sizeof(commands[0]), compare_builtin);
+    if (cmd)
+        return cmd;
+    const ApiCommand *const *reg = bsearch(name, registered, numRegistered, sizeof(registered[0]), compare_registered);
+    return reg ? *reg : NULL;
 }
 
-i32 api_handle_misc(const char *cmd, const char *args) {
-    if (strcasecmp(cmd, "ABOUT") == 0) {
-        return api_about(args);
-    } else if (strcasecmp(cmd, "HELP") == 0) {
-        return api_help(args);
-    } else if (strcasecmp(cmd, "PING") == 0) {
-        return api_ping(args);
-    } else if (strcasecmp(cmd, "REBOOT") == 0) {
-        return api_reboot(args);
-    } else if (strcasecmp(cmd, "RESET") == 0) {
-        return api_reset(args);
-    } else
+const ApiCommand *api_command_at(u32 index) {
+    if (index < count_of(commands))
+        return &commands[index];
+    index -= count_of(commands);
+    return index < numRegistered ? registered[index] : NULL;
+}
+
+bool api_register(const ApiCommand *cmd) {
+    if (!cmd || !cmd->name || numRegistered >= count_of(registered) || api_find_command(cmd->name))
+        return false;
+    // Insert the command in order
+    u32 i = numRegistered;
+    while (i > 0 && strcasecmp(registered[i - 1]->name, cmd->name) > 0) {
+        registered[i] = registered[i - 1];
+        i--;
+    }
+    registered[i] = cmd;
+    numRegistered++;
+    return true;
+}
+
+i32 api_check_command(const ApiCommand *cmd, const char *args) {
+    if (!(cmd->modes & API_MODE(aircraft.mode)))
+        return 403;
+    if (cmd->args == API_ARGS_REQUIRED && (!args || args[0] == '\0'))
+        return 400;
+    return 200;
+}
+
+i32 api_exec_http(const char *route, u8 method, const char *body, JSONWriter *json) {
+    // Convert the route into the name of its command (e.g. "get/config" -> "GET_CONFIG"), ignoring any query string
+    char name[ROUTE_MAX + 1];
+    u32 len = 0;
+    for (; route[len] != '\0' && route[len] != '?'; len++) {
+        if (len >= ROUTE_MAX)
+            return 404;
+        name[len] = route[len] == '/' ? '_' : (char)toupper((unsigned char)route[len]);
+    }
+    name[len] = '\0';
+
+    const ApiCommand *cmd = api_find_command(name);
+    if (!cmd || !cmd->http || !cmd->runHttp)
         return 404;
+    if (!(cmd->http & method))
+        return 405;
+    i32 status = api_check_command(cmd, body);
+    if (status != 200)
+        return status;
+    return cmd->runHttp(body, json);
 }
@@ -1,35 +1,96 @@
 #pragma once
 
+#include <stdbool.h>
 #include "platform/types.h"
 
+#include "lib/jsonwriter.h"
+
+// The command registry: every API command is a single ApiCommand entry, which both the text/binary API (`api_exec()`) and
+// the HTTP servers (`api_exec_http()`) dispatch through. Built-in commands live in a table sorted by name, so they're found
+// with a binary search; platform code can add its own with `api_register()`.
+//
+// Commands served over HTTP are found at /api/v1/ followed by their name in lowercase, with '_' replaced by '/' (e.g.
+// GET_CONFIG is served at /api/v1/get/config).
+
+#define API_REGISTERED_MAX 8 // Commands that can be registered at runtime
+
+#define API_MODE(mode) (1u << (mode)) // Flag of a Mode, for ApiCommand.modes
+#define API_MODES_ALL UINT32_MAX
+
+// Flags of ApiCommand.http
+#define API_HTTP_GET (1 << 0)
+#define API_HTTP_POST (1 << 1)
+
+// clang-format off
+typedef enum ApiArgs {
+    API_ARGS_NONE,     // The command takes no arguments (any that are given are ignored)
+    API_ARGS_OPTIONAL, // The command may be given arguments
+    API_ARGS_REQUIRED, // The command is refused (400) if it is given no arguments
+} ApiArgs;
+// clang-format on
+
 /**
- * Handles API GET commands.
- * @param cmd the command
- * @param args the command arguments
- * @return the status code.
+ * Runs a command for the text API.
+ * @param args the command's arguments, or NULL if none were given
+ * @return the status code of the command (-1 for success with output)
+ * @note Output should be printed with `api_print()`.
  */
-i32 api_handle_get(const char *cmd, const char *args);
+typedef i32 (*api_cmd_t)(const char *args);
 
 /**
- * Handles API SET commands.
- * @param cmd the command
- * @param args the command arguments
- * @return the status code.
+ * Runs a command for an HTTP request.
+ * @param input the request's body, or NULL if it has none
+ * @param json the writer to write the response to; if nothing is written, the response is an empty object
+ * @return the status code of the command
  */
-i32 api_handle_set(const char *cmd, const char *args);
+typedef i32 (*api_http_cmd_t)(const char *input, JSONWriter *json);
+
+typedef struct ApiCommand {
+    const char *name;       // e.g. "GET_CONFIG"
+    const char *help;       // One-line description, shown by HELP
+    api_cmd_t run;          // Runs the command for the text API, or NULL if it's handled by the session itself (e.g. BINARY)
+    ApiArgs args;
+    u32 modes;              // API_MODE() flags of the modes the command is permitted in; it is refused (403) in others
+    u8 http;                // API_HTTP_* methods the command is served with over HTTP, or 0 if it isn't
+    api_http_cmd_t runHttp; // Runs the command for HTTP (required if `http` is set)
+} ApiCommand;
 
 /**
- * Handles API TEST commands.
- * @param cmd the command
- * @param args the command arguments
- * @return the status code.
+ * Finds a command by name.
+ * @param name the name of the command (case-insensitive)
+ * @return the command, or NULL if there is no such command
  */
-i32 api_handle_test(const char *cmd, const char *args);
+const ApiCommand *api_find_command(const char *name);
 
 /**
- * Handles API MISC (no prefix) commands.
+ * @param index the index of the command, from 0
+ * @return the command, or NULL if `index` is past the last command
+ * @note Built-in commands come first (in order of name), followed by registered commands.
+ */
+const ApiCommand *api_command_at(u32 index);
+
+/**
+ * Registers a command, so it can be run like a built-in one.
+ * @param cmd the command; it must stay valid for as long as the system runs
+ * @return true if successful, false if a command of the same name exists or too many have been registered
+ * @note This should only be called during boot, before any commands are run.
+ */
+bool api_register(const ApiCommand *cmd);
+
+/**
+ * Checks whether a command may be run right now.
  * @param cmd the command
- * @param args the command arguments
- * @return either status code 404, or -1 if the command was successful (MISC commands don't have return codes).
+ * @param args the arguments it would be run with, or NULL if none were given
+ * @return 200 if it may be run, 403 if it isn't permitted in the current mode, or 400 if it's missing required arguments
+ */
+i32 api_check_command(const ApiCommand *cmd, const char *args);
+
+/**
+ * Runs a command for an HTTP request.
+ * @param route the request's path under /api/v1/ (e.g. "get/config"); any query string is ignored
+ * @param method the request's method (API_HTTP_GET or API_HTTP_POST)
+ * @param body the request's body, or NULL if it has none
+ * @param json the writer to write the response to; if nothing is written, the response is an empty object
+ * @return the status code of the command, 404 if no command is served on `route`, or 405 if it isn't served with `method`
  */
-i32 api_handle_misc(const char *cmd, const char *args);
\ No newline at end of file
+i32 api_exec_http(const char *route, u8 method, const char *body, JSONWriter *json);
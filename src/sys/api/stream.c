@@ -0,0 +1,344 @@
+/**
+ * Source file of pico-fbw: https://github.com/pico-fbw/pico-fbw
+ * Licensed under the GNU AGPL-3.0
+ */
+
+#include <assert.h>
+#include <math.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+#include "platform/helpers.h"
+#include "platform/time.h"
+
+#include "lib/cobs.h"
+#include "lib/parson.h"
+
+#include "stream.h"
+
+#define STREAM_RATE_DEFAULT 10
+#define STREAM_JSON_MAX 768 // Largest JSON update, bytes
+
+// Each channel's struct is described member by member, which drives both the delta encoding and the JSON output
+
+typedef enum FieldType {
+    FIELD_U8,
+    FIELD_U32,
+    FIELD_I32,
+    FIELD_F32,
+    FIELD_DEG_E7, // i32, 1e-7 deg (output in deg)
+} FieldType;
+
+typedef struct Field {
+    const char *name; // Name in JSON updates
+    u8 offset;        // Offset in the struct, bytes
+    u8 size;          // Size of the member, bytes (more than one element makes it an array)
+    FieldType type;
+} Field;
+
+typedef struct Channel {
+    const char *name;
+    BinaryType type;
+    const Field *fields;
+    u32 numFields;
+} Channel;
+
+#define FIELD(strct, member, name, type) {name, offsetof(strct, member), sizeof(((strct *)0)->member), type}
+
+static const Field attitudeFields[] = {
+    FIELD(BinaryAttitude, valid, "valid", FIELD_U8),
+    FIELD(BinaryAttitude, roll, "roll", FIELD_F32),
+    FIELD(BinaryAttitude, pitch, "pitch", FIELD_F32),
+    FIELD(BinaryAttitude, yaw, "yaw", FIELD_F32),
+    FIELD(BinaryAttitude, rollRate, "roll_rate", FIELD_F32),
+    FIELD(BinaryAttitude, pitchRate, "pitch_rate", FIELD_F32),
+    FIELD(BinaryAttitude, yawRate, "yaw_rate", FIELD_F32),
+    FIELD(BinaryAttitude, accel, "accel", FIELD_F32),
+    FIELD(BinaryAttitude, alt, "alt", FIELD_F32),
+};
+
+static const Field gpsFields[] = {
+    FIELD(BinaryGPS, valid, "valid", FIELD_U8),
+    FIELD(BinaryGPS, lat, "lat", FIELD_DEG_E7),
+    FIELD(BinaryGPS, lng, "lng", FIELD_DEG_E7),
+    FIELD(BinaryGPS, alt, "alt", FIELD_I32),
+    FIELD(BinaryGPS, speed, "speed", FIELD_F32),
+    FIELD(BinaryGPS, track, "track", FIELD_F32),
+    FIELD(BinaryGPS, pdop, "pdop", FIELD_F32),
+    FIELD(BinaryGPS, hdop, "hdop", FIELD_F32),
+    FIELD(BinaryGPS, vdop, "vdop", FIELD_F32),
+    FIELD(BinaryGPS, sats, "sats", FIELD_U8),
+};
+
+static const Field inputsFields[] = {
+    FIELD(BinaryInputs, present, "present", FIELD_U8),
+    FIELD(BinaryInputs, ail, "ail", FIELD_F32),
+    FIELD(BinaryInputs, ele, "ele", FIELD_F32),
+    FIELD(BinaryInputs, rud, "rud", FIELD_F32),
+    FIELD(BinaryInputs, thr, "thr", FIELD_F32),
+    FIELD(BinaryInputs, sw, "switch", FIELD_F32),
+};
+
+static const Field modeFields[] = {
+    FIELD(BinaryMode, mode, "mode", FIELD_U8),
+    FIELD(BinaryMode, flags, "flags", FIELD_U8),
+};
+
+static const Field perfFields[] = {
+    FIELD(BinaryPerf, mean, "mean", FIELD_U32),
+    FIELD(BinaryPerf, max, "max", FIELD_U32),
+    FIELD(BinaryPerf, p99, "p99", FIELD_U32),
+    FIELD(BinaryPerf, overruns, "overruns", FIELD_U32),
+};
+
+// In the order of the BINARY_CHANNEL_* flags
+static const Channel channelTable[BINARY_CHANNELS] = {
+    {"aahrs", BINARY_ATTITUDE, attitudeFields, count_of(attitudeFields)},
+    {"gps", BINARY_GPS, gpsFields, count_of(gpsFields)},
+    {"inputs", BINARY_INPUTS, inputsFields, count_of(inputsFields)},
+    {"mode", BINARY_MODE, modeFields, count_of(modeFields)},
+    {"perf", BINARY_PERF, perfFields, count_of(perfFields)},
+};
+
+static_assert(sizeof(BinaryAttitude) <= STREAM_SNAPSHOT_MAX && sizeof(BinaryGPS) <= STREAM_SNAPSHOT_MAX &&
+                  sizeof(BinaryInputs) <= STREAM_SNAPSHOT_MAX && sizeof(BinaryMode) <= STREAM_SNAPSHOT_MAX &&
+                  sizeof(BinaryPerf) <= STREAM_SNAPSHOT_MAX,
+              "STREAM_SNAPSHOT_MAX is too small");
+
+static StreamClient *clients[STREAM_CLIENTS_MAX];
+
+static u32 element_size(FieldType type) {
+    return type == FIELD_U8 ? sizeof(u8) : sizeof(u32);
+}
+
+/**
+ * @return a mask of the fields that differ between two snapshots of a channel
+ */
+static u32 changed_fields(const Channel *channel, const byte *snapshot, const byte *baseline) {
+    u32 mask = 0;
+    for (u32 i = 0; i < channel->numFields; i++) {
+        const Field *f = &channel->fields[i];
+        if (memcmp(snapshot + f->offset, baseline + f->offset, f->size) != 0)
+            mask |= 1u << i;
+    }
+    return mask;
+}
+
+// Appends one element of a field to a JSON update
+static u32 json_element(char *buf, u32 size, const byte *at, FieldType type) {
+    switch (type) {
+        case FIELD_U8:
+            return snprintf(buf, size, "%u", *at);
+        case FIELD_U32: {
+            u32 v;
+            memcpy(&v, at, sizeof(v));
+            return snprintf(buf, size, "%lu", v);
+        }
+        case FIELD_I32: {
+            i32 v;
+            memcpy(&v, at, sizeof(v));
+            return snprintf(buf, size, "%ld", v);
+        }
+        case FIELD_DEG_E7: {
+            i32 v;
+            memcpy(&v, at, sizeof(v));
+            return snprintf(buf, size, "%.7f", v / 1E7);
+        }
+        case FIELD_F32: {
+            f32 v;
+            memcpy(&v, at, sizeof(v));
+            if (!isfinite(v))
+                return snprintf(buf, size, "null"); // Not representable in JSON
+            return snprintf(buf, size, "%.7g", v);
+        }
+    }
+    return 0;
+}
+
+static bool send_json(StreamClient *client, const Channel *channel, const byte *snapshot, u32 mask) {
+    char buf[STREAM_JSON_MAX];
+    u32 len = snprintf(buf, sizeof(buf), "{\"%s\":{", channel->name);
+    bool first = true;
+    for (u32 i = 0; i < channel->numFields && len < sizeof(buf); i++) {
+        if (!(mask & (1u << i)))
+            continue;
+        const Field *f = &channel->fields[i];
+        u32 count = f->size / element_size(f->type);
+        len += snprintf(buf + len, sizeof(buf) - len, "%s\"%s\":%s", first ? "" : ",", f->name, count > 1 ? "[" : "");
+        for (u32 e = 0; e < count && len < sizeof(buf); e++) {
+            if (e > 0)
+                len += snprintf(buf + len, sizeof(buf) - len, ",");
+            len += json_element(buf + len, sizeof(buf) - len, snapshot + f->offset + e * element_size(f->type), f->type);
+        }
+        if (count > 1 && len < sizeof(buf))
+            len += snprintf(buf + len, sizeof(buf) - len, "]");
+        first = false;
+    }
+    if (len < sizeof(buf))
+        len += snprintf(buf + len, sizeof(buf) - len, "}}");
+    if (len >= sizeof(buf) || len > client->tokens)
+        return false;
+    if (!client->write(buf, len, client->ctx))
+        return false;
+    client->tokens -= len;
+    return true;
+}
+
+static bool send_binary(StreamClient *client, const Channel *channel, const byte *snapshot, u32 mask) {
+    byte payload[sizeof(BinaryUpdate) + STREAM_SNAPSHOT_MAX];
+    BinaryUpdate update = {.channel = (u8)channel->type, .fields = mask};
+    memcpy(payload, &update, sizeof(update));
+    u32 len = sizeof(update);
+    for (u32 i = 0; i < channel->numFields; i++) {
+        if (!(mask & (1u << i)))
+            continue;
+        memcpy(payload + len, snapshot + channel->fields[i].offset, channel->fields[i].size);
+        len += channel->fields[i].size;
+    }
+    // Framing adds the type, sequence number, CRC, COBS overhead, and the delimiters
+    u32 cost = COBS_ENCODED_MAX(len + 4) + 2;
+    if (cost > client->tokens)
+        return false;
+    if (!binary_send(client->session, BINARY_UPDATE, client->seq, payload, len))
+        return false;
+    client->seq++;
+    client->tokens -= cost;
+    return true;
+}
+
+void stream_configure(StreamClient *client, u8 channels, u32 rate) {
+    client->channels = channels & ((1 << BINARY_CHANNELS) - 1);
+    client->period = 1000000 / clamp(rate, STREAM_RATE_MIN, STREAM_RATE_MAX);
+    client->lastSent = 0;
+    client->lastRefill = time_us();
+    client->tokens = STREAM_BUDGET / 10; // Enough for a first round of keyframes, the rest of the budget builds up
+    for (u32 i = 0; i < BINARY_CHANNELS; i++)
+        client->hasBaseline[i] = false;
+}
+
+bool stream_subscribe(StreamClient *client, u8 channels, u32 rate) {
+    if (channels == 0) {
+        stream_unsubscribe(client);
+        return true;
+    }
+    i32 slot = -1;
+    for (u32 i = 0; i < STREAM_CLIENTS_MAX; i++) {
+        if (clients[i] == client) {
+            slot = i;
+            break;
+        }
+        if (!clients[i] && slot < 0)
+            slot = i;
+    }
+    if (slot < 0)
+        return false;
+    stream_configure(client, channels, rate);
+    clients[slot] = client;
+    return true;
+}
+
+void stream_unsubscribe(StreamClient *client) {
+    client->channels = 0;
+    for (u32 i = 0; i < STREAM_CLIENTS_MAX; i++) {
+        if (clients[i] == client)
+            clients[i] = NULL;
+    }
+}
+
+bool stream_is_subscribed(const StreamClient *client) {
+    return client->channels != 0;
+}
+
+static u8 channel_from_name(const char *name, size_t len) {
+    for (u32 i = 0; i < BINARY_CHANNELS; i++) {
+        if (strlen(channelTable[i].name) == len && strncasecmp(name, channelTable[i].name, len) == 0)
+            return 1 << i;
+    }
+    return 0;
+}
+
+u8 stream_parse_channels(const char *list) {
+    u8 channels = 0;
+    while (*list) {
+        size_t len = strcspn(list, ",");
+        u8 channel = channel_from_name(list, len);
+        if (!channel)
+            return 0;
+        channels |= channel;
+        list += len;
+        if (*list == ',')
+            list++;
+    }
+    return channels;
+}
+
+// {"channels":["aahrs"|"gps"|"inputs"|"mode"|"perf",...],"rate":number}
+
+i32 stream_subscribe_args(StreamClient *client, const char *args) {
+    JSON_Value *root = json_parse_string(args);
+    if (!root)
+        return 400;
+    JSON_Object *obj = json_value_get_object(root);
+    if (!obj) {
+        json_value_free(root);
+        return 400;
+    }
+    u8 channels = 0;
+    JSON_Array *arr = json_object_get_array(obj, "channels");
+    for (size_t i = 0; arr && i < json_array_get_count(arr); i++) {
+        const char *name = json_array_get_string(arr, i);
+        u8 channel = name ? channel_from_name(name, strlen(name)) : 0;
+        if (!channel) {
+            json_value_free(root);
+            return 400;
+        }
+        channels |= channel;
+    }
+    u32 rate = STREAM_RATE_DEFAULT;
+    if (json_object_has_value_of_type(obj, "rate", JSONNumber))
+        rate = (u32)json_object_get_number(obj, "rate");
+    json_value_free(root);
+    return stream_subscribe(client, channels, rate) ? 200 : 409;
+}
+
+void stream_service(StreamClient *client) {
+    if (!client->channels)
+        return;
+    u64 now = time_us();
+    // Refill the budget (whole bytes only, so the remainder carries over)
+    u32 refill = (u32)((now - client->lastRefill) * STREAM_BUDGET / 1000000);
+    if (refill > 0) {
+        client->tokens = client->tokens + refill < STREAM_BUDGET ? client->tokens + refill : STREAM_BUDGET;
+        client->lastRefill = now;
+    }
+    if (now - client->lastSent < client->period)
+        return;
+    client->lastSent = now;
+
+    for (u32 i = 0; i < BINARY_CHANNELS; i++) {
+        if (!(client->channels & (1 << i)))
+            continue;
+        const Channel *channel = &channelTable[i];
+        byte snapshot[STREAM_SNAPSHOT_MAX];
+        u32 size = binary_telemetry(channel->type, snapshot);
+        bool key = !client->hasBaseline[i] || now - client->lastKey[i] >= STREAM_KEYFRAME_MS * 1000;
+        u32 mask = key ? (1u << channel->numFields) - 1 : changed_fields(channel, snapshot, client->baseline[i]);
+        if (mask == 0)
+            continue; // Nothing new
+        bool sent = client->format == STREAM_FORMAT_BINARY ? send_binary(client, channel, snapshot, mask)
+                                                           : send_json(client, channel, snapshot, mask);
+        if (!sent)
+            continue; // Over budget or the transport is busy, the baseline is kept so the changes go out next time
+        memcpy(client->baseline[i], snapshot, size);
+        client->hasBaseline[i] = true;
+        if (key)
+            client->lastKey[i] = now;
+    }
+}
+
+void stream_update() {
+    for (u32 i = 0; i < STREAM_CLIENTS_MAX; i++) {
+        if (clients[i])
+            stream_service(clients[i]);
+    }
+}
@@ -0,0 +1,118 @@
+#pragma once
+
+#include <stdbool.h>
+#include "platform/types.h"
+
+#include "sys/api/binary.h"
+
+// Telemetry streaming: instead of polling, a client subscribes to channels at a rate and gets pushed updates.
+//
+// Updates are delta-encoded against what the client last received, so a channel that hasn't changed costs nothing and one
+// that has only sends the fields that did. A keyframe (every field) is sent every STREAM_KEYFRAME_MS, so a client that missed
+// something always catches up. Binary clients receive BINARY_UPDATE frames (see sys/api/binary.h); text clients receive one
+// JSON object per update, keyed by channel, e.g. {"aahrs":{"roll":1.5,"yaw":92.1}}.
+//
+// Streaming can never starve the control loop: updates are only sent from the low-priority "stream" task, at most at
+// STREAM_RATE_MAX, and each client has a budget of STREAM_BUDGET bytes per second. An update that doesn't fit in the budget
+// (or in the transport's buffer) is simply not sent; since its baseline is then kept, the next update carries its changes.
+
+#define STREAM_RATE_MIN 1
+#define STREAM_RATE_MAX 50 // Also the rate of the stream task
+#define STREAM_CLIENTS_MAX 4 // Clients that can be subscribed at once
+#define STREAM_BUDGET 8000 // Bytes per second per client
+#define STREAM_KEYFRAME_MS 1000
+#define STREAM_SNAPSHOT_MAX 128 // Size of the largest channel's struct, bytes
+
+// clang-format off
+typedef enum StreamFormat {
+    STREAM_FORMAT_BINARY, // BINARY_UPDATE frames, sent through the client's BinarySession
+    STREAM_FORMAT_JSON,   // JSON objects, sent through the client's `write`
+} StreamFormat;
+// clang-format on
+
+/**
+ * Writes a JSON update to a text client's transport.
+ * @param json the update (a JSON object, null-terminated, without a line ending)
+ * @param len the length of the update
+ * @param ctx the client's context
+ * @return true if the update was written, false if it was dropped
+ */
+typedef bool (*stream_write_t)(const char *json, u32 len, void *ctx);
+
+typedef struct StreamClient {
+    // Set up by the transport
+    StreamFormat format;
+    BinarySession *session; // For STREAM_FORMAT_BINARY
+    stream_write_t write;   // For STREAM_FORMAT_JSON
+    void *ctx;              // Passed to `write`
+    // Managed by the stream
+    u8 channels; // BINARY_CHANNEL_* flags, 0 if not subscribed
+    u32 period;  // us
+    u64 lastSent, lastRefill;
+    u32 tokens; // Remaining budget, bytes
+    u8 seq;     // Sequence number of the next BINARY_UPDATE
+    u64 lastKey[BINARY_CHANNELS];
+    bool hasBaseline[BINARY_CHANNELS];
+    byte baseline[BINARY_CHANNELS][STREAM_SNAPSHOT_MAX]; // What the client last received of each channel
+} StreamClient;
+
+/**
+ * Subscribes a client to a set of channels, replacing any previous subscription.
+ * @param client the client
+ * @param channels BINARY_CHANNEL_* flags, or 0 to unsubscribe
+ * @param rate the rate at which to send updates, Hz (clamped to STREAM_RATE_MIN..STREAM_RATE_MAX)
+ * @return true if successful, false if too many clients are already subscribed
+ * @note This must only be called from the main loop.
+ */
+bool stream_subscribe(StreamClient *client, u8 channels, u32 rate);
+
+/**
+ * Unsubscribes a client from all channels.
+ * @param client the client
+ * @note This must only be called from the main loop.
+ */
+void stream_unsubscribe(StreamClient *client);
+
+/**
+ * @param client the client
+ * @return whether the client is subscribed to any channels
+ */
+bool stream_is_subscribed(const StreamClient *client);
+
+/**
+ * Subscribes a client to the channels and rate given as text API arguments.
+ * @param client the client
+ * @param args the arguments, {"channels":["aahrs"|"gps"|"inputs"|"mode"|"perf",...],"rate":number}; no (or empty) channels
+ * unsubscribes
+ * @return the status code of the request
+ */
+i32 stream_subscribe_args(StreamClient *client, const char *args);
+
+/**
+ * Parses a comma-separated list of channel names (e.g. "aahrs,gps").
+ * @param list the list
+ * @return the channels' BINARY_CHANNEL_* flags, or 0 if any name was invalid
+ */
+u8 stream_parse_channels(const char *list);
+
+/**
+ * Sets up a client's channels and rate without subscribing it, for clients that are serviced with `stream_service()`.
+ * @param client the client
+ * @param channels BINARY_CHANNEL_* flags
+ * @param rate the rate at which to send updates, Hz (clamped to STREAM_RATE_MIN..STREAM_RATE_MAX)
+ */
+void stream_configure(StreamClient *client, u8 channels, u32 rate);
+
+/**
+ * Sends a client whatever updates are due.
+ * This is done for all subscribed clients by `stream_update()`; it is only needed for clients that are serviced elsewhere
+ * (e.g. from a transport's own thread), which should be set up with `stream_configure()` instead of being subscribed.
+ * @param client the client
+ */
+void stream_service(StreamClient *client);
+
+/**
+ * Sends all subscribed clients whatever updates are due.
+ * @note This should be called at STREAM_RATE_MAX.
+ */
+void stream_update();
@@ -8,6 +8,7 @@
 #include <string.h>
 #include "platform/defs.h"
 #include "platform/flash.h"
+#include "platform/helpers.h"
 #include "platform/types.h"
 #include "platform/wifi.h"
 
@@ -16,6 +17,7 @@
 #include "io/receiver.h"
 
 #include "sys/print.h"
+#include "sys/recorder.h"
 #include "sys/runtime.h"
 #include "sys/version.h"
 
@@ -32,7 +34,8 @@ Config config = {
     .general = {
         CTRLMODE_2AXIS_ATHR, SWITCH_TYPE_3_POS, 20, 50, 50, true,
         // Wi-Fi should be enabled by default, but only if the platform supports it
-        #if PLATFORM_SUPPORTS_WIFI
+        // (the host's web server is opt-in, as it needs the web interface to have been built; see platform/host/wifi.c)
+        #if PLATFORM_SUPPORTS_WIFI && !FBW_PLATFORM_HOST
             WIFI_ENABLED_PASS,
         #else
             WIFI_DISABLED,
@@ -65,6 +68,8 @@ Config config = {
     .sensors = {
         IMU_MODEL_ICM20948, BARO_MODEL_NONE, 400, // AAHRS configuration
         GPS_COMMAND_TYPE_PMTK, 9600, // GPS configuration
+        AAHRS_FUSION_RATE_DEFAULT, ESTIMATOR_MADGWICK, // Fusion configuration
+        AAHRS_GPS_LATENCY_DEFAULT, AAHRS_DEAD_RECKON_DEFAULT, // Navigation configuration
         CONFIG_END_MAGIC,
     },
     .system = {
@@ -73,6 +78,8 @@ Config config = {
         // so setting it to true means the display will always be initialized on boot (if possible),
         // because this is the initial state of the config before it becomes overwritten by config_load()
         true, false, false, false, false, // Default print settings, also found in PrintDefs below
+        RECORDER_RATE_DEFAULT, // Flight data recorder configuration
+        true, // Save warnings and errors to flash
         CONFIG_END_MAGIC,
     },
     .wifi = {
@@ -92,12 +99,21 @@ Calibration calibration = {
     },
     .aahrs = {false},
     .pid = {
-        false,
-        // TODO: find good defaults!
-        0.01f, 0, 0.01f, 0.001f, -50, 50, // Default roll PID parameters
-        0.01f, 0, 0.01f, 0.001f, -50, 50, // Default pitch PID parameters
-        0.01f, 0, 0.01f, 0.001f, -50, 50, // Default yaw PID parameters
-        0.01f, 0, 0.01f, 0.001f, -50, 50, // Default autothrottle PID parameters
+        // Host platforms fly the simulated airframe (see platform/host/sim), which these gains were tuned for
+        #if FBW_PLATFORM_HOST
+            true,
+            1.0f, 0.2f, 0.05f, 0.001f, -50, 50, // Default roll PID parameters
+            3.0f, 1.0f, 0.1f, 0.001f, -50, 50, // Default pitch PID parameters
+            0.01f, 0, 0.01f, 0.001f, -50, 50, // Default yaw PID parameters
+            3.0f, 1.0f, 0.0f, 0.001f, -50, 50, // Default autothrottle PID parameters
+        #else
+            false,
+            // TODO: find good defaults!
+            0.01f, 0, 0.01f, 0.001f, -50, 50, // Default roll PID parameters
+            0.01f, 0, 0.01f, 0.001f, -50, 50, // Default pitch PID parameters
+            0.01f, 0, 0.01f, 0.001f, -50, 50, // Default yaw PID parameters
+            0.01f, 0, 0.01f, 0.001f, -50, 50, // Default autothrottle PID parameters
+        #endif
     }
 };
 
@@ -151,9 +167,95 @@ static bool save_struct_to_file(const char *file, void *strct, size_t size) {
     return lfs_file_close(&lfs, &f) == LFS_ERR_OK;
 }
 
+// Keys are only ever added to the end of a section, so a saved section holds the keys it had when it was saved, followed by
+// CONFIG_END_MAGIC. When a config saved by an older version is loaded, the keys added since then are past that marker (so they
+// hold whatever followed it), and are filled in with their defaults.
+
+// A key whose value is used without any further checks, along with the range it must be in; a value outside of it (e.g. from a
+// corrupted config) is replaced by the key's default when the config is loaded
+typedef struct KeyRange {
+    ConfigSection section;
+    u32 key;
+    f32 min, max;
+} KeyRange;
+
+static const KeyRange loadRanges[] = {
+    {CONFIG_SENSORS, SENSORS_FUSION_RATE, AAHRS_FUSION_RATE_MIN, AAHRS_FUSION_RATE_MAX},
+    {CONFIG_SENSORS, SENSORS_ESTIMATOR, ESTIMATOR_MIN, ESTIMATOR_MAX},
+    {CONFIG_SENSORS, SENSORS_GPS_LATENCY, AAHRS_GPS_LATENCY_MIN, AAHRS_GPS_LATENCY_MAX},
+    {CONFIG_SENSORS, SENSORS_DEAD_RECKON_TIME, AAHRS_DEAD_RECKON_MIN, AAHRS_DEAD_RECKON_MAX},
+    {CONFIG_SYSTEM, SYSTEM_RECORDER_RATE, RECORDER_RATE_MIN, RECORDER_RATE_MAX},
+    {CONFIG_SYSTEM, SYSTEM_SAVE_LOGS, false, true},
+};
+
+static f32 *float_section(Config *cfg, ConfigSection section) {
+    switch (section) {
+        case CONFIG_GENERAL:
+            return cfg->general;
+        case CONFIG_CONTROL:
+            return cfg->control;
+        case CONFIG_PINS:
+            return cfg->pins;
+        case CONFIG_SENSORS:
+            return cfg->sensors;
+        case CONFIG_SYSTEM:
+            return cfg->system;
+        default:
+            return NULL;
+    }
+}
+
+/**
+ * @param section the section
+ * @return the index of the section's end marker, or CONFIG_SECTION_SIZE if it has none
+ */
+static u32 section_end(const f32 *section) {
+    u32 end = 0;
+    while (end < CONFIG_SECTION_SIZE && section[end] != CONFIG_END_MAGIC)
+        end++;
+    return end;
+}
+
+/**
+ * Fills in the keys missing from a section that was saved by an older version with their defaults.
+ * @param section the loaded section
+ * @param defaults the section's defaults
+ * @return true if any keys were missing
+ */
+static bool migrate_section(f32 *section, const f32 *defaults) {
+    u32 end = section_end(section), defaultEnd = section_end(defaults);
+    if (end >= defaultEnd)
+        return false; // Nothing is missing (or there's no end marker to go by)
+    // The new end marker is copied along with the new keys
+    for (u32 i = end; i <= defaultEnd; i++)
+        section[i] = defaults[i];
+    return true;
+}
+
 void config_load() {
+    // The defaults are set aside before the saved config is loaded over them, so anything it's missing can be filled in
+    Config *defaults = malloc(sizeof(Config));
+    if (defaults)
+        *defaults = config;
     load_file_to_struct(FILE_CONFIG, &config, sizeof(config));
     load_file_to_struct(FILE_CALIBRATION, &calibration, sizeof(calibration));
+    if (defaults) {
+        bool changed = false;
+        for (ConfigSection section = CONFIG_GENERAL; section <= CONFIG_SYSTEM; section++)
+            changed |= migrate_section(float_section(&config, section), float_section(defaults, section));
+        for (u32 i = 0; i < count_of(loadRanges); i++) {
+            const KeyRange *range = &loadRanges[i];
+            f32 *value = &float_section(&config, range->section)[range->key];
+            if (!(*value >= range->min && *value <= range->max)) { // Also catches NaN
+                *value = float_section(defaults, range->section)[range->key];
+                changed = true;
+            }
+        }
+        free(defaults);
+        // Save the filled-in config, so this only has to be done once
+        if (changed)
+            save_struct_to_file(FILE_CONFIG, &config, sizeof(config));
+    }
     // Load print settings and set debug flag
     shouldPrint.fbw = config.system[SYSTEM_PRINT_FBW];
     shouldPrint.aahrs = config.system[SYSTEM_PRINT_AAHRS];
@@ -405,6 +507,14 @@ static void get_from_sensors(const char *key, f32 **value) {
         *value = &config.sensors[SENSORS_GPS_COMMAND_TYPE];
     } else if (strcasecmp(key, "gpsBaudrate") == 0) {
         *value = &config.sensors[SENSORS_GPS_BAUDRATE];
+    } else if (strcasecmp(key, "fusionRate") == 0) {
+        *value = &config.sensors[SENSORS_FUSION_RATE];
+    } else if (strcasecmp(key, "estimator") == 0) {
+        *value = &config.sensors[SENSORS_ESTIMATOR];
+    } else if (strcasecmp(key, "gpsLatency") == 0) {
+        *value = &config.sensors[SENSORS_GPS_LATENCY];
+    } else if (strcasecmp(key, "deadReckonTime") == 0) {
+        *value = &config.sensors[SENSORS_DEAD_RECKON_TIME];
     } else {
         *value = NULL;
     }
@@ -421,6 +531,14 @@ static bool set_to_sensors(const char *key, f32 value) {
         config.sensors[SENSORS_GPS_COMMAND_TYPE] = value;
     } else if (strcasecmp(key, "gpsBaudrate") == 0) {
         config.sensors[SENSORS_GPS_BAUDRATE] = value;
+    } else if (strcasecmp(key, "fusionRate") == 0) {
+        config.sensors[SENSORS_FUSION_RATE] = value;
+    } else if (strcasecmp(key, "estimator") == 0) {
+        config.sensors[SENSORS_ESTIMATOR] = value;
+    } else if (strcasecmp(key, "gpsLatency") == 0) {
+        config.sensors[SENSORS_GPS_LATENCY] = value;
+    } else if (strcasecmp(key, "deadReckonTime") == 0) {
+        config.sensors[SENSORS_DEAD_RECKON_TIME] = value;
     } else
         return false;
     return true;
@@ -439,6 +557,10 @@ static void get_from_system(const char *key, f32 **value) {
         *value = &config.system[SYSTEM_PRINT_GPS];
     } else if (strcasecmp(key, "printNetwork") == 0) {
         *value = &config.system[SYSTEM_PRINT_NETWORK];
+    } else if (strcasecmp(key, "recorderRate") == 0) {
+        *value = &config.system[SYSTEM_RECORDER_RATE];
+    } else if (strcasecmp(key, "saveLogs") == 0) {
+        *value = &config.system[SYSTEM_SAVE_LOGS];
     } else {
         *value = NULL;
     }
@@ -457,6 +579,10 @@ static bool set_to_system(const char *key, f32 value) {
         config.system[SYSTEM_PRINT_GPS] = value;
     } else if (strcasecmp(key, "printNetwork") == 0) {
         config.system[SYSTEM_PRINT_NETWORK] = value;
+    } else if (strcasecmp(key, "recorderRate") == 0) {
+        config.system[SYSTEM_RECORDER_RATE] = value;
+    } else if (strcasecmp(key, "saveLogs") == 0) {
+        config.system[SYSTEM_SAVE_LOGS] = value;
     } else
         return false;
     return true;
@@ -510,6 +636,29 @@ bool config_validate() {
         print("ERROR: GPS command type must be between %d and %d.", GPS_COMMAND_TYPE_MIN, GPS_COMMAND_TYPE_MAX);
         return false;
     }
+    if (config.sensors[SENSORS_FUSION_RATE] < AAHRS_FUSION_RATE_MIN ||
+        config.sensors[SENSORS_FUSION_RATE] > AAHRS_FUSION_RATE_MAX) {
+        print("ERROR: Fusion rate must be between %d and %d.", AAHRS_FUSION_RATE_MIN, AAHRS_FUSION_RATE_MAX);
+        return false;
+    }
+    if (config.sensors[SENSORS_ESTIMATOR] < ESTIMATOR_MIN || config.sensors[SENSORS_ESTIMATOR] > ESTIMATOR_MAX) {
+        print("ERROR: Estimator must be between %d and %d.", ESTIMATOR_MIN, ESTIMATOR_MAX);
+        return false;
+    }
+    if (config.sensors[SENSORS_GPS_LATENCY] < AAHRS_GPS_LATENCY_MIN ||
+        config.sensors[SENSORS_GPS_LATENCY] > AAHRS_GPS_LATENCY_MAX) {
+        print("ERROR: GPS latency must be between %d and %d.", AAHRS_GPS_LATENCY_MIN, AAHRS_GPS_LATENCY_MAX);
+        return false;
+    }
+    if (config.sensors[SENSORS_DEAD_RECKON_TIME] < AAHRS_DEAD_RECKON_MIN ||
+        config.sensors[SENSORS_DEAD_RECKON_TIME] > AAHRS_DEAD_RECKON_MAX) {
+        print("ERROR: Dead reckoning time must be between %d and %d.", AAHRS_DEAD_RECKON_MIN, AAHRS_DEAD_RECKON_MAX);
+        return false;
+    }
+    if (config.system[SYSTEM_RECORDER_RATE] < RECORDER_RATE_MIN || config.system[SYSTEM_RECORDER_RATE] > RECORDER_RATE_MAX) {
+        print("ERROR: Recorder rate must be between %d and %d.", RECORDER_RATE_MIN, RECORDER_RATE_MAX);
+        return false;
+    }
     // Unique pin validation
     i32 lastPin = -1;
     switch ((ControlMode)config.general[GENERAL_CONTROL_MODE]) {
@@ -90,6 +90,10 @@ typedef enum ConfigSensors {
     SENSORS_AAHRS_BUS_FREQ,
     SENSORS_GPS_COMMAND_TYPE,
     SENSORS_GPS_BAUDRATE,
+    SENSORS_FUSION_RATE,
+    SENSORS_ESTIMATOR,
+    SENSORS_GPS_LATENCY,
+    SENSORS_DEAD_RECKON_TIME,
 } ConfigSensors;
 
 typedef enum ConfigSystem {
@@ -99,6 +103,8 @@ typedef enum ConfigSystem {
     SYSTEM_PRINT_AIRCRAFT,
     SYSTEM_PRINT_GPS,
     SYSTEM_PRINT_NETWORK,
+    SYSTEM_RECORDER_RATE,
+    SYSTEM_SAVE_LOGS,
 } ConfigSystem;
 
 typedef struct ConfigWifi {
@@ -211,6 +217,7 @@ typedef enum ConfigSection {
 /**
  * Loads the config from flash memory into the config struct.
  * If the config is invalid/nonexistant, it will be reset to default values.
+ * Keys that are missing from a config saved by an older version are filled in with their defaults.
  */
 void config_load();
 
@@ -4,10 +4,12 @@
  */
 
 #include <math.h>
-#include <stdlib.h>
 #include <string.h>
 
-#include "lib/parson.h"
+#include "platform/flash.h"
+
+#include "lib/cobs.h"
+#include "lib/jsonreader.h"
 
 #include "sys/log.h"
 #include "sys/print.h"
@@ -15,134 +17,322 @@
 
 #include "flightplan.h"
 
-#define JSON_SCHEMA_V1                                                                                                         \
-    "{\"version\":\"\",\"version_fw\":\"\",\"alt_samples\":0,\"waypoints\":"                                                   \
-    "[{\"lat\":0,\"lng\":0,\"alt\":0,\"speed\":0,\"drop\":0}]}"
+// Fields of a Flightplan document, as bits of a mask of the ones that have been read (all of them are required)
+#define FIELD_VERSION (1 << 0)
+#define FIELD_VERSION_FW (1 << 1)
+#define FIELD_ALT_SAMPLES (1 << 2)
+#define FIELD_WAYPOINTS (1 << 3)
+#define FIELDS_ALL (FIELD_VERSION | FIELD_VERSION_FW | FIELD_ALT_SAMPLES | FIELD_WAYPOINTS)
+
+// Keys of a Waypoint's fields, which are all required too
+static const char *waypointKeys[WAYPOINT_NUM_FIELDS] = {"lat", "lng", "alt", "speed", "drop"};
 
 static Flightplan flightplan;
 static FlightplanError state = FLIGHTPLAN_STATUS_AWAITING; // Current state of the flightplan parsage
 
-static inline bool state_is_error() {
-    return state == FLIGHTPLAN_ERR_PARSE || state == FLIGHTPLAN_ERR_VERSION || state == FLIGHTPLAN_ERR_MEM;
+static inline bool state_is_error(FlightplanError err) {
+    return err == FLIGHTPLAN_ERR_PARSE || err == FLIGHTPLAN_ERR_VERSION || err == FLIGHTPLAN_ERR_MEM ||
+           err == FLIGHTPLAN_ERR_STORAGE;
 }
 
-static inline bool state_is_warning() {
-    return state == FLIGHTPLAN_WARN_FW_VERSION;
+static FlightplanError schema_error(bool silent) {
+    if (!silent)
+        printpre("flightplan", "ERROR: schema validation failed");
+    return FLIGHTPLAN_ERR_PARSE;
 }
 
-bool waypoint_is_valid(Waypoint *wpt) {
-    return fabs(wpt->lat) <= 90 && fabs(wpt->lng) <= 180 && wpt->alt >= 0 && wpt->alt <= 400 && wpt->speed >= 0 &&
-           wpt->speed <= 100 && wpt->drop >= 0 && wpt->drop <= 60;
+static FlightplanError storage_error(bool silent) {
+    if (!silent)
+        printpre("flightplan", "ERROR: unable to store flightplan");
+    return FLIGHTPLAN_ERR_STORAGE;
 }
 
-bool flightplan_was_parsed() {
-    return (state == FLIGHTPLAN_STATUS_OK || state == FLIGHTPLAN_STATUS_GPS_OFFSET || state == FLIGHTPLAN_WARN_FW_VERSION);
+// Converts a number to an integer, limiting it first so that it's always representable (out-of-range values stay invalid)
+static inline i32 to_i32(f64 num) {
+    return (i32)(num < -1E9 ? -1E9 : (num > 1E9 ? 1E9 : num));
 }
 
-FlightplanError flightplan_parse(const char *json, bool silent) {
-    if (flightplan_was_parsed())
-        state = FLIGHTPLAN_STATUS_AWAITING;
-    // Ensure the recieved JSON matches the template schema for a valid flightplan
-    JSON_Value *schema = json_parse_string(JSON_SCHEMA_V1);
-    JSON_Value *root = json_parse_string(json);
-    if (json_validate(schema, root) != JSONSuccess) {
-        if (!silent)
-            printpre("flightplan", "ERROR: schema validation failed");
-        state = FLIGHTPLAN_ERR_PARSE;
-        goto cleanup;
+static void record_from_waypoint(const Waypoint *wpt, FlightplanRecord *record) {
+    record->lat = (i32)lround(wpt->lat * 1E7);
+    record->lng = (i32)lround(wpt->lng * 1E7);
+    record->alt = (i16)wpt->alt;
+    record->speed = (u16)lroundf(wpt->speed * 100.f);
+    record->drop = (u8)wpt->drop;
+}
+
+static void waypoint_from_record(const FlightplanRecord *record, Waypoint *wpt) {
+    wpt->lat = record->lat / 1E7;
+    wpt->lng = record->lng / 1E7;
+    wpt->alt = record->alt;
+    wpt->speed = record->speed / 100.f;
+    wpt->drop = record->drop;
+}
+
+/**
+ * Reads a Waypoint object, whose beginning has just been read.
+ * @param reader the reader
+ * @param wpt pointer to where the Waypoint should be stored
+ * @return true if the Waypoint was read with all of its fields, false if the document is malformed
+ */
+static bool read_waypoint(JSONReader *reader, Waypoint *wpt) {
+    u32 fields = 0;
+    while (jsonr_next(reader) == JSONR_KEY) {
+        u32 field = 0;
+        while (field < WAYPOINT_NUM_FIELDS && !jsonr_equals(reader, waypointKeys[field]))
+            field++;
+        if (field == WAYPOINT_NUM_FIELDS) {
+            // Unknown fields are allowed, but ignored
+            if (!jsonr_skip(reader))
+                return false;
+            continue;
+        }
+        if (jsonr_next(reader) != JSONR_NUMBER)
+            return false;
+        f64 num = reader->number;
+        switch (field) {
+            case 0:
+                wpt->lat = num;
+                break;
+            case 1:
+                wpt->lng = num;
+                break;
+            case 2:
+                wpt->alt = to_i32(num);
+                break;
+            case 3:
+                wpt->speed = (f32)num;
+                break;
+            case 4:
+                wpt->drop = to_i32(num);
+                break;
+        }
+        fields |= 1u << field;
     }
+    return reader->token == JSONR_OBJECT_END && fields == (1u << WAYPOINT_NUM_FIELDS) - 1;
+}
+
+/**
+ * Reads a Flightplan document, writing its Waypoints to a file as they're read.
+ * @param reader the reader, at the start of the document
+ * @param file the file, positioned where the first Waypoint should be written
+ * @param header pointer to where the rest of the Flightplan's details should be stored
+ * @param silent if true, suppresses log messages
+ * @return FLIGHTPLAN_STATUS_OK if the document was read, otherwise the error that stopped it from being read
+ */
+static FlightplanError read_document(JSONReader *reader, lfs_file_t *file, FlightplanHeader *header, bool silent) {
+    u32 fields = 0;
+    if (jsonr_next(reader) != JSONR_OBJECT_BEGIN)
+        return schema_error(silent);
+    while (jsonr_next(reader) == JSONR_KEY) {
+        if (jsonr_equals(reader, "version") && !(fields & FIELD_VERSION)) {
+            if (jsonr_next(reader) != JSONR_STRING || !jsonr_string(reader, header->version, sizeof(header->version)))
+                return schema_error(silent);
+            fields |= FIELD_VERSION;
+        } else if (jsonr_equals(reader, "version_fw") && !(fields & FIELD_VERSION_FW)) {
+            if (jsonr_next(reader) != JSONR_STRING || !jsonr_string(reader, header->version_fw, sizeof(header->version_fw)))
+                return schema_error(silent);
+            fields |= FIELD_VERSION_FW;
+        } else if (jsonr_equals(reader, "alt_samples") && !(fields & FIELD_ALT_SAMPLES)) {
+            if (jsonr_next(reader) != JSONR_NUMBER)
+                return schema_error(silent);
+            if (reader->number < 0 || reader->number > 100) {
+                if (!silent)
+                    printpre("flightplan", "ERROR: invalid altitude samples");
+                return FLIGHTPLAN_ERR_PARSE;
+            }
+            header->alt_samples = (u8)reader->number;
+            fields |= FIELD_ALT_SAMPLES;
+        } else if (jsonr_equals(reader, "waypoints") && !(fields & FIELD_WAYPOINTS)) {
+            if (jsonr_next(reader) != JSONR_ARRAY_BEGIN)
+                return schema_error(silent);
+            // Each Waypoint is checked and written out as soon as it's been read, so only one is ever held at a time
+            while (jsonr_next(reader) == JSONR_OBJECT_BEGIN) {
+                Waypoint wpt;
+                if (!read_waypoint(reader, &wpt))
+                    return schema_error(silent);
+                if (!waypoint_is_valid(&wpt)) {
+                    if (!silent)
+                        printpre("flightplan", "ERROR: Waypoint %lu contains invalid data", header->waypoint_count + 1);
+                    return FLIGHTPLAN_ERR_PARSE;
+                }
+                FlightplanRecord record;
+                record_from_waypoint(&wpt, &record);
+                if (lfs_file_write(&lfs, file, &record, sizeof(record)) != sizeof(record))
+                    return storage_error(silent);
+                header->waypoint_count++;
+            }
+            if (reader->token != JSONR_ARRAY_END)
+                return schema_error(silent);
+            fields |= FIELD_WAYPOINTS;
+        } else if (!jsonr_skip(reader))
+            return schema_error(silent);
+    }
+    if (reader->token != JSONR_OBJECT_END || jsonr_next(reader) != JSONR_END || fields != FIELDS_ALL)
+        return schema_error(silent);
+    if (!silent)
+        printpre("flightplan", "flightplan contains %lu Waypoints\n", header->waypoint_count);
+    return FLIGHTPLAN_STATUS_OK;
+}
+
+/**
+ * Checks the versions in a Flightplan's header, and works out the state the Flightplan would be in.
+ * @param header the header
+ * @param silent if true, suppresses log messages
+ * @return the state of the Flightplan
+ */
+static FlightplanError check_header(const FlightplanHeader *header, bool silent) {
     // Version
-    JSON_Object *obj = json_value_get_object(root);
-    const char *version = json_object_get_string(obj, "version");
-    if (strcmp(version, FLIGHTPLAN_VERSION) != 0) {
+    if (strcmp(header->version, FLIGHTPLAN_VERSION) != 0) {
         if (!silent)
             printpre("flightplan", "ERROR: version mismatch");
-        state = FLIGHTPLAN_ERR_VERSION;
-        goto cleanup;
-    }
-    flightplan.version = malloc(strlen(version) + 1);
-    if (!flightplan.version) {
-        if (!silent)
-            printpre("flightplan", "ERROR: out of memory");
-        state = FLIGHTPLAN_ERR_MEM;
-        goto cleanup;
+        return FLIGHTPLAN_ERR_VERSION;
     }
-    strcpy(flightplan.version, version);
     // Firmware version
-    const char *version_fw = json_object_get_string(obj, "version_fw");
-    VersionCheck versionCheck = version_check((char *)version_fw);
-    switch (versionCheck) {
+    FlightplanError res = FLIGHTPLAN_STATUS_OK;
+    char version_fw[64]; // `version_check()` may write up to 64 characters back into the string
+    strcpy(version_fw, header->version_fw);
+    switch (version_check(version_fw)) {
         case VERSION_SAME:
         case VERSION_OLDER:
             break;
         case VERSION_NEWER:
             if (!silent)
                 printpre("flightplan", "a new firmware version is available");
-            state = FLIGHTPLAN_WARN_FW_VERSION;
-            // Don't return here as this is just a warning, we should continue parsing
+            res = FLIGHTPLAN_WARN_FW_VERSION;
+            // Don't return here as this is just a warning, we should continue checking
             break;
         default:
             if (!silent)
                 printpre("flightplan", "ERROR: firmware version check failed");
-            state = FLIGHTPLAN_ERR_PARSE;
-            goto cleanup;
+            return FLIGHTPLAN_ERR_PARSE;
     }
     // Altitude samples
-    flightplan.alt_samples = json_object_get_number(obj, "alt_samples");
-    if (flightplan.alt_samples < 0 || flightplan.alt_samples > 100) {
-        if (!silent)
-            printpre("flightplan", "ERROR: invalid altitude samples");
-        state = FLIGHTPLAN_ERR_PARSE;
-        goto cleanup;
-    }
-    if (flightplan.alt_samples != 0 && !state_is_warning() && !state_is_error())
-        state = FLIGHTPLAN_STATUS_GPS_OFFSET; // Only replace the state if there have been no warnings/errors up to this point
+    if (header->alt_samples != 0 && res == FLIGHTPLAN_STATUS_OK)
+        res = FLIGHTPLAN_STATUS_GPS_OFFSET; // Only replace the state if there have been no warnings up to this point
     // Note that the signal to start sampling altitudes is only sent once the user engages auto mode
-    // Waypoint array
-    JSON_Array *waypoints = json_object_get_array(obj, "waypoints");
-    flightplan.waypoint_count = json_array_get_count(waypoints);
-    if (!silent)
-        printpre("flightplan", "flightplan contains %lu Waypoints\n", flightplan.waypoint_count);
-    flightplan.waypoints = calloc(flightplan.waypoint_count, sizeof(Waypoint));
-    if (!flightplan.waypoints) {
-        if (!silent)
-            printpre("flightplan", "ERROR: out of memory");
-        state = FLIGHTPLAN_ERR_MEM;
-        goto cleanup;
+    return res;
+}
+
+/**
+ * Computes the CRC of the start of a file.
+ * @param file the file, which is left positioned at `len`
+ * @param len the number of bytes to include
+ * @param crc pointer to where the CRC should be stored
+ * @return true if successful
+ */
+static bool file_crc(lfs_file_t *file, u32 len, u16 *crc) {
+    if (lfs_file_seek(&lfs, file, 0, LFS_SEEK_SET) < 0)
+        return false;
+    *crc = CRC16_CCITT_INIT;
+    byte buf[32];
+    while (len > 0) {
+        u32 n = len < sizeof(buf) ? len : sizeof(buf);
+        if (lfs_file_read(&lfs, file, buf, n) != (lfs_ssize_t)n)
+            return false;
+        *crc = crc16_ccitt_update(*crc, buf, n);
+        len -= n;
     }
-    for (u32 i = 0; i < flightplan.waypoint_count; i++) {
-        JSON_Object *waypoint = json_array_get_object(waypoints, i);
-        flightplan.waypoints[i].lat = json_object_get_number(waypoint, "lat");
-        flightplan.waypoints[i].lng = json_object_get_number(waypoint, "lng");
-        flightplan.waypoints[i].alt = json_object_get_number(waypoint, "alt");
-        flightplan.waypoints[i].speed = json_object_get_number(waypoint, "speed");
-        flightplan.waypoints[i].drop = json_object_get_number(waypoint, "drop");
-        if (!waypoint_is_valid(&flightplan.waypoints[i])) {
-            if (!silent)
-                printpre("flightplan", "ERROR: Waypoint %lu contains invalid data", i + 1);
-            state = FLIGHTPLAN_ERR_PARSE;
-            goto cleanup;
-        }
+    return true;
+}
+
+/**
+ * Finishes writing a Flightplan file: writes its header, and appends the CRC.
+ * @param file the file, holding space for the header followed by all of the Waypoints
+ * @param header the header
+ * @return true if successful
+ */
+static bool finish_file(lfs_file_t *file, const FlightplanHeader *header) {
+    if (lfs_file_seek(&lfs, file, 0, LFS_SEEK_SET) < 0 ||
+        lfs_file_write(&lfs, file, header, sizeof(*header)) != sizeof(*header))
+        return false;
+    // The CRC is computed from what was actually written, so anything that didn't make it to the flash intact is caught
+    u16 crc;
+    if (!file_crc(file, sizeof(*header) + header->waypoint_count * sizeof(FlightplanRecord), &crc))
+        return false;
+    return lfs_file_write(&lfs, file, &crc, sizeof(crc)) == sizeof(crc);
+}
+
+static void use_header(const FlightplanHeader *header) {
+    strcpy(flightplan.version, header->version);
+    strcpy(flightplan.version_fw, header->version_fw);
+    flightplan.alt_samples = header->alt_samples;
+    flightplan.waypoint_count = header->waypoint_count;
+}
+
+bool waypoint_is_valid(Waypoint *wpt) {
+    return fabs(wpt->lat) <= 90 && fabs(wpt->lng) <= 180 && wpt->alt >= 0 && wpt->alt <= 400 && wpt->speed >= 0 &&
+           wpt->speed <= 100 && wpt->drop >= 0 && wpt->drop <= 60;
+}
+
+bool flightplan_was_parsed() {
+    return (state == FLIGHTPLAN_STATUS_OK || state == FLIGHTPLAN_STATUS_GPS_OFFSET || state == FLIGHTPLAN_WARN_FW_VERSION);
+}
+
+bool flightplan_load() {
+    lfs_file_t file;
+    if (lfs_file_open(&lfs, &file, FLIGHTPLAN_FILE, LFS_O_RDONLY) != LFS_ERR_OK)
+        return false; // Nothing stored
+    FlightplanHeader header;
+    u16 crc, storedCrc;
+    u64 len = 0;
+    bool valid = lfs_file_read(&lfs, &file, &header, sizeof(header)) == sizeof(header) &&
+                 header.magic == FLIGHTPLAN_MAGIC && header.format == FLIGHTPLAN_FORMAT;
+    if (valid) {
+        len = sizeof(header) + (u64)header.waypoint_count * sizeof(FlightplanRecord);
+        valid = (u64)lfs_file_size(&lfs, &file) == len + sizeof(storedCrc) && file_crc(&file, (u32)len, &crc) &&
+                lfs_file_read(&lfs, &file, &storedCrc, sizeof(storedCrc)) == sizeof(storedCrc) && crc == storedCrc;
     }
+    lfs_file_close(&lfs, &file);
+    FlightplanError res = FLIGHTPLAN_ERR_PARSE;
+    if (valid) {
+        header.version[sizeof(header.version) - 1] = '\0';
+        header.version_fw[sizeof(header.version_fw) - 1] = '\0';
+        res = check_header(&header, false);
+    } else
+        printpre("flightplan", "stored flightplan is corrupt");
+    if (state_is_error(res)) {
+        // A Flightplan that can't be used is discarded, so this doesn't happen again on every boot
+        lfs_remove(&lfs, FLIGHTPLAN_FILE);
+        return false;
+    }
+    use_header(&header);
+    state = res;
+    printpre("flightplan", "loaded stored flightplan with %lu Waypoints", flightplan.waypoint_count);
+    return true;
+}
 
-    // Copy JSON string to be accessible later
-    flightplan.json = malloc(strlen(json) + 1);
-    if (!flightplan.json) {
-        if (!silent)
-            printpre("flightplan", "ERROR: out of memory");
-        state = FLIGHTPLAN_ERR_MEM;
+FlightplanError flightplan_parse(const char *json, bool silent) {
+    state = FLIGHTPLAN_STATUS_AWAITING;
+    lfs_file_t file;
+    if (lfs_file_open(&lfs, &file, FLIGHTPLAN_FILE, LFS_O_RDWR | LFS_O_CREAT | LFS_O_TRUNC) != LFS_ERR_OK) {
+        state = storage_error(silent);
+        return state;
+    }
+    // The header's fields may come in any order in the document (including after the Waypoints), so it's only written once
+    // the whole document has been read; space is left for it until then
+    FlightplanHeader header = {.magic = FLIGHTPLAN_MAGIC, .format = FLIGHTPLAN_FORMAT};
+    FlightplanError res;
+    if (lfs_file_write(&lfs, &file, &header, sizeof(header)) == sizeof(header)) {
+        JSONReader reader;
+        jsonr_init(&reader, json, (u32)strlen(json));
+        res = read_document(&reader, &file, &header, silent);
+    } else
+        res = storage_error(silent);
+    if (!state_is_error(res))
+        res = check_header(&header, silent);
+    if (!state_is_error(res) && !finish_file(&file, &header))
+        res = storage_error(silent);
+    if (lfs_file_close(&lfs, &file) != LFS_ERR_OK && !state_is_error(res))
+        res = storage_error(silent);
+    state = res;
+    if (state_is_error(state)) {
+        // Whatever was stored before has already been overwritten, so no Flightplan is left
+        lfs_remove(&lfs, FLIGHTPLAN_FILE);
         return state;
     }
-    strcpy(flightplan.json, json);
 
-    if (state != FLIGHTPLAN_STATUS_GPS_OFFSET && state != FLIGHTPLAN_WARN_FW_VERSION)
-        // Make sure we don't overwrite the state if it's already set
-        state = FLIGHTPLAN_STATUS_OK;
+    use_header(&header);
     log_message(TYPE_INFO, "Flightplan recieved!", -1, 0, false);
-
-cleanup:
-    json_value_free(root);
-    json_value_free(schema);
     return state;
 }
 
@@ -152,6 +342,25 @@ Flightplan *flightplan_get() {
     return NULL;
 }
 
+u32 flightplan_read_waypoints(u32 index, Waypoint wpts[], u32 max) {
+    if (!flightplan_was_parsed() || index >= flightplan.waypoint_count)
+        return 0;
+    if (max > flightplan.waypoint_count - index)
+        max = flightplan.waypoint_count - index;
+    lfs_file_t file;
+    if (max == 0 || lfs_file_open(&lfs, &file, FLIGHTPLAN_FILE, LFS_O_RDONLY) != LFS_ERR_OK)
+        return 0;
+    u32 read = 0;
+    if (lfs_file_seek(&lfs, &file, sizeof(FlightplanHeader) + index * sizeof(FlightplanRecord), LFS_SEEK_SET) >= 0) {
+        // Records are read one at a time (the filesystem caches reads anyway), so nothing bigger than one is buffered here
+        FlightplanRecord record;
+        while (read < max && lfs_file_read(&lfs, &file, &record, sizeof(record)) == sizeof(record))
+            waypoint_from_record(&record, &wpts[read++]);
+    }
+    lfs_file_close(&lfs, &file);
+    return read;
+}
+
 FlightplanError flightplan_state() {
     return state;
 }
@@ -5,18 +5,42 @@
 
 #include "modes/auto.h"
 
+// Flightplans are uploaded as JSON, but are read straight into a compact binary form as they're parsed (so the document is never
+// held as a tree, and its Waypoints are never all in RAM at once). The binary form is stored in FLIGHTPLAN_FILE, so the
+// Flightplan survives a reboot, and its Waypoints are read back from there whenever they're needed.
+// FLIGHTPLAN_FILE holds a FlightplanHeader, followed by `waypoint_count` FlightplanRecords, followed by the CRC-16/CCITT of
+// everything before it (u16, little-endian like the rest of the file).
+
+#define FLIGHTPLAN_FILE "flightplan.bin"
+#define FLIGHTPLAN_MAGIC 0x50574246 // "FBWP"
+#define FLIGHTPLAN_FORMAT 1         // Version of the binary form, bumped whenever it changes
+#define FLIGHTPLAN_VERSION_MAX 32   // Longest version string that can be stored, including the null terminator
+
 #define FLIGHTPLAN_MSG_STATUS_GPS_OFFSET "When ready, please engage auto mode to calibrate the GPS."
 #define FLIGHTPLAN_MSG_WARN_FW_VERSION "A new firmware version is available!"
 
 typedef struct Flightplan {
-    char *version;
-    char *version_fw;
+    char version[FLIGHTPLAN_VERSION_MAX];
+    char version_fw[FLIGHTPLAN_VERSION_MAX];
     i32 alt_samples;
-    Waypoint *waypoints;
+    u32 waypoint_count; // The Waypoints themselves are read with `flightplan_read_waypoints()`
+} Flightplan;
+
+typedef struct __attribute__((packed)) FlightplanHeader {
+    u32 magic; // FLIGHTPLAN_MAGIC
+    u8 format; // FLIGHTPLAN_FORMAT
+    char version[FLIGHTPLAN_VERSION_MAX];
+    char version_fw[FLIGHTPLAN_VERSION_MAX];
+    u8 alt_samples;
     u32 waypoint_count;
+} FlightplanHeader;
 
-    char *json;
-} Flightplan;
+typedef struct __attribute__((packed)) FlightplanRecord {
+    i32 lat, lng; // deg * 1e7 (about 1cm)
+    i16 alt;      // m
+    u16 speed;    // kts * 100
+    u8 drop;      // s
+} FlightplanRecord;
 
 typedef enum FlightplanError {
     FLIGHTPLAN_STATUS_OK,
@@ -26,6 +50,7 @@ typedef enum FlightplanError {
     FLIGHTPLAN_ERR_PARSE,
     FLIGHTPLAN_ERR_VERSION,
     FLIGHTPLAN_ERR_MEM,
+    FLIGHTPLAN_ERR_STORAGE,
 } FlightplanError;
 
 /**
@@ -34,12 +59,19 @@ typedef enum FlightplanError {
 bool waypoint_is_valid(Waypoint *wpt);
 
 /**
- * @return true if a Flightplan has previously been parsed
+ * @return true if a Flightplan has previously been parsed (or loaded)
  */
 bool flightplan_was_parsed();
 
 /**
- * Parses a Flightplan from a JSON string.
+ * Loads the Flightplan stored in the filesystem, if there is one.
+ * @return true if a Flightplan was loaded
+ * @note The filesystem must be mounted first.
+ */
+bool flightplan_load();
+
+/**
+ * Parses a Flightplan from a JSON string, and stores it in the filesystem (replacing any previous one).
  * @param json the JSON string to parse
  * @param silent if true, suppresses log messages
  * @return the result of the parse attempt, if successful,
@@ -52,6 +84,16 @@ FlightplanError flightplan_parse(const char *json, bool silent);
  */
 Flightplan *flightplan_get();
 
+/**
+ * Reads Waypoints of the Flightplan from the filesystem.
+ * @param index index of the first Waypoint to read
+ * @param wpts where to store the Waypoints
+ * @param max the most Waypoints to read
+ * @return the number of Waypoints read (fewer than `max` if the Flightplan ends first, 0 if there's no Flightplan or the read
+ * failed)
+ */
+u32 flightplan_read_waypoints(u32 index, Waypoint wpts[], u32 max);
+
 /**
  * @return the current state of the Flightplan
  */
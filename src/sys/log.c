@@ -4,9 +4,9 @@
  */
 
 #include <stdio.h>
-#include <stdlib.h>
 #include <string.h>
 #include "platform/defs.h"
+#include "platform/flash.h"
 #include "platform/gpio.h"
 #include "platform/sys.h"
 #include "platform/time.h"
@@ -27,26 +27,36 @@
 
 #define DISP_LOG_URL "pico-fbw.org/"
 
-static LogEntry *logs = NULL;
-static u32 numLogs = 0;
-static LogEntry *lastEntry = NULL, *lastDisplayedEntry = NULL;
-static CallbackData *queueCallback = NULL;
+static LogEntry logs[LOG_CAPACITY]; // Ring of entries, the oldest of which is at `first`
+static u32 first = 0, numLogs = 0;
+static u32 numOfType[TYPE_FATAL + 1]; // Number of entries of each type, so the most severe entries can be found directly
+
+static LogEntry lastEntry; // Copy of the last entry, which new entries are compared against to decide whether to display them
+static bool hasLastEntry = false;
+static LogType displayedType = TYPE_NONE;
+static LogEntry queuedEntry; // Entry waiting for boot to complete to be displayed
+static CallbackID queueCallback = 0;
+
+static LogRecord pending[LOG_PENDING_MAX]; // Entries waiting to be saved by `log_flush()`
+static u32 numPending = 0;
+static bool saving = false;
+static u16 boot = 0;
+static u32 numSaved = 0, numSavedOld = 0; // Number of records in LOG_FILE and LOG_FILE_OLD
 
 /* --- LED --- */
 
 #ifdef PIN_LED
 
-static CallbackData *pulseCallback = NULL;
+static CallbackID pulseCallback = 0;
 static u32 pulseMs = 0;
-static CallbackData *toggleCallback = NULL;
+static CallbackID toggleCallback = 0;
 static u32 toggleMs = 0;
 
 // Resets the LED to the on state and cancels any scheduled state change callbacks
 static void led_reset() {
     cancel_callback(toggleCallback);
     toggleMs = 0;
-    // We cannot cancel the pulse callback as it does not reschedule itself, and the callback system doesn't support
-    // cancelling a one-time callback
+    cancel_callback(pulseCallback);
     pulseMs = 0;
     gpio_set(PIN_LED, STATE_HIGH);
 }
@@ -77,7 +87,7 @@ static i32 led_callback(void *data) {
  * Visually displays a log entry.
  * @param entry The entry to display.
  */
-static void display_log(LogEntry *entry) {
+static void display_log(const LogEntry *entry) {
 #if PLATFORM_SUPPORTS_DISPLAY
     if ((bool)config.system[SYSTEM_USE_DISPLAY]) {
         // Display the entry on the external display, if available
@@ -144,71 +154,179 @@ static void display_log(LogEntry *entry) {
     toggleMs = entry->code;
     toggleCallback = callback_in_ms(toggleMs, led_callback, NULL);
 #endif
-    lastDisplayedEntry = entry;
+    displayedType = entry->type;
 }
 
 // Callback to process the a queued log entry from boot
 static i32 process_queue(void *data) {
     if (!boot_is_booted())
         return 500; // Not booted yet, check back in 500ms
-    LogEntry *queuedEntry = (LogEntry *)data;
-    if (queuedEntry)
-        display_log(queuedEntry);
+    display_log(&queuedEntry);
+    queueCallback = 0;
     return 0;
+    (void)data;
 }
 
 /**
  * Resets the last log entry.
  * @note This makes it so that the next log entry will be displayed regardless.
  */
-void reset_last() {
-    if (lastEntry) {
-        lastEntry->type = TYPE_NONE;
-        lastEntry->code = UINT16_MAX;
+static void reset_last() {
+    if (hasLastEntry) {
+        lastEntry.type = TYPE_NONE;
+        lastEntry.code = UINT16_MAX;
     }
 }
 
+/**
+ * @param index the index of the entry, from 0 (the oldest entry)
+ * @return the entry's slot in the ring
+ */
+static inline LogEntry *entry_at(u32 index) {
+    return &logs[(first + index) % LOG_CAPACITY];
+}
+
+/**
+ * Finds the entry that should be displayed when nothing more recent is: the oldest of the most severe type.
+ * @return the entry, or NULL if there are no entries that can be displayed
+ */
+static LogEntry *most_severe() {
+    for (LogType type = TYPE_FATAL; type >= TYPE_INFO; type--) {
+        if (numOfType[type] == 0)
+            continue;
+        for (u32 i = 0; i < numLogs; i++) {
+            LogEntry *entry = entry_at(i);
+            if (entry->type == type && entry->code > -1)
+                return entry;
+        }
+    }
+    return NULL;
+}
+
+/**
+ * Queues an entry to be saved to the filesystem, if it's severe enough.
+ * @param entry the entry to save
+ */
+static void queue_save(const LogEntry *entry) {
+    if (entry->type < TYPE_WARNING || numPending >= LOG_PENDING_MAX)
+        return;
+    LogRecord *record = &pending[numPending++];
+    *record = (LogRecord){
+        .boot = boot,
+        .type = (u8)entry->type,
+        .code = entry->code,
+        .timestamp = entry->timestamp,
+    };
+    strncpy(record->msg, entry->msg, LOG_MSG_MAX - 1);
+}
+
+/**
+ * Counts the records saved in a file.
+ * @param path the path to the file
+ * @param last pointer to where the last record should be stored, left untouched if there are no records
+ * @return the number of records
+ */
+static u32 count_records(const char *path, LogRecord *last) {
+    lfs_file_t file;
+    if (lfs_file_open(&lfs, &file, path, LFS_O_RDWR) != LFS_ERR_OK)
+        return 0;
+    lfs_soff_t size = lfs_file_size(&lfs, &file);
+    u32 count = size > 0 ? (u32)size / sizeof(LogRecord) : 0;
+    // A write that failed partway may have left part of a record at the end, which new records would be misaligned after
+    if (size > 0 && (u32)size % sizeof(LogRecord) != 0)
+        lfs_file_truncate(&lfs, &file, count * sizeof(LogRecord));
+    if (count > 0) {
+        lfs_file_seek(&lfs, &file, (count - 1) * sizeof(LogRecord), LFS_SEEK_SET);
+        if (lfs_file_read(&lfs, &file, last, sizeof(LogRecord)) != sizeof(LogRecord))
+            count = 0;
+    }
+    lfs_file_close(&lfs, &file);
+    return count;
+}
+
+/**
+ * Reads records saved in a file.
+ * @param path the path to the file
+ * @param index the index of the first record to read
+ * @param records the array to read the records into
+ * @param max the maximum number of records to read
+ * @return the number of records read
+ */
+static u32 read_records(const char *path, u32 index, LogRecord records[], u32 max) {
+    lfs_file_t file;
+    if (max == 0 || lfs_file_open(&lfs, &file, path, LFS_O_RDONLY) != LFS_ERR_OK)
+        return 0;
+    lfs_ssize_t read = -1;
+    if (lfs_file_seek(&lfs, &file, index * sizeof(LogRecord), LFS_SEEK_SET) >= 0)
+        read = lfs_file_read(&lfs, &file, records, max * sizeof(LogRecord));
+    lfs_file_close(&lfs, &file);
+    return read > 0 ? (u32)read / sizeof(LogRecord) : 0;
+}
+
 void log_init() {
 #ifdef PIN_LED
     gpio_setup(PIN_LED, MODE_OUTPUT);
     gpio_set(PIN_LED, STATE_HIGH);
 #endif
-    logs = NULL;
+    first = 0;
     numLogs = 0;
-    reset_last();
+    memset(numOfType, 0, sizeof(numOfType));
+    hasLastEntry = false;
+    displayedType = TYPE_NONE;
+}
+
+bool log_persist_init() {
+    // Entries saved during previous boots can be read even if saving is disabled now
+    LogRecord last;
+    numSavedOld = count_records(LOG_FILE_OLD, &last);
+    numSaved = count_records(LOG_FILE, &last);
+    boot = numSavedOld + numSaved > 0 ? last.boot + 1 : 0;
+    if (!(bool)config.system[SYSTEM_SAVE_LOGS])
+        return true;
+    lfs_file_t file;
+    if (lfs_file_open(&lfs, &file, LOG_FILE, LFS_O_WRONLY | LFS_O_CREAT) != LFS_ERR_OK)
+        return false;
+    lfs_file_close(&lfs, &file);
+    saving = true;
+    for (u32 i = 0; i < numLogs; i++)
+        queue_save(entry_at(i));
+    return true;
 }
 
 void log_message(LogType type, const char *msg, i32 code, u32 pulse_ms, bool force) {
-    numLogs++;
-    LogEntry *new = realloc(logs, numLogs * sizeof(LogEntry));
-    if (!new) {
+    if (numLogs == LOG_CAPACITY) {
+        // The ring is full, overwrite the oldest entry
+        numOfType[logs[first].type]--;
+        first = (first + 1) % LOG_CAPACITY;
         numLogs--;
-        return;
     }
-    logs = new;
-    LogEntry *entry = &logs[numLogs - 1];
+    LogEntry *entry = entry_at(numLogs++);
     entry->type = type;
     entry->msg = msg;
     entry->code = code;
     entry->pulse = pulse_ms;
     entry->timestamp = time_us();
+    numOfType[type]++;
+    if (saving)
+        queue_save(entry);
 
     // Display the entry if: the error is more severe than the last,
     // there was a code given, the type is severe enough, it was forced, or of the same type (but newer)
     if (type >= TYPE_INFO && code > -1) {
-        if (force || (lastEntry && (type >= lastEntry->type || code <= lastEntry->code))) {
+        if (force || (hasLastEntry && (type >= lastEntry.type || code <= lastEntry.code))) {
             if (boot_is_booted() || force || type == TYPE_FATAL || type == TYPE_INFO) {
                 display_log(entry);
             } else {
                 // The system isn't booted and the type isn't severe enough to warrant displaying it at the moment,
                 // so we'll check back every 500ms if the system is booted and display if it is
-                if (queueCallback)
-                    cancel_callback(queueCallback);
-                queueCallback = callback_in_ms(500, process_queue, (void *)entry);
+                cancel_callback(queueCallback);
+                queuedEntry = *entry;
+                queueCallback = callback_in_ms(500, process_queue, NULL);
             }
         }
     }
-    lastEntry = entry;
+    lastEntry = *entry;
+    hasLastEntry = true;
 
     // Format an error string to be printed
     const char *typeMsg = NULL;
@@ -245,6 +363,7 @@ void log_message(LogType type, const char *msg, i32 code, u32 pulse_ms, bool for
     if (type == TYPE_FATAL) {
         // Halt execution for fatal errors
         print("\n" COLOR_LIGHT_RED "Fatal error encountered, halting pico-fbw!");
+        log_flush(); // Nothing will be flushed after this, and this is the entry most worth reading after a reboot
         while (true)
             // Keep the system running but hang (callbacks still run for LED)
             sys_periodic();
@@ -252,66 +371,110 @@ void log_message(LogType type, const char *msg, i32 code, u32 pulse_ms, bool for
 }
 
 void log_clear(LogType type) {
-    // Delete any entries with matching type from the log array
+    // Delete any entries with matching type, moving the rest towards the oldest in a single pass
+    u32 kept = 0;
     for (u32 i = 0; i < numLogs; i++) {
-        if (logs[i].type == type) {
-            for (u32 j = i; j < numLogs - 1; j++)
-                logs[j] = logs[j + 1];
-            numLogs--;
-            i--;
-            LogEntry *new = realloc(logs, numLogs * sizeof(LogEntry));
-            if (!new)
-                return;
-            logs = new;
-        }
+        LogEntry *entry = entry_at(i);
+        if (entry->type == type)
+            continue;
+        if (kept != i)
+            *entry_at(kept) = *entry;
+        kept++;
     }
-    if (lastEntry) {
-        // If the last entry is of the specified type to clear, reset it so the next entry is properly logged
-        if (lastEntry->type == type)
-            reset_last();
-        // Reset the error display if the current displayed error is of this type
-        if (lastEntry->type == type) {
-            // Go through all log types in reverse order to find the most fatal error (if it exists), and display it instead
-            bool hadError = false;
-            for (LogType type = TYPE_FATAL; type >= TYPE_INFO; type--) {
-                for (u32 i = 0; i < numLogs; i++) {
-                    if (logs[i].type >= type) {
-                        display_log(&logs[i]);
-                        hadError = true;
-                        break;
-                    }
-                }
-                if (hadError)
-                    break;
-            }
-            // If there was no error, reset the display
-            if (!hadError) {
-                if ((bool)config.system[SYSTEM_USE_DISPLAY])
-                    display_power_save();
+    numLogs = kept;
+    numOfType[type] = 0;
+    if (queueCallback && queuedEntry.type == type) {
+        cancel_callback(queueCallback);
+        queueCallback = 0;
+    }
+    // If the last entry is of the specified type to clear, reset it so the next entry is properly logged
+    if (hasLastEntry && lastEntry.type == type)
+        reset_last();
+    // If the displayed entry is of this type, display the most severe entry left instead (if there is one)
+    if (displayedType == type) {
+        LogEntry *entry = most_severe();
+        if (entry) {
+            display_log(entry);
+        } else {
+            displayedType = TYPE_NONE;
+            if ((bool)config.system[SYSTEM_USE_DISPLAY])
+                display_power_save();
 #ifdef PIN_LED
-                else
-                    led_reset();
+            else
+                led_reset();
 #endif
-            }
         }
     }
 }
 
+void log_flush() {
+    if (!saving || numPending == 0)
+        return;
+    u32 written = 0;
+    while (written < numPending) {
+        if (numSaved >= LOG_FILE_RECORDS) {
+            // Rotate the file; renaming replaces the old one
+            if (lfs_rename(&lfs, LOG_FILE, LOG_FILE_OLD) != LFS_ERR_OK)
+                break;
+            numSavedOld = numSaved;
+            numSaved = 0;
+        }
+        u32 count = numPending - written;
+        if (count > LOG_FILE_RECORDS - numSaved)
+            count = LOG_FILE_RECORDS - numSaved;
+        lfs_file_t file;
+        if (lfs_file_open(&lfs, &file, LOG_FILE, LFS_O_WRONLY | LFS_O_CREAT | LFS_O_APPEND) != LFS_ERR_OK)
+            break;
+        lfs_ssize_t size = count * sizeof(LogRecord);
+        bool ok = lfs_file_write(&lfs, &file, &pending[written], size) == size;
+        if (lfs_file_close(&lfs, &file) != LFS_ERR_OK || !ok)
+            break;
+        numSaved += count;
+        written += count;
+    }
+    if (written < numPending) {
+        printpre("log", "ERROR: unable to save logs, saving disabled");
+        saving = false;
+    }
+    numPending = 0;
+}
+
 u32 log_count() {
     return numLogs;
 }
 
 u32 log_count_errs() {
-    u32 count = 0;
-    for (u32 i = 0; i < numLogs; i++) {
-        if (logs[i].type == TYPE_WARNING || logs[i].type == TYPE_ERROR || logs[i].type == TYPE_FATAL)
-            count++;
-    }
-    return count;
+    return numOfType[TYPE_WARNING] + numOfType[TYPE_ERROR] + numOfType[TYPE_FATAL];
 }
 
 LogEntry *log_get(u32 index) {
-    if (index < numLogs && logs)
-        return &logs[index];
+    if (index < numLogs)
+        return entry_at(index);
     return NULL;
 }
+
+u16 log_boot() {
+    return boot;
+}
+
+u32 log_count_saved() {
+    return numSavedOld + numSaved;
+}
+
+u32 log_read_saved(u32 index, LogRecord records[], u32 max) {
+    // The records in LOG_FILE_OLD come first, followed by those in LOG_FILE
+    u32 read = 0;
+    if (index < numSavedOld) {
+        u32 count = numSavedOld - index < max ? numSavedOld - index : max;
+        read = read_records(LOG_FILE_OLD, index, records, count);
+        if (read < count || read == max)
+            return read;
+        index = numSavedOld;
+    }
+    index -= numSavedOld;
+    if (index < numSaved) {
+        u32 count = numSaved - index < max - read ? numSaved - index : max - read;
+        read += read_records(LOG_FILE, index, records + read, count);
+    }
+    return read;
+}
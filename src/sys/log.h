@@ -3,6 +3,21 @@
 #include <stdbool.h>
 #include "platform/types.h"
 
+// Log entries are kept in RAM in a ring of LOG_CAPACITY entries; once it's full, the oldest entry is overwritten by each new
+// one, so logging never allocates and a noisy sensor can't use up memory.
+//
+// Entries of WARNING severity and above are also saved to the filesystem (if enabled by the configuration), so errors that led
+// up to a reboot (e.g. by the watchdog) can be read after it. Saving is deferred to `log_flush()`, so logging never touches the
+// flash itself. Saved entries are LogRecords appended to LOG_FILE; once it holds LOG_FILE_RECORDS of them, it's renamed to
+// LOG_FILE_OLD (replacing the previous one) and a new LOG_FILE is started.
+
+#define LOG_CAPACITY 64          // Entries kept in RAM
+#define LOG_MSG_MAX 48           // Longest message of a saved entry, including the null terminator (longer ones are cut off)
+#define LOG_FILE "log.bin"       // Saved entries, oldest first
+#define LOG_FILE_OLD "log.1.bin" // Saved entries from before LOG_FILE was last rotated
+#define LOG_FILE_RECORDS 32      // Entries saved to LOG_FILE before it's rotated
+#define LOG_PENDING_MAX 8        // Entries waiting to be saved; any more are dropped until `log_flush()` catches up
+
 typedef enum LogType {
     TYPE_NONE,
     TYPE_INFO, // Printed to the console and displayed on the system's LED/OLED
@@ -19,12 +34,29 @@ typedef struct LogEntry {
     u64 timestamp;
 } LogEntry;
 
+typedef struct __attribute__((packed)) LogRecord {
+    u16 boot;              // Boot the entry was logged during, counting up from 0 since the log was first saved
+    u8 type;               // LogType
+    u8 reserved;
+    i32 code;
+    u64 timestamp;         // Time since boot, us
+    char msg[LOG_MSG_MAX]; // Null-terminated
+} LogRecord;
+
 /**
  * Initialize the logging system.
  * @note This also initializes the onboard LED where applicable.
  */
 void log_init();
 
+/**
+ * Starts saving entries to the filesystem, if enabled by the configuration.
+ * Entries logged since boot that haven't been overwritten are saved too.
+ * @return true if successful (or disabled), false if entries cannot be saved
+ * @note The filesystem must be mounted and the configuration loaded.
+ */
+bool log_persist_init();
+
 /**
  * Logs a message.
  * @param type the type of log to make
@@ -38,9 +70,16 @@ void log_message(LogType type, const char *msg, i32 code, u32 pulse_ms, bool for
 /**
  * Clears all logs of the specified type.
  * @param type the type of log to clear
+ * @note Entries that have already been saved are not affected.
  */
 void log_clear(LogType type);
 
+/**
+ * Saves any entries that are waiting to be saved to the filesystem.
+ * @note This should be called periodically, at a lower priority than anything time-critical.
+ */
+void log_flush();
+
 /**
  * @return the current number of log entries
  */
@@ -52,6 +91,27 @@ u32 log_count();
 u32 log_count_errs();
 
 /**
- * @return the log entry at the given index
+ * @param index the index of the entry, from 0 (the oldest entry still kept)
+ * @return the log entry at the given index, or NULL if there is no such entry
+ * @note The entry is only valid until the next entry is logged or entries are cleared.
  */
 LogEntry *log_get(u32 index);
+
+/**
+ * @return the number of boots before this one that entries have been saved during (this boot's LogRecord.boot)
+ */
+u16 log_boot();
+
+/**
+ * @return the number of entries saved to the filesystem, including those from previous boots
+ */
+u32 log_count_saved();
+
+/**
+ * Reads entries saved to the filesystem.
+ * @param index the index of the first entry to read, from 0 (the oldest entry saved)
+ * @param records the array to read the entries into
+ * @param max the maximum number of entries to read
+ * @return the number of entries read
+ */
+u32 log_read_saved(u32 index, LogRecord records[], u32 max);
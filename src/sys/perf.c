@@ -0,0 +1,97 @@
+/**
+ * Source file of pico-fbw: https://github.com/pico-fbw/pico-fbw
+ * Licensed under the GNU AGPL-3.0
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "platform/time.h"
+
+#include "perf.h"
+
+typedef struct PerfRing {
+    u32 samples[PERF_SAMPLES];
+    u32 head;     // Total number of samples written, the next sample is written at head % PERF_SAMPLES
+    u32 overruns; // Number of samples that exceeded the budget
+    u32 budget;   // Budget in us, 0 if none
+    u64 start;    // Time at which the stage was last begun, in us
+} PerfRing;
+
+static PerfRing rings[PERF_STAGE_COUNT];
+
+static const char *stageNames[PERF_STAGE_COUNT] = {
+    [PERF_AAHRS] = "aahrs", [PERF_AIRCRAFT] = "aircraft", [PERF_GPS] = "gps",       [PERF_API] = "api",
+    [PERF_WIFI] = "wifi",   [PERF_RECORDER] = "recorder", [PERF_STREAM] = "stream", [PERF_JITTER] = "jitter",
+};
+
+static int compare_u32(const void *a, const void *b) {
+    u32 x = *(const u32 *)a, y = *(const u32 *)b;
+    return (x > y) - (x < y);
+}
+
+void perf_set_budget(PerfStage stage, u32 budget_us) {
+    if (stage >= PERF_STAGE_COUNT)
+        return;
+    rings[stage].budget = budget_us;
+}
+
+void perf_begin(PerfStage stage) {
+    if (stage >= PERF_STAGE_COUNT)
+        return;
+    rings[stage].start = time_us();
+}
+
+void perf_end(PerfStage stage) {
+    if (stage >= PERF_STAGE_COUNT)
+        return;
+    perf_record(stage, (u32)(time_us() - rings[stage].start));
+}
+
+void perf_record(PerfStage stage, u32 us) {
+    if (stage >= PERF_STAGE_COUNT)
+        return;
+    PerfRing *ring = &rings[stage];
+    ring->samples[ring->head % PERF_SAMPLES] = us;
+    ring->head++;
+    if (ring->budget != 0 && us > ring->budget)
+        ring->overruns++;
+}
+
+bool perf_get(PerfStage stage, PerfStats *stats) {
+    if (stage >= PERF_STAGE_COUNT || !stats)
+        return false;
+    const PerfRing *ring = &rings[stage];
+    stats->samples = ring->head;
+    stats->overruns = ring->overruns;
+    stats->budget = ring->budget;
+    if (ring->head == 0) {
+        stats->min = stats->max = stats->mean = stats->p99 = 0;
+        return false;
+    }
+    // Work on a sorted copy of the window so the recording side never has to do more than a store
+    u32 count = ring->head < PERF_SAMPLES ? ring->head : PERF_SAMPLES;
+    u32 sorted[PERF_SAMPLES];
+    memcpy(sorted, ring->samples, count * sizeof(u32));
+    qsort(sorted, count, sizeof(u32), compare_u32);
+    u64 sum = 0;
+    for (u32 i = 0; i < count; i++)
+        sum += sorted[i];
+    stats->min = sorted[0];
+    stats->max = sorted[count - 1];
+    stats->mean = (u32)(sum / count);
+    stats->p99 = sorted[(count * 99 + 99) / 100 - 1]; // Nearest-rank percentile
+    return true;
+}
+
+const char *perf_stage_name(PerfStage stage) {
+    if (stage >= PERF_STAGE_COUNT)
+        return NULL;
+    return stageNames[stage];
+}
+
+void perf_reset() {
+    for (u32 i = 0; i < PERF_STAGE_COUNT; i++) {
+        rings[i].head = 0;
+        rings[i].overruns = 0;
+    }
+}
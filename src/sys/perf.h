@@ -0,0 +1,70 @@
+#pragma once
+
+#include <stdbool.h>
+#include "platform/types.h"
+
+#define PERF_SAMPLES 128 // Number of samples kept per stage
+
+typedef enum PerfStage {
+    PERF_AAHRS,    // aahrs.update()
+    PERF_AIRCRAFT, // aircraft.update()
+    PERF_GPS,      // gps.update()
+    PERF_API,      // api_poll()
+    PERF_WIFI,     // wifi_periodic()
+    PERF_RECORDER, // recorder_flush()
+    PERF_STREAM,   // stream_update()
+    PERF_JITTER,   // Deviation of the control loop's period from its nominal value
+    PERF_STAGE_COUNT,
+} PerfStage;
+
+typedef struct PerfStats {
+    u32 min, max, mean, p99; // Over the last PERF_SAMPLES samples, in us
+    u32 samples;             // Total number of samples recorded
+    u32 overruns;            // Total number of samples that exceeded the stage's budget
+    u32 budget;              // Budget of the stage, in us (0 if none)
+} PerfStats;
+
+/**
+ * Sets the time budget of a stage; samples that exceed it are counted as overruns.
+ * @param stage the stage to set the budget of
+ * @param budget_us the budget, in microseconds, or 0 to disable overrun counting
+ */
+void perf_set_budget(PerfStage stage, u32 budget_us);
+
+/**
+ * Marks the beginning of a stage.
+ * @param stage the stage that is beginning
+ */
+void perf_begin(PerfStage stage);
+
+/**
+ * Marks the end of a stage and records the time elapsed since the matching `perf_begin()`.
+ * @param stage the stage that has ended
+ */
+void perf_end(PerfStage stage);
+
+/**
+ * Records a sample for a stage directly.
+ * @param stage the stage to record the sample for
+ * @param us the sample, in microseconds
+ */
+void perf_record(PerfStage stage, u32 us);
+
+/**
+ * Computes the statistics of a stage.
+ * @param stage the stage to get the statistics of
+ * @param stats pointer to where the statistics should be stored
+ * @return true if the stage has recorded any samples, false if not
+ */
+bool perf_get(PerfStage stage, PerfStats *stats);
+
+/**
+ * @param stage the stage to get the name of
+ * @return the name of the stage
+ */
+const char *perf_stage_name(PerfStage stage);
+
+/**
+ * Clears all recorded samples and overrun counters.
+ */
+void perf_reset();
@@ -0,0 +1,312 @@
+/**
+ * Source file of pico-fbw: https://github.com/pico-fbw/pico-fbw
+ * Licensed under the GNU AGPL-3.0
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "platform/flash.h"
+#include "platform/helpers.h"
+#include "platform/time.h"
+
+#include "io/aahrs.h"
+#include "io/gps.h"
+
+#include "modes/aircraft.h"
+#include "modes/flight.h"
+
+#include "sys/configuration.h"
+#include "sys/print.h"
+#include "sys/throttle.h"
+
+#include "recorder.h"
+
+#define RECORDER_SYNC_BLOCKS 4 // Number of blocks written between syncs (the file's size is only committed on a sync)
+
+// Recording is double-buffered: the control loop fills one block in RAM while the other waits to be written to flash
+typedef struct Block {
+    byte data[RECORDER_BLOCK_SIZE];
+    u32 len;   // Number of bytes used
+    bool full; // Whether the block is waiting to be written
+    bool last; // Whether the file should be closed after this block (end of a flight)
+} Block;
+
+static Block blocks[2];
+static u32 filling = 0;  // Index of the block being filled
+static u32 flushing = 0; // Index of the next block to be written (blocks are always written in the order they were filled)
+static u32 blocksRecorded = 0, framesDropped = 0;
+
+static lfs_file_t file;
+static bool fileOpen = false;
+static u32 fileSize = 0, unsyncedBlocks = 0;
+static u32 firstFile = 0, nextFile = 0; // Sequence numbers of the oldest recording and of the next one to be created
+static u32 maxFiles;
+
+static bool enabled = false;
+static u32 rate;
+static bool wasFlying = false;
+static u32 lastFix = 0;
+
+static void file_path(u32 seq, char path[], size_t size) {
+    snprintf(path, size, RECORDER_DIR "/%05lu.bin", seq);
+}
+
+// Finds the range of existing recordings
+static bool scan_files() {
+    i32 err = lfs_mkdir(&lfs, RECORDER_DIR);
+    if (err != LFS_ERR_OK && err != LFS_ERR_EXIST)
+        return false;
+    lfs_dir_t dir;
+    if (lfs_dir_open(&lfs, &dir, RECORDER_DIR) != LFS_ERR_OK)
+        return false;
+    struct lfs_info info;
+    bool found = false;
+    u32 min = 0, max = 0;
+    while (lfs_dir_read(&lfs, &dir, &info) > 0) {
+        if (info.type != LFS_TYPE_REG)
+            continue;
+        char *end;
+        u32 seq = strtoul(info.name, &end, 10);
+        if (end == info.name || strcmp(end, ".bin") != 0)
+            continue;
+        if (!found || seq < min)
+            min = seq;
+        if (!found || seq > max)
+            max = seq;
+        found = true;
+    }
+    lfs_dir_close(&lfs, &dir);
+    firstFile = found ? min : 0;
+    nextFile = found ? max + 1 : 0;
+    return true;
+}
+
+static bool open_file() {
+    char path[LFS_NAME_MAX + 1];
+    // Make room for the new recording by deleting the oldest ones
+    while (nextFile - firstFile >= maxFiles) {
+        file_path(firstFile, path, sizeof(path));
+        lfs_remove(&lfs, path); // May have already been deleted by the user
+        firstFile++;
+    }
+    file_path(nextFile, path, sizeof(path));
+    if (lfs_file_open(&lfs, &file, path, LFS_O_WRONLY | LFS_O_CREAT | LFS_O_TRUNC) != LFS_ERR_OK)
+        return false;
+    printpre("recorder", "recording to %s", path);
+    nextFile++;
+    fileOpen = true;
+    fileSize = 0;
+    unsyncedBlocks = 0;
+    return true;
+}
+
+static void close_file() {
+    lfs_file_close(&lfs, &file);
+    fileOpen = false;
+}
+
+static void begin_block(Block *block) {
+    RecorderBlockHeader header = {
+        .magic = RECORDER_MAGIC,
+        .version = RECORDER_VERSION,
+        .rate = (u16)rate,
+        .seq = blocksRecorded++,
+        .dropped = framesDropped,
+    };
+    memcpy(block->data, &header, sizeof(header));
+    block->len = sizeof(header);
+}
+
+// Hands a block over to be written; the rest of it is zero-filled, which reads as RECORDER_FRAME_END
+static void seal_block(Block *block) {
+    memset(block->data + block->len, 0, RECORDER_BLOCK_SIZE - block->len);
+    block->full = true;
+}
+
+static void append(const void *frame, u32 size) {
+    Block *block = &blocks[filling];
+    if (block->full) {
+        // Both blocks are still waiting to be written
+        framesDropped++;
+        return;
+    }
+    if (block->len + size > RECORDER_BLOCK_SIZE) {
+        seal_block(block);
+        filling ^= 1;
+        block = &blocks[filling];
+        if (block->full) {
+            framesDropped++;
+            return;
+        }
+    }
+    if (block->len == 0)
+        begin_block(block);
+    memcpy(block->data + block->len, frame, size);
+    block->len += size;
+}
+
+// Hands over whatever has been recorded so far and marks it as the end of the current file
+static void end_flight() {
+    Block *block = &blocks[filling];
+    if (block->full) {
+        // Both blocks are waiting to be written, the other one is the newest
+        block = &blocks[filling ^ 1];
+    } else {
+        if (block->len == 0)
+            begin_block(block);
+        seal_block(block);
+        filling ^= 1;
+    }
+    block->last = true;
+}
+
+static inline i16 to_i16(f32 value, f32 scale) {
+    if (isnan(value))
+        return 0;
+    return (i16)lroundf(clampf(value * scale, INT16_MIN, INT16_MAX));
+}
+
+static inline u16 to_u16(f32 value, f32 scale) {
+    if (isnan(value))
+        return 0;
+    return (u16)lroundf(clampf(value * scale, 0, UINT16_MAX));
+}
+
+static void record_state() {
+    RecorderStateFrame frame = {
+        .header = {.type = RECORDER_FRAME_STATE, .size = sizeof(RecorderStateFrame), .time = time_ms()},
+        .mode = (u8)aircraft.mode,
+        .flags = (aircraft.aahrsSafe ? RECORDER_FLAG_AAHRS_SAFE : 0) | (aircraft.gpsSafe ? RECORDER_FLAG_GPS_SAFE : 0),
+        .roll = to_i16(aahrs.roll, 100.f),
+        .pitch = to_i16(aahrs.pitch, 100.f),
+        .yaw = to_u16(aahrs.yaw < 0.f ? aahrs.yaw + 360.f : aahrs.yaw, 100.f),
+        .rollRate = to_i16(aahrs.rollRate, 10.f),
+        .pitchRate = to_i16(aahrs.pitchRate, 10.f),
+        .yawRate = to_i16(aahrs.yawRate, 10.f),
+        .alt = isfinite(aahrs.alt) ? (i32)lroundf(aahrs.alt) : -1,
+    };
+    for (u32 i = 0; i < 3; i++)
+        frame.accel[i] = to_i16(aahrs.accel[i], 1000.f);
+
+    FlightState flight;
+    flight_get_state(&flight);
+    if (flight.yawDamperOn)
+        frame.flags |= RECORDER_FLAG_YAW_DAMPER;
+    append(&frame, sizeof(frame));
+
+    RecorderControlFrame control = {
+        .header = {.type = RECORDER_FRAME_CONTROL, .size = sizeof(RecorderControlFrame), .time = time_ms()},
+        .rollSetpoint = to_i16(flight.rollSetpoint, 100.f),
+        .pitchSetpoint = to_i16(flight.pitchSetpoint, 100.f),
+        .yawSetpoint = to_i16(flight.yawSetpoint, 100.f),
+        .ail = to_u16(flight.ailOut, 100.f),
+        .ele = to_u16(flight.eleOut, 100.f),
+        .rud = to_u16(flight.rudOut, 100.f),
+        .throttle = (u8)clampf(throttle.output, 0, 100),
+    };
+    for (u32 i = 0; i < 3; i++) {
+        control.roll[i] = to_i16(flight.roll[i], 100.f);
+        control.pitch[i] = to_i16(flight.pitch[i], 100.f);
+        control.yaw[i] = to_i16(flight.yaw[i], 100.f);
+    }
+    append(&control, sizeof(control));
+}
+
+static void record_gps() {
+    RecorderGPSFrame frame = {
+        .header = {.type = RECORDER_FRAME_GPS, .size = sizeof(RecorderGPSFrame), .time = time_ms()},
+        .lat = (i32)llround(gps.lat * 1E7),
+        .lng = (i32)llround(gps.lng * 1E7),
+        .alt = gps.alt,
+        .speed = to_u16(gps.speed, 100.f),
+        .track = to_u16(gps.track, 100.f),
+        .sats = (u8)clamp(gps.sats, 0, UINT8_MAX),
+        .hdop = (u8)lroundf(clampf(gps.hdop * 10.f, 0, UINT8_MAX)),
+    };
+    append(&frame, sizeof(frame));
+}
+
+bool recorder_init() {
+    f32 configRate = config.system[SYSTEM_RECORDER_RATE];
+    if (!(configRate >= RECORDER_RATE_MIN && configRate <= RECORDER_RATE_MAX)) { // Also catches NaN
+        printpre("recorder", "WARNING: invalid rate, using the default of %lu Hz", (u32)RECORDER_RATE_DEFAULT);
+        configRate = RECORDER_RATE_DEFAULT;
+    }
+    rate = (u32)configRate;
+    if (rate == 0)
+        return true;
+    // Whole blocks are always written, so as long as they divide the filesystem's blocks, no write ever spans two
+    if (lfs_cfg.block_size % RECORDER_BLOCK_SIZE != 0) {
+        printpre("recorder", "ERROR: block size %lu is incompatible with the filesystem", (u32)RECORDER_BLOCK_SIZE);
+        return false;
+    }
+    if (!scan_files()) {
+        printpre("recorder", "ERROR: unable to access " RECORDER_DIR);
+        return false;
+    }
+    maxFiles = (lfs_cfg.block_size * lfs_cfg.block_count / 2) / RECORDER_FILE_SIZE;
+    if (maxFiles < 2)
+        maxFiles = 2;
+    enabled = true;
+    printpre("recorder", "recording at %lu Hz, keeping up to %lu files", rate, maxFiles);
+    return true;
+}
+
+bool recorder_is_enabled() {
+    return enabled;
+}
+
+u32 recorder_rate() {
+    return rate;
+}
+
+void recorder_update() {
+    if (!enabled)
+        return;
+    if (!aircraft.isFlying) {
+        if (wasFlying)
+            end_flight();
+        wasFlying = false;
+        return;
+    }
+    wasFlying = true;
+    record_state();
+    if (gps.is_supported() && gps.fixes != lastFix) {
+        lastFix = gps.fixes;
+        record_gps();
+    }
+}
+
+void recorder_flush() {
+    if (!enabled)
+        return;
+    Block *block = &blocks[flushing];
+    if (!block->full)
+        return;
+    if (!fileOpen && !open_file()) {
+        printpre("recorder", "ERROR: unable to create a recording, recorder disabled");
+        enabled = false;
+        return;
+    }
+    if (lfs_file_write(&lfs, &file, block->data, RECORDER_BLOCK_SIZE) != RECORDER_BLOCK_SIZE) {
+        printpre("recorder", "ERROR: write failed, recorder disabled");
+        close_file();
+        enabled = false;
+        return;
+    }
+    fileSize += RECORDER_BLOCK_SIZE;
+    bool last = block->last;
+    block->len = 0;
+    block->full = false;
+    block->last = false;
+    flushing ^= 1;
+    if (last || fileSize >= RECORDER_FILE_SIZE) {
+        close_file();
+    } else if (++unsyncedBlocks >= RECORDER_SYNC_BLOCKS) {
+        // Commit what has been written so far, so that a crash or power loss only loses the last few blocks
+        lfs_file_sync(&lfs, &file);
+        unsyncedBlocks = 0;
+    }
+}
@@ -0,0 +1,113 @@
+#pragma once
+
+#include <stdbool.h>
+#include "platform/types.h"
+
+// The flight data recorder logs the aircraft's state to flash while it is flying, at the rate given by the configuration.
+//
+// Recordings are kept in RECORDER_DIR as files named by an increasing sequence number (e.g. "fdr/00042.bin"). A new file is
+// started on every takeoff and whenever the current one reaches RECORDER_FILE_SIZE; the oldest files are deleted so that
+// recordings never take up more than half of the filesystem.
+//
+// A file is a series of RECORDER_BLOCK_SIZE-byte blocks. Each block starts with a RecorderBlockHeader and is followed by
+// frames, each starting with a RecorderFrameHeader. Frames never cross blocks; the space left at the end of a block is
+// zero-filled (so a frame type of RECORDER_FRAME_END means "skip to the next block"). Readers should skip frames of unknown
+// types using their size, so that new types can be added without bumping RECORDER_VERSION. All values are little-endian.
+
+#define RECORDER_RATE_MIN 0 // Disables the recorder
+#define RECORDER_RATE_MAX 100
+#define RECORDER_RATE_DEFAULT 25
+
+#define RECORDER_DIR "fdr"
+#define RECORDER_MAGIC 0x52444650 // "PFDR"
+#define RECORDER_VERSION 1
+#define RECORDER_BLOCK_SIZE 1024 // Must evenly divide the filesystem's block size
+#define RECORDER_FILE_SIZE (32 * 1024)
+
+// clang-format off
+typedef enum RecorderFrameType {
+    RECORDER_FRAME_END,     // End of the block's frames
+    RECORDER_FRAME_STATE,   // RecorderStateFrame
+    RECORDER_FRAME_CONTROL, // RecorderControlFrame
+    RECORDER_FRAME_GPS,     // RecorderGPSFrame, written whenever a new fix is received
+} RecorderFrameType;
+// clang-format on
+
+// Flags of RecorderStateFrame
+#define RECORDER_FLAG_AAHRS_SAFE (1 << 0)
+#define RECORDER_FLAG_GPS_SAFE (1 << 1)
+#define RECORDER_FLAG_YAW_DAMPER (1 << 2)
+
+typedef struct __attribute__((packed)) RecorderBlockHeader {
+    u32 magic;   // RECORDER_MAGIC
+    u16 version; // RECORDER_VERSION
+    u16 rate;    // Rate at which state and control frames are recorded, Hz
+    u32 seq;     // Number of blocks recorded before this one since boot, gaps mean blocks were lost
+    u32 dropped; // Number of frames dropped since boot because the flash could not keep up
+} RecorderBlockHeader;
+
+typedef struct __attribute__((packed)) RecorderFrameHeader {
+    u8 type;  // RecorderFrameType
+    u8 size;  // Size of the whole frame (including this header), bytes
+    u32 time; // Time since boot, ms
+} RecorderFrameHeader;
+
+typedef struct __attribute__((packed)) RecorderStateFrame {
+    RecorderFrameHeader header;
+    u8 mode;                          // Mode
+    u8 flags;                         // RECORDER_FLAG_*
+    i16 roll, pitch;                  // 0.01 deg
+    u16 yaw;                          // Heading, 0.01 deg
+    i16 rollRate, pitchRate, yawRate; // 0.1 deg/s
+    i16 accel[3];                     // Accelerometer reading (IMU frame), 0.001 g
+    i32 alt;                          // MSL, ft, or -1 if unknown
+} RecorderStateFrame;
+
+typedef struct __attribute__((packed)) RecorderControlFrame {
+    RecorderFrameHeader header;
+    i16 rollSetpoint, pitchSetpoint, yawSetpoint; // 0.01 deg
+    i16 roll[3], pitch[3], yaw[3];                // Proportional, integral, and derivative terms of each axis's PID, 0.01 deg
+    u16 ail, ele, rud;                            // Servo outputs, 0.01 deg
+    u8 throttle;                                  // ESC output, %
+} RecorderControlFrame;
+
+typedef struct __attribute__((packed)) RecorderGPSFrame {
+    RecorderFrameHeader header;
+    i32 lat, lng; // 1e-7 deg
+    i32 alt;      // MSL, ft
+    u16 speed;    // 0.01 kts
+    u16 track;    // 0.01 deg
+    u8 sats;      // Number of satellites
+    u8 hdop;      // 0.1
+} RecorderGPSFrame;
+
+/**
+ * Initializes the flight data recorder, if it is enabled.
+ * @return true if successful (or disabled), false if recordings cannot be stored
+ * @note The filesystem must be mounted and the configuration loaded.
+ */
+bool recorder_init();
+
+/**
+ * @return whether the recorder is enabled and initialized, in which case `recorder_update()` and `recorder_flush()` should be
+ * called periodically
+ */
+bool recorder_is_enabled();
+
+/**
+ * @return the rate at which `recorder_update()` should be called, Hz
+ */
+u32 recorder_rate();
+
+/**
+ * Records the aircraft's current state into RAM, if it is flying.
+ * This never touches the flash, so it is safe to call from time-critical code.
+ */
+void recorder_update();
+
+/**
+ * Writes at most one block of recorded data to flash.
+ * @note This should be called at a lower priority than anything time-critical, at least every
+ * (RECORDER_BLOCK_SIZE / bytes recorded per second) seconds, or frames will be dropped.
+ */
+void recorder_flush();
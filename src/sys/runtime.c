@@ -16,11 +16,27 @@
 #include "modes/aircraft.h"
 
 #include "sys/api/api.h"
+#include "sys/api/stream.h"
 #include "sys/configuration.h"
 #include "sys/flightplan.h"
+#include "sys/log.h"
+#include "sys/perf.h"
+#include "sys/recorder.h"
+#include "sys/scheduler.h"
 
 #include "runtime.h"
 
+// Task rates, in Hz; the AAHRS task's rate is set by the AAHRS itself (see aahrs.updateRate)
+#define CONTROL_RATE 100
+#define SWITCH_RATE 50
+#define GPS_RATE 50
+#define API_RATE 50
+#define WIFI_RATE 50
+#define RECORDER_FLUSH_RATE 10
+#define LOG_FLUSH_RATE 2
+
+#define HZ_TO_US(hz) (1000000 / (hz))
+
 // clang-format off
 typedef enum SwitchPosition {
     SWITCH_POSITION_LOW,
@@ -80,22 +96,117 @@ static void switch_update() {
     }
 }
 
-void runtime_loop(bool update_aircraft) {
-    // Update the mode switch's position, update sensors, run the current mode's code, respond to any new API calls, and run
-    // platform-specific system tasks
-    switch_update();
-    if (aahrs.isInitialized)
+static bool updateAircraft = true;
+static i32 aahrsTask = -1;
+
+// Updates the AAHRS, at whichever rate it asks for
+static void aahrs_task() {
+    // The rate is only known once the AAHRS has initialized, and it may change if it is ever reinitialized
+    u32 period = HZ_TO_US(aahrs.updateRate);
+    const Task *task = scheduler_get(aahrsTask);
+    if (task && task->period != period) {
+        scheduler_set_period(aahrsTask, period);
+        perf_set_budget(PERF_AAHRS, period);
+    }
+    if (aahrs.isInitialized) {
+        perf_begin(PERF_AAHRS);
         aahrs.update();
-    if (gps.is_supported())
-        gps.update();
-    if (update_aircraft)
+        perf_end(PERF_AAHRS);
+    }
+}
+
+// Runs the current mode's code
+static void control_task() {
+    static Timestamp lastRun = {0};
+    // Jitter is how far the time between two runs strays from the nominal period
+    if (lastRun.us != 0) {
+        i64 deviation = (i64)time_since_us(&lastRun) - HZ_TO_US(CONTROL_RATE);
+        perf_record(PERF_JITTER, (u32)(deviation < 0 ? -deviation : deviation));
+    }
+    lastRun = timestamp_now();
+
+    if (updateAircraft) {
+        perf_begin(PERF_AIRCRAFT);
         aircraft.update();
+        perf_end(PERF_AIRCRAFT);
+    }
+}
+
+static void gps_task() {
+    perf_begin(PERF_GPS);
+    gps.update();
+    perf_end(PERF_GPS);
+}
+
+static void api_task() {
+    perf_begin(PERF_API);
+    api_poll();
+    perf_end(PERF_API);
+}
+
+static void stream_task() {
+    perf_begin(PERF_STREAM);
+    stream_update();
+    perf_end(PERF_STREAM);
+}
+
+static void recorder_flush_task() {
+    perf_begin(PERF_RECORDER);
+    recorder_flush();
+    perf_end(PERF_RECORDER);
+}
+
+#if PLATFORM_SUPPORTS_WIFI
+static void wifi_task() {
+    perf_begin(PERF_WIFI);
+    wifi_periodic();
+    perf_end(PERF_WIFI);
+}
+#endif
+
+static void create_tasks() {
+    // Stages share their task's period; anything beyond that will delay the next run
+    perf_set_budget(PERF_AAHRS, HZ_TO_US(aahrs.updateRate));
+    perf_set_budget(PERF_AIRCRAFT, HZ_TO_US(CONTROL_RATE));
+    perf_set_budget(PERF_JITTER, HZ_TO_US(CONTROL_RATE) / 10);
+    perf_set_budget(PERF_GPS, HZ_TO_US(GPS_RATE));
+    perf_set_budget(PERF_API, HZ_TO_US(API_RATE));
+    perf_set_budget(PERF_WIFI, HZ_TO_US(WIFI_RATE));
+    perf_set_budget(PERF_RECORDER, HZ_TO_US(RECORDER_FLUSH_RATE));
+    perf_set_budget(PERF_STREAM, HZ_TO_US(STREAM_RATE_MAX) / 4);
+    // Rate-monotonic scheduling means the control chain (being the fastest task) always takes precedence over the rest
+    // The AAHRS is added first so that it runs before the control task when their periods match, so modes get fresh data
+    aahrsTask = scheduler_add("aahrs", aahrs_task, HZ_TO_US(aahrs.updateRate), 0);
+    scheduler_add("control", control_task, HZ_TO_US(CONTROL_RATE), 0);
+    scheduler_add("switch", switch_update, HZ_TO_US(SWITCH_RATE), 0);
+    if (gps.is_supported())
+        scheduler_add("gps", gps_task, HZ_TO_US(GPS_RATE), 0);
     if ((bool)config.general[GENERAL_API_ENABLED])
-        api_poll();
+        scheduler_add("api", api_task, HZ_TO_US(API_RATE), 0);
 #if PLATFORM_SUPPORTS_WIFI
     if ((WifiEnabled)config.general[GENERAL_WIFI_ENABLED] != WIFI_DISABLED)
-        wifi_periodic();
+        scheduler_add("wifi", wifi_task, HZ_TO_US(WIFI_RATE), 0);
 #endif
+    // Streaming is added after everything else at its rate, so it only ever runs in time they leave over
+    if ((bool)config.general[GENERAL_API_ENABLED])
+        scheduler_add("stream", stream_task, HZ_TO_US(STREAM_RATE_MAX), 0);
+    // Recording only fills RAM; the flash is written by the flush task which, being the slowest, runs in whatever time is left
+    if (recorder_is_enabled() && scheduler_add("recorder", recorder_update, HZ_TO_US(recorder_rate()), 0) >= 0)
+        scheduler_add("flush", recorder_flush_task, HZ_TO_US(RECORDER_FLUSH_RATE), 0);
+    // Saving logs is the least urgent of all, so it runs last
+    scheduler_add("log", log_flush, HZ_TO_US(LOG_FLUSH_RATE), 0);
+}
+
+void runtime_loop(bool update_aircraft) {
+    static bool tasksCreated = false;
+    if (!tasksCreated) {
+        create_tasks();
+        tasksCreated = true;
+    }
+    // Update the mode switch's position, update sensors, run the current mode's code, respond to any new API calls, and run
+    // platform-specific system tasks--all at their respective rates
+    updateAircraft = update_aircraft;
+    scheduler_run();
     sys_periodic();
 }
 
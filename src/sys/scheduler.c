@@ -0,0 +1,170 @@
+/**
+ * Source file of pico-fbw: https://github.com/pico-fbw/pico-fbw
+ * Licensed under the GNU AGPL-3.0
+ */
+
+#include <stddef.h>
+#include <string.h>
+#include "platform/time.h"
+
+#include "scheduler.h"
+
+#define RUNTIME_DECAY_SHIFT 3 // Each shorter run moves a task's expected runtime 1/2^RUNTIME_DECAY_SHIFT of the way down to it
+
+static Task tasks[SCHEDULER_MAX_TASKS];
+static u32 numTasks = 0;
+static u32 order[SCHEDULER_MAX_TASKS]; // Task IDs sorted by priority (highest first)
+
+/**
+ * Re-assigns rate-monotonic priorities to all tasks.
+ */
+static void assign_priorities() {
+    for (u32 i = 0; i < numTasks; i++)
+        order[i] = i;
+    // Insertion sort by period; stable, so tasks with equal periods keep the order in which they were added
+    for (u32 i = 1; i < numTasks; i++) {
+        u32 id = order[i];
+        i32 j = (i32)i - 1;
+        while (j >= 0 && tasks[order[j]].period > tasks[id].period) {
+            order[j + 1] = order[j];
+            j--;
+        }
+        order[j + 1] = id;
+    }
+    for (u32 i = 0; i < numTasks; i++)
+        tasks[order[i]].priority = i;
+}
+
+/**
+ * @param task the task to check against
+ * @return the earliest release time of any task with a higher priority than `task`, or UINT64_MAX if there is none
+ */
+static u64 next_higher_release(const Task *task) {
+    u64 next = UINT64_MAX;
+    for (u32 i = 0; i < task->priority; i++) {
+        const Task *higher = &tasks[order[i]];
+        if (higher->enabled && !higher->running && higher->release < next)
+            next = higher->release;
+    }
+    return next;
+}
+
+/**
+ * Runs a task and updates its statistics and next release time.
+ * @param task the task to run
+ * @param now the current time, in us
+ * @return the time at which the task completed, in us
+ */
+static u64 dispatch(Task *task, u64 now) {
+    task->lastLatency = (u32)(now - task->release);
+    task->running = true;
+    task->function();
+    task->running = false;
+    u64 end = time_us();
+
+    task->lastRuntime = (u32)(end - now);
+    if (task->lastRuntime > task->maxRuntime)
+        task->maxRuntime = task->lastRuntime;
+    // Err towards waiting: a longer run is expected again straight away, while shorter runs only gradually lower the estimate
+    if (task->lastRuntime > task->estRuntime)
+        task->estRuntime = task->lastRuntime;
+    else
+        task->estRuntime -= (task->estRuntime - task->lastRuntime + (1u << RUNTIME_DECAY_SHIFT) - 1) >> RUNTIME_DECAY_SHIFT;
+    if (end > task->release + task->deadline)
+        task->overruns++;
+    task->runs++;
+
+    // Releases happen on a fixed grid so the task's rate does not drift; releases that have already passed are dropped
+    task->release += task->period;
+    if (task->release <= end) {
+        u64 missed = (end - task->release) / task->period + 1;
+        task->skips += (u32)missed;
+        task->release += missed * task->period;
+    }
+    return end;
+}
+
+i32 scheduler_add(const char *name, TaskFunction function, u32 period_us, u32 deadline_us) {
+    if (numTasks >= SCHEDULER_MAX_TASKS || !function || period_us == 0)
+        return -1;
+    Task *task = &tasks[numTasks];
+    memset(task, 0, sizeof(Task));
+    task->name = name;
+    task->function = function;
+    task->period = period_us;
+    task->deadline = deadline_us != 0 ? deadline_us : period_us;
+    task->enabled = true;
+    task->release = time_us();
+    numTasks++;
+    assign_priorities();
+    return (i32)(numTasks - 1);
+}
+
+void scheduler_set_enabled(i32 id, bool enabled) {
+    if (id < 0 || (u32)id >= numTasks)
+        return;
+    if (enabled && !tasks[id].enabled)
+        tasks[id].release = time_us();
+    tasks[id].enabled = enabled;
+}
+
+void scheduler_set_period(i32 id, u32 period_us) {
+    if (id < 0 || (u32)id >= numTasks || period_us == 0)
+        return;
+    // Keep an implicit deadline implicit
+    if (tasks[id].deadline == tasks[id].period)
+        tasks[id].deadline = period_us;
+    tasks[id].period = period_us;
+    assign_priorities();
+}
+
+u64 scheduler_run() {
+    u64 now = time_us();
+    bool ran;
+    do {
+        ran = false;
+        // Find the highest-priority task that has been released
+        for (u32 i = 0; i < numTasks; i++) {
+            Task *task = &tasks[order[i]];
+            if (!task->enabled || task->running || task->release > now)
+                continue;
+            // Don't start the task if it would (likely) still be running when a higher-priority task is released,
+            // unless waiting any longer would cause it to miss its own deadline
+            bool late = now + task->estRuntime > task->release + task->deadline;
+            if (!late && now + task->estRuntime > next_higher_release(task))
+                continue;
+            now = dispatch(task, now);
+            ran = true;
+            // Start over from the highest priority, as higher-priority tasks may have been released in the meantime
+            break;
+        }
+    } while (ran);
+
+    u64 next = UINT64_MAX;
+    for (u32 i = 0; i < numTasks; i++) {
+        if (tasks[i].enabled && !tasks[i].running && tasks[i].release < next)
+            next = tasks[i].release;
+    }
+    return next > now ? next - now : 0;
+}
+
+u32 scheduler_count() {
+    return numTasks;
+}
+
+const Task *scheduler_get(i32 id) {
+    if (id < 0 || (u32)id >= numTasks)
+        return NULL;
+    return &tasks[id];
+}
+
+void scheduler_reset_stats() {
+    for (u32 i = 0; i < numTasks; i++) {
+        tasks[i].runs = 0;
+        tasks[i].overruns = 0;
+        tasks[i].skips = 0;
+        tasks[i].lastRuntime = 0;
+        tasks[i].maxRuntime = 0;
+        tasks[i].lastLatency = 0;
+    }
+}
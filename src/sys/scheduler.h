@@ -0,0 +1,83 @@
+#pragma once
+
+#include <stdbool.h>
+#include "platform/types.h"
+
+#define SCHEDULER_MAX_TASKS 12
+
+typedef void (*TaskFunction)();
+
+typedef struct Task {
+    const char *name;      // Human-readable name of the task
+    TaskFunction function; // Function that is run every time the task is released
+    u32 period;            // Time between releases, in us
+    u32 deadline;          // Time after each release by which the task must have completed, in us
+    u32 priority;          // Rate-monotonic priority (0 is the highest), derived from the period
+    bool enabled;          // Whether the task will be released at all
+    bool running;          // Whether the task is currently executing (used to prevent re-entry)
+    u64 release;           // Absolute time of the task's next release, in us
+    u32 estRuntime;        // Expected execution time, in us (follows longer runs at once and shorter ones gradually)
+    // Statistics (read-only)
+    u32 runs;        // Number of times the task has completed
+    u32 overruns;    // Number of times the task completed after its deadline
+    u32 skips;       // Number of releases that were missed entirely because the task was still late
+    u32 lastRuntime; // Execution time of the last run, in us
+    u32 maxRuntime;  // Longest observed execution time, in us
+    u32 lastLatency; // Time between the last release and the start of execution, in us
+} Task;
+
+/**
+ * Registers a new periodic task with the scheduler.
+ * Priorities are assigned rate-monotonically, that is, tasks with shorter periods always take precedence over tasks with
+ * longer periods. Tasks with equal periods are prioritized in the order they were added.
+ * @param name the name of the task
+ * @param function the function to run every time the task is released
+ * @param period_us the period of the task, in microseconds
+ * @param deadline_us the relative deadline of the task in microseconds, or 0 to use the period as the deadline
+ * @return the ID of the task, or -1 if the task could not be added
+ * @note The task is first released immediately after it is added.
+ */
+i32 scheduler_add(const char *name, TaskFunction function, u32 period_us, u32 deadline_us);
+
+/**
+ * Enables or disables a task.
+ * @param id the ID of the task
+ * @param enabled whether the task should be released
+ * @note A task that is re-enabled will be released immediately.
+ */
+void scheduler_set_enabled(i32 id, bool enabled);
+
+/**
+ * Changes the period of a task.
+ * @param id the ID of the task
+ * @param period_us the new period of the task, in microseconds
+ * @note This re-evaluates the priorities of all tasks.
+ */
+void scheduler_set_period(i32 id, u32 period_us);
+
+/**
+ * Runs all tasks that have been released, in order of priority.
+ * A lower-priority task will only be started if its expected execution time fits before the next release of a
+ * higher-priority task, unless it has already missed its deadline; this bounds the jitter that slow tasks can add to faster
+ * ones. The expected execution time rises to any longer run at once and decays back towards shorter runs over the next few,
+ * so a one-off slow run doesn't hold a task back for good.
+ * @return the number of microseconds until the next release of any task
+ * @note This should be called as often as possible.
+ */
+u64 scheduler_run();
+
+/**
+ * @return the number of tasks registered with the scheduler
+ */
+u32 scheduler_count();
+
+/**
+ * @param id the ID of the task
+ * @return the task with the given ID, or NULL if it does not exist
+ */
+const Task *scheduler_get(i32 id);
+
+/**
+ * Resets the statistics of all tasks.
+ */
+void scheduler_reset_stats();
@@ -86,6 +86,7 @@ void throttle_update() {
     // Apply filtering to smooth out any rapid throttle changes, and send final value to ESC
     escTarget = lerp(prevEscTarget, escTarget, config.control[CONTROL_THROTTLE_SENSITIVITY]);
     prevEscTarget = escTarget;
+    throttle.output = escTarget;
     esc_set((u32)config.pins[PINS_ESC_THROTTLE], (u16)(escTarget + 0.5f));
 }
 
@@ -94,6 +95,7 @@ Throttle throttle = {
     .mode = THRMODE_THRUST,
     .supportedMode = THRMODE_THRUST,
     .target = 0.f,
+    .output = 0.f,
     .init = throttle_init,
     .update = throttle_update
 };
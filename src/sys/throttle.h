@@ -15,6 +15,7 @@ typedef struct Throttle {
     // If this is set to THRUST mode
     ThrottleMode supportedMode;
     f32 target; // Target speed [kts] or thrust [0-100] (depending on mode)
+    f32 output; // (Read-only) Thrust last sent to the ESC [0-100], after limits and smoothing
     /**
      * Initializes the throttle system (checks for highest supported mode and initializes it).
      */
@@ -0,0 +1,190 @@
+/**
+ * Source file of pico-fbw: https://github.com/pico-fbw/pico-fbw
+ * Licensed under the GNU AGPL-3.0
+ */
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include "platform/flash.h"
+#include "platform/helpers.h"
+#include "platform/host/sim/sim.h"
+#include "platform/time.h"
+
+#include "io/aahrs.h"
+#include "io/esc.h"
+#include "io/gps.h"
+#include "io/receiver.h"
+#include "io/servo.h"
+
+#include "modes/aircraft.h"
+
+#include "sys/boot.h"
+#include "sys/configuration.h"
+#include "sys/flightplan.h"
+#include "sys/runtime.h"
+#include "sys/version.h"
+
+#include "test.h"
+
+// Flies a flight plan around a square in auto mode, in the simulator (platform/host/sim) and in virtual time, and checks how
+// closely its legs were followed (the cross-track error, measured from the nearest side of the square) and how far the
+// aircraft flew to get around it.
+// The aircraft starts out over one corner heading along the first side, so it's on the square from the moment auto mode is
+// engaged until the flight plan is complete. Usage: auto_test [wind speed (m/s),direction it blows from (deg)]; ctest flies it
+// in calm air and in a crosswind on the first and last sides.
+
+#define HOME_LAT 47.397742
+#define HOME_LNG 8.545594
+#define HOME_ALT 0                // The altitudes of waypoints aren't offset for the ground here, so they're heights above it
+#define EARTH_RADIUS_M 6378137.0 // As used by the simulator
+
+#define SIDE_M 600
+#define WAYPOINT_ALT 330  // ft, about the height the aircraft starts at
+#define WAYPOINT_SPEED 36 // kts
+
+#define NAV_TIMEOUT_S 30     // Longest the aircraft may take to get a valid navigation state after booting
+#define FLIGHT_TIMEOUT_S 400 // Longest it may take to fly the flight plan
+
+// Limits (m); the flight plan's ideal distance is SIDE_M * 4 plus what was left of the first side when auto was engaged
+#define CROSS_TRACK_MEAN_MAX 7
+#define CROSS_TRACK_MAX 30
+#define DISTANCE_EXCESS_MAX 100 // Further than the ideal distance, corners are cut so it's usually less
+#define DISTANCE_SHORT_MAX 100  // Shorter than the ideal distance
+
+// Corners of the square (north, east of home in m), in the order they're flown; the aircraft starts at the last one
+static const f64 corners[][2] = {{SIDE_M, 0}, {SIDE_M, SIDE_M}, {0, SIDE_M}, {0, 0}, {SIDE_M, 0}};
+
+// Distance from a point to the segment between a and b
+static f64 segment_distance(const f64 p[2], const f64 a[2], const f64 b[2]) {
+    f64 dx = b[0] - a[0], dy = b[1] - a[1];
+    f64 t = ((p[0] - a[0]) * dx + (p[1] - a[1]) * dy) / (dx * dx + dy * dy);
+    t = t < 0 ? 0 : (t > 1 ? 1 : t);
+    return hypot(p[0] - (a[0] + t * dx), p[1] - (a[1] + t * dy));
+}
+
+static f64 cross_track(const f64 p[2]) {
+    f64 min = INFINITY;
+    for (u32 i = 0; i + 1 < count_of(corners); i++) {
+        f64 d = segment_distance(p, corners[i], corners[i + 1]);
+        if (d < min)
+            min = d;
+    }
+    return min;
+}
+
+// Brings the system up the way main() does, minus what the simulator doesn't need (calibration and the web interface)
+static bool boot() {
+    boot_begin();
+    if (lfs_mount(&lfs, &lfs_cfg) != LFS_ERR_OK) {
+        lfs_format(&lfs, &lfs_cfg);
+        if (lfs_mount(&lfs, &lfs_cfg) != LFS_ERR_OK)
+            return false;
+    }
+    config_load();
+    u32 num_pins = 5;
+    u32 pins[num_pins];
+    f32 deviations[num_pins];
+    receiver_get_pins(pins, &num_pins, deviations);
+    receiver_enable(pins, num_pins);
+    u32 num_servos = 4;
+    u32 servos[num_servos];
+    servo_get_pins(servos, &num_servos);
+    servo_enable(servos, num_servos);
+    if (receiver_has_athr())
+        esc_enable((u32)config.pins[PINS_ESC_THROTTLE]);
+    if (!aahrs.init() || !gps.init())
+        return false;
+    aircraft.set_aahrs_safe(true);
+    boot_complete();
+    return true;
+}
+
+// Runs the system until it has been up for the given time, or until done() returns true
+static void run_until(u64 us, bool (*done)()) {
+    while (time_us() < us && !(done && done()))
+        runtime_loop(true);
+}
+
+static bool nav_ready() {
+    return aircraft.gpsSafe && aahrs.nav.valid;
+}
+
+static bool plan_complete() {
+    return aircraft.mode != MODE_AUTO || sim_state()->crashed;
+}
+
+static bool load_plan() {
+    char json[1024];
+    i32 len = snprintf(json, sizeof(json), "{\"version\":\"%s\",\"version_fw\":\"%s\",\"alt_samples\":0,\"waypoints\":[",
+                       FLIGHTPLAN_VERSION, PICO_FBW_VERSION);
+    for (u32 i = 0; i < count_of(corners); i++) {
+        f64 lat = HOME_LAT + corners[i][0] / EARTH_RADIUS_M * 180 / M_PI;
+        f64 lng = HOME_LNG + corners[i][1] / (EARTH_RADIUS_M * cos(HOME_LAT * M_PI / 180)) * 180 / M_PI;
+        len += snprintf(json + len, sizeof(json) - len, "%s{\"lat\":%.8f,\"lng\":%.8f,\"alt\":%d,\"speed\":%d,\"drop\":0}",
+                        i > 0 ? "," : "", lat, lng, WAYPOINT_ALT, WAYPOINT_SPEED);
+    }
+    snprintf(json + len, sizeof(json) - len, "]}");
+    return flightplan_parse(json, false) == FLIGHTPLAN_STATUS_OK;
+}
+
+int main(int argc, char **argv) {
+    // A fresh home directory, so the configuration (and so the gains flown with) are the defaults
+    char home[] = "/tmp/pico-fbw-auto-XXXXXX";
+    if (!mkdtemp(home)) {
+        CHECK(false, "couldn't create a home directory");
+        return test_result();
+    }
+    char simHome[64];
+    snprintf(simHome, sizeof(simHome), "%f,%f,%d", HOME_LAT, HOME_LNG, HOME_ALT);
+    setenv("HOME", home, 1);
+    setenv("PICO_FBW_SIM", "1", 1);
+    setenv("PICO_FBW_VIRTUAL_TIME", "1", 1);
+    setenv("PICO_FBW_SIM_HOME", simHome, 1);
+    setenv("PICO_FBW_SIM_WIND", argc > 1 ? argv[1] : "0,0", 1);
+
+    if (!boot()) {
+        CHECK(false, "the system didn't boot");
+        return test_result();
+    }
+    run_until(time_us() + NAV_TIMEOUT_S * 1000000ull, nav_ready);
+    CHECK(nav_ready(), "no valid navigation state within %d s", NAV_TIMEOUT_S);
+    CHECK(load_plan(), "the flight plan wasn't accepted");
+    aircraft.change_to(MODE_AUTO);
+    CHECK(aircraft.mode == MODE_AUTO, "auto mode couldn't be engaged");
+    if (testFailures > 0)
+        return test_result();
+
+    const SimState *sim = sim_state();
+    f64 start = SIDE_M - sim->pos[0]; // What's left of the first side
+    f64 last[2] = {sim->pos[0], sim->pos[1]}, distance = 0, crossTrackSum = 0, crossTrackMax = 0;
+    u32 samples = 0;
+    u64 startUs = time_us(), timeout = startUs + FLIGHT_TIMEOUT_S * 1000000ull;
+    while (time_us() < timeout && !plan_complete()) {
+        u64 next = sim->time + 100000; // Sampled every 100 ms of simulated time
+        while (sim->time < next && !plan_complete())
+            runtime_loop(true);
+        f64 pos[2] = {sim->pos[0], sim->pos[1]};
+        f64 crossTrack = cross_track(pos);
+        distance += hypot(pos[0] - last[0], pos[1] - last[1]);
+        crossTrackSum += crossTrack;
+        if (crossTrack > crossTrackMax)
+            crossTrackMax = crossTrack;
+        samples++;
+        last[0] = pos[0];
+        last[1] = pos[1];
+    }
+    f64 ideal = start + SIDE_M * 4, crossTrackMean = samples > 0 ? crossTrackSum / samples : INFINITY;
+    printf("wind %s: flew %.0f m (%.0f m of legs) in %.1f s, cross-track mean %.1f m, max %.1f m\n", argv[1] ? argv[1] : "0,0",
+           distance, ideal, (time_us() - startUs) / 1E6, crossTrackMean, crossTrackMax);
+
+    CHECK(!sim->crashed, "the aircraft crashed");
+    CHECK(aircraft.mode == MODE_HOLD, "the flight plan wasn't completed within %d s", FLIGHT_TIMEOUT_S);
+    CHECK(crossTrackMean <= CROSS_TRACK_MEAN_MAX, "mean cross-track error was %.1f m (at most %d m)", crossTrackMean,
+          CROSS_TRACK_MEAN_MAX);
+    CHECK(crossTrackMax <= CROSS_TRACK_MAX, "cross-track error reached %.1f m (at most %d m)", crossTrackMax, CROSS_TRACK_MAX);
+    CHECK(distance <= ideal + DISTANCE_EXCESS_MAX && distance >= ideal - DISTANCE_SHORT_MAX,
+          "flew %.0f m for %.0f m of legs (between %.0f m and %.0f m)", distance, ideal, ideal - DISTANCE_SHORT_MAX,
+          ideal + DISTANCE_EXCESS_MAX);
+    return test_result();
+}
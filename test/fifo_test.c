@@ -0,0 +1,175 @@
+/**
+ * Source file of pico-fbw: https://github.com/pico-fbw/pico-fbw
+ * Licensed under the GNU AGPL-3.0
+ */
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include "platform/helpers.h"
+#include "platform/i2c.h"
+#include "platform/sys.h"
+#include "platform/time.h"
+
+#include "lib/fusion/drivers/icm20948.h"
+#include "lib/fusion/fusion.h"
+
+#include "test.h"
+
+// Replays a recording of the ICM20948's FIFO registers through the driver and fusion_fifo_read(), and checks the samples
+// that come out and the time that's worked out for them (their timestamps and dt).
+// The chip is found and set up as usual (the simulator emulates it, see platform/host/sim/imu.c); once its FIFO is enabled,
+// reads of FIFO_COUNTH and FIFO_R_W are answered from the recording instead, and time_us() returns the time they were made at.
+// data/icm20948_fifo.txt was recorded from that same emulated chip with the gyro at 550 Hz, reading it every 10 ms with two
+// stalls: one of 45 ms, and one of 150 ms which overflows the FIFO (42 frames, more than FUSION_FIFO_BATCH, so it's drained
+// over two reads). Each line is one register read: the time it was made at (us), the register, and the bytes read (hex).
+// Both i2c_read() and time_us() are wrapped for this, which needs GNU ld.
+
+#define RECORDING "data/icm20948_fifo.txt"
+#define RECORDED_READS 49
+#define RECORDED_SAMPLES 172
+#define RECORDED_OVERFLOWS 1
+
+#define FRAME_LEN 12 // Bytes per frame (accel and gyro)
+#define READ_MAX 96  // Bytes the driver reads from FIFO_R_W at most at once (eight frames)
+
+#define ODR 400                // Asked of the gyro, which runs at the closest rate it can (about 550 Hz)
+#define TIMESTAMP_TOLERANCE 2  // us, samples are stamped whole us apart
+#define DT_TOLERANCE 2E-6f     // s
+
+typedef struct RecordedRead {
+    u64 time; // us
+    byte reg;
+    byte data[READ_MAX];
+    u32 len;
+} RecordedRead;
+
+static RecordedRead reads[RECORDED_READS + 1];
+static u32 numReads = 0, nextRead = 0;
+static bool replaying = false;
+static u64 replayTime = 0;  // Time of the last replayed read, us
+static u32 replayFrames = 0; // Frames the last replayed FIFO_COUNTH said were buffered
+
+bool __real_i2c_read(u32 sda, u32 scl, byte addr, byte reg, byte dest[], size_t len);
+bool __wrap_i2c_read(u32 sda, u32 scl, byte addr, byte reg, byte dest[], size_t len) {
+    if (!replaying || (reg != ICM20948_REG0_FIFO_COUNTH && reg != ICM20948_REG0_FIFO_R_W))
+        return __real_i2c_read(sda, scl, addr, reg, dest, len);
+    if (nextRead >= numReads) {
+        CHECK(false, "read 0x%02x past the end of the recording", reg);
+        return false;
+    }
+    const RecordedRead *read = &reads[nextRead++];
+    if (read->reg != reg || read->len != len) {
+        CHECK(false, "read %lu bytes of 0x%02x where the recording has %lu bytes of 0x%02x", (unsigned long)len, reg,
+              (unsigned long)read->len, read->reg);
+        return false;
+    }
+    memcpy(dest, read->data, len);
+    replayTime = read->time;
+    if (reg == ICM20948_REG0_FIFO_COUNTH)
+        replayFrames = (((dest[0] & 0x1f) << 8) | dest[1]) / FRAME_LEN;
+    return true;
+}
+
+u64 __real_time_us();
+u64 __wrap_time_us() {
+    return replaying ? replayTime : __real_time_us();
+}
+
+static bool load() {
+    FILE *file = fopen(RECORDING, "r");
+    if (!file) {
+        CHECK(false, "couldn't open %s (tests must be run from the test directory)", RECORDING);
+        return false;
+    }
+    unsigned long long time;
+    unsigned int reg;
+    char hex[2 * sizeof(reads[0].data) + 1];
+    while (numReads < count_of(reads) && fscanf(file, "%llu %x %192s", &time, &reg, hex) == 3) {
+        RecordedRead *read = &reads[numReads++];
+        read->time = time;
+        read->reg = (byte)reg;
+        read->len = (u32)strlen(hex) / 2;
+        for (u32 i = 0; i < read->len; i++) {
+            unsigned int b;
+            sscanf(&hex[i * 2], "%2x", &b);
+            read->data[i] = (byte)b;
+        }
+    }
+    fclose(file);
+    CHECK(numReads == RECORDED_READS, "the recording has %lu reads, expected %u", (unsigned long)numReads, RECORDED_READS);
+    return numReads == RECORDED_READS;
+}
+
+int main() {
+    setenv("PICO_FBW_SIM", "1", 1);
+    setenv("PICO_FBW_VIRTUAL_TIME", "1", 1);
+    if (!load())
+        return test_result();
+
+    sys_boot_begin();
+    i2c_setup(0, 1, 400000);
+    IMU *imu = fusion_imu_create();
+    AccelerometerOptions accOpts = {.scale = 16, .odr = ODR};
+    GyroscopeOptions gyroOpts = {.scale = 2000, .odr = ODR};
+    bool found = fusion_accelerometer_find(imu, &accOpts) && fusion_gyroscope_find(imu, &gyroOpts);
+    CHECK(found && fusion_fifo_enable(imu, true), "the (emulated) ICM20948 couldn't be set up");
+    if (testFailures > 0)
+        return test_result();
+    f32 period = imu->fifo_period; // us
+
+    replaying = true;
+    IMUSample samples[FUSION_FIFO_BATCH];
+    u32 total = 0, overflows = 0;
+    u64 previous = 0; // Timestamp of the previous sample
+    while (nextRead < numReads) {
+        bool overflow;
+        i32 n = fusion_fifo_read(imu, samples, count_of(samples), &overflow);
+        if (n < 0) {
+            CHECK(false, "reading the FIFO failed after %lu of the recording's reads", (unsigned long)nextRead);
+            break;
+        }
+        total += n;
+        overflows += overflow;
+        if (n == 0)
+            continue;
+
+        // The newest sample was taken when the FIFO was read, or one period before each sample still left in it
+        u64 newest = replayTime - (u64)(period * (replayFrames - n));
+        CHECK(llabs((long long)(samples[n - 1].timestamp - newest)) <= TIMESTAMP_TOLERANCE,
+              "a read at %llu us with %lu of %lu frames stamped its newest sample %llu us, expected %llu us",
+              (unsigned long long)replayTime, (unsigned long)n, (unsigned long)replayFrames,
+              (unsigned long long)samples[n - 1].timestamp, (unsigned long long)newest);
+
+        for (i32 i = 0; i < n; i++) {
+            const IMUSample *s = &samples[i];
+            CHECK(s->timestamp > previous && s->timestamp <= replayTime,
+                  "a sample read at %llu us was stamped %llu us, after the previous one at %llu us",
+                  (unsigned long long)replayTime, (unsigned long long)s->timestamp, (unsigned long long)previous);
+            CHECK(s->dt > 0 && s->dt <= period * FUSION_FIFO_DT_PERIODS / 1E6f + DT_TOLERANCE,
+                  "the sample at %llu us has a dt of %f s (period %f s)", (unsigned long long)s->timestamp, s->dt,
+                  period / 1E6f);
+            if (previous == 0 || (overflow && i == 0)) {
+                // Nothing is known about what came before, and after an overflow that's a stall many periods long
+                CHECK(fabsf(s->dt - period / 1E6f) <= DT_TOLERANCE,
+                      "the sample at %llu us (%llu us after the one before it) has a dt of %f s, expected one period (%f s)",
+                      (unsigned long long)s->timestamp, (unsigned long long)(s->timestamp - previous), s->dt,
+                      period / 1E6f);
+            } else {
+                // Otherwise it covers the time since the previous sample, which is never more than a few periods
+                CHECK(fabsf(s->dt - (f32)(s->timestamp - previous) / 1E6f) <= DT_TOLERANCE,
+                      "the sample at %llu us (%llu us after the one before it) has a dt of %f s",
+                      (unsigned long long)s->timestamp, (unsigned long long)(s->timestamp - previous), s->dt);
+            }
+            previous = s->timestamp;
+        }
+    }
+    replaying = false;
+    printf("%lu samples over %lu reads, %lu overflows, period %.1f us\n", (unsigned long)total, (unsigned long)numReads,
+           (unsigned long)overflows, period);
+
+    CHECK(total == RECORDED_SAMPLES, "read %lu samples, expected %u", (unsigned long)total, RECORDED_SAMPLES);
+    CHECK(overflows == RECORDED_OVERFLOWS, "%lu overflows were reported, expected %u", (unsigned long)overflows,
+          RECORDED_OVERFLOWS);
+    return test_result();
+}
@@ -0,0 +1,218 @@
+/**
+ * Source file of pico-fbw: https://github.com/pico-fbw/pico-fbw
+ * Licensed under the GNU AGPL-3.0
+ */
+
+#include <math.h>
+#include "platform/helpers.h"
+
+#include "lib/fusion/estimator.h"
+
+#include "test.h"
+
+// Runs the estimators over the same synthetic flight and compares their accuracy against the truth it was generated from, and
+// their cost per IMU sample.
+// The flight is a series of gentle coordinated turns and climbs at constant airspeed. IMU samples are generated from it with
+// noise and a gyroscope bias, GPS fixes (with noise) at 10 Hz, and everything is seeded so every run is the same.
+
+#define RATE 100.f     // IMU rate, Hz
+#define GPS_RATE 10    // Hz
+#define DURATION 300.f // s
+#define SETTLE 30.f    // Time given to converge before errors are counted, s
+#define SPEED 20.f     // m/s
+#define GRAVITY 9.80665f
+#define EARTH_RADIUS 6371000.0
+#define ORIGIN_LAT 47.4
+#define ORIGIN_LNG 8.5
+
+#define GYRO_NOISE 0.005f   // rad/s
+#define ACC_NOISE 0.1f      // m/s^2
+#define MAG_NOISE 0.005f    // Relative to the field
+#define GPS_POS_NOISE 1.5f  // m
+#define GPS_VEL_NOISE 0.2f  // m/s
+static const f32 gyroBias[3] = {0.01f, -0.005f, 0.008f}; // rad/s
+static const f32 magField[3] = {0.22f, 0.f, 0.42f};      // NED, declination is 0
+
+// Largest RMS errors allowed (roll/pitch, yaw) for each estimator, in degrees, and position for those that estimate it (m).
+// Madgwick's yaw isn't checked: without the magnetometer it only integrates the (biased) gyroscope. Its roll/pitch are pulled
+// towards level in every turn, as a coordinated turn looks level to the accelerometer, so its bound only guards against it
+// getting any worse.
+#define MADGWICK_TILT_MAX 12.f
+#define EKF_TILT_MAX 2.f
+#define EKF_YAW_MAX 5.f
+#define EKF_POS_MAX 5.f
+
+typedef struct Truth {
+    f32 roll, pitch, yaw; // rad
+    f32 vel[3];           // NED, m/s
+    f64 pos[3];           // NED, m
+} Truth;
+
+typedef struct Result {
+    f32 tiltRms, yawRms, posRms; // deg, deg, m
+    f64 ns, cycles;              // Per IMU sample
+} Result;
+
+static u64 rng = 0x2545F4914F6CDD1D;
+
+// Gaussian noise (Box-Muller over xorshift64)
+static f32 noise(f32 sigma) {
+    f64 u[2];
+    for (u32 i = 0; i < 2; i++) {
+        rng ^= rng << 13;
+        rng ^= rng >> 7;
+        rng ^= rng << 17;
+        u[i] = ((rng >> 11) + 1) * (1.0 / 9007199254740993.0);
+    }
+    return (f32)(sqrt(-2.0 * log(u[0])) * cos(2.0 * M_PI * u[1])) * sigma;
+}
+
+// The flight's heading rate and pitch over time; bank follows from the heading rate, so turns are coordinated
+static void euler_at(f32 t, f32 *roll, f32 *pitch, f32 *yaw) {
+    f32 yawRate = 0.15f * sinf(2.f * (f32)M_PI * t / 40.f);
+    *roll = atanf(SPEED * yawRate / GRAVITY);
+    *pitch = 0.1f * sinf(2.f * (f32)M_PI * t / 25.f);
+    // Integral of the heading rate
+    *yaw = 0.15f * 40.f / (2.f * (f32)M_PI) * (1.f - cosf(2.f * (f32)M_PI * t / 40.f));
+}
+
+static void velocity_at(f32 t, f32 vel[3]) {
+    f32 roll, pitch, yaw;
+    euler_at(t, &roll, &pitch, &yaw);
+    vel[0] = SPEED * cosf(pitch) * cosf(yaw);
+    vel[1] = SPEED * cosf(pitch) * sinf(yaw);
+    vel[2] = -SPEED * sinf(pitch);
+}
+
+// Rotates a vector from the navigation frame into the body frame of the given attitude
+static void to_body(f32 roll, f32 pitch, f32 yaw, const f32 v[3], f32 out[3]) {
+    f32 cr = cosf(roll), sr = sinf(roll), cp = cosf(pitch), sp = sinf(pitch), cy = cosf(yaw), sy = sinf(yaw);
+    out[0] = cp * cy * v[0] + cp * sy * v[1] - sp * v[2];
+    out[1] = (sr * sp * cy - cr * sy) * v[0] + (sr * sp * sy + cr * cy) * v[1] + sr * cp * v[2];
+    out[2] = (cr * sp * cy + sr * sy) * v[0] + (cr * sp * sy - sr * cy) * v[1] + cr * cp * v[2];
+}
+
+// Generates the IMU sample at time t (and the truth it was generated from)
+static void imu_at(f32 t, EstimatorIMU *imu, Truth *truth) {
+    const f32 h = 1E-3f;
+    f32 r0, p0, y0, r1, p1, y1;
+    euler_at(t - h, &r0, &p0, &y0);
+    euler_at(t + h, &r1, &p1, &y1);
+    euler_at(t, &truth->roll, &truth->pitch, &truth->yaw);
+    f32 roll = truth->roll, pitch = truth->pitch;
+    f32 rollRate = (r1 - r0) / (2 * h), pitchRate = (p1 - p0) / (2 * h), yawRate = (y1 - y0) / (2 * h);
+    imu->gyro[0] = rollRate - yawRate * sinf(pitch);
+    imu->gyro[1] = pitchRate * cosf(roll) + yawRate * cosf(pitch) * sinf(roll);
+    imu->gyro[2] = -pitchRate * sinf(roll) + yawRate * cosf(pitch) * cosf(roll);
+    // Specific force is acceleration minus gravity
+    f32 v0[3], v1[3], force[3];
+    velocity_at(t - h, v0);
+    velocity_at(t + h, v1);
+    for (u32 i = 0; i < 3; i++)
+        force[i] = (v1[i] - v0[i]) / (2 * h);
+    force[2] -= GRAVITY;
+    to_body(truth->roll, truth->pitch, truth->yaw, force, imu->acc);
+    to_body(truth->roll, truth->pitch, truth->yaw, magField, imu->mag);
+    velocity_at(t, truth->vel);
+    for (u32 i = 0; i < 3; i++) {
+        imu->gyro[i] += gyroBias[i] + noise(GYRO_NOISE);
+        imu->acc[i] += noise(ACC_NOISE);
+        imu->mag[i] += noise(MAG_NOISE);
+    }
+}
+
+static f32 wrap_pi(f32 angle) {
+    while (angle > M_PI)
+        angle -= 2 * M_PI;
+    while (angle < -M_PI)
+        angle += 2 * M_PI;
+    return angle;
+}
+
+static Result run(const Estimator *estimator) {
+    Result result = {0};
+    void *state = estimator->create(RATE);
+    if (!state)
+        return (Result){.tiltRms = INFINITY, .yawRms = INFINITY, .posRms = INFINITY};
+    rng = 0x2545F4914F6CDD1D;
+    const f32 dt = 1.f / RATE;
+    Truth truth = {0};
+    f64 tiltSq = 0, yawSq = 0, posSq = 0;
+    u32 samples = (u32)(DURATION * RATE), counted = 0, positions = 0;
+    u64 ns = 0, cycles = 0;
+    for (u32 i = 0; i < samples; i++) {
+        f32 t = i * dt;
+        EstimatorIMU imu;
+        imu_at(t, &imu, &truth);
+        for (u32 j = 0; j < 3; j++)
+            truth.pos[j] += truth.vel[j] * dt;
+        if (!estimator->usesMag)
+            imu.mag[0] = imu.mag[1] = imu.mag[2] = 0;
+        EstimatorGPS gps;
+        bool hasFix = estimator->update_gps && i % (u32)(RATE / GPS_RATE) == 0;
+        if (hasFix) {
+            gps = (EstimatorGPS){
+                .lat = ORIGIN_LAT + (truth.pos[0] + noise(GPS_POS_NOISE)) / EARTH_RADIUS * 180.0 / M_PI,
+                .lng = ORIGIN_LNG + (truth.pos[1] + noise(GPS_POS_NOISE)) / (EARTH_RADIUS * cos(radians(ORIGIN_LAT))) *
+                                        180.0 / M_PI,
+                .alt = (f32)-truth.pos[2] + noise(GPS_POS_NOISE),
+                .vel = {truth.vel[0] + noise(GPS_VEL_NOISE), truth.vel[1] + noise(GPS_VEL_NOISE)},
+                .hasVel = true,
+                .hAcc = GPS_POS_NOISE,
+            };
+        }
+
+        // Only the estimator itself is timed
+        u64 startNs = bench_ns(), startCycles = bench_cycles();
+        estimator->update_imu(state, dt, &imu);
+        if (hasFix)
+            estimator->update_gps(state, &gps);
+        cycles += bench_cycles() - startCycles;
+        ns += bench_ns() - startNs;
+
+        if (t < SETTLE)
+            continue;
+        f32 roll, pitch, yaw;
+        estimator->get_attitude(state, &roll, &pitch, &yaw);
+        f32 rollErr = degrees(wrap_pi(roll - truth.roll)), pitchErr = degrees(wrap_pi(pitch - truth.pitch));
+        f32 yawErr = degrees(wrap_pi(yaw - truth.yaw));
+        tiltSq += (rollErr * rollErr + pitchErr * pitchErr) / 2;
+        yawSq += yawErr * yawErr;
+        counted++;
+        f64 lat, lng;
+        f32 alt;
+        if (estimator->get_position && estimator->get_position(state, &lat, &lng, &alt)) {
+            f64 north = radians(lat - ORIGIN_LAT) * EARTH_RADIUS - truth.pos[0];
+            f64 east = radians(lng - ORIGIN_LNG) * EARTH_RADIUS * cos(radians(ORIGIN_LAT)) - truth.pos[1];
+            posSq += north * north + east * east;
+            positions++;
+        }
+    }
+    estimator->destroy(state);
+    result.tiltRms = sqrtf(tiltSq / counted);
+    result.yawRms = sqrtf(yawSq / counted);
+    result.posRms = positions > 0 ? sqrtf(posSq / positions) : NAN;
+    result.ns = (f64)ns / samples;
+    result.cycles = (f64)cycles / samples;
+    printf("%-9s tilt %5.2f deg  yaw %5.2f deg  position %6.2f m  %7.0f ns/sample  %7.0f cycles/sample\n", estimator->name,
+           result.tiltRms, result.yawRms, result.posRms, result.ns, result.cycles);
+    return result;
+}
+
+int main() {
+    printf("%.0f s of flight at %.0f Hz, errors counted after %.0f s\n", DURATION, RATE, SETTLE);
+    Result madgwick = run(&estimator_madgwick);
+    Result ekf = run(&estimator_ekf);
+    if (madgwick.ns > 0)
+        printf("ekf costs %.1fx madgwick per sample\n", ekf.ns / madgwick.ns);
+
+    CHECK(madgwick.tiltRms <= MADGWICK_TILT_MAX, "madgwick's roll/pitch error is %.2f deg", madgwick.tiltRms);
+    CHECK(ekf.tiltRms <= EKF_TILT_MAX, "ekf's roll/pitch error is %.2f deg", ekf.tiltRms);
+    CHECK(ekf.yawRms <= EKF_YAW_MAX, "ekf's yaw error is %.2f deg", ekf.yawRms);
+    CHECK(ekf.posRms <= EKF_POS_MAX, "ekf's position error is %.2f m", ekf.posRms);
+    // The EKF is only worth its cost if it's at least as accurate
+    CHECK(ekf.tiltRms <= madgwick.tiltRms, "ekf is less accurate than madgwick (%.2f vs. %.2f deg)", ekf.tiltRms,
+          madgwick.tiltRms);
+
+    return test_result();
+}
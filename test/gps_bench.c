@@ -0,0 +1,202 @@
+/**
+ * Source file of pico-fbw: https://github.com/pico-fbw/pico-fbw
+ * Licensed under the GNU AGPL-3.0
+ */
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include "platform/helpers.h"
+
+#include "lib/nmea.h"
+#include "lib/ubx.h"
+
+#include "test.h"
+
+// Runs the GPS parsers (lib/nmea and lib/ubx) over recorded GPS streams, byte by byte and handling each fix the way
+// src/io/gps.c does, reporting their cost per byte and per fix and checking what they decoded.
+// The recordings in data/ were taken from the simulated GPS (platform/host/sim/gps.c) in SITL, over the first 30 s of a
+// flight: sitl.nmea in NMEA mode (gpsCommandType 0, starting with the module's answer to the PMTK configuration), and sitl.ubx
+// in u-blox mode (gpsCommandType 2, starting with the acknowledgements of the CFG messages).
+// Each is then parsed again with one byte of every fix damaged, which must drop that fix (and nothing else).
+
+#define RUNS 200
+#define UART_BAUD 9600 // The default GPS baud rate, which carries about UART_BAUD / 10 bytes/s
+
+#define NMEA_CAPTURE "data/sitl.nmea"
+#define NMEA_SENTENCES 451 // One PMTK001, then a GGA, GSA, and VTG for each fix
+#define UBX_CAPTURE "data/sitl.ubx"
+#define UBX_MESSAGES 309 // Nine ACK-ACKs, then a NAV-PVT and NAV-DOP for each fix
+#define FIXES 150
+
+#define COORD_TOLERANCE 1E-9 // Coordinates are decoded at full precision, so this is only rounding
+#define ALT_TOLERANCE 0.01f  // m
+
+typedef struct Capture {
+    byte *data;
+    u32 len;
+} Capture;
+
+// What the parsers were left with once a stream was parsed
+typedef struct Parsed {
+    u32 messages, errors, fixes;
+    f64 lat, lng;
+    f32 alt, speed, pdop; // m, ground speed as sent (kts or m/s), unitless
+} Parsed;
+
+static Capture load(const char *path) {
+    Capture capture = {0};
+    FILE *file = fopen(path, "rb");
+    if (!file) {
+        CHECK(false, "couldn't open %s (tests must be run from the test directory)", path);
+        return capture;
+    }
+    fseek(file, 0, SEEK_END);
+    long size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    capture.data = malloc(size > 0 ? size : 1);
+    if (capture.data && size > 0 && fread(capture.data, size, 1, file) == 1)
+        capture.len = (u32)size;
+    fclose(file);
+    return capture;
+}
+
+/* --- NMEA --- */
+
+static void handle_nmea(const NMEAParser *nmea, Parsed *out) {
+    if (nmea_is(nmea, "GGA")) {
+        i32 quality;
+        if (!nmea_to_int(nmea_field(nmea, 6), &quality) || quality == 0)
+            return;
+        if (nmea_to_coord(nmea_field(nmea, 2), nmea_field(nmea, 3), &out->lat) &&
+            nmea_to_coord(nmea_field(nmea, 4), nmea_field(nmea, 5), &out->lng) && nmea_to_float(nmea_field(nmea, 9), &out->alt))
+            out->fixes++;
+    } else if (nmea_is(nmea, "GSA")) {
+        nmea_to_float(nmea_field(nmea, 15), &out->pdop);
+    } else if (nmea_is(nmea, "VTG")) {
+        nmea_to_float(nmea_field(nmea, 5), &out->speed);
+    }
+}
+
+static Parsed parse_nmea(const Capture *capture) {
+    Parsed out = {0};
+    NMEAParser nmea;
+    nmea_init(&nmea);
+    for (u32 i = 0; i < capture->len; i++) {
+        if (nmea_feed(&nmea, (char)capture->data[i]))
+            handle_nmea(&nmea, &out);
+    }
+    out.messages = nmea.sentences;
+    out.errors = nmea.errors;
+    return out;
+}
+
+// Changes a digit of the latitude in every GGA sentence, so they all fail their checksum
+static void damage_nmea(Capture *capture) {
+    for (u32 i = 0; i + 20 < capture->len; i++) {
+        if (memcmp(&capture->data[i], "$GPGGA,", 7) == 0)
+            capture->data[i + 20] ^= 0x01;
+    }
+}
+
+/* --- UBX --- */
+
+static void handle_ubx(const UBXParser *ubx, Parsed *out) {
+    UBXNavPVT pvt;
+    UBXNavDOP dop;
+    if (ubx_decode_nav_pvt(ubx, &pvt)) {
+        if (!pvt.fixOk || pvt.fixType < UBX_FIX_3D)
+            return;
+        out->lat = pvt.lat;
+        out->lng = pvt.lng;
+        out->alt = pvt.hMSL;
+        out->speed = pvt.gSpeed;
+        out->fixes++;
+    } else if (ubx_decode_nav_dop(ubx, &dop)) {
+        out->pdop = dop.pDOP;
+    }
+}
+
+static Parsed parse_ubx(const Capture *capture) {
+    Parsed out = {0};
+    UBXParser ubx;
+    ubx_init(&ubx);
+    for (u32 i = 0; i < capture->len; i++) {
+        if (ubx_feed(&ubx, capture->data[i]))
+            handle_ubx(&ubx, &out);
+    }
+    out.messages = ubx.messages;
+    out.errors = ubx.errors;
+    return out;
+}
+
+// Changes a byte of the latitude in every NAV-PVT message, so they all fail their checksum
+static void damage_ubx(Capture *capture) {
+    for (u32 i = 0; i + 6 + 28 < capture->len; i++) {
+        if (capture->data[i] == UBX_SYNC1 && capture->data[i + 1] == UBX_SYNC2 && capture->data[i + 2] == UBX_CLASS_NAV &&
+            capture->data[i + 3] == UBX_NAV_PVT)
+            capture->data[i + 6 + 28] ^= 0x01;
+    }
+}
+
+/* --- Benchmark --- */
+
+typedef struct Recording {
+    const char *name, *path;
+    Parsed (*parse)(const Capture *);
+    void (*damage)(Capture *); // Damages every fix of the recording
+    u32 messages;
+    f64 lastLat, lastLng; // The recording's last fix, deg
+    f32 lastAlt;          // m
+} Recording;
+
+static const Recording recordings[] = {
+    // 4724.1271 N, 00832.7356 E, 633.4 M
+    {"NMEA", NMEA_CAPTURE, parse_nmea, damage_nmea, NMEA_SENTENCES, 47 + 24.1271 / 60, 8 + 32.7356 / 60, 633.4f},
+    // lat 474021182, lon 85455940 (1E-7 deg), hMSL 633425 mm
+    {"UBX", UBX_CAPTURE, parse_ubx, damage_ubx, UBX_MESSAGES, 47.4021182, 8.545594, 633.425f},
+};
+
+static void bench(const Recording *rec) {
+    Capture capture = load(rec->path);
+    if (capture.len == 0) {
+        free(capture.data);
+        return;
+    }
+
+    Parsed parsed = rec->parse(&capture);
+    u32 fixes = 0; // Used, so the runs can't be optimized out
+    u64 startNs = bench_ns(), startCycles = bench_cycles();
+    for (u32 i = 0; i < RUNS; i++)
+        fixes += rec->parse(&capture).fixes;
+    f64 ns = (f64)(bench_ns() - startNs) / RUNS, cycles = (f64)(bench_cycles() - startCycles) / RUNS;
+    printf("%s: %lu bytes, %lu messages, %lu fixes\n", rec->name, (unsigned long)capture.len, (unsigned long)parsed.messages,
+           (unsigned long)parsed.fixes);
+    printf("  %6.1f ns %6.1f cycles per byte, %7.0f ns per fix, %5.1f us per second of data at %u baud\n", ns / capture.len,
+           cycles / capture.len, ns / FIXES, ns / capture.len * (UART_BAUD / 10) / 1000, UART_BAUD);
+
+    CHECK(parsed.messages == rec->messages && parsed.errors == 0, "%s: %lu messages parsed and %lu dropped, expected %lu and 0",
+          rec->name, (unsigned long)parsed.messages, (unsigned long)parsed.errors, (unsigned long)rec->messages);
+    CHECK(parsed.fixes == FIXES && fixes == FIXES * RUNS, "%s: %lu fixes, expected %u", rec->name,
+          (unsigned long)parsed.fixes, FIXES);
+    CHECK(fabs(parsed.lat - rec->lastLat) < COORD_TOLERANCE && fabs(parsed.lng - rec->lastLng) < COORD_TOLERANCE,
+          "%s: last fix was at %.9f, %.9f, expected %.9f, %.9f", rec->name, parsed.lat, parsed.lng, rec->lastLat, rec->lastLng);
+    CHECK(fabsf(parsed.alt - rec->lastAlt) < ALT_TOLERANCE, "%s: last altitude was %.3f m, expected %.3f m", rec->name,
+          parsed.alt, rec->lastAlt);
+    CHECK(parsed.speed > 0 && parsed.pdop > 0, "%s: speed (%.2f) or PDOP (%.2f) was never decoded", rec->name, parsed.speed,
+          parsed.pdop);
+
+    rec->damage(&capture);
+    Parsed damaged = rec->parse(&capture);
+    CHECK(damaged.fixes == 0 && damaged.errors == FIXES && damaged.messages == rec->messages - FIXES,
+          "%s (damaged): %lu fixes, %lu messages parsed and %lu dropped, expected 0, %lu, and %u", rec->name,
+          (unsigned long)damaged.fixes, (unsigned long)damaged.messages, (unsigned long)damaged.errors,
+          (unsigned long)(rec->messages - FIXES), FIXES);
+    free(capture.data);
+}
+
+int main() {
+    for (u32 i = 0; i < count_of(recordings); i++)
+        bench(&recordings[i]);
+    return test_result();
+}
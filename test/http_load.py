@@ -0,0 +1,202 @@
+# Load test for the host web server (platform/host/http.c).
+# Runs a number of concurrent clients against one path for a while and reports the requests/s they were served at and the
+# latency of those requests; exits non-zero if any request failed.
+#
+# Either point it at a running server with --url, or give it a host build of pico-fbw with --binary, which is then run (with
+# a temporary home directory, and through stdbuf from coreutils) with Wi-Fi enabled. It isn't simulated, as the aircraft
+# disables Wi-Fi once it's flying. The server only starts with a web interface image, so the build must be configured with
+# -DFBW_BUILD_WWW=ON, or PICO_FBW_WWWFS must point at an image.
+#
+# Example: python3 test/http_load.py --binary build/pico-fbw --clients 8 --duration 10 --path /api/v1/get/info
+
+# Source file of pico-fbw: https://github.com/pico-fbw/pico-fbw
+# Licensed under the GNU AGPL-3.0
+
+import argparse
+import http.client
+import os
+import socket
+import subprocess
+import sys
+import tempfile
+import threading
+import time
+from urllib.parse import urlsplit
+
+BOOT_TIMEOUT = 20 # s
+
+# === Running the server ===
+
+class Server:
+    """A host build of pico-fbw, run with its own home directory."""
+
+    def __init__(self, binary, home, port):
+        self.binary = binary
+        self.env = dict(os.environ, HOME=home, PICO_FBW_HTTP_PORT=str(port))
+        self.process = None
+        self.output = []
+        self.lines = threading.Condition()
+
+    def start(self):
+        self.output = []
+        # Its output is read line by line as it boots, so it mustn't be buffered any more than that
+        self.process = subprocess.Popen(["stdbuf", "-oL", self.binary], stdin=subprocess.PIPE, stdout=subprocess.PIPE,
+                                        stderr=subprocess.STDOUT, env=self.env)
+        threading.Thread(target=self._read, daemon=True).start()
+
+    def _read(self):
+        for line in self.process.stdout:
+            with self.lines:
+                self.output.append(line.decode(errors="replace"))
+                self.lines.notify_all()
+        with self.lines:
+            self.lines.notify_all()
+
+    def wait_for(self, text, timeout=BOOT_TIMEOUT):
+        """Waits until the server prints a line containing text, returning false if it doesn't in time or exits."""
+        deadline = time.monotonic() + timeout
+        with self.lines:
+            while not any(text in line for line in self.output):
+                remaining = deadline - time.monotonic()
+                if remaining <= 0 or self.process.poll() is not None:
+                    return False
+                self.lines.wait(remaining)
+        return True
+
+    def command(self, line):
+        """Sends a command to the serial API."""
+        self.process.stdin.write((line + "\n").encode())
+        self.process.stdin.flush()
+
+    def stop(self):
+        if self.process and self.process.poll() is None:
+            self.process.terminate()
+            try:
+                self.process.wait(timeout=5)
+            except subprocess.TimeoutExpired:
+                self.process.kill()
+                self.process.wait()
+
+def free_port():
+    with socket.socket() as s:
+        s.bind(("127.0.0.1", 0))
+        return s.getsockname()[1]
+
+def start_server(binary, home):
+    """Runs binary once to enable Wi-Fi in its config, then again to serve; returns the running server and its port."""
+    port = free_port()
+    server = Server(binary, home, port)
+    server.start()
+    if not server.wait_for("Done!"):
+        server.stop()
+        sys.exit("pico-fbw didn't finish booting:\n" + "".join(server.output))
+    server.command('SET_CONFIG {"changes":[{"section":"General","key":"wifiEnabled","value":"1"}],"save":true}')
+    if not server.wait_for("pico-fbw 200", timeout=5):
+        server.stop()
+        sys.exit("couldn't enable Wi-Fi:\n" + "".join(server.output))
+    server.stop()
+    server.start()
+    if not server.wait_for("web interface available"):
+        server.stop()
+        sys.exit("the web server didn't start (was the web interface image built?):\n" + "".join(server.output))
+    return server, port
+
+# === Load ===
+
+class Client(threading.Thread):
+    """Sends requests one after another until stop is set, recording the latency of each."""
+
+    def __init__(self, host, port, path, keep_alive, stop):
+        super().__init__(daemon=True)
+        self.host, self.port, self.path = host, port, path
+        self.keep_alive = keep_alive
+        self.stop = stop
+        self.latencies = [] # s
+        self.errors = 0
+        self.first_error = None
+
+    def run(self):
+        conn = None
+        headers = {} if self.keep_alive else {"Connection": "close"}
+        while not self.stop.is_set():
+            start = time.perf_counter()
+            try:
+                if conn is None:
+                    conn = http.client.HTTPConnection(self.host, self.port, timeout=10)
+                conn.request("GET", self.path, headers=headers)
+                response = conn.getresponse()
+                response.read()
+                if response.status != 200:
+                    raise RuntimeError(f"status {response.status}")
+                self.latencies.append(time.perf_counter() - start)
+                if not self.keep_alive or response.will_close:
+                    conn.close()
+                    conn = None
+            except Exception as e:
+                self.errors += 1
+                if self.first_error is None:
+                    self.first_error = f"{type(e).__name__}: {e}"
+                if conn is not None:
+                    conn.close()
+                    conn = None
+        if conn is not None:
+            conn.close()
+
+def percentile(sorted_values, p):
+    if not sorted_values:
+        return float("nan")
+    index = min(len(sorted_values) - 1, int(round(p / 100 * (len(sorted_values) - 1))))
+    return sorted_values[index]
+
+def run_load(host, port, path, clients, duration, keep_alive):
+    stop = threading.Event()
+    threads = [Client(host, port, path, keep_alive, stop) for _ in range(clients)]
+    start = time.perf_counter()
+    for thread in threads:
+        thread.start()
+    time.sleep(duration)
+    stop.set()
+    for thread in threads:
+        thread.join()
+    elapsed = time.perf_counter() - start
+
+    latencies = sorted(l for thread in threads for l in thread.latencies)
+    errors = sum(thread.errors for thread in threads)
+    ms = lambda p: percentile(latencies, p) * 1000
+    print(f"{clients} clients ({'keep-alive' if keep_alive else 'a connection per request'}) for {elapsed:.1f} s on {path}")
+    print(f"  {len(latencies)} requests, {len(latencies) / elapsed:.0f} requests/s, {errors} errors")
+    print(f"  latency p50 {ms(50):.2f} ms, p90 {ms(90):.2f} ms, p99 {ms(99):.2f} ms, max {ms(100):.2f} ms")
+    for thread in threads:
+        if thread.first_error:
+            print(f"  first error: {thread.first_error}")
+            break
+    return errors == 0 and len(latencies) > 0
+
+def main():
+    parser = argparse.ArgumentParser(description="Load test for the host web server")
+    target = parser.add_mutually_exclusive_group(required=True)
+    target.add_argument("--binary", help="host build of pico-fbw to run and test")
+    target.add_argument("--url", help="address of a server that is already running, e.g. http://localhost:8080")
+    parser.add_argument("--clients", type=int, default=8, help="number of concurrent clients (default: 8)")
+    parser.add_argument("--duration", type=float, default=10, help="how long to run for, in seconds (default: 10)")
+    parser.add_argument("--path", default="/api/v1/ping", help="path to request (default: /api/v1/ping)")
+    parser.add_argument("--close", action="store_true", help="open a new connection for every request")
+    args = parser.parse_args()
+
+    server = None
+    try:
+        if args.binary:
+            home = tempfile.TemporaryDirectory(prefix="pico-fbw-load-")
+            server, port = start_server(os.path.abspath(args.binary), home.name)
+            host = "127.0.0.1"
+        else:
+            url = urlsplit(args.url if "//" in args.url else "http://" + args.url)
+            host, port = url.hostname, url.port or 80
+        ok = run_load(host, port, args.path, args.clients, args.duration, not args.close)
+    finally:
+        if server:
+            server.stop()
+    sys.exit(0 if ok else 1)
+
+if __name__ == "__main__":
+    main()
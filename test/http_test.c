@@ -0,0 +1,154 @@
+/**
+ * Source file of pico-fbw: https://github.com/pico-fbw/pico-fbw
+ * Licensed under the GNU AGPL-3.0
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "platform/common/http.h"
+#include "platform/helpers.h"
+
+#include "test.h"
+
+// Checks the HTTP engine that the platforms' web servers share (platform/common/http.c).
+// Requests are fed to the parser the way the servers feed it, in however many pieces they arrive in (see
+// tcp_server_process() in platform/pico/wifi/tcp.c), and every way of splitting a stream must parse to the same requests.
+
+#define PARSED_MAX 8
+
+typedef struct Parsed {
+    HTTPMethod method;
+    char target[64];
+    char body[64];
+    char host[32];
+    bool keepAlive;
+    i32 error; // Non-zero if the request was malformed (which ends the stream)
+} Parsed;
+
+// Pipelined requests on one connection, with a stray empty line between two of them (which is ignored)
+static const char stream[] = "GET /api/v1/get/config?foo=bar HTTP/1.1\r\nHost: 192.168.4.1\r\nUser-Agent: test\r\n\r\n"
+                             "POST /api/v1/set/flightplan HTTP/1.1\r\nhost: 192.168.4.1\r\nContent-Length: 13\r\n\r\n"
+                             "{\"version\":1}"
+                             "\r\n"
+                             "GET /index.html HTTP/1.0\r\n\r\n"
+                             "HEAD / HTTP/1.0\r\nConnection: keep-alive\r\n\r\n"
+                             "GET /favicon.ico HTTP/1.1\r\nConnection: close\r\nHOST:   pico-fbw  \r\n\r\n";
+
+static const Parsed expected[] = {
+    {HTTP_METHOD_GET, "/api/v1/get/config?foo=bar", "", "192.168.4.1", true, 0},
+    {HTTP_METHOD_POST, "/api/v1/set/flightplan", "{\"version\":1}", "192.168.4.1", true, 0},
+    {HTTP_METHOD_GET, "/index.html", "", "", false, 0},
+    {HTTP_METHOD_HEAD, "/", "", "", true, 0},
+    {HTTP_METHOD_GET, "/favicon.ico", "", "pico-fbw", false, 0},
+};
+
+static void record(const HTTPParser *parser, Parsed *out) {
+    const HTTPRequest *req = &parser->request;
+    *out = (Parsed){.method = req->method, .keepAlive = req->keepAlive, .error = parser->error};
+    if (parser->state == HTTP_PARSE_ERROR)
+        return;
+    snprintf(out->target, sizeof(out->target), "%s", req->target);
+    snprintf(out->body, sizeof(out->body), "%s", req->body ? req->body : "");
+    const char *host = http_get_header(req, "Host");
+    snprintf(out->host, sizeof(out->host), "%s", host ? host : "");
+}
+
+/**
+ * Parses a stream received in pieces.
+ * @param data the stream
+ * @param len the length of the stream
+ * @param step the size of each piece, or 0 to split the stream in two at `split`
+ * @param split where to split the stream in two
+ * @param out where to store the requests
+ * @return the number of requests parsed (including a malformed one, which ends the stream)
+ */
+static u32 parse_pieces(const char *data, u32 len, u32 step, u32 split, Parsed out[PARSED_MAX]) {
+    HTTPParser *parser = malloc(sizeof(HTTPParser));
+    http_parser_init(parser);
+    u32 count = 0, pos = 0;
+    while (pos < len && count < PARSED_MAX) {
+        u32 end = step > 0 ? pos - pos % step + step : (pos < split ? split : len);
+        if (end > len)
+            end = len;
+        // Like a server, feed the rest of each piece again after every complete request
+        pos += http_parse(parser, data + pos, end - pos);
+        if (parser->state == HTTP_PARSE_DONE) {
+            record(parser, &out[count++]);
+            http_parser_reset(parser);
+        } else if (parser->state == HTTP_PARSE_ERROR) {
+            record(parser, &out[count++]);
+            break;
+        }
+    }
+    http_parser_reset(parser);
+    free(parser);
+    return count;
+}
+
+static bool same(const Parsed *a, const Parsed *b) {
+    return a->method == b->method && strcmp(a->target, b->target) == 0 && strcmp(a->body, b->body) == 0 &&
+           strcmp(a->host, b->host) == 0 && a->keepAlive == b->keepAlive && a->error == b->error;
+}
+
+static void check_stream(u32 step, u32 split) {
+    Parsed parsed[PARSED_MAX];
+    u32 count = parse_pieces(stream, strlen(stream), step, split, parsed);
+    CHECK(count == count_of(expected), "%u requests parsed (step %u, split %u), expected %u", count, step, split,
+          (u32)count_of(expected));
+    for (u32 i = 0; i < count && i < count_of(expected); i++)
+        CHECK(same(&parsed[i], &expected[i]), "request %u differs (step %u, split %u): %d %s \"%s\" host \"%s\" keepAlive %d",
+              i, step, split, parsed[i].method, parsed[i].target, parsed[i].body, parsed[i].host, parsed[i].keepAlive);
+}
+
+static void check_error(const char *request, i32 error) {
+    Parsed parsed[PARSED_MAX];
+    // Byte by byte as well as all at once, so the error is found wherever the request is split
+    for (u32 step = 0; step <= 1; step++) {
+        u32 count = parse_pieces(request, strlen(request), step, 0, parsed);
+        CHECK(count == 1 && parsed[0].error == error && !parsed[0].keepAlive, "expected %ld for \"%.40s\", got %ld",
+              (long)error, request, count == 1 ? (long)parsed[0].error : 0L);
+    }
+}
+
+int main() {
+    // Every split of the stream into two pieces, and into equal pieces of every size
+    for (u32 split = 0; split <= strlen(stream); split++)
+        check_stream(0, split);
+    for (u32 step = 1; step <= strlen(stream); step++)
+        check_stream(step, 0);
+
+    check_error("GARBAGE\r\n\r\n", 400);
+    check_error("GET / HTTP/2\r\n\r\n", 400);
+    check_error("GET / HTTP/1.1\r\nNo colon here\r\n\r\n", 400);
+    check_error("POST / HTTP/1.1\r\nContent-Length: 12abc\r\n\r\n", 400);
+    check_error("POST / HTTP/1.1\r\nContent-Length: 999999\r\n\r\n", 413);
+    check_error("POST / HTTP/1.1\r\nTransfer-Encoding: chunked\r\n\r\n", 501);
+    char *longHead = malloc(HTTP_HEAD_MAX + 64);
+    snprintf(longHead, HTTP_HEAD_MAX + 64, "GET / HTTP/1.1\r\nCookie: %0*d\r\n\r\n", HTTP_HEAD_MAX, 0);
+    check_error(longHead, 431);
+    free(longHead);
+
+    char value[16];
+    const char *target = "/api/v1/stream?channels=aahrs,gps&rate=10";
+    CHECK(http_get_query(target, "channels", value, sizeof(value)) && strcmp(value, "aahrs,gps") == 0, "channels: %s", value);
+    CHECK(http_get_query(target, "rate", value, sizeof(value)) && strcmp(value, "10") == 0, "rate: %s", value);
+    CHECK(!http_get_query(target, "rat", value, sizeof(value)), "a prefix of a parameter matched");
+    CHECK(!http_get_query(target, "channels", value, 4), "a value that doesn't fit was returned");
+    CHECK(!http_get_query("/api/v1/stream", "rate", value, sizeof(value)), "a parameter was found without a query");
+
+    char head[HTTP_RESPONSE_HEAD_MAX];
+    u32 len = http_format_head(head, sizeof(head), "200 OK", "application/json", HTTP_CHUNKED, true, NULL);
+    CHECK(len == strlen(head) &&
+              strcmp(head, "HTTP/1.1 200 OK\r\nContent-Type: application/json\r\nTransfer-Encoding: chunked\r\n\r\n") == 0,
+          "unexpected chunked head:\n%s", head);
+    len = http_format_head(head, sizeof(head), "404 Not Found", NULL, 0, false, "X-Test: 1\r\n");
+    CHECK(len == strlen(head) &&
+              strcmp(head, "HTTP/1.1 404 Not Found\r\nContent-Length: 0\r\nConnection: close\r\nX-Test: 1\r\n\r\n") == 0,
+          "unexpected head:\n%s", head);
+    len = http_format_head(head, sizeof(head), "304 Not Modified", NULL, HTTP_NO_BODY, true, NULL);
+    CHECK(len > 0 && !strstr(head, "Content-Length") && !strstr(head, "Transfer-Encoding"), "unexpected 304 head:\n%s", head);
+    CHECK(http_format_head(head, 16, "200 OK", "application/json", 2, true, NULL) == 0,
+          "a head that doesn't fit was formatted");
+
+    return test_result();
+}
@@ -0,0 +1,275 @@
+/**
+ * Source file of pico-fbw: https://github.com/pico-fbw/pico-fbw
+ * Licensed under the GNU AGPL-3.0
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "platform/helpers.h"
+
+#include "lib/jsonwriter.h"
+#include "lib/parson.h"
+
+#include "test.h"
+
+// Compares writing API responses with lib/jsonwriter against building them as a parson tree and serializing it (as they used
+// to be), reporting the heap allocations and time each takes per response, and checking that both produce the same document.
+// Two responses are written: one shaped like GET_CONFIG's, and one like GET_FLIGHTPLAN's for a plan of WAYPOINTS waypoints.
+// Allocations are counted by wrapping the allocator at link time (see test.cmake), which is only done where the linker
+// supports it; elsewhere they're not reported.
+
+#define CONFIG_RUNS 20000
+#define FLIGHTPLAN_RUNS 500
+#define WAYPOINTS 500
+#define SINK_BUFFER_SIZE 128 // Same as the serial API's
+
+#if COUNT_ALLOCATIONS
+
+static u32 allocations = 0;
+
+void *__real_malloc(size_t size);
+void *__real_calloc(size_t count, size_t size);
+void *__real_realloc(void *ptr, size_t size);
+
+void *__wrap_malloc(size_t size) {
+    allocations++;
+    return __real_malloc(size);
+}
+
+void *__wrap_calloc(size_t count, size_t size) {
+    allocations++;
+    return __real_calloc(count, size);
+}
+
+void *__wrap_realloc(void *ptr, size_t size) {
+    allocations++;
+    return __real_realloc(ptr, size);
+}
+
+#endif
+
+typedef struct Section {
+    const char *name;
+    u32 count;
+    f32 values[20];
+} Section;
+
+static const Section sections[] = {
+    {"General", 9, {2, 1, 20, 50, 50, 1, 0, 0, 1}},
+    {"Control", 20, {25, 15, 1.5f, 2, 10, 30, 0.015f, 180, 0, 33, 67, -15, 30, 25, 15, 20, 20, 0.5f, 1, 1}},
+    {"Pins", 17, {1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 16, 17}},
+    {"Sensors", 9, {1, 0, 400, 1, 9600, 100, 0, 100, 20}},
+    {"System", 8, {1, 1, 0, 0, 0, 0, 25, 1}},
+};
+
+typedef struct Waypoint {
+    f64 lat, lng;
+    i32 alt;
+    f32 speed;
+    i32 drop;
+} Waypoint;
+
+static Waypoint waypoints[WAYPOINTS];
+
+/* --- Before: parson --- */
+
+static char *config_parson() {
+    JSON_Value *root = json_value_init_object();
+    JSON_Value *array = json_value_init_array();
+    for (u32 i = 0; i < count_of(sections); i++) {
+        JSON_Value *section = json_value_init_object();
+        json_object_set_string(json_object(section), "name", sections[i].name);
+        JSON_Value *values = json_value_init_array();
+        for (u32 j = 0; j < sections[i].count; j++)
+            json_array_append_number(json_array(values), sections[i].values[j]);
+        json_object_set_value(json_object(section), "values", values);
+        json_array_append_value(json_array(array), section);
+    }
+    JSON_Value *wifi = json_value_init_object();
+    json_object_set_string(json_object(wifi), "name", "WiFi");
+    JSON_Value *values = json_value_init_array();
+    json_array_append_string(json_array(values), "pico-fbw");
+    json_array_append_string(json_array(values), "picodashfbw");
+    json_object_set_value(json_object(wifi), "values", values);
+    json_array_append_value(json_array(array), wifi);
+    json_object_set_value(json_object(root), "sections", array);
+    char *str = json_serialize_to_string(root);
+    json_value_free(root);
+    return str;
+}
+
+static char *flightplan_parson() {
+    JSON_Value *root = json_value_init_object();
+    json_object_set_string(json_object(root), "version", "1.0");
+    json_object_set_string(json_object(root), "version_fw", "1.0.0-alpha.3");
+    json_object_set_number(json_object(root), "alt_samples", 5);
+    JSON_Value *array = json_value_init_array();
+    for (u32 i = 0; i < WAYPOINTS; i++) {
+        JSON_Value *wpt = json_value_init_object();
+        json_object_set_number(json_object(wpt), "lat", waypoints[i].lat);
+        json_object_set_number(json_object(wpt), "lng", waypoints[i].lng);
+        json_object_set_number(json_object(wpt), "alt", waypoints[i].alt);
+        json_object_set_number(json_object(wpt), "speed", waypoints[i].speed);
+        json_object_set_number(json_object(wpt), "drop", waypoints[i].drop);
+        json_array_append_value(json_array(array), wpt);
+    }
+    json_object_set_value(json_object(root), "waypoints", array);
+    char *str = json_serialize_to_string(root);
+    json_value_free(root);
+    return str;
+}
+
+/* --- After: jsonwriter --- */
+
+static void config_writer(JSONWriter *json) {
+    jsonw_object_begin(json);
+    jsonw_key(json, "sections");
+    jsonw_array_begin(json);
+    for (u32 i = 0; i < count_of(sections); i++) {
+        jsonw_object_begin(json);
+        jsonw_key_string(json, "name", sections[i].name);
+        jsonw_key(json, "values");
+        jsonw_array_begin(json);
+        for (u32 j = 0; j < sections[i].count; j++)
+            jsonw_number(json, sections[i].values[j]);
+        jsonw_array_end(json);
+        jsonw_object_end(json);
+    }
+    jsonw_object_begin(json);
+    jsonw_key_string(json, "name", "WiFi");
+    jsonw_key(json, "values");
+    jsonw_array_begin(json);
+    jsonw_string(json, "pico-fbw");
+    jsonw_string(json, "picodashfbw");
+    jsonw_array_end(json);
+    jsonw_object_end(json);
+    jsonw_array_end(json);
+    jsonw_object_end(json);
+    jsonw_finish(json);
+}
+
+static void flightplan_writer(JSONWriter *json) {
+    jsonw_object_begin(json);
+    jsonw_key_string(json, "version", "1.0");
+    jsonw_key_string(json, "version_fw", "1.0.0-alpha.3");
+    jsonw_key_number(json, "alt_samples", 5);
+    jsonw_key(json, "waypoints");
+    jsonw_array_begin(json);
+    for (u32 i = 0; i < WAYPOINTS; i++) {
+        jsonw_object_begin(json);
+        jsonw_key_number(json, "lat", waypoints[i].lat);
+        jsonw_key_number(json, "lng", waypoints[i].lng);
+        jsonw_key_number(json, "alt", waypoints[i].alt);
+        jsonw_key_number(json, "speed", waypoints[i].speed);
+        jsonw_key_number(json, "drop", waypoints[i].drop);
+        jsonw_object_end(json);
+    }
+    jsonw_array_end(json);
+    jsonw_object_end(json);
+    jsonw_finish(json);
+}
+
+// Stands in for the serial port or a socket
+static void sink(const char *data, u32 len, void *ctx) {
+    *(u32 *)ctx += len;
+    (void)data;
+}
+
+/* --- Benchmark --- */
+
+typedef struct Measurement {
+    f64 allocations, ns, cycles; // Per response
+} Measurement;
+
+static void report(const char *what, const Measurement *m) {
+#if COUNT_ALLOCATIONS
+    printf("  %-10s %7.1f allocations %9.0f ns %10.0f cycles per response\n", what, m->allocations, m->ns, m->cycles);
+#else
+    printf("  %-10s %9.0f ns %10.0f cycles per response\n", what, m->ns, m->cycles);
+#endif
+}
+
+static Measurement measure_parson(char *(*build)(), u32 runs) {
+#if COUNT_ALLOCATIONS
+    allocations = 0;
+#endif
+    u64 startNs = bench_ns(), startCycles = bench_cycles();
+    for (u32 i = 0; i < runs; i++)
+        json_free_serialized_string(build());
+    Measurement m = {.ns = (f64)(bench_ns() - startNs) / runs, .cycles = (f64)(bench_cycles() - startCycles) / runs};
+#if COUNT_ALLOCATIONS
+    m.allocations = (f64)allocations / runs;
+#endif
+    return m;
+}
+
+static Measurement measure_writer(void (*write)(JSONWriter *), u32 runs) {
+#if COUNT_ALLOCATIONS
+    allocations = 0;
+#endif
+    u64 startNs = bench_ns(), startCycles = bench_cycles();
+    for (u32 i = 0; i < runs; i++) {
+        char buf[SINK_BUFFER_SIZE];
+        u32 written = 0;
+        JSONWriter json;
+        jsonw_init_sink(&json, buf, sizeof(buf), sink, &written);
+        write(&json);
+    }
+    Measurement m = {.ns = (f64)(bench_ns() - startNs) / runs, .cycles = (f64)(bench_cycles() - startCycles) / runs};
+#if COUNT_ALLOCATIONS
+    m.allocations = (f64)allocations / runs;
+#endif
+    return m;
+}
+
+// Checks that both ways produce the same document (as parsed, since numbers may be formatted differently)
+static void check_same(const char *name, char *(*build)(), void (*write)(JSONWriter *)) {
+    char *before = build();
+    JSONWriter json;
+    jsonw_init(&json, NULL, 0); // Measure first
+    write(&json);
+    u32 measured = jsonw_finish(&json); // Finishing again changes nothing
+    char *after = malloc(measured + 1);
+    jsonw_init(&json, after, measured + 1);
+    write(&json);
+    CHECK(measured > 0 && jsonw_finish(&json) == measured && strlen(after) == measured,
+          "%s: measured %lu bytes, but wrote %lu", name, (unsigned long)measured, (unsigned long)strlen(after));
+    char small[8];
+    jsonw_init(&json, small, sizeof(small));
+    write(&json);
+    CHECK(jsonw_finish(&json) == 0, "%s: a document that didn't fit into %lu bytes wasn't reported", name,
+          (unsigned long)sizeof(small));
+    JSON_Value *a = json_parse_string(before), *b = json_parse_string(after);
+    CHECK(a && b && json_value_equals(a, b), "%s: the documents differ:\n%s\n%s", name, before, after);
+    printf("%s (%lu bytes)\n", name, (unsigned long)strlen(after));
+    json_value_free(a);
+    json_value_free(b);
+    json_free_serialized_string(before);
+    free(after);
+}
+
+static void bench(const char *name, char *(*build)(), void (*write)(JSONWriter *), u32 runs) {
+    check_same(name, build, write);
+    Measurement before = measure_parson(build, runs);
+    Measurement after = measure_writer(write, runs);
+    report("parson", &before);
+    report("jsonwriter", &after);
+#if COUNT_ALLOCATIONS
+    CHECK(after.allocations == 0, "%s: jsonwriter allocated %.1f times per response", name, after.allocations);
+#endif
+}
+
+int main() {
+    for (u32 i = 0; i < WAYPOINTS; i++) {
+        waypoints[i] = (Waypoint){
+            .lat = 47.4021161 + i * 1.234567E-4,
+            .lng = 8.5455940 - i * 7.654321E-5,
+            .alt = 100 + (i % 50),
+            .speed = 25.5f,
+            .drop = i % 7 == 0 ? 3 : 0,
+        };
+    }
+    bench("GET_CONFIG", config_parson, config_writer, CONFIG_RUNS);
+    bench("GET_FLIGHTPLAN", flightplan_parson, flightplan_writer, FLIGHTPLAN_RUNS);
+    return test_result();
+}
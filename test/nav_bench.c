@@ -0,0 +1,163 @@
+/**
+ * Source file of pico-fbw: https://github.com/pico-fbw/pico-fbw
+ * Licensed under the GNU AGPL-3.0
+ */
+
+#include <math.h>
+#include "platform/helpers.h"
+
+#include "lib/nav.h"
+
+#include "test.h"
+
+// Checks the flat-earth leg navigation in lib/nav (nav_leg_track()) against great-circle math, for every length of leg it's
+// used for (up to NAV_FLAT_EARTH_MAX), and compares their cost per position.
+// The reference is the same leg navigated on a great circle, which is worked out with calculate_distance() and
+// calculate_bearing() (as legs longer than NAV_FLAT_EARTH_MAX are). Legs start anywhere up to LAT_MAX from the equator, in any
+// direction, and are flown from positions spread along them and up to a tenth of their length off to either side.
+
+#define LEGS 20000 // Per length
+#define LAT_MAX 60 // deg
+#define EARTH_RADIUS_M 6371000.0
+#define CLOSE_M 10 // Bearings aren't compared closer than this to the end of a leg, where they turn quickly
+
+// Largest errors allowed against great-circle math (m, deg)
+#define DISTANCE_ERROR_MAX 0.1f
+#define BEARING_ERROR_MAX 0.1f
+// A leg is a straight line on its plane, which bows away from the great circle by up to length^2 * tan(lat) / (8 * radius)
+// in the middle (3.4 m for a 10 km leg at 60 deg), so cross-track and along-track distances are measured from a slightly
+// different line. On top of that, the reference's along-track distance (an acos of something close to 1) is only good to
+// about 0.1 m near the start of a leg.
+#define TRACK_ERROR_MARGIN 0.2f
+
+// Every leg length up to where legs switch to great circles (which is decided on the plane, so this stays just short of it)
+static const f32 lengths[] = {100, 1000, 5000, NAV_FLAT_EARTH_MAX * 0.999f};
+
+typedef struct Errors {
+    f32 distance, crossTrack, alongTrack, bearing; // Worst seen
+} Errors;
+
+static u64 rng = 0x9E3779B97F4A7C15;
+
+// Uniform in [min, max) (xorshift64)
+static f64 uniform(f64 min, f64 max) {
+    rng ^= rng << 13;
+    rng ^= rng >> 7;
+    rng ^= rng << 17;
+    return min + (max - min) * ((rng >> 11) * (1.0 / 9007199254740992.0));
+}
+
+// Finds the point at a distance and initial course from another, on a great circle
+static void destination(f64 lat, f64 lng, f64 course, f64 distance, f64 *outLat, f64 *outLng) {
+    f64 d = distance / EARTH_RADIUS_M, c = radians(course), phi = radians(lat);
+    f64 phi2 = asin(sin(phi) * cos(d) + cos(phi) * sin(d) * cos(c));
+    f64 lambda = radians(lng) + atan2(sin(c) * sin(d) * cos(phi), cos(d) - sin(phi) * sin(phi2));
+    *outLat = degrees(phi2);
+    *outLng = degrees(lambda);
+    if (*outLng > 180)
+        *outLng -= 360;
+    else if (*outLng < -180)
+        *outLng += 360;
+}
+
+static f32 bearing_error(f32 a, f32 b) {
+    f32 error = fabsf(a - b);
+    return error > 180 ? 360 - error : error;
+}
+
+static void worst(f32 *worst, f32 error) {
+    if (!(error <= *worst)) // Also catches NaN
+        *worst = error;
+}
+
+// Generates a leg of the given length, along with a position to fly it from
+static void random_leg(f32 length, f64 leg[4], f64 pos[2]) {
+    leg[0] = uniform(-LAT_MAX, LAT_MAX);
+    leg[1] = uniform(-180, 180);
+    f64 course = uniform(0, 360);
+    destination(leg[0], leg[1], course, length, &leg[2], &leg[3]);
+    f64 alongLat, alongLng;
+    destination(leg[0], leg[1], course, uniform(0, 1) * length, &alongLat, &alongLng);
+    destination(alongLat, alongLng, course + 90, uniform(-0.1, 0.1) * length, &pos[0], &pos[1]);
+}
+
+static void check_length(f32 length) {
+    Errors errors = {0};
+    f32 trackErrorMax = (f32)(length * length * tan(radians(LAT_MAX)) / (8 * EARTH_RADIUS_M)) + TRACK_ERROR_MARGIN;
+    for (u32 i = 0; i < LEGS; i++) {
+        f64 l[4], pos[2];
+        random_leg(length, l, pos);
+        NavLeg leg, reference;
+        nav_leg_init(&leg, l[0], l[1], l[2], l[3]);
+        reference = leg;
+        reference.greatCircle = true;
+        reference.course = (f32)calculate_bearing(l[0], l[1], l[2], l[3]);
+        reference.length = (f32)calculate_distance(l[0], l[1], l[2], l[3]);
+        CHECK(!leg.greatCircle, "a %.0f m leg was navigated on a great circle", length);
+
+        NavTrack flat, great;
+        nav_leg_track(&leg, pos[0], pos[1], &flat);
+        nav_leg_track(&reference, pos[0], pos[1], &great);
+        worst(&errors.distance, fabsf(flat.distance - great.distance));
+        worst(&errors.distance, fabsf(leg.length - reference.length));
+        worst(&errors.crossTrack, fabsf(flat.crossTrack - great.crossTrack));
+        worst(&errors.alongTrack, fabsf(flat.alongTrack - great.alongTrack));
+        worst(&errors.bearing, bearing_error(leg.course, reference.course));
+        if (great.distance > CLOSE_M)
+            worst(&errors.bearing, bearing_error(flat.bearing, great.bearing));
+    }
+    printf("%6.0f m legs: worst errors distance %.4f m, cross-track %.4f m, along-track %.4f m, bearing %.4f deg\n", length,
+           errors.distance, errors.crossTrack, errors.alongTrack, errors.bearing);
+    CHECK(errors.distance <= DISTANCE_ERROR_MAX, "%.0f m legs: distance is off by up to %.4f m", length, errors.distance);
+    CHECK(errors.crossTrack <= trackErrorMax && errors.alongTrack <= trackErrorMax,
+          "%.0f m legs: cross-track is off by up to %.4f m, along-track by up to %.4f m (at most %.4f m)", length,
+          errors.crossTrack, errors.alongTrack, trackErrorMax);
+    CHECK(errors.bearing <= BEARING_ERROR_MAX, "%.0f m legs: bearing is off by up to %.4f deg", length, errors.bearing);
+}
+
+// Times working out the distance and bearing to the end of a leg, as auto mode does on every update
+static void bench() {
+    static f64 legs[LEGS][4], positions[LEGS][2];
+    static NavLeg navLegs[LEGS];
+    for (u32 i = 0; i < LEGS; i++) {
+        random_leg(NAV_FLAT_EARTH_MAX / 2, legs[i], positions[i]);
+        nav_leg_init(&navLegs[i], legs[i][0], legs[i][1], legs[i][2], legs[i][3]);
+    }
+    f64 sum = 0; // Used, so nothing can be optimized out
+
+    u64 startNs = bench_ns(), startCycles = bench_cycles();
+    for (u32 i = 0; i < LEGS; i++) {
+        sum += calculate_distance(positions[i][0], positions[i][1], legs[i][2], legs[i][3]);
+        sum += calculate_bearing(positions[i][0], positions[i][1], legs[i][2], legs[i][3]);
+    }
+    f64 greatNs = (f64)(bench_ns() - startNs) / LEGS, greatCycles = (f64)(bench_cycles() - startCycles) / LEGS;
+
+    startNs = bench_ns();
+    startCycles = bench_cycles();
+    for (u32 i = 0; i < LEGS; i++) {
+        NavTrack track;
+        nav_leg_track(&navLegs[i], positions[i][0], positions[i][1], &track);
+        sum += track.distance + track.bearing;
+    }
+    f64 flatNs = (f64)(bench_ns() - startNs) / LEGS, flatCycles = (f64)(bench_cycles() - startCycles) / LEGS;
+
+    printf("calculate_distance() + calculate_bearing() %6.1f ns %6.0f cycles per position\n", greatNs, greatCycles);
+    printf("nav_leg_track()                             %6.1f ns %6.0f cycles per position\n", flatNs, flatCycles);
+    if (flatNs > 0)
+        printf("nav_leg_track() is %.1fx as fast (checksum %.0f)\n", greatNs / flatNs, sum);
+}
+
+int main() {
+    for (u32 i = 0; i < count_of(lengths); i++)
+        check_length(lengths[i]);
+
+    // Just past NAV_FLAT_EARTH_MAX, legs switch to great circles
+    f64 l[4], pos[2];
+    random_leg(NAV_FLAT_EARTH_MAX * 1.01f, l, pos);
+    NavLeg leg;
+    nav_leg_init(&leg, l[0], l[1], l[2], l[3]);
+    CHECK(leg.greatCircle, "a %.0f m leg wasn't navigated on a great circle", NAV_FLAT_EARTH_MAX * 1.01f);
+
+    bench();
+    return test_result();
+}
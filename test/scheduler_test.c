@@ -0,0 +1,182 @@
+/**
+ * Source file of pico-fbw: https://github.com/pico-fbw/pico-fbw
+ * Licensed under the GNU AGPL-3.0
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "platform/helpers.h"
+#include "platform/host/sys_shared.h"
+#include "platform/time.h"
+
+#include "sys/scheduler.h"
+
+#include "test.h"
+
+// Drives the scheduler on the host's virtual clock, so every run is the same and time only passes where the tasks (or the
+// loop, while waiting for the next release) say it does
+
+#define RUN_TIME_US 1000000
+#define JITTER_MAX_US 50 // Most a release may be started late by, with nothing else in the way
+#define TRACE_MAX 16
+#define SPIKE_RUNTIME_US 100
+
+static i32 fastId, fast2Id, midId, slowId, hogId, longId, spikeId;
+static u64 lastStart[SCHEDULER_MAX_TASKS];
+static u32 maxInterval[SCHEDULER_MAX_TASKS], minInterval[SCHEDULER_MAX_TASKS], maxLatency[SCHEDULER_MAX_TASKS];
+static i32 trace[TRACE_MAX];
+static u32 traceLen = 0;
+
+// Records when a task started, how far apart its starts were, and the order in which tasks started
+static void record(i32 id) {
+    u64 now = time_us();
+    if (lastStart[id] != 0) {
+        u32 interval = (u32)(now - lastStart[id]);
+        if (interval > maxInterval[id])
+            maxInterval[id] = interval;
+        if (minInterval[id] == 0 || interval < minInterval[id])
+            minInterval[id] = interval;
+    }
+    lastStart[id] = now;
+    u32 latency = scheduler_get(id)->lastLatency;
+    if (latency > maxLatency[id])
+        maxLatency[id] = latency;
+    if (traceLen < TRACE_MAX)
+        trace[traceLen++] = id;
+}
+
+static void fast_task() {
+    record(fastId);
+}
+
+static void fast2_task() {
+    record(fast2Id);
+}
+
+static void mid_task() {
+    record(midId);
+}
+
+static void slow_task() {
+    record(slowId);
+}
+
+static void hog_task() {
+    record(hogId);
+    sleep_us_blocking(3000); // Longer than its own period
+}
+
+static void long_task() {
+    record(longId);
+    sleep_us_blocking(700); // Fits between releases of the fast task, but not just anywhere
+}
+
+static void spike_task() {
+    record(spikeId);
+    // Its first run is an outlier, taking almost as long as the fast task's period; it's quick after that
+    sleep_us_blocking(scheduler_get(spikeId)->runs == 0 ? 900 : SPIKE_RUNTIME_US);
+}
+
+static void reset_records() {
+    memset(lastStart, 0, sizeof(lastStart));
+    memset(maxInterval, 0, sizeof(maxInterval));
+    memset(minInterval, 0, sizeof(minInterval));
+    memset(maxLatency, 0, sizeof(maxLatency));
+    traceLen = 0;
+}
+
+static void run_for(u64 us) {
+    u64 end = time_us() + us;
+    while (time_us() < end)
+        sleep_us_blocking(scheduler_run());
+}
+
+// Checks that a task ran on its period for the whole run
+static void check_periodic(i32 id, u32 period) {
+    const Task *task = scheduler_get(id);
+    u32 expected = RUN_TIME_US / period;
+    CHECK(task->runs >= expected && task->runs <= expected + 1, "%s ran %u times, expected %u", task->name, task->runs,
+          expected);
+    CHECK(maxInterval[id] <= period + JITTER_MAX_US && minInterval[id] + JITTER_MAX_US >= period,
+          "%s ran every %u-%u us, expected %u", task->name, minInterval[id], maxInterval[id], period);
+    CHECK(task->overruns == 0 && task->skips == 0, "%s overran %u times and skipped %u times", task->name, task->overruns,
+          task->skips);
+}
+
+int main() {
+    setenv("PICO_FBW_VIRTUAL_TIME", "1", 1);
+    time_virtual_init();
+    sleep_us_blocking(1000); // Start time isn't 0, which record() uses to tell that a task hasn't run yet
+
+    // Priorities are rate-monotonic, whatever the order in which tasks were added; equal periods keep the order of adding
+    slowId = scheduler_add("slow", slow_task, 10000, 0);
+    fastId = scheduler_add("fast", fast_task, 1000, 0);
+    midId = scheduler_add("mid", mid_task, 5000, 0);
+    fast2Id = scheduler_add("fast2", fast2_task, 1000, 0);
+    CHECK(scheduler_add("zero", fast_task, 0, 0) < 0, "a task with a period of 0 was added");
+    CHECK(scheduler_count() == 4, "%u tasks registered, expected 4", scheduler_count());
+    CHECK(scheduler_get(fastId)->priority == 0, "fast has priority %u", scheduler_get(fastId)->priority);
+    CHECK(scheduler_get(fast2Id)->priority == 1, "fast2 has priority %u", scheduler_get(fast2Id)->priority);
+    CHECK(scheduler_get(midId)->priority == 2, "mid has priority %u", scheduler_get(midId)->priority);
+    CHECK(scheduler_get(slowId)->priority == 3, "slow has priority %u", scheduler_get(slowId)->priority);
+
+    // Everything is released at once to begin with, so tasks first run in order of priority
+    run_for(RUN_TIME_US);
+    i32 order[] = {fastId, fast2Id, midId, slowId};
+    for (u32 i = 0; i < count_of(order); i++)
+        CHECK(traceLen > i && trace[i] == order[i], "task %u to run was %s, expected %s", i,
+              traceLen > i ? scheduler_get(trace[i])->name : "none", scheduler_get(order[i])->name);
+    check_periodic(fastId, 1000);
+    check_periodic(fast2Id, 1000);
+    check_periodic(midId, 5000);
+    check_periodic(slowId, 10000);
+
+    // Changing a period re-evaluates priorities
+    scheduler_set_period(midId, 500);
+    CHECK(scheduler_get(midId)->priority == 0, "mid has priority %u after its period changed", scheduler_get(midId)->priority);
+    CHECK(scheduler_get(midId)->deadline == 500, "mid's implicit deadline wasn't updated");
+    scheduler_set_enabled(fast2Id, false);
+    scheduler_set_enabled(midId, false);
+    scheduler_set_enabled(slowId, false);
+    scheduler_reset_stats();
+
+    // A task that takes longer than its period overruns, and the releases it misses are skipped rather than queued up
+    reset_records();
+    hogId = scheduler_add("hog", hog_task, 2000, 0);
+    u64 hogStart = scheduler_get(hogId)->release;
+    run_for(RUN_TIME_US / 10);
+    const Task *hog = scheduler_get(hogId);
+    CHECK(hog->overruns > 0, "hog never overran");
+    CHECK(hog->skips > 0, "hog never skipped a release");
+    CHECK((hog->release - hogStart) % hog->period == 0, "hog's releases drifted off its grid");
+    scheduler_set_enabled(hogId, false);
+
+    // A long task only starts when it won't hold up the fast task, once its runtime is known
+    reset_records();
+    scheduler_reset_stats();
+    longId = scheduler_add("long", long_task, 20300, 0); // Off the fast task's grid, so it's released all over it
+    run_for(30000); // Long enough for the long task to run (and be timed) once
+    maxLatency[fastId] = 0;
+    run_for(RUN_TIME_US);
+    CHECK(scheduler_get(longId)->runs > RUN_TIME_US / 20300 - 2, "long only ran %u times", scheduler_get(longId)->runs);
+    CHECK(maxLatency[fastId] <= JITTER_MAX_US, "fast was started up to %u us late by long", maxLatency[fastId]);
+    CHECK(scheduler_get(fastId)->overruns == 0, "fast overran %u times", scheduler_get(fastId)->overruns);
+    scheduler_set_enabled(longId, false);
+
+    // A single slow run doesn't hold a task back for good: once its runs are quick again, it's fitted in where they fit
+    reset_records();
+    spikeId = scheduler_add("spike", spike_task, 7300, 0); // Off the fast task's grid too
+    run_for(RUN_TIME_US / 4); // The outlier, then enough quick runs for the estimate to come back down
+    const Task *spike = scheduler_get(spikeId);
+    CHECK(spike->maxRuntime >= 900, "spike's outlier wasn't timed (longest run %u us)", spike->maxRuntime);
+    CHECK(spike->estRuntime <= SPIKE_RUNTIME_US + JITTER_MAX_US,
+          "spike is expected to run for %u us after its outlier, expected about %u us", spike->estRuntime, SPIKE_RUNTIME_US);
+    maxLatency[fastId] = maxLatency[spikeId] = 0;
+    run_for(RUN_TIME_US);
+    // Were the outlier still expected, spike could only start in the first 100 us after the fast task and wait up to 900 us
+    CHECK(maxLatency[spikeId] <= SPIKE_RUNTIME_US + JITTER_MAX_US, "spike was started up to %u us late",
+          maxLatency[spikeId]);
+    CHECK(maxLatency[fastId] <= JITTER_MAX_US, "fast was started up to %u us late by spike", maxLatency[fastId]);
+
+    return test_result();
+}
@@ -0,0 +1,9 @@
+#pragma once
+
+// Part of the stand-in for lwIP that tcp_test builds the Pico's web server (platform/pico/wifi/tcp.c) against; only what
+// the server uses is declared, and the test implements it (see tcp_test.c)
+
+#define LWIP_DBG_OFF 0x00
+#define LWIP_DEBUGF(debug, message)                                                                                            \
+    do {                                                                                                                       \
+    } while (0)
@@ -0,0 +1,14 @@
+#pragma once
+
+// Part of the stand-in for lwIP that tcp_test builds the Pico's web server against (see lwip/debug.h)
+
+#include <stdint.h>
+
+typedef int8_t err_t;
+
+// Values as in lwIP
+#define ERR_OK 0
+#define ERR_MEM -1
+#define ERR_VAL -6
+#define ERR_ABRT -13
+#define ERR_RST -14
@@ -0,0 +1,14 @@
+#pragma once
+
+// Part of the stand-in for lwIP that tcp_test builds the Pico's web server against (see lwip/debug.h)
+
+#include <stdint.h>
+
+typedef struct ip_addr {
+    uint32_t addr;
+} ip_addr_t;
+
+#define IPADDR_TYPE_V4 0
+#define IP_ANY_TYPE NULL
+
+char *ipaddr_ntoa(const ip_addr_t *addr);
@@ -0,0 +1,21 @@
+#pragma once
+
+// Part of the stand-in for lwIP that tcp_test builds the Pico's web server against (see lwip/debug.h)
+
+#include <stdint.h>
+
+typedef uint8_t u8_t;
+typedef uint16_t u16_t;
+
+struct pbuf {
+    struct pbuf *next;
+    void *payload;
+    u16_t tot_len; // Length of this pbuf and all that follow it in the chain
+    u16_t len;     // Length of this pbuf
+};
+
+// As in lwIP: freeing a pbuf frees the rest of its chain, pbuf_cat() takes over the tail, and pbuf_free_header() drops
+// bytes from the front of a chain, returning what's left of it (NULL if nothing is)
+u8_t pbuf_free(struct pbuf *p);
+void pbuf_cat(struct pbuf *head, struct pbuf *tail);
+struct pbuf *pbuf_free_header(struct pbuf *q, u16_t size);
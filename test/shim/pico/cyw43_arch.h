@@ -0,0 +1,7 @@
+#pragma once
+
+// Part of the stand-in for lwIP that tcp_test builds the Pico's web server against (see lwip/debug.h); the test is
+// single-threaded, so there's nothing to lock
+
+#define cyw43_arch_lwip_begin()
+#define cyw43_arch_lwip_end()
@@ -0,0 +1,145 @@
+# Flight test of a host build of pico-fbw in its simulator (platform/host/sim).
+# Stores a flight plan around a square in the firmware (through the serial API), then boots it again with the simulator
+# enabled, in virtual time, moving the mode switch to auto, and checks that every Waypoint of the plan was captured in order
+# and that auto mode then handed over to hold mode. Exits non-zero otherwise.
+#
+# The binary is run with a temporary home directory, and through stdbuf from coreutils.
+#
+# Example: python3 test/sitl_flight.py --binary build/pico-fbw
+
+# Source file of pico-fbw: https://github.com/pico-fbw/pico-fbw
+# Licensed under the GNU AGPL-3.0
+
+import argparse
+import json
+import math
+import os
+import re
+import subprocess
+import sys
+import tempfile
+import threading
+import time
+
+BOOT_TIMEOUT = 20   # s
+FLIGHT_TIMEOUT = 60 # s (of real time; the flight itself takes about three minutes of virtual time)
+ENGAGE_AT = 10      # s of simulated time at which the mode switch is moved to auto, once the GPS has a fix
+
+HOME = (47.397742, 8.545594) # deg; the simulator's home is at sea level, as Waypoint altitudes aren't offset for the ground
+EARTH_RADIUS = 6378137.0     # m, as used by the simulator
+SIDE = 600                   # m
+ALT = 330                    # ft, about the height the aircraft starts at
+SPEED = 36                   # kts
+
+# Corners of the square (north, east of home in m) in the order they're flown; the aircraft starts at home, heading north
+CORNERS = [(SIDE, 0), (SIDE, SIDE), (0, SIDE), (0, 0), (SIDE, 0)]
+
+class Firmware:
+    """A host build of pico-fbw, run with its own home directory."""
+
+    def __init__(self, binary, env):
+        self.output = []
+        self.lines = threading.Condition()
+        # Its output is read line by line, so it mustn't be buffered any more than that
+        self.process = subprocess.Popen(["stdbuf", "-oL", binary], stdin=subprocess.PIPE, stdout=subprocess.PIPE,
+                                        stderr=subprocess.STDOUT, env=env)
+        threading.Thread(target=self._read, daemon=True).start()
+
+    def _read(self):
+        for line in self.process.stdout:
+            with self.lines:
+                self.output.append(line.decode(errors="replace"))
+                self.lines.notify_all()
+        with self.lines:
+            self.lines.notify_all()
+
+    def wait_for(self, text, timeout=BOOT_TIMEOUT):
+        """Waits until the firmware prints a line containing any of texts, returning it, or None if it doesn't in time."""
+        texts = text if isinstance(text, tuple) else (text,)
+        deadline = time.monotonic() + timeout
+        with self.lines:
+            while True:
+                for line in self.output:
+                    if any(t in line for t in texts):
+                        return line
+                remaining = deadline - time.monotonic()
+                if remaining <= 0 or self.process.poll() is not None:
+                    return None
+                self.lines.wait(remaining)
+
+    def command(self, line):
+        """Sends a command to the serial API and waits for it to succeed."""
+        with self.lines:
+            self.output.clear()
+        self.process.stdin.write((line + "\n").encode())
+        self.process.stdin.flush()
+        return self.wait_for("pico-fbw 200", timeout=5) is not None
+
+    def stop(self):
+        if self.process.poll() is None:
+            self.process.terminate()
+            try:
+                self.process.wait(timeout=5)
+            except subprocess.TimeoutExpired:
+                self.process.kill()
+                self.process.wait()
+
+def flightplan():
+    waypoints = []
+    for north, east in CORNERS:
+        lat = HOME[0] + math.degrees(north / EARTH_RADIUS)
+        lng = HOME[1] + math.degrees(east / (EARTH_RADIUS * math.cos(math.radians(HOME[0]))))
+        waypoints.append({"lat": lat, "lng": lng, "alt": ALT, "speed": SPEED, "drop": 0})
+    return {"version": "1.0", "version_fw": "0.0.1", "alt_samples": 0, "waypoints": waypoints}
+
+def prepare(binary, env):
+    """Stores the flight plan, and has the aircraft's messages printed from the next boot on."""
+    firmware = Firmware(binary, env)
+    try:
+        if firmware.wait_for("Done!") is None:
+            sys.exit("pico-fbw didn't finish booting:\n" + "".join(firmware.output))
+        if not firmware.command("SET_FLIGHTPLAN " + json.dumps(flightplan())):
+            sys.exit("the flight plan wasn't accepted:\n" + "".join(firmware.output))
+        if not firmware.command('SET_CONFIG {"changes":[{"section":"System","key":"printAircraft","value":"1"}],'
+                                '"save":true}'):
+            sys.exit("couldn't enable the aircraft's messages:\n" + "".join(firmware.output))
+    finally:
+        firmware.stop()
+
+def fly(binary, env):
+    """Flies the stored flight plan; returns whether every Waypoint was captured, in order, before entering hold mode."""
+    env = dict(env, PICO_FBW_SIM="1", PICO_FBW_VIRTUAL_TIME="1", PICO_FBW_SIM_SWITCH=f"high,{ENGAGE_AT}",
+               PICO_FBW_SIM_HOME=f"{HOME[0]},{HOME[1]},0")
+    firmware = Firmware(binary, env)
+    try:
+        end = firmware.wait_for(("entering hold mode", "hit the ground"), timeout=FLIGHT_TIMEOUT)
+    finally:
+        firmware.stop()
+    output = "".join(firmware.output)
+    captured = [(int(m.group(1)), int(m.group(2))) for m in re.finditer(r"captured Waypoint (\d+) of (\d+)", output)]
+    for index, total in captured:
+        print(f"captured Waypoint {index} of {total}")
+    expected = [(i + 1, len(CORNERS)) for i in range(len(CORNERS))]
+    if end is None or "hit the ground" in end:
+        print("the flight plan wasn't completed: " + (end.strip() if end else f"timed out after {FLIGHT_TIMEOUT} s"))
+    elif captured != expected:
+        print(f"expected Waypoints {expected} to be captured, but {captured} were")
+    else:
+        return True
+    print(output)
+    return False
+
+def main():
+    parser = argparse.ArgumentParser(description="Flight test of a host build of pico-fbw in its simulator")
+    parser.add_argument("--binary", required=True, help="host build of pico-fbw to fly")
+    args = parser.parse_args()
+
+    with tempfile.TemporaryDirectory(prefix="pico-fbw-sitl-") as home:
+        binary = os.path.abspath(args.binary)
+        env = dict(os.environ, HOME=home)
+        prepare(binary, env)
+        ok = fly(binary, env)
+    sys.exit(0 if ok else 1)
+
+if __name__ == "__main__":
+    main()
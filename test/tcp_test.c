@@ -0,0 +1,512 @@
+/**
+ * Source file of pico-fbw: https://github.com/pico-fbw/pico-fbw
+ * Licensed under the GNU AGPL-3.0
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "lwip/pbuf.h"
+#include "lwip/tcp.h"
+#include "platform/helpers.h"
+#include "platform/pico/wifi/tcp.h"
+
+#include "sys/api/cmds/cmds.h"
+
+#include "test.h"
+
+// Runs the Pico's web server (platform/pico/wifi/tcp.c) against a stand-in for lwIP (shim/), which hands it connections,
+// received data, acknowledgements and polls the way lwIP's callbacks do, and records what it writes back.
+// Checks keep-alive, pipelined requests (received whole and split across pbufs), responses that don't fit into the send
+// buffer (which are sent as it's acknowledged, holding up the requests behind them), and what happens when every
+// connection in the pool is in use. The web interface isn't loaded, so files are answered with the captive portal's redirect.
+
+#define CLIENTS_MAX (TCP_CONNECTIONS_MAX + 2)
+#define BODY_MAX 65536
+
+// The stand-in's side of a connection
+typedef struct Client {
+    struct tcp_pcb pcb;                 // First, so the server's pcbs can be turned back into clients
+    u16 segments[TCP_SND_QUEUELEN];     // Lengths of the segments that haven't been acknowledged, oldest first
+    u32 numSegments;
+    size_t read;                        // How much of what the server wrote has been looked at
+    bool used;                          // Whether the client has connected (and so may still be connected)
+} Client;
+
+typedef struct Response {
+    bool complete;   // Whether the whole response has been written
+    char status[32]; // e.g. "200 OK"
+    bool close;      // Whether the server said it would close the connection
+    bool chunked;
+    char *body;      // NUL-terminated (and dechunked)
+    size_t bodyLen;
+} Response;
+
+static struct tcp_pcb listener;
+static Client clients[CLIENTS_MAX];
+static i32 pbufs = 0; // Allocated and not yet freed
+static char body[BODY_MAX + 1];
+
+/* --- The stand-in for lwIP --- */
+
+char *ipaddr_ntoa(const ip_addr_t *addr) {
+    static char buf[16];
+    snprintf(buf, sizeof(buf), "%u.%u.%u.%u", addr->addr & 0xff, (addr->addr >> 8) & 0xff, (addr->addr >> 16) & 0xff,
+             addr->addr >> 24);
+    return buf;
+}
+
+u8_t pbuf_free(struct pbuf *p) {
+    u8_t freed = 0;
+    while (p) {
+        struct pbuf *next = p->next;
+        free(p);
+        pbufs--;
+        freed++;
+        p = next;
+    }
+    return freed;
+}
+
+void pbuf_cat(struct pbuf *head, struct pbuf *tail) {
+    struct pbuf *p = head;
+    for (; p->next; p = p->next)
+        p->tot_len += tail->tot_len;
+    p->tot_len += tail->tot_len;
+    p->next = tail;
+}
+
+struct pbuf *pbuf_free_header(struct pbuf *q, u16_t size) {
+    while (q && size > 0) {
+        if (size >= q->len) {
+            struct pbuf *next = q->next;
+            size -= q->len;
+            q->next = NULL;
+            pbuf_free(q);
+            q = next;
+        } else {
+            q->payload = (char *)q->payload + size;
+            q->len -= size;
+            q->tot_len -= size;
+            size = 0;
+        }
+    }
+    return q;
+}
+
+struct tcp_pcb *tcp_new_ip_type(u8_t type) {
+    memset(&listener, 0, sizeof(listener));
+    return &listener;
+    (void)type;
+}
+
+err_t tcp_bind(struct tcp_pcb *pcb, const ip_addr_t *ipaddr, u16_t port) {
+    return ERR_OK;
+    (void)pcb, (void)ipaddr, (void)port;
+}
+
+struct tcp_pcb *tcp_listen_with_backlog(struct tcp_pcb *pcb, u8_t backlog) {
+    return pcb;
+    (void)backlog;
+}
+
+void tcp_arg(struct tcp_pcb *pcb, void *arg) {
+    pcb->callback_arg = arg;
+}
+
+void tcp_accept(struct tcp_pcb *pcb, tcp_accept_fn accept) {
+    pcb->accept = accept;
+}
+
+void tcp_recv(struct tcp_pcb *pcb, tcp_recv_fn recv) {
+    pcb->recv = recv;
+}
+
+void tcp_sent(struct tcp_pcb *pcb, tcp_sent_fn sent) {
+    pcb->sent = sent;
+}
+
+void tcp_poll(struct tcp_pcb *pcb, tcp_poll_fn poll, u8_t interval) {
+    pcb->poll = poll;
+    (void)interval;
+}
+
+void tcp_err(struct tcp_pcb *pcb, tcp_err_fn err) {
+    pcb->errf = err;
+}
+
+void tcp_recved(struct tcp_pcb *pcb, u16_t len) {
+    pcb->recved += len;
+}
+
+err_t tcp_write(struct tcp_pcb *pcb, const void *dataptr, u16_t len, u8_t apiflags) {
+    Client *client = (Client *)pcb;
+    u32 segments = (len + TCP_MSS - 1) / TCP_MSS;
+    CHECK(!pcb->closed && !pcb->aborted, "the server wrote to a connection it had closed");
+    if (len > pcb->snd_buf || client->numSegments + segments > TCP_SND_QUEUELEN)
+        return ERR_MEM;
+    // Data that isn't copied is sent from where it is later on, which is the same thing here
+    pcb->out = realloc(pcb->out, pcb->outLen + len + 1);
+    memcpy(pcb->out + pcb->outLen, dataptr, len);
+    pcb->outLen += len;
+    pcb->out[pcb->outLen] = '\0'; // So it can be searched as a string
+    pcb->snd_buf -= len;
+    for (u32 done = 0; done < len; done += TCP_MSS)
+        client->segments[client->numSegments++] = (u16)LWIP_MIN(len - done, TCP_MSS);
+    pcb->snd_queuelen = (u16_t)client->numSegments;
+    return ERR_OK;
+    (void)apiflags;
+}
+
+err_t tcp_output(struct tcp_pcb *pcb) {
+    return ERR_OK;
+    (void)pcb;
+}
+
+err_t tcp_close(struct tcp_pcb *pcb) {
+    pcb->closed = true;
+    return ERR_OK;
+}
+
+void tcp_abort(struct tcp_pcb *pcb) {
+    pcb->aborted = true;
+    if (pcb->errf)
+        pcb->errf(pcb->callback_arg, ERR_ABRT);
+}
+
+/* --- The client's side --- */
+
+static bool is_open(const Client *client) {
+    return !client->pcb.closed && !client->pcb.aborted;
+}
+
+static Client *client_connect(err_t *err) {
+    for (u32 i = 0; i < count_of(clients); i++) {
+        Client *client = &clients[i];
+        if (client->used && is_open(client))
+            continue; // Still connected
+        free(client->pcb.out);
+        *client = (Client){.pcb.snd_buf = TCP_SND_BUF, .used = true};
+        *err = listener.accept(listener.callback_arg, &client->pcb, ERR_OK);
+        return client;
+    }
+    CHECK(false, "ran out of clients");
+    return NULL;
+}
+
+/**
+ * Sends data to the server in one go, as a chain of pbufs.
+ * @param client the client
+ * @param data the data to send
+ * @param piece the length of each pbuf in the chain, or 0 for a single pbuf
+ */
+static void send_pieces(Client *client, const char *data, u32 piece) {
+    u32 len = strlen(data);
+    if (piece == 0)
+        piece = len;
+    struct pbuf *chain = NULL;
+    for (u32 pos = 0; pos < len; pos += piece) {
+        u32 n = LWIP_MIN(piece, len - pos);
+        struct pbuf *p = malloc(sizeof(struct pbuf) + n);
+        *p = (struct pbuf){.payload = p + 1, .len = (u16_t)n, .tot_len = (u16_t)n};
+        memcpy(p->payload, data + pos, n);
+        pbufs++;
+        if (chain)
+            pbuf_cat(chain, p);
+        else
+            chain = p;
+    }
+    client->pcb.recv(client->pcb.callback_arg, &client->pcb, chain, ERR_OK);
+}
+
+static void client_send(Client *client, const char *data) {
+    send_pieces(client, data, 0);
+}
+
+// Closes the client's side of the connection
+static void hang_up(Client *client) {
+    if (is_open(client) && client->pcb.recv)
+        client->pcb.recv(client->pcb.callback_arg, &client->pcb, NULL, ERR_OK);
+}
+
+/**
+ * Acknowledges everything the server has written so far (which may have it write more), until it writes nothing more.
+ * @param client the client
+ */
+static void ack_all(Client *client) {
+    while (is_open(client) && client->numSegments > 0) {
+        u32 len = 0;
+        for (u32 i = 0; i < client->numSegments; i++)
+            len += client->segments[i];
+        client->numSegments = 0;
+        client->pcb.snd_queuelen = 0;
+        client->pcb.snd_buf += len;
+        if (client->pcb.sent)
+            client->pcb.sent(client->pcb.callback_arg, &client->pcb, (u16_t)len);
+    }
+}
+
+/**
+ * Reads the next response the server wrote to a client.
+ * @param client the client
+ * @return the response (which isn't complete if the server hasn't finished writing it)
+ */
+static Response next_response(Client *client) {
+    Response res = {.body = body};
+    body[0] = '\0';
+    const char *out = client->pcb.out + client->read, *end = client->pcb.out + client->pcb.outLen;
+    const char *headEnd = client->pcb.out ? strstr(out, "\r\n\r\n") : NULL;
+    if (!headEnd)
+        return res;
+    headEnd += 4;
+    sscanf(out, "HTTP/1.1 %31[^\r]", res.status);
+    char head[1024];
+    snprintf(head, sizeof(head), "%.*s", (int)(headEnd - out), out);
+    res.close = strstr(head, "Connection: close") != NULL;
+    res.chunked = strstr(head, "Transfer-Encoding: chunked") != NULL;
+    const char *p = headEnd;
+    if (res.chunked) {
+        for (;;) {
+            char *lineEnd;
+            unsigned long size = strtoul(p, &lineEnd, 16);
+            if (lineEnd + 2 > end || strncmp(lineEnd, "\r\n", 2) != 0 || lineEnd + 2 + size + 2 > end)
+                return res; // Not all written yet
+            memcpy(body + res.bodyLen, lineEnd + 2, LWIP_MIN(size, BODY_MAX - res.bodyLen));
+            res.bodyLen += LWIP_MIN(size, BODY_MAX - res.bodyLen);
+            p = lineEnd + 2 + size + 2;
+            if (size == 0)
+                break;
+        }
+    } else {
+        const char *length = strstr(head, "Content-Length: ");
+        size_t len = length ? strtoul(length + strlen("Content-Length: "), NULL, 10) : 0;
+        if ((size_t)(end - p) < len)
+            return res;
+        res.bodyLen = LWIP_MIN(len, BODY_MAX);
+        memcpy(body, p, res.bodyLen);
+        p += len;
+    }
+    body[res.bodyLen] = '\0';
+    res.complete = true;
+    client->read = p - client->pcb.out;
+    return res;
+}
+
+// Whether the server has written anything the client hasn't read yet
+static bool unread(const Client *client) {
+    return client->read < client->pcb.outLen;
+}
+
+/* --- A command to answer with --- */
+
+// Answers with {"data":"aaa..."}, as many a's as the request's body asks for
+static i32 run_data(const char *input, JSONWriter *json) {
+    static char data[BODY_MAX];
+    u32 len = input ? strtoul(input, NULL, 10) : 0;
+    if (len >= sizeof(data))
+        return 400;
+    memset(data, 'a', len);
+    data[len] = '\0';
+    jsonw_object_begin(json);
+    jsonw_key_string(json, "data", data);
+    jsonw_object_end(json);
+    return 200;
+}
+
+static const ApiCommand dataCmd = {"TEST_DATA", "", NULL, API_ARGS_REQUIRED, API_MODES_ALL, API_HTTP_POST, run_data};
+
+// A request for it, and the body it should be answered with
+static void data_request(char *buf, u32 size, u32 len, bool close) {
+    char lenStr[16];
+    snprintf(lenStr, sizeof(lenStr), "%lu", (unsigned long)len);
+    snprintf(buf, size, "POST /api/v1/test/data HTTP/1.1\r\nHost: 192.168.4.1\r\n%sContent-Length: %lu\r\n\r\n%s",
+             close ? "Connection: close\r\n" : "", (unsigned long)strlen(lenStr), lenStr);
+}
+
+static bool data_body(const Response *res, u32 len) {
+    static char expected[BODY_MAX + 16];
+    snprintf(expected, sizeof(expected), "{\"data\":\"%0*d\"}", (int)len, 0);
+    memset(expected + strlen("{\"data\":\""), 'a', len);
+    return res->bodyLen == strlen(expected) && strcmp(res->body, expected) == 0;
+}
+
+/* --- Checks --- */
+
+static const char getIndex[] = "GET /index.html HTTP/1.1\r\nHost: 192.168.4.1\r\n\r\n";
+
+// A kept-alive connection answers request after request, until it's been idle for too long
+static void check_keep_alive() {
+    err_t err;
+    Client *client = client_connect(&err);
+    CHECK(err == ERR_OK && client->pcb.recv && client->pcb.sent && client->pcb.poll && client->pcb.errf,
+          "a connection wasn't accepted (%d)", err);
+
+    char req[256];
+    data_request(req, sizeof(req), 16, false);
+    for (u32 i = 0; i < 3; i++) {
+        client_send(client, getIndex);
+        Response res = next_response(client);
+        CHECK(res.complete && strcmp(res.status, "302 Redirect") == 0 && !res.close,
+              "request %lu on a kept-alive connection was answered with \"%s\"%s", (unsigned long)i, res.status,
+              res.close ? ", closing it" : "");
+        CHECK(strstr(client->pcb.out, "Location: http://192.168.4.1/\r\n"), "the redirect doesn't lead to the server");
+        client_send(client, req);
+        res = next_response(client);
+        CHECK(res.complete && strcmp(res.status, "200 OK") == 0 && !res.close && !res.chunked && data_body(&res, 16),
+              "an API request on a kept-alive connection was answered with \"%s\" \"%s\"", res.status, res.body);
+        CHECK(is_open(client), "the connection was closed after request %lu", (unsigned long)i);
+        ack_all(client);
+    }
+    CHECK(client->pcb.recved == 3 * (strlen(getIndex) + strlen(req)), "the receive window was opened by %lu bytes, not %lu",
+          (unsigned long)client->pcb.recved, (unsigned long)(3 * (strlen(getIndex) + strlen(req))));
+
+    // Anything received counts as activity, so only the polls since the last request count towards closing it
+    client->pcb.poll(client->pcb.callback_arg, &client->pcb);
+    CHECK(is_open(client), "the connection was closed after being polled once");
+    client_send(client, getIndex);
+    next_response(client);
+    client->pcb.poll(client->pcb.callback_arg, &client->pcb);
+    CHECK(is_open(client), "a request didn't count as activity");
+    client->pcb.poll(client->pcb.callback_arg, &client->pcb);
+    CHECK(client->pcb.closed, "an idle kept-alive connection wasn't closed");
+    CHECK(!client->pcb.recv && !client->pcb.sent && !client->pcb.poll && !client->pcb.errf,
+          "callbacks were left registered on a closed connection");
+}
+
+// Requests that arrive together are answered in order, however they're split into pbufs
+static void check_pipelining(u32 piece) {
+    char stream[1024], req[256];
+    u32 sizes[] = {10, 0, 1000};
+    stream[0] = '\0';
+    for (u32 i = 0; i < count_of(sizes); i++) {
+        bool last = i == count_of(sizes) - 1;
+        if (sizes[i] == 0) {
+            strcat(stream, getIndex);
+            continue;
+        }
+        data_request(req, sizeof(req), sizes[i], last);
+        strcat(stream, req);
+    }
+
+    err_t err;
+    Client *client = client_connect(&err);
+    send_pieces(client, stream, piece);
+    for (u32 i = 0; i < count_of(sizes); i++) {
+        Response res = next_response(client);
+        bool ok = sizes[i] == 0 ? strcmp(res.status, "302 Redirect") == 0 : data_body(&res, sizes[i]);
+        CHECK(res.complete && ok && res.close == (i == count_of(sizes) - 1),
+              "pipelined request %lu (in %lu byte pieces) was answered with \"%s\" (%lu bytes)%s", (unsigned long)i,
+              (unsigned long)piece, res.status, (unsigned long)res.bodyLen, res.close ? ", closing the connection" : "");
+    }
+    CHECK(!unread(client), "more was written than the pipelined requests were answered with (in %lu byte pieces)",
+          (unsigned long)piece);
+    CHECK(client->pcb.closed && client->pcb.recved == strlen(stream),
+          "after the last pipelined request (in %lu byte pieces), the connection was %s and %lu of %lu bytes were taken in",
+          (unsigned long)piece, client->pcb.closed ? "closed" : "left open", (unsigned long)client->pcb.recved,
+          (unsigned long)strlen(stream));
+    CHECK(pbufs == 0, "%ld pbufs weren't freed", (long)pbufs);
+}
+
+// A response that doesn't fit into the send buffer is sent as it's acknowledged, and holds up the requests behind it
+static void check_pending() {
+    const u32 large = TCP_SND_BUF + 2000;
+    char first[256], second[256], stream[512];
+    data_request(first, sizeof(first), large, false);
+    data_request(second, sizeof(second), 8, false);
+    snprintf(stream, sizeof(stream), "%s%s", first, second);
+
+    err_t err;
+    Client *client = client_connect(&err);
+    client_send(client, stream);
+    Response res = next_response(client);
+    CHECK(!res.complete && client->pcb.snd_buf < TCP_MSS,
+          "a response larger than the send buffer wasn't held back (%lu bytes written, %u free)",
+          (unsigned long)client->pcb.outLen, client->pcb.snd_buf);
+    CHECK(client->pcb.recved == strlen(first), "the request behind a held back response was taken in (%lu of %lu bytes)",
+          (unsigned long)client->pcb.recved, (unsigned long)strlen(stream));
+
+    // Polls retry what's held back too, but there's no room until something's acknowledged
+    client->pcb.poll(client->pcb.callback_arg, &client->pcb);
+    CHECK(is_open(client), "a connection with a response held back was closed when polled");
+    ack_all(client);
+    res = next_response(client);
+    CHECK(res.complete && res.chunked && strcmp(res.status, "200 OK") == 0 && data_body(&res, large),
+          "the held back response was \"%s\" with %lu bytes, expected %lu", res.status, (unsigned long)res.bodyLen,
+          (unsigned long)(large + strlen("{\"data\":\"\"}")));
+    res = next_response(client);
+    CHECK(res.complete && data_body(&res, 8), "the request behind a held back response was answered with \"%s\" \"%s\"",
+          res.status, res.body);
+    CHECK(is_open(client) && client->pcb.recved == strlen(stream), "the connection wasn't left open for more requests");
+
+    // One that doesn't fit into what may be held back either can't be sent in full, so the connection is closed
+    const u32 tooLarge = BODY_MAX - 64;
+    data_request(first, sizeof(first), tooLarge, false);
+    client_send(client, first);
+    ack_all(client);
+    res = next_response(client);
+    CHECK(!res.complete && client->pcb.closed, "a response too large to be held back was %s and the connection %s",
+          res.complete ? "complete" : "cut short", client->pcb.closed ? "closed" : "left open");
+    CHECK(pbufs == 0, "%ld pbufs weren't freed", (long)pbufs);
+}
+
+// Connections beyond the pool are turned away, until one of those in it closes
+static void check_pool() {
+    Client *open[TCP_CONNECTIONS_MAX];
+    err_t err;
+    for (u32 i = 0; i < count_of(open); i++) {
+        open[i] = client_connect(&err);
+        CHECK(err == ERR_OK && is_open(open[i]), "connection %lu of %u wasn't accepted (%d)", (unsigned long)i + 1,
+              TCP_CONNECTIONS_MAX, err);
+    }
+    Client *extra = client_connect(&err);
+    CHECK(err == ERR_ABRT && extra->pcb.aborted && !extra->pcb.recv, "a connection beyond the pool was accepted (%d)", err);
+
+    // The ones in the pool are unaffected
+    client_send(open[0], getIndex);
+    Response res = next_response(open[0]);
+    CHECK(res.complete && strcmp(res.status, "302 Redirect") == 0, "a connection in a full pool wasn't answered");
+
+    hang_up(open[1]);
+    CHECK(open[1]->pcb.closed, "a connection the client closed wasn't closed");
+    extra = client_connect(&err);
+    CHECK(err == ERR_OK && is_open(extra), "a connection wasn't accepted after one in the pool was closed (%d)", err);
+    client_send(extra, getIndex);
+    res = next_response(extra);
+    CHECK(res.complete && strcmp(res.status, "302 Redirect") == 0, "a connection that took a freed slot wasn't answered");
+
+    // A connection lwIP drops (e.g. reset by the client) frees its slot too
+    open[2]->pcb.errf(open[2]->pcb.callback_arg, ERR_RST);
+    open[2]->pcb.closed = true;
+    extra = client_connect(&err);
+    CHECK(err == ERR_OK && is_open(extra), "a connection wasn't accepted after one in the pool was reset (%d)", err);
+
+    for (u32 i = 0; i < count_of(clients); i++)
+        hang_up(&clients[i]);
+    for (u32 i = 0; i < count_of(open); i++) {
+        open[i] = client_connect(&err);
+        CHECK(err == ERR_OK, "connection %lu of %u wasn't accepted once all were closed (%d)", (unsigned long)i + 1,
+              TCP_CONNECTIONS_MAX, err);
+    }
+    for (u32 i = 0; i < count_of(clients); i++)
+        hang_up(&clients[i]);
+}
+
+int main() {
+    api_register(&dataCmd);
+    TCPServer server;
+    ip_addr_t ip = {192 | 168 << 8 | 4 << 16 | 1 << 24};
+    CHECK(tcp_server_open(&server, &ip, 80) && listener.accept, "the server couldn't be opened");
+    if (testFailures > 0)
+        return test_result();
+
+    check_keep_alive();
+    u32 pieces[] = {0, 1, 7, 100};
+    for (u32 i = 0; i < count_of(pieces); i++)
+        check_pipelining(pieces[i]);
+    check_pending();
+    check_pool();
+
+    CHECK(tcp_server_close(&server), "the server couldn't be closed");
+    for (u32 i = 0; i < count_of(clients); i++)
+        free(clients[i].pcb.out);
+    return test_result();
+}
@@ -0,0 +1,73 @@
+set(FBW_TESTS OFF CACHE BOOL "Build host tests and benchmarks")
+
+if (NOT FBW_TESTS)
+    message("Tests will not be built (disabled)")
+    return()
+endif()
+
+if (NOT FBW_PLATFORM STREQUAL "host")
+    message(WARNING "FBW_TESTS was selected but tests can only be built for the host platform")
+    return()
+endif()
+
+enable_testing()
+
+# Adds a test built from test/<name>.c, linked against the same libraries as the firmware, and runs it as part of ctest.
+# Tests are labelled with their kind, so e.g. only the benchmarks can be run with `ctest -L bench`.
+function(add_fbw_test name label)
+    add_executable(${name} ${CMAKE_SOURCE_DIR}/test/${name}.c)
+    target_include_directories(${name} PRIVATE ${CMAKE_SOURCE_DIR} ${CMAKE_SOURCE_DIR}/src)
+    target_link_libraries(${name} fbw_io fbw_modes fbw_sys fbw_api platform_host fbw_lib)
+    add_test(NAME ${name} COMMAND ${name} WORKING_DIRECTORY ${CMAKE_SOURCE_DIR}/test)
+    set_tests_properties(${name} PROPERTIES LABELS ${label})
+endfunction()
+
+add_fbw_test(auto_test test)
+# The same circuit again, in a 5 m/s wind across its first and last sides
+add_test(NAME auto_test_crosswind COMMAND auto_test 5,270 WORKING_DIRECTORY ${CMAKE_SOURCE_DIR}/test)
+set_tests_properties(auto_test_crosswind PROPERTIES LABELS test)
+# Replays recorded IMU FIFO reads by wrapping i2c_read() and time_us(), which needs GNU ld
+if (CMAKE_SYSTEM_NAME STREQUAL "Linux")
+    add_fbw_test(fifo_test test)
+    target_link_options(fifo_test PRIVATE -Wl,--wrap=i2c_read,--wrap=time_us)
+endif()
+add_fbw_test(fusion_bench bench)
+add_fbw_test(gps_bench bench)
+add_fbw_test(http_test test)
+add_fbw_test(jsonwriter_bench bench)
+# Allocations are counted by wrapping the allocator, which needs GNU ld
+if (CMAKE_SYSTEM_NAME STREQUAL "Linux")
+    target_link_options(jsonwriter_bench PRIVATE -Wl,--wrap=malloc,--wrap=calloc,--wrap=realloc)
+    target_compile_definitions(jsonwriter_bench PRIVATE COUNT_ALLOCATIONS=1)
+endif()
+add_fbw_test(nav_bench bench)
+add_fbw_test(scheduler_test test)
+# The Pico's web server (platform/pico/wifi/tcp.c), built against a stand-in for lwIP (test/shim); the host only builds its
+# Wi-Fi code on Linux (see platform/host/defs.h)
+if (CMAKE_SYSTEM_NAME STREQUAL "Linux")
+    add_fbw_test(tcp_test test)
+    target_sources(tcp_test PRIVATE ${CMAKE_SOURCE_DIR}/platform/pico/wifi/tcp.c)
+    target_include_directories(tcp_test BEFORE PRIVATE ${CMAKE_SOURCE_DIR}/test/shim)
+    # The API commands it pulls in go round the libraries' cycle (io, modes, sys, api) once more than anything else does
+    set_property(TARGET fbw_api PROPERTY LINK_INTERFACE_MULTIPLICITY 3)
+endif()
+
+# These tests run the firmware itself (through stdbuf, so on Linux) and are driven from Python
+if (CMAKE_SYSTEM_NAME STREQUAL "Linux")
+    find_package(Python3 COMPONENTS Interpreter)
+endif()
+if (Python3_FOUND)
+    # Flies a flight plan in the simulator (test/sitl_flight.py)
+    add_test(NAME sitl_flight
+        COMMAND ${Python3_EXECUTABLE} ${CMAKE_SOURCE_DIR}/test/sitl_flight.py --binary $<TARGET_FILE:${PROJECT_NAME}>)
+    set_tests_properties(sitl_flight PROPERTIES LABELS test)
+    # The web server's load test (test/http_load.py) needs the web interface image, and Linux for the server (see
+    # platform/host/defs.h)
+    if (FBW_BUILD_WWW)
+        add_test(NAME http_load
+            COMMAND ${Python3_EXECUTABLE} ${CMAKE_SOURCE_DIR}/test/http_load.py --binary $<TARGET_FILE:${PROJECT_NAME}> --duration 5)
+        set_tests_properties(http_load PROPERTIES LABELS bench)
+    endif()
+endif()
+
+message("Tests will be built (run them with ctest)")
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <time.h>
+#if defined(__x86_64__) || defined(__i386__)
+    #include <x86intrin.h>
+#endif
+#include "platform/types.h"
+
+// Minimal helpers shared by the host tests and benchmarks in this directory (see test.cmake).
+// Each test is a single source file whose main() runs its checks and returns `test_result()`, so it can be run by ctest.
+
+static u32 testChecks = 0;
+static u32 testFailures = 0;
+
+/**
+ * Checks a condition, printing the message (printf-style) and counting a failure if it doesn't hold.
+ */
+#define CHECK(cond, ...)                                                                                                       \
+    do {                                                                                                                       \
+        testChecks++;                                                                                                          \
+        if (!(cond)) {                                                                                                         \
+            testFailures++;                                                                                                    \
+            printf("FAIL %s:%d: ", __FILE__, __LINE__);                                                                        \
+            printf(__VA_ARGS__);                                                                                               \
+            printf("\n");                                                                                                      \
+        }                                                                                                                      \
+    } while (0)
+
+/**
+ * Prints a summary of the checks that were made.
+ * @return the exit code of the test (0 if every check passed)
+ */
+static inline int test_result() {
+    printf("%u checks, %u failed\n", testChecks, testFailures);
+    return testFailures == 0 ? 0 : 1;
+}
+
+/**
+ * @return a monotonic time in nanoseconds, for timing benchmarks
+ */
+static inline u64 bench_ns() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (u64)ts.tv_sec * 1000000000 + (u64)ts.tv_nsec;
+}
+
+/**
+ * @return the CPU's timestamp counter where there is one that can be read (x86), otherwise 0
+ * @note Like all host timings, these are only good for comparing one build (or implementation) against another.
+ */
+static inline u64 bench_cycles() {
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return 0;
+#endif
+}
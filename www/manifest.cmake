@@ -0,0 +1,76 @@
+# Generates the manifest of the built web interface, which the web servers load at boot to serve files without probing the
+# filesystem for them (see platform/common/www.h).
+# Run as a script: cmake -DWWW_DIR=<directory the web interface was built into> -P manifest.cmake
+#
+# Each line of the manifest describes one file, with tab-separated fields:
+#   <path> <gzipped (0/1)> <content type> <size> <hash> <immutable (0/1)>
+# where <path> is the path the file is requested at (without any .gz extension), <size> is the size of the file as stored,
+# and <hash> is the start of the SHA-256 of the file as stored (used as its ETag).
+
+if (NOT DEFINED WWW_DIR)
+    message(FATAL_ERROR "WWW_DIR must be defined")
+endif()
+
+set(WWW_TYPES
+    html text/html
+    htm text/html
+    css text/css
+    txt text/plain
+    js application/javascript
+    json application/json
+    png image/png
+    gif image/gif
+    jpg image/jpeg
+    ico image/x-icon
+    svg image/svg+xml
+    ttf application/x-font-ttf
+    otf application/x-font-opentype
+    woff application/font-woff
+    woff2 application/font-woff2
+    eot application/vnd.ms-fontobject
+    sfnt application/font-sfnt
+    xml text/xml
+    pdf application/pdf
+    zip application/zip
+    appcache text/cache-manifest
+)
+# Vite names assets "<name>-<8 character hash>.<ext>", so their contents never change under the same name
+set(HASH_CHAR "[A-Za-z0-9_-]")
+set(HASHED_REGEX "^/assets/.+-${HASH_CHAR}${HASH_CHAR}${HASH_CHAR}${HASH_CHAR}${HASH_CHAR}${HASH_CHAR}${HASH_CHAR}${HASH_CHAR}\\.[A-Za-z0-9]+$")
+
+set(MANIFEST "")
+file(GLOB_RECURSE FILES RELATIVE ${WWW_DIR}/www ${WWW_DIR}/www/*)
+foreach(FILE ${FILES})
+    set(PATH "/${FILE}")
+    set(GZIPPED 0)
+    if (PATH MATCHES "\\.gz$")
+        string(REGEX REPLACE "\\.gz$" "" PATH "${PATH}")
+        set(GZIPPED 1)
+    endif()
+
+    set(TYPE application/octet-stream)
+    string(REGEX MATCH "[^.]+$" EXT "${PATH}")
+    string(TOLOWER "${EXT}" EXT)
+    list(FIND WWW_TYPES "${EXT}" INDEX)
+    if (INDEX GREATER_EQUAL 0)
+        math(EXPR INDEX "${INDEX} + 1")
+        list(GET WWW_TYPES ${INDEX} TYPE)
+    endif()
+
+    file(READ ${WWW_DIR}/www/${FILE} CONTENT HEX) # file(SIZE) needs CMake 3.14
+    string(LENGTH "${CONTENT}" SIZE)
+    math(EXPR SIZE "${SIZE} / 2")
+    file(SHA256 ${WWW_DIR}/www/${FILE} HASH)
+    string(SUBSTRING "${HASH}" 0 16 HASH)
+
+    set(IMMUTABLE 0)
+    if (PATH MATCHES "${HASHED_REGEX}")
+        set(IMMUTABLE 1)
+    endif()
+
+    string(APPEND MANIFEST "${PATH}\t${GZIPPED}\t${TYPE}\t${SIZE}\t${HASH}\t${IMMUTABLE}\n")
+endforeach()
+
+file(WRITE ${WWW_DIR}/manifest "${MANIFEST}")
+list(LENGTH FILES NUM_FILES)
+message("Generated web interface manifest (${NUM_FILES} files)")
@@ -339,12 +339,37 @@ const config: ConfigDatabase = {
             enumMap: {
                 0: "GPS Disabled",
                 1: "MTK",
+                2: "u-blox (UBX)",
             },
         },
         {
             name: "GPS Baudrate",
             id: "gpsBaudrate",
-            desc: "The baudrate of the GPS. Almost all GPS modules use either 4600 or 9600 baud rates with 9600 being more common. Check the documentation of your GPS module and find its baudrate if you are experiencing communication issues.",
+            desc: "The baudrate of the GPS. Almost all GPS modules use either 4600 or 9600 baud rates with 9600 being more common. u-blox modules send fixes at 10Hz with a baudrate of 38400 or higher, and at 5Hz otherwise. Check the documentation of your GPS module and find its baudrate if you are experiencing communication issues.",
+        },
+        {
+            name: "Fusion Rate",
+            id: "fusionRate",
+            desc: "The rate at which IMU samples are fused into the attitude estimate, in Hz (between 50 and 1000). The IMU's sample rate is set to match. Faster airframes benefit from higher rates, at the cost of more CPU time and I2C bus usage. The default is 100 Hz.",
+        },
+        {
+            name: "Estimator",
+            id: "estimator",
+            desc: "The algorithm used to estimate the aircraft's attitude. Madgwick is lightweight and estimates attitude only. The EKF (extended Kalman filter) also fuses the magnetometer and GPS to estimate position and altitude, at the cost of more CPU time.",
+            enumMap: {
+                0: "Madgwick",
+                1: "EKF",
+            },
+        },
+        {
+            name: "GPS Latency",
+            id: "gpsLatency",
+            desc: "How long it takes for a GPS fix to arrive after it was measured, in milliseconds (up to 500). Navigation makes up for this delay, so setting it to match your GPS module keeps the autopilot's position from lagging behind. The default of 100ms suits most modules.",
+        },
+        {
+            name: "Dead Reckoning Time",
+            id: "deadReckonTime",
+            desc: "How long, in seconds (up to 120), that auto and hold modes keep navigating on dead reckoning if the GPS is lost, before falling back to normal mode. Set to 0 to fall back to normal mode straight away.",
         },
     ],
 
@@ -416,6 +441,20 @@ const config: ConfigDatabase = {
                 1: "Enabled",
             },
         },
+        {
+            name: "Flight Data Recorder Rate",
+            id: "recorderRate",
+            desc: "The rate at which flight data (attitude, GPS, setpoints, PID terms, and outputs) is recorded to flash while flying, in Hz (up to 100). Recordings are kept in the `fdr` folder, oldest first to be replaced. Set to 0 to disable the recorder. The default is 25 Hz.",
+        },
+        {
+            name: "Save Logs",
+            id: "saveLogs",
+            desc: "Saves warnings and errors to flash (in `log.bin` and `log.1.bin`), so they can still be read after a reboot. Up to the 64 most recent are kept.",
+            enumMap: {
+                0: "Disabled",
+                1: "Enabled",
+            },
+        },
     ],
 };
 
@@ -53,7 +53,7 @@ ExternalProject_Add(mklittlefs
     COMMENT "Building mklittlefs"
 )
 
-# Add a target to build the web interface
+# Add a target to build the web interface, along with its manifest (see www/manifest.cmake)
 # It depends on all files in the www directory, so it will only rebuild if any of those files change
 file(GLOB_RECURSE WWW_FILES ${PROJECT_SOURCE_DIR}/www/*)
 if (NOT CMAKE_HOST_WIN32)
@@ -62,6 +62,7 @@ if (NOT CMAKE_HOST_WIN32)
         # This command will also output an empty file whose modify timestamp can be used to check if/when the web interface has been built
         OUTPUT ${CMAKE_BINARY_DIR}/generated/www/built
         COMMAND ${PROJECT_SOURCE_DIR}/www/www.sh ${PROJECT_SOURCE_DIR}/www ${YARN_EXE}
+        COMMAND ${CMAKE_COMMAND} -DWWW_DIR=${CMAKE_BINARY_DIR}/www -P ${PROJECT_SOURCE_DIR}/www/manifest.cmake
         COMMAND ${CMAKE_COMMAND} -E make_directory ${CMAKE_BINARY_DIR}/generated/www
         COMMAND ${CMAKE_COMMAND} -E touch ${CMAKE_BINARY_DIR}/generated/www/built
         WORKING_DIRECTORY ${PROJECT_SOURCE_DIR}/www
@@ -74,6 +75,7 @@ else()
     add_custom_command(
         OUTPUT ${CMAKE_BINARY_DIR}/generated/www/built
         COMMAND ${YARN_EXE} install && ${YARN_EXE} build # nvm doesn't exist on windows so just attempt to run directly
+        COMMAND ${CMAKE_COMMAND} -DWWW_DIR=${CMAKE_BINARY_DIR}/www -P ${PROJECT_SOURCE_DIR}/www/manifest.cmake
         COMMAND ${CMAKE_COMMAND} -E make_directory ${CMAKE_BINARY_DIR}/generated/www
         COMMAND ${CMAKE_COMMAND} -E touch ${CMAKE_BINARY_DIR}/generated/www/built
         WORKING_DIRECTORY ${PROJECT_SOURCE_DIR}/www